@@ -0,0 +1,423 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include "acquisitionworker.h"
+#include "diagnostics.h"
+#include "usbhotplugmonitor.h"
+
+static bool sameChargeInfo(const b6::ChargeInfo &a, const b6::ChargeInfo &b) {
+    if (a.state != b.state || a.time != b.time || a.current != b.current || a.voltage != b.voltage ||
+            a.capacity != b.capacity || a.tempInt != b.tempInt || a.tempExt != b.tempExt) {
+        return false;
+    }
+    for (int i = 0; i < 8; i++) {
+        if (a.cells[i] != b.cells[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+AcquisitionWorker::AcquisitionWorker(const QString &location, const QString &deviceSpec, QObject *parent) :
+        QObject(parent), m_location(location), m_deviceSpec(deviceSpec) {
+    m_notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    qRegisterMetaType<DeviceInfo>();
+    qRegisterMetaType<b6::SysInfo>();
+    qRegisterMetaType<b6::ChargeProfile>();
+    qRegisterMetaType<b6::ChargeInfo>();
+    qRegisterMetaType<b6::BATTERY_TYPE>();
+}
+
+AcquisitionWorker::~AcquisitionWorker() {
+    delete m_dev;
+    if (m_ctx != nullptr) {
+        libusb_exit(m_ctx);
+    }
+    if (m_notifyFd >= 0) {
+        close(m_notifyFd);
+    }
+}
+
+void AcquisitionWorker::acknowledge() {
+    eventfd_t value;
+    eventfd_read(m_notifyFd, &value);
+}
+
+void AcquisitionWorker::start() {
+    if (libusb_init(&m_ctx) != LIBUSB_SUCCESS) {
+        m_ctx = nullptr;
+    }
+
+    m_timer = new QTimer(this);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(onTimer()));
+
+    m_attachTimer = new QTimer(this);
+    connect(m_attachTimer, SIGNAL(timeout()), this, SLOT(onAttachRetry()));
+
+    m_logTimer = new QTimer(this);
+    connect(m_logTimer, SIGNAL(timeout()), this, SLOT(onLogTimer()));
+}
+
+QString AcquisitionWorker::logDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/sessions";
+}
+
+QString AcquisitionWorker::lastLog(const QString &location) {
+    // names start with the location and end with the start time, so the last one sorts last
+    QStringList logs = QDir(logDirectory()).entryList(QStringList(location + "_*.cglog"), QDir::Files, QDir::Name);
+    return logs.isEmpty() ? QString() : logDirectory() + "/" + logs.last();
+}
+
+void AcquisitionWorker::onTimer() {
+    static LatencyHistogram &lateness = Diagnostics::histogram("worker.pollLateness");
+    static std::atomic<uint64_t> &late = Diagnostics::counter("samples.late");
+
+    // how far behind its schedule the event loop got to this poll
+    if (m_pollClock.isValid()) {
+        const qint64 behind = m_pollClock.nsecsElapsed() - m_timer->interval() * 1000000LL;
+        lateness.record(static_cast<uint64_t>(std::max<qint64>(behind, 0)));
+        if (behind > m_timer->interval() * 500000LL) {
+            late.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    m_pollClock.start();
+
+    if (m_dev != nullptr) {
+        m_readChargeInfo();
+    }
+}
+
+void AcquisitionWorker::attach() {
+    if (m_dev != nullptr) {
+        return;
+    }
+
+    m_attachElapsed.start();
+    m_attachAttempts = 0;
+    m_attachTimer->start(std::chrono::milliseconds(ATTACH_RETRY_MS));
+    onAttachRetry();
+}
+
+void AcquisitionWorker::onAttachRetry() {
+    // the MCU takes a moment to bring its interface up after enumeration
+    if (m_createDevice()) {
+        m_attachTimer->stop();
+        const int interval = m_sampling.intervalMs();
+        m_timer->setTimerType(interval < 1000 ? Qt::PreciseTimer : Qt::CoarseTimer);
+        m_timer->start(std::chrono::milliseconds(interval));
+        m_reportedSustainableMs = m_sampling.sustainableMs();
+        emit samplingChanged(interval, m_reportedSustainableMs);
+    } else if (!m_deviceSpec.isEmpty() || ++m_attachAttempts >= ATTACH_MAX_ATTEMPTS) {
+        // a virtual charger is there right away or not at all
+        m_attachTimer->stop();
+    }
+}
+
+void AcquisitionWorker::detach() {
+    m_attachTimer->stop();
+    m_timer->stop();
+    m_pollClock.invalidate();
+    if (m_dev == nullptr) {
+        return;
+    }
+
+    delete m_dev;
+    m_dev = nullptr;
+    m_hasLastInfo = false;
+    // the charge may go on without us, leave the log open so it can be resumed
+    m_logTimer->stop();
+    m_log.close();
+    emit deviceDisconnected();
+}
+
+void AcquisitionWorker::loadSysInfo() {
+    if (m_dev == nullptr) {
+        return;
+    }
+
+    static LatencyHistogram &readTime = Diagnostics::histogram("device.getSysInfo");
+    try {
+        LatencyHistogram::Scope timing(readTime);
+        emit sysInfoLoaded(m_dev->getSysInfo());
+    } catch (std::exception& e) {
+
+    }
+}
+
+void AcquisitionWorker::saveSysInfo(b6::SysInfo info) {
+    if (m_dev == nullptr) {
+        return;
+    }
+
+    static LatencyHistogram &writeTime = Diagnostics::histogram("device.saveSysInfo");
+    try {
+        LatencyHistogram::Scope timing(writeTime);
+        m_dev->setTimeLimit(info.timeLimitOn, info.timeLimit);
+        m_dev->setCapacityLimit(info.capLimitOn, info.capLimit);
+        m_dev->setTempLimit(info.tempLimit);
+        m_dev->setCycleTime(info.cycleTime);
+        m_dev->setBuzzers(info.systemBuzzer, info.keyBuzzer);
+    } catch (std::exception& e) {
+
+    }
+}
+
+void AcquisitionWorker::startCharging(b6::BATTERY_TYPE battType, b6::ChargeProfile settings) {
+    if (m_dev == nullptr) {
+        return;
+    }
+
+    static LatencyHistogram &commandTime = Diagnostics::histogram("device.command");
+    try {
+        LatencyHistogram::Scope timing(commandTime);
+        b6::ChargeProfile profile = m_dev->getDefaultChargeProfile(battType);
+        profile.mode = settings.mode;
+        profile.cellCount = settings.cellCount;
+        profile.chargeCurrent = settings.chargeCurrent;
+        profile.dischargeCurrent = settings.dischargeCurrent;
+        profile.cellDischargeVoltage = settings.cellDischargeVoltage;
+        profile.endVoltage = settings.endVoltage;
+        profile.rPeakCount = settings.rPeakCount;
+        profile.cycleCount = settings.cycleCount;
+
+        m_dev->startCharging(profile);
+        if (!m_timer->isActive()) {
+            m_timer->start(std::chrono::milliseconds(m_sampling.intervalMs()));
+        }
+        emit chargingStarted();
+    } catch (std::exception& e) {
+
+    }
+}
+
+void AcquisitionWorker::stopCharging() {
+    if (m_dev == nullptr) {
+        return;
+    }
+
+    static LatencyHistogram &commandTime = Diagnostics::histogram("device.command");
+    try {
+        LatencyHistogram::Scope timing(commandTime);
+        m_dev->stopCharging();
+        emit chargingStopped();
+    } catch (std::exception& e) {
+
+    }
+}
+
+bool AcquisitionWorker::m_createDevice() {
+    try {
+        m_dev = m_deviceSpec.isEmpty() ? m_openUsbDevice() : ChargerDevice::fromSpec(m_deviceSpec.toStdString());
+        if (m_dev == nullptr) {
+            return false;
+        }
+
+        DeviceInfo info;
+        info.coreType = QString::fromStdString(m_dev->getCoreType());
+        info.hwVersion = m_dev->getHWVersion();
+        info.swVersion = m_dev->getSWVersion();
+        info.cellCount = m_dev->getCellCount();
+        m_cellCount = info.cellCount;
+        m_sampling.reset(m_dev->pollIntervalMs(), m_dev->minPollIntervalMs());
+        m_sampleClock.reset();
+        m_reportedSustainableMs = 0;
+        if (!m_hostClock.isValid()) {
+            m_hostClock.start();
+        }
+        // read times differ between firmwares, keep them apart
+        m_modelReadTime = &Diagnostics::histogram("device.getChargeInfo." + info.coreType.toStdString());
+        if (m_attachElapsed.isValid()) {
+            info.attachToReadyMs = m_attachElapsed.elapsed();
+            m_attachElapsed.invalidate();
+        }
+        emit deviceConnected(info);
+
+        loadSysInfo();
+        m_readChargeInfo();
+        return true;
+    } catch (std::exception& e) {
+        if (!m_deviceSpec.isEmpty()) {
+            qWarning("%s: %s", qPrintable(m_location), e.what());
+        }
+        delete m_dev;
+        m_dev = nullptr;
+        return false;
+    }
+}
+
+ChargerDevice *AcquisitionWorker::m_openUsbDevice() {
+    if (m_ctx == nullptr) {
+        return nullptr;
+    }
+
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(m_ctx, &list);
+    if (count < 0) {
+        return nullptr;
+    }
+
+    ChargerDevice *dev = nullptr;
+    try {
+        libusb_device *usbDev = UsbHotplugMonitor::findDevice(list, count, m_location);
+        if (usbDev != nullptr) {
+            dev = new B6ChargerDevice(usbDev);
+        }
+    } catch (std::runtime_error& e) {
+
+    }
+    libusb_free_device_list(list, 1);
+    return dev;
+}
+
+void AcquisitionWorker::m_readChargeInfo() {
+    static LatencyHistogram &readTime = Diagnostics::histogram("device.getChargeInfo");
+    static std::atomic<uint64_t> &failed = Diagnostics::counter("device.readFailed");
+
+    try {
+        QElapsedTimer timing;
+        timing.start();
+        const b6::ChargeInfo info = m_dev->getChargeInfo();
+        const uint64_t elapsed = static_cast<uint64_t>(timing.nsecsElapsed());
+        readTime.record(elapsed);
+        m_modelReadTime->record(elapsed);
+        m_sampling.recordRead(elapsed);
+        m_publish(info);
+        if (!m_dev->hasMoreSamples()) {
+            // a recording played to its end, startCharging() polls it again
+            m_timer->stop();
+            m_pollClock.invalidate();
+        }
+    } catch (b6::ChargingError& e) {
+        emit chargingError(QString::fromStdString(e.message()));
+    } catch (ChargerError& e) {
+        emit chargingError(QString::fromUtf8(e.what()));
+    } catch (std::exception& e) {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        emit readFailed();
+    }
+}
+
+void AcquisitionWorker::m_publish(const b6::ChargeInfo &info) {
+    // the charger is polled, so most idle reports are repeats - only wake the GUI for new data
+    if (m_hasLastInfo && sameChargeInfo(info, m_lastInfo)) {
+        return;
+    }
+
+    // the charger counts seconds, a jump of more than one while charging means we never saw a sample
+    static std::atomic<uint64_t> &missed = Diagnostics::counter("samples.missed");
+    const uint8_t charging = static_cast<uint8_t>(b6::STATE::CHARGING);
+    if (m_hasLastInfo && info.state == charging && m_lastInfo.state == charging && info.time > m_lastInfo.time + 1) {
+        missed.fetch_add(static_cast<uint64_t>(info.time - m_lastInfo.time - 1), std::memory_order_relaxed);
+    }
+    m_lastInfo = info;
+    m_hasLastInfo = true;
+
+    Sample sample;
+    sample.info = info;
+    const int64_t deviceMs = m_dev->sampleTimeMs();
+    sample.timeMs = deviceMs >= 0 ? static_cast<uint32_t>(deviceMs) : m_sampleClock.stamp(info.time, m_hostClock.elapsed());
+    m_updateSampling(sample);
+    m_logSample(sample);
+
+    if (!m_queue.push(sample)) {
+        static std::atomic<uint64_t> &dropped = Diagnostics::counter("samples.dropped");
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    eventfd_write(m_notifyFd, 1);
+}
+
+void AcquisitionWorker::m_updateSampling(const Sample &sample) {
+    const int before = m_sampling.intervalMs();
+    const int interval = m_sampling.update(sample.timeMs, sample.info);
+    if (!m_timer->isActive()) {
+        return;
+    }
+
+    // the measured limit moves a little with every read, only its arrival is news
+    const bool measured = m_reportedSustainableMs == 0 && m_sampling.sustainableMs() > 0;
+    if (interval != before) {
+        static std::atomic<uint64_t> &switches = Diagnostics::counter("sampling.switches");
+        switches.fetch_add(1, std::memory_order_relaxed);
+        m_timer->setTimerType(interval < 1000 ? Qt::PreciseTimer : Qt::CoarseTimer);
+        m_timer->setInterval(interval);
+    } else if (!measured) {
+        return;
+    }
+    m_reportedSustainableMs = m_sampling.sustainableMs();
+    emit samplingChanged(interval, m_reportedSustainableMs);
+}
+
+void AcquisitionWorker::m_logSample(const Sample &sample) {
+    if (!m_deviceSpec.isEmpty()) {
+        return;
+    }
+
+    const b6::ChargeInfo &info = sample.info;
+    const bool charging = info.state == static_cast<uint8_t>(b6::STATE::CHARGING);
+    if (charging && !m_log.isOpen() && !m_openLog(sample)) {
+        return;
+    }
+    if (!m_log.isOpen()) {
+        return;
+    }
+
+    m_log.append(SessionLog::makeRecord(sample.timeMs, info));
+    if (!charging) {
+        // the last record carries the state the charge ended in
+        m_logTimer->stop();
+        m_log.finish();
+    } else if (m_log.pending() >= LOG_BATCH) {
+        m_log.flush(false);
+    }
+}
+
+bool AcquisitionWorker::m_openLog(const Sample &sample) {
+    // after a crash or an unplug the charger may still be on the same charge, keep appending to it
+    QString last = lastLog(m_location);
+    if (!last.isEmpty() && m_log.resume(last.toStdString())) {
+        const SessionLog::Record *record = m_log.lastRecord();
+        if (record != nullptr && record->timeMs <= sample.timeMs) {
+            m_logTimer->start(LOG_FLUSH_MS);
+            return true;
+        }
+        m_log.finish();
+    }
+
+    QDir().mkpath(logDirectory());
+    QString path = QString("%1/%2_%3.cglog").arg(logDirectory(), m_location,
+                                                 QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    if (!m_log.create(path.toStdString(), m_cellCount, QDateTime::currentMSecsSinceEpoch())) {
+        return false;
+    }
+    m_logTimer->start(LOG_FLUSH_MS);
+    return true;
+}
+
+void AcquisitionWorker::onLogTimer() {
+    static LatencyHistogram &flushTime = Diagnostics::histogram("log.flush");
+    LatencyHistogram::Scope timing(flushTime);
+    m_log.flush(true);
+}
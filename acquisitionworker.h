@@ -0,0 +1,153 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACQUISITIONWORKER_H
+#define ACQUISITIONWORKER_H
+
+#include <atomic>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <b6/Device.hh>
+#include <libusb.h>
+#include "chargerdevice.h"
+#include "ringbuffer.h"
+#include "samplingpolicy.h"
+#include "sessionlog.h"
+
+class LatencyHistogram;
+
+struct DeviceInfo {
+    QString coreType;
+    double hwVersion = 0.0;
+    double swVersion = 0.0;
+    int cellCount = 0;
+    qint64 attachToReadyMs = -1; // time from USB arrival until the charger answered, -1 if unknown
+};
+
+Q_DECLARE_METATYPE(DeviceInfo)
+Q_DECLARE_METATYPE(b6::BATTERY_TYPE)
+Q_DECLARE_METATYPE(b6::CHARGING_MODE_LI)
+Q_DECLARE_METATYPE(b6::CHARGING_MODE_NI)
+Q_DECLARE_METATYPE(b6::CHARGING_MODE_PB)
+Q_DECLARE_METATYPE(b6::SysInfo)
+Q_DECLARE_METATYPE(b6::ChargeProfile)
+Q_DECLARE_METATYPE(b6::ChargeInfo)
+
+/*
+ * Owns the charger plugged in at one USB location, or the virtual one described
+ * by a device spec (see ChargerDevice::fromSpec()), and performs all of its
+ * I/O on its own thread, so a stalled charger never delays another. Charge info
+ * samples are handed to the GUI through queue(), stamped with the charge time
+ * in ms (see SampleClock), everything else through
+ * queued signals/slots. notifyFd() becomes readable whenever new samples have
+ * been queued, so the consumer can watch it with a QSocketNotifier.
+ *
+ * While a USB charger reports a charge in progress every new sample is also
+ * appended to a session log under logDirectory(), flushed in batches from
+ * this thread. Virtual chargers keep no log: their locations repeat from run
+ * to run and their charges are not real ones.
+ *
+ * The charger is polled at the interval its SamplingPolicy asks for, which may
+ * change with every sample; samplingChanged() reports it.
+ */
+class AcquisitionWorker : public QObject {
+    Q_OBJECT
+public:
+    struct Sample {
+        uint32_t timeMs;            // charge time
+        b6::ChargeInfo info;
+    };
+    typedef RingBuffer<Sample, 256> Queue;
+
+    explicit AcquisitionWorker(const QString &location, const QString &deviceSpec = QString(), QObject *parent = 0);
+    ~AcquisitionWorker();
+
+    Queue &queue() { return m_queue; }
+    int notifyFd() const { return m_notifyFd; }
+    void acknowledge();
+    unsigned long droppedSamples() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    static QString logDirectory();
+    // most recent session log recorded for a charger location, empty if none
+    static QString lastLog(const QString &location);
+
+public slots:
+    void start();
+    void attach();
+    void detach();
+    void loadSysInfo();
+    void saveSysInfo(b6::SysInfo info);
+    void startCharging(b6::BATTERY_TYPE battType, b6::ChargeProfile settings);
+    void stopCharging();
+
+signals:
+    void deviceConnected(DeviceInfo info);
+    void deviceDisconnected();
+    void sysInfoLoaded(b6::SysInfo info);
+    void chargingStarted();
+    void chargingStopped();
+    void chargingError(QString message);
+    void readFailed();
+    // sustainableMs is 0 until the charger has been measured
+    void samplingChanged(int intervalMs, int sustainableMs);
+
+private slots:
+    void onTimer();
+    void onAttachRetry();
+    void onLogTimer();
+
+private:
+    static const int ATTACH_RETRY_MS = 250;
+    static const int ATTACH_MAX_ATTEMPTS = 40;
+    static const int LOG_FLUSH_MS = 1000;
+    static const std::size_t LOG_BATCH = 64;
+
+    QString m_location;
+    QString m_deviceSpec;
+    libusb_context *m_ctx = nullptr;
+    QTimer *m_timer = nullptr;
+    QTimer *m_attachTimer = nullptr;
+    QTimer *m_logTimer = nullptr;
+    QElapsedTimer m_attachElapsed;
+    QElapsedTimer m_pollClock;
+    QElapsedTimer m_hostClock;
+    int m_attachAttempts = 0;
+    ChargerDevice *m_dev = nullptr;
+    int m_cellCount = 0;
+    Queue m_queue;
+    int m_notifyFd = -1;
+    bool m_hasLastInfo = false;
+    b6::ChargeInfo m_lastInfo;
+    std::atomic<unsigned long> m_dropped{0};
+    SamplingPolicy m_sampling;
+    SampleClock m_sampleClock;
+    int m_reportedSustainableMs = 0;
+    LatencyHistogram *m_modelReadTime = nullptr;
+    SessionLogWriter m_log;
+
+    bool m_createDevice();
+    ChargerDevice *m_openUsbDevice();
+    void m_readChargeInfo();
+    void m_publish(const b6::ChargeInfo &info);
+    void m_updateSampling(const Sample &sample);
+    void m_logSample(const Sample &sample);
+    bool m_openLog(const Sample &sample);
+};
+
+#endif // ACQUISITIONWORKER_H
@@ -0,0 +1,109 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include "acquisitionworker.h"
+#include "fleetanalysis.h"
+#include "sessionhistory.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("ChargeGuru");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Fleet health report over recorded ChargeGuru sessions: capacity fade, internal "
+                                     "resistance growth and cells drifting out of balance, per pack.");
+    parser.addHelpOption();
+    QCommandLineOption threadsOption("threads", "Worker threads, 0 for one per core.", "count", "0");
+    QCommandLineOption formatOption("format", "Output format: text or json.", "format", "text");
+    QCommandLineOption outputOption("output", "Write the report to this file instead of stdout.", "file");
+    QCommandLineOption historyOption("history", "Session history to look the packs of the logs up in; logs it does not "
+                                     "know are grouped by charger.", "file", SessionHistory::defaultPath());
+    parser.addOptions({ threadsOption, formatOption, outputOption, historyOption });
+    parser.addPositionalArgument("paths", "Session logs or directories of them, the session log directory if none.",
+                                 "[paths...]");
+    parser.process(a);
+
+    QStringList paths = parser.positionalArguments();
+    if (paths.isEmpty()) {
+        paths << AcquisitionWorker::logDirectory();
+    }
+
+    // only the summary rows are read here, the logs themselves by the workers
+    QHash<QString, QString> packs;
+    if (QFileInfo::exists(parser.value(historyOption))) {
+        SessionHistory history;
+        if (history.open(parser.value(historyOption))) {
+            for (const ChargeSummary &summary : history.find(SessionHistory::Query())) {
+                if (!summary.pack.empty()) {
+                    packs.insert(QString::fromStdString(summary.log), QString::fromStdString(summary.pack));
+                }
+            }
+        }
+    }
+
+    std::vector<FleetAnalysis::Input> inputs;
+    auto addLog = [&](const QFileInfo &file) {
+        // named location_started.cglog; virtual chargers are no packs of the fleet
+        const QString location = file.fileName().section('_', 0, -2);
+        if (location.startsWith("replay-") || location.startsWith("sim-")) {
+            return;
+        }
+        const QString path = file.absoluteFilePath();
+        inputs.push_back({ path.toStdString(), packs.value(path, location).toStdString() });
+    };
+    for (const QString &path : paths) {
+        if (QFileInfo(path).isDir()) {
+            QDirIterator it(path, QStringList("*.cglog"), QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                it.next();
+                addLog(it.fileInfo());
+            }
+        } else if (QFileInfo::exists(path)) {
+            addLog(QFileInfo(path));
+        } else {
+            std::fprintf(stderr, "no such file or directory: %s\n", qPrintable(path));
+            return 2;
+        }
+    }
+
+    const FleetAnalysis::Report report = FleetAnalysis::run(inputs, parser.value(threadsOption).toInt());
+
+    std::ofstream file;
+    if (parser.isSet(outputOption)) {
+        file.open(parser.value(outputOption).toStdString());
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(outputOption)));
+            return 2;
+        }
+    }
+    std::ostream &out = parser.isSet(outputOption) ? static_cast<std::ostream&>(file) : std::cout;
+    if (parser.value(formatOption) == "json") {
+        FleetAnalysis::writeJson(report, out);
+    } else {
+        FleetAnalysis::writeText(report, out);
+    }
+    return 0;
+}
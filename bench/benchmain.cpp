@@ -0,0 +1,119 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * chargeguru_bench: micro and macro benchmarks of the acquisition -> store ->
+ * chart pipeline and of the session log.
+ *
+ *   ./chargeguru_bench --format json --output results.json
+ *   ./chargeguru_bench --baseline results.json --tolerance 10
+ *   ./chargeguru_bench --soak 300
+ *   ./chargeguru_bench --forecast --forecast-type nimh charge1.cglog charge2.cglog
+ *
+ * Runs offscreen unless QT_QPA_PLATFORM says otherwise. Progress goes to
+ * stderr, results to stdout or --output.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include "benchmark.h"
+
+int main(int argc, char *argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("ChargeGuru");
+    // session logs written by the benchmarks stay out of the user's data
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption formatOption("format", "Output format: table, json (one object per line) or csv.", "format", "table");
+    QCommandLineOption outputOption("output", "Write results to this file instead of stdout.", "file");
+    QCommandLineOption filterOption("filter", "Only run cases whose \"name params\" contains this.", "text");
+    QCommandLineOption minTimeOption("min-time", "Minimum time spent in each case, seconds.", "seconds", "0.5");
+    QCommandLineOption baselineOption("baseline", "Compare against results saved with --format json.", "file");
+    QCommandLineOption toleranceOption("tolerance", "Slowdown against the baseline that counts as a regression, percent.", "percent", "10");
+    QCommandLineOption soakOption("soak", "Instead of the benchmarks, run this many simulated charges back to back "
+                                  "and fail if memory keeps growing.", "charges");
+    QCommandLineOption forecastOption("forecast", "Instead of the benchmarks, check the charge forecast against the "
+                                      "given session logs, or simulated charges if there are none.");
+    QCommandLineOption forecastTypeOption("forecast-type", "Battery type of the session logs.", "type", "lipo");
+    parser.addOptions({ formatOption, outputOption, filterOption, minTimeOption, baselineOption, toleranceOption,
+                        soakOption, forecastOption, forecastTypeOption });
+    parser.addPositionalArgument("logs", "Session logs for --forecast.", "[logs...]");
+    parser.process(app);
+
+    Bench::Format format = Bench::TABLE;
+    if (parser.value(formatOption) == "json") {
+        format = Bench::JSON;
+    } else if (parser.value(formatOption) == "csv") {
+        format = Bench::CSV;
+    }
+
+    FILE *out = stdout;
+    if (parser.isSet(outputOption)) {
+        out = std::fopen(qPrintable(parser.value(outputOption)), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(outputOption)));
+            return 2;
+        }
+    }
+
+    if (parser.isSet(soakOption)) {
+        const bool flat = Bench::soak(std::max(parser.value(soakOption).toInt(), 1), out);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+        return flat ? 0 : 1;
+    }
+
+    if (parser.isSet(forecastOption)) {
+        const bool read = Bench::forecast(parser.positionalArguments(), parser.value(forecastTypeOption), out);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+        return read ? 0 : 2;
+    }
+
+    Bench::Runner runner(parser.value(filterOption), parser.value(minTimeOption).toDouble());
+    Bench::storeBenchmarks(runner);
+    Bench::chartBenchmarks(runner);
+    Bench::logBenchmarks(runner);
+    Bench::historyBenchmarks(runner);
+    Bench::print(runner.results(), format, out);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    if (parser.isSet(baselineOption)) {
+        QVector<Bench::Result> baseline = Bench::load(parser.value(baselineOption));
+        if (baseline.isEmpty()) {
+            std::fprintf(stderr, "cannot read baseline %s\n", qPrintable(parser.value(baselineOption)));
+            return 2;
+        }
+        if (Bench::compare(runner.results(), baseline, parser.value(toleranceOption).toDouble() / 100.0, stderr) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
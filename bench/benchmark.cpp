@@ -0,0 +1,176 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "benchmark.h"
+#include "simulateddevice.h"
+
+static QString key(const Bench::Result &result) {
+    return result.name + " " + result.params;
+}
+
+QVector<Bench::Session> Bench::sessions() {
+    return { { "1h@1Hz", 1, 1 }, { "8h@1Hz", 8, 1 }, { "24h@1Hz", 24, 1 }, { "24h@10Hz", 24, 10 } };
+}
+
+bool Bench::Runner::enabled(const QString &name, const QString &params) const {
+    return m_filter.isEmpty() || (name + " " + params).contains(m_filter);
+}
+
+void Bench::Runner::run(const QString &name, const QString &params, const std::function<void()> &fn, double items, double bytes) {
+    if (!enabled(name, params)) {
+        return;
+    }
+
+    // one untimed run to warm caches and lazy initialization up
+    fn();
+
+    QElapsedTimer timer;
+    qint64 runs = 0;
+    timer.start();
+    do {
+        fn();
+        runs++;
+    } while (timer.nsecsElapsed() < m_minSeconds * 1e9);
+    record(name, params, runs, timer.nsecsElapsed(), items, bytes);
+}
+
+void Bench::Runner::record(const QString &name, const QString &params, qint64 runs, qint64 nanoseconds, double items, double bytes) {
+    if (!enabled(name, params)) {
+        return;
+    }
+
+    Result result;
+    result.name = name;
+    result.params = params;
+    result.runs = runs;
+    result.nsPerRun = (double)(nanoseconds) / runs;
+    result.itemsPerSecond = items * 1e9 / result.nsPerRun;
+    result.bytesPerSecond = bytes * 1e9 / result.nsPerRun;
+    m_results.append(result);
+
+    std::fprintf(stderr, "  %-28s %-12s %14.0f ns\n", qPrintable(name), qPrintable(params), result.nsPerRun);
+}
+
+void Bench::print(const QVector<Result> &results, Format format, FILE *out) {
+    if (format == TABLE) {
+        std::fprintf(out, "%-28s %-12s %10s %14s %14s %12s\n", "case", "params", "runs", "ns/run", "items/s", "MB/s");
+    } else if (format == CSV) {
+        std::fprintf(out, "name,params,runs,ns_per_run,items_per_s,bytes_per_s\n");
+    }
+
+    for (const Result &r : results) {
+        if (format == TABLE) {
+            std::fprintf(out, "%-28s %-12s %10lld %14.0f %14.0f %12.1f\n", qPrintable(r.name), qPrintable(r.params),
+                         r.runs, r.nsPerRun, r.itemsPerSecond, r.bytesPerSecond / 1e6);
+        } else if (format == CSV) {
+            std::fprintf(out, "%s,%s,%lld,%.1f,%.1f,%.1f\n", qPrintable(r.name), qPrintable(r.params),
+                         r.runs, r.nsPerRun, r.itemsPerSecond, r.bytesPerSecond);
+        } else {
+            QJsonObject object;
+            object.insert("name", r.name);
+            object.insert("params", r.params);
+            object.insert("runs", r.runs);
+            object.insert("ns_per_run", r.nsPerRun);
+            object.insert("items_per_s", r.itemsPerSecond);
+            object.insert("bytes_per_s", r.bytesPerSecond);
+            std::fprintf(out, "%s\n", QJsonDocument(object).toJson(QJsonDocument::Compact).constData());
+        }
+    }
+}
+
+QVector<Bench::Result> Bench::load(const QString &path) {
+    QVector<Result> results;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return results;
+    }
+
+    while (!file.atEnd()) {
+        QJsonObject object = QJsonDocument::fromJson(file.readLine()).object();
+        if (object.isEmpty()) {
+            continue;
+        }
+        Result result;
+        result.name = object.value("name").toString();
+        result.params = object.value("params").toString();
+        result.runs = object.value("runs").toVariant().toLongLong();
+        result.nsPerRun = object.value("ns_per_run").toDouble();
+        result.itemsPerSecond = object.value("items_per_s").toDouble();
+        result.bytesPerSecond = object.value("bytes_per_s").toDouble();
+        results.append(result);
+    }
+    return results;
+}
+
+int Bench::compare(const QVector<Result> &results, const QVector<Result> &baseline, double tolerance, FILE *out) {
+    QHash<QString, double> before;
+    for (const Result &r : baseline) {
+        before.insert(key(r), r.nsPerRun);
+    }
+
+    int regressions = 0;
+    for (const Result &r : results) {
+        if (!before.contains(key(r))) {
+            continue;
+        }
+        const double ratio = r.nsPerRun / before.value(key(r));
+        if (ratio > 1.0 + tolerance) {
+            std::fprintf(out, "REGRESSION %s %s: %.0f ns -> %.0f ns (+%.0f%%)\n", qPrintable(r.name), qPrintable(r.params),
+                         before.value(key(r)), r.nsPerRun, (ratio - 1.0) * 100.0);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+std::vector<b6::ChargeInfo> Bench::chargeSamples(std::size_t count, int cells) {
+    SimulatedDevice::Options options;
+    options.cells = cells;
+    options.speed = 0.0;
+    options.extSensor = true;
+    SimulatedDevice device(options);
+
+    b6::ChargeProfile profile = device.getDefaultChargeProfile(b6::BATTERY_TYPE::LIPO);
+    profile.cellCount = static_cast<uint8_t>(cells);
+    profile.chargeCurrent = 2000;
+    profile.dischargeCurrent = 1000;
+    profile.mode.li = b6::CHARGING_MODE_LI::BALANCE;
+    device.startCharging(profile);
+
+    std::vector<b6::ChargeInfo> samples;
+    samples.reserve(count);
+    bool charging = true;
+    while (samples.size() < count) {
+        b6::ChargeInfo info = device.getChargeInfo();
+        if (info.state != static_cast<uint8_t>(b6::STATE::CHARGING)) {
+            // one long session made of back to back charges and discharges
+            charging = !charging;
+            profile.mode.li = charging ? b6::CHARGING_MODE_LI::BALANCE : b6::CHARGING_MODE_LI::DISCHARGE;
+            device.startCharging(profile);
+            continue;
+        }
+        info.time = static_cast<int>(samples.size());
+        samples.push_back(info);
+    }
+    return samples;
+}
@@ -0,0 +1,108 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <b6/Device.hh>
+
+/*
+ * Minimal harness for chargeguru_bench. A case runs until it has taken at
+ * least minSeconds and reports the time per run plus, if it processes a
+ * known amount of samples or bytes per run, the throughput. Results are keyed
+ * by name and params, so two runs of the suite can be compared.
+ */
+namespace Bench {
+    enum Format { TABLE, JSON, CSV };
+
+    struct Result {
+        QString name;             // group/case
+        QString params;           // e.g. 24h@1Hz
+        qint64 runs = 0;
+        double nsPerRun = 0.0;
+        double itemsPerSecond = 0.0;
+        double bytesPerSecond = 0.0;
+    };
+
+    // a session length length dependent cases are measured at
+    struct Session {
+        QString params;           // e.g. 24h@1Hz
+        double hours;
+        int rate;                 // samples per second
+
+        std::size_t samples() const { return static_cast<std::size_t>(hours * 3600 * rate); }
+        uint32_t timeMs(std::size_t index) const { return static_cast<uint32_t>(index * 1000 / rate); }
+    };
+    // 1h, 8h and 24h at the B6's 1 Hz, and 24h at 10 Hz
+    QVector<Session> sessions();
+
+    class Runner {
+    public:
+        Runner(const QString &filter, double minSeconds) : m_filter(filter), m_minSeconds(minSeconds) {}
+
+        bool enabled(const QString &name, const QString &params) const;
+        // items and bytes are per call of fn, 0 if not meaningful
+        void run(const QString &name, const QString &params, const std::function<void()> &fn,
+                 double items = 0.0, double bytes = 0.0);
+        // for cases that time themselves, e.g. because every run needs fresh setup
+        void record(const QString &name, const QString &params, qint64 runs, qint64 nanoseconds,
+                    double items = 0.0, double bytes = 0.0);
+
+        const QVector<Result> &results() const { return m_results; }
+
+    private:
+        QString m_filter;
+        double m_minSeconds;
+        QVector<Result> m_results;
+    };
+
+    void print(const QVector<Result> &results, Format format, FILE *out);
+    // reads results written with the JSON format, empty if the file is unreadable
+    QVector<Result> load(const QString &path);
+    // prints every case slower than the baseline by more than tolerance (a fraction), returns how many
+    int compare(const QVector<Result> &results, const QVector<Result> &baseline, double tolerance, FILE *out);
+
+    // a charge from the simulator, cycled between charging and discharging until count samples exist
+    std::vector<b6::ChargeInfo> chargeSamples(std::size_t count, int cells);
+
+    // keeps the optimizer from discarding a result
+    template <typename T>
+    inline void keep(const T &value) {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    void storeBenchmarks(Runner &runner);
+    void chartBenchmarks(Runner &runner);
+    void logBenchmarks(Runner &runner);
+    void historyBenchmarks(Runner &runner);
+
+    // runs sessions simulated charges back to back, false if the resident set kept growing
+    bool soak(int sessions, FILE *out);
+    // checks ChargeForecast against charge logs of the given battery type, or simulated charges if there are none
+    bool forecast(const QStringList &logs, const QString &type, FILE *out);
+}
+
+#endif // BENCHMARK_H
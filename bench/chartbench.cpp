@@ -0,0 +1,326 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * GUI side: loading a session into its charts (the min/max axis tracking
+ * of SessionCharts runs once per sample), raw QLineSeries append/replace,
+ * offscreen repaints with every point versus the LOD selection, one
+ * RenderScheduler tick as the GUI does per new sample, the same sample on a
+ * StripChart, past charges laid over a chart while it is panned, the
+ * per-cell table refresh of the main window and a wall of chargers on the
+ * dashboard.
+ */
+
+#include <cmath>
+#include <memory>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QTableWidget>
+#include <QTemporaryDir>
+#include <QtCharts>
+#include "acquisitionworker.h"
+#include "benchmark.h"
+#include "chargeoverlay.h"
+#include "chargersession.h"
+#include "dashboardwidget.h"
+#include "renderscheduler.h"
+#include "sessioncharts.h"
+#include "sessionlog.h"
+#include "stripchart.h"
+
+using namespace QtCharts;
+
+static const int CELLS = 6;
+static const int CHART_WIDTH = 1000;
+static const int CHART_HEIGHT = 300;
+static const int SESSION_LOADS = 3;
+static const int OVERLAY_CHARGES = 50;
+static const int DASHBOARD_CHARGERS = 16;
+
+static double paint(QWidget &widget, QImage &image) {
+    QPainter painter(&image);
+    widget.render(&painter);
+    return image.constBits()[0];
+}
+
+// a session as ChargerSession finds it after a crash: an unclosed log for its location
+static QString writeSessionLog(const Bench::Session &session, const std::vector<b6::ChargeInfo> &samples) {
+    QString location = "bench-" + QString(session.params).replace('@', '-');
+    QDir().mkpath(AcquisitionWorker::logDirectory());
+    QString path = QString("%1/%2_bench.cglog").arg(AcquisitionWorker::logDirectory(), location);
+
+    SessionLogWriter writer;
+    writer.create(path.toStdString(), CELLS, 0);
+    for (std::size_t i = 0; i < session.samples(); i++) {
+        writer.append(SessionLog::makeRecord(session.timeMs(i), samples[i]));
+    }
+    writer.close();
+    return location;
+}
+
+void Bench::chartBenchmarks(Runner &runner) {
+    const QVector<Session> lengths = sessions();
+    const std::vector<b6::ChargeInfo> samples = chargeSamples(lengths.last().samples(), CELLS);
+    QImage image(CHART_WIDTH, CHART_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+
+    for (const Session &session : lengths) {
+        if (!runner.enabled("session/recover", session.params) && !runner.enabled("charts/plot_session", session.params)) {
+            continue;
+        }
+        const QString location = writeSessionLog(session, samples);
+        qint64 recoverNs = 0, plotNs = 0;
+        for (int i = 0; i < SESSION_LOADS; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            std::unique_ptr<ChargerSession> charger(new ChargerSession(location));
+            recoverNs += timer.nsecsElapsed();
+
+            timer.restart();
+            SessionCharts *charts = new SessionCharts(charger.get());
+            plotNs += timer.nsecsElapsed();
+            keep(charts);
+        }
+        QFile::remove(AcquisitionWorker::lastLog(location));
+        runner.record("session/recover", session.params, SESSION_LOADS, recoverNs, session.samples());
+        runner.record("charts/plot_session", session.params, SESSION_LOADS, plotNs, session.samples());
+    }
+
+    QLineSeries *series = new QLineSeries();
+    QChart *chart = new QChart();
+    chart->addSeries(series);
+    chart->createDefaultAxes();
+    chart->legend()->hide();
+    QChartView view(chart);
+    view.resize(CHART_WIDTH, CHART_HEIGHT);
+    view.setRenderHint(QPainter::Antialiasing);
+
+    // how the charts were fed before the render scheduler: one append() per sample
+    runner.run("series/append", "points=3600", [&]() {
+        series->clear();
+        for (int i = 0; i < 3600; i++) {
+            series->append(i, samples[i].voltage / 1000.0);
+        }
+    }, 3600);
+
+    QVector<QPointF> frame;
+    for (int i = 0; i < 2000; i++) {
+        frame.append(QPointF(i, samples[i].voltage / 1000.0));
+    }
+    runner.run("series/replace", "points=2000", [&]() {
+        series->replace(frame);
+    }, 2000);
+
+    for (const Session &session : lengths) {
+        const std::size_t count = session.samples();
+        TelemetryStore store(CELLS);
+        for (std::size_t i = 0; i < count; i++) {
+            store.append(session.timeMs(i), samples[i]);
+        }
+        TelemetryColumn voltage(&store, TelemetryStore::VOLTAGE, 0, 0.001);
+        const double end = store.timeMs(count - 1) / 1000.0;
+        chart->axes(Qt::Horizontal).at(0)->setRange(0, end);
+        chart->axes(Qt::Vertical).at(0)->setRange(15.0, 26.0);
+
+        if (runner.enabled("render/repaint_raw", session.params)) {
+            QVector<QPointF> raw;
+            raw.reserve(static_cast<int>(count));
+            for (std::size_t i = 0; i < count; i++) {
+                raw.append(QPointF(voltage.at(i).x, voltage.at(i).y));
+            }
+            series->replace(raw);
+            runner.run("render/repaint_raw", session.params, [&]() { keep(paint(view, image)); });
+        }
+
+        LodSeries lod(&voltage);
+        lod.update();
+        std::vector<LodSeries::Point> selected;
+        lod.query(0, end, static_cast<std::size_t>(chart->plotArea().width()), selected);
+        QVector<QPointF> points;
+        for (const LodSeries::Point &p : selected) {
+            points.append(QPointF(p.x, p.y));
+        }
+        series->replace(points);
+        runner.run("render/repaint_lod", session.params, [&]() { keep(paint(view, image)); });
+
+        // one new sample through the scheduler, with and without painting the result
+        RenderScheduler render;
+        render.addSeries(series, &voltage);
+        std::size_t next = count;
+        auto tick = [&]() {
+            store.append(session.timeMs(next), samples[next % samples.size()]);
+            next++;
+            render.update();
+            render.setRange(chart, Qt::Horizontal, 0, store.timeMs(next - 1) / 1000.0);
+            render.commit();
+        };
+        runner.run("render/tick", session.params, tick, 1);
+        runner.run("render/frame", session.params, [&]() {
+            tick();
+            keep(paint(view, image));
+        }, 1);
+        render.removeSeries(series);
+
+        // the same sample on a strip chart, which only draws the columns it scrolled into
+        StripChart strip;
+        strip.setAttribute(Qt::WA_DontShowOnScreen);
+        strip.resize(CHART_WIDTH, CHART_HEIGHT);
+        strip.show();
+        strip.addTrace(new TelemetryColumn(&store, TelemetryStore::VOLTAGE, 0, 0.001), QColor(0x00, 0x00, 0xff));
+        auto stripTick = [&]() {
+            store.append(session.timeMs(next), samples[next % samples.size()]);
+            next++;
+            strip.appendSamples();
+        };
+        runner.run("strip/tick", session.params, stripTick, 1);
+        runner.run("strip/frame", session.params, [&]() {
+            stripTick();
+            keep(paint(strip, image));
+        }, 1);
+        runner.run("strip/redraw", session.params, [&]() {
+            strip.setWindow(strip.window());
+            keep(paint(strip, image));
+        });
+    }
+
+    // 50 past 8 h charges on one chart, panned across a quarter of their length at a time
+    const Session past = lengths[1];
+    const QString overlayParams = QString("%1x%2").arg(OVERLAY_CHARGES).arg(past.params);
+    if (runner.enabled("overlay/load", overlayParams) || runner.enabled("overlay/resample", overlayParams) ||
+        runner.enabled("overlay/frame", overlayParams)) {
+        QTemporaryDir dir;
+        std::vector<std::string> logs;
+        for (int i = 0; i < OVERLAY_CHARGES; i++) {
+            logs.push_back(QString("%1/past-%2.cglog").arg(dir.path()).arg(i).toStdString());
+            SessionLogWriter writer;
+            writer.create(logs.back(), CELLS, 0);
+            for (std::size_t j = 0; j < past.samples(); j++) {
+                writer.append(SessionLog::makeRecord(past.timeMs(j), samples[(j + i * 60) % samples.size()]));
+            }
+            writer.finish();
+        }
+        const std::size_t records = past.samples() * OVERLAY_CHARGES;
+        runner.run("overlay/load", overlayParams, [&]() {
+            ChargeOverlay overlay;
+            for (const std::string &log : logs) {
+                overlay.add(log);
+            }
+            keep(overlay.size());
+        }, static_cast<double>(records), static_cast<double>(records * sizeof(SessionLog::Record)));
+
+        ChargeOverlay overlay;
+        for (const std::string &log : logs) {
+            overlay.add(log);
+        }
+        const double span = overlay.extent().timeS / 4;
+        std::vector<QLineSeries*> curves;
+        for (int i = 0; i < OVERLAY_CHARGES; i++) {
+            curves.push_back(new QLineSeries());
+            chart->addSeries(curves.back());
+            curves.back()->attachAxis(chart->axes(Qt::Horizontal).at(0));
+            curves.back()->attachAxis(chart->axes(Qt::Vertical).at(0));
+        }
+        std::vector<LodSeries::Point> points;
+        QVector<QPointF> replace;
+        int step = 0;
+        // what OverlayResampler does per range change, every figure of every curve
+        auto resample = [&](bool show) {
+            const double from = (step++ % 100) * span * 3 / 100;
+            for (std::size_t curve = 0; curve < overlay.size(); curve++) {
+                for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+                    overlay.resample(curve, static_cast<ChargeOverlay::Figure>(figure), ChargeOverlay::ALIGN_TIME,
+                                     from, from + span, CHART_WIDTH, points);
+                    if (show && figure == ChargeOverlay::VOLTAGE) {
+                        replace.resize(static_cast<int>(points.size()));
+                        for (std::size_t i = 0; i < points.size(); i++) {
+                            replace[static_cast<int>(i)] = QPointF(points[i].x, points[i].y);
+                        }
+                        curves[curve]->replace(replace);
+                    }
+                }
+            }
+            if (show) {
+                chart->axes(Qt::Horizontal).at(0)->setRange(from, from + span);
+            }
+        };
+        runner.run("overlay/resample", overlayParams, [&]() { resample(false); }, OVERLAY_CHARGES);
+        runner.run("overlay/frame", overlayParams, [&]() {
+            resample(true);
+            keep(paint(view, image));
+        }, OVERLAY_CHARGES);
+        for (QLineSeries *curve : curves) {
+            chart->removeSeries(curve);
+            delete curve;
+        }
+    }
+
+    // MainWindow::m_showChargeInfo() refreshing the cell voltages
+    QTableWidget cells(1, 8);
+    cells.resize(CHART_WIDTH, 60);
+    for (int i = 0; i < 8; i++) {
+        cells.setItem(0, i, new QTableWidgetItem());
+    }
+    std::size_t next = 0;
+    auto updateCells = [&]() {
+        const b6::ChargeInfo &info = samples[next++ % samples.size()];
+        for (int i = 0; i < CELLS; i++) {
+            double cellV = (double)(info.cells[i]) / 1000.0;
+            cells.item(0, i)->setText(QString("%1V").arg(cellV > 0.4 ? cellV : 0.0, 0, 'f', 3));
+        }
+    };
+    runner.run("table/cells_update", "cells=6", updateCells, CELLS);
+    runner.run("table/cells_paint", "cells=6", [&]() {
+        updateCells();
+        keep(paint(cells, image));
+    }, CELLS);
+
+    // every charger of a wall display reporting one sample, each at its own point of the charge
+    DashboardWidget dashboard;
+    dashboard.setAttribute(Qt::WA_DontShowOnScreen);
+    dashboard.resize(CHART_WIDTH, CHART_WIDTH);
+    dashboard.show();
+    for (int i = 0; i < DASHBOARD_CHARGERS; i++) {
+        dashboard.dashboardModel()->addRow(QString("bench-%1").arg(i));
+    }
+    QImage wall(CHART_WIDTH, CHART_WIDTH, QImage::Format_ARGB32_Premultiplied);
+    const QString wallParams = QString("chargers=%1").arg(DASHBOARD_CHARGERS);
+    std::size_t tick = 0;
+    auto updateDashboard = [&]() {
+        for (int row = 0; row < DASHBOARD_CHARGERS; row++) {
+            const b6::ChargeInfo &info = samples[(tick + row * 600) % samples.size()];
+            DashboardModel::Readout readout;
+            readout.state = "CHARGING";
+            readout.values[DashboardModel::VOLTAGE] = info.voltage;
+            readout.values[DashboardModel::CURRENT] = info.current;
+            readout.values[DashboardModel::CAPACITY] = info.capacity;
+            readout.values[DashboardModel::TIME] = info.time;
+            for (int i = 0; i < CELLS; i++) {
+                readout.values[DashboardModel::CELL + i] = info.cells[i];
+            }
+            dashboard.dashboardModel()->setReadout(row, readout);
+        }
+        tick++;
+    };
+    runner.run("dashboard/update", wallParams, updateDashboard, DASHBOARD_CHARGERS);
+    runner.run("dashboard/frame", wallParams, [&]() {
+        updateDashboard();
+        keep(paint(dashboard, wall));
+    }, DASHBOARD_CHARGERS);
+}
@@ -0,0 +1,211 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Offline check of ChargeForecast: runs recorded charges through
+ * ChargeAnalytics and the forecast as ChargerSession does and compares every
+ * forecast with how the charge actually ended. Without logs it records one
+ * simulated charge of every battery type first. Reports the error of the
+ * remaining time (as a share of the whole charge) and of the final capacity
+ * at a quarter, half and three quarters of the charge, how often the real end
+ * fell inside the band, and the cost of an update.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "benchmark.h"
+#include "chargeanalytics.h"
+#include "chargeforecast.h"
+#include "chargeprofiles.h"
+#include "sessionlog.h"
+#include "simulateddevice.h"
+
+// a charge long enough for any simulated pack, samples
+static const std::size_t MAX_SAMPLES = 48 * 3600;
+
+struct Recording {
+    QString name;
+    b6::BATTERY_TYPE type;
+    b6::ChargeProfile profile;
+    b6::ChargeInfo rest;          // before the charge, for the first resistance estimate
+    bool hasRest = false;
+    std::vector<uint32_t> times;
+    std::vector<b6::ChargeInfo> samples;
+};
+
+static Recording simulate(const QString &name, b6::BATTERY_TYPE type) {
+    const bool li = b6::Device::isBatteryLi(type);
+    SimulatedDevice::Options options;
+    options.cells = li ? 3 : 6;
+    options.soc = 0.2;
+    options.speed = 0.0;
+    SimulatedDevice device(options);
+
+    Recording recording;
+    recording.name = "sim/" + name;
+    recording.type = type;
+    recording.profile = device.getDefaultChargeProfile(type);
+    recording.profile.cellCount = static_cast<uint8_t>(options.cells);
+    recording.profile.chargeCurrent = 1000;
+    std::memset(&recording.profile.mode, 0, sizeof(recording.profile.mode));
+    if (li) {
+        recording.profile.mode.li = b6::CHARGING_MODE_LI::BALANCE;
+    }
+    // the pack takes on the chemistry with the first charge, so its resting voltage is only right after one
+    device.startCharging(recording.profile);
+    device.stopCharging();
+    recording.rest = device.getChargeInfo();
+    recording.hasRest = true;
+
+    device.startCharging(recording.profile);
+    for (std::size_t i = 0; i < MAX_SAMPLES; i++) {
+        const b6::ChargeInfo info = device.getChargeInfo();
+        if (info.state != static_cast<uint8_t>(b6::STATE::CHARGING)) {
+            break;
+        }
+        recording.times.push_back(static_cast<uint32_t>(info.time) * 1000);
+        recording.samples.push_back(info);
+    }
+    return recording;
+}
+
+static bool load(const QString &path, b6::BATTERY_TYPE type, Recording &recording) {
+    SessionLogReader log;
+    if (!log.open(path.toStdString())) {
+        return false;
+    }
+    recording.name = path;
+    recording.type = type;
+    for (std::size_t i = 0; i < log.size() && SessionLog::isValid(log.record(i)); i++) {
+        const b6::ChargeInfo info = SessionLog::toChargeInfo(log.record(i));
+        if (info.state == static_cast<uint8_t>(b6::STATE::CHARGING)) {
+            recording.times.push_back(log.record(i).timeMs);
+            recording.samples.push_back(info);
+        }
+    }
+    if (recording.samples.empty()) {
+        return false;
+    }
+
+    // the log does not say what was charged: the balance port counts Li cells, the others go by voltage
+    const b6::ChargeInfo &first = recording.samples.front();
+    int cells = 0;
+    if (b6::Device::isBatteryLi(type)) {
+        for (int i = 0; i < 8; i++) {
+            cells += first.cells[i] > 400;
+        }
+    } else {
+        const int nominal = b6::Device::isBatteryNi(type) ? 1200 : 2000;
+        cells = static_cast<int>(std::lround(static_cast<double>(first.voltage) / nominal));
+    }
+    std::memset(&recording.profile, 0, sizeof(recording.profile));
+    recording.profile.batteryType = type;
+    recording.profile.cellCount = static_cast<uint8_t>(std::max(cells, 1));
+    return true;
+}
+
+static void evaluate(const Recording &recording, FILE *out) {
+    const std::size_t count = recording.samples.size();
+    if (count < 2) {
+        std::fprintf(out, "%-24s too short\n", qPrintable(recording.name));
+        return;
+    }
+
+    // the figures the forecast sees, computed up front so only the forecast is timed
+    ChargeAnalytics analytics;
+    if (recording.hasRest) {
+        analytics.update(0, recording.rest);
+        analytics.startCharge();
+    }
+    std::vector<ChargeAnalytics::Figures> figures(count);
+    for (std::size_t i = 0; i < count; i++) {
+        analytics.update(recording.times[i], recording.samples[i]);
+        figures[i] = analytics.figures();
+    }
+
+    ChargeForecast forecast;
+    forecast.configure(recording.type, recording.profile);
+    const auto started = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i++) {
+        forecast.update(recording.times[i], recording.samples[i], figures[i]);
+    }
+    const double nsPerSample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / count;
+
+    const double end = recording.times.back() / 1000.0;
+    const double duration = std::max(end - recording.times.front() / 1000.0, 1.0);
+    const double capacity = std::max(recording.samples.back().capacity, 1);
+    const double checkpoints[] = { 0.25, 0.5, 0.75 };
+    std::size_t next = 0, valid = 0, inBand = 0;
+    double timeError[3] = { NAN, NAN, NAN }, capacityError[3] = { NAN, NAN, NAN };
+
+    forecast.configure(recording.type, recording.profile);
+    for (std::size_t i = 0; i < count; i++) {
+        forecast.update(recording.times[i], recording.samples[i], figures[i]);
+        const ChargeForecast::Forecast &f = forecast.forecast();
+        const double left = end - recording.times[i] / 1000.0;
+        if (f.valid) {
+            valid++;
+            inBand += left >= f.remainingLowS && left <= f.remainingHighS;
+        }
+        if (next < 3 && i >= checkpoints[next] * (count - 1)) {
+            if (f.valid) {
+                timeError[next] = 100.0 * (f.remainingS - left) / duration;
+                capacityError[next] = 100.0 * (f.finalCapacity - capacity) / capacity;
+            }
+            next++;
+        }
+    }
+
+    std::fprintf(out, "%-24s %7.0f %6.0f  %+6.1f %+6.1f %+6.1f  %+6.1f %+6.1f %+6.1f  %5.1f %5.1f  %7.1f\n",
+                 qPrintable(recording.name), duration / 60.0, capacity,
+                 timeError[0], timeError[1], timeError[2], capacityError[0], capacityError[1], capacityError[2],
+                 100.0 * valid / count, valid > 0 ? 100.0 * inBand / valid : 0.0, nsPerSample);
+}
+
+bool Bench::forecast(const QStringList &logs, const QString &type, FILE *out) {
+    std::vector<Recording> recordings;
+    if (logs.isEmpty()) {
+        for (const auto &batteryType : ChargeProfiles::batteryTypes()) {
+            std::fprintf(stderr, "forecast: simulating a %s charge\n", qPrintable(batteryType.first));
+            recordings.push_back(simulate(batteryType.first, batteryType.second));
+        }
+    } else {
+        b6::BATTERY_TYPE batteryType;
+        if (!ChargeProfiles::parseBatteryType(type, batteryType)) {
+            std::fprintf(stderr, "unknown battery type: %s\n", qPrintable(type));
+            return false;
+        }
+        for (const QString &path : logs) {
+            Recording recording;
+            if (!load(path, batteryType, recording)) {
+                std::fprintf(stderr, "cannot read a charge from %s\n", qPrintable(path));
+                return false;
+            }
+            recordings.push_back(recording);
+        }
+    }
+
+    std::fprintf(out, "%-24s %7s %6s  %-20s  %-20s  %5s %5s  %7s\n", "charge", "min", "mAh",
+                 "time err % 25/50/75", "mAh err % 25/50/75", "fc %", "band%", "ns/upd");
+    for (const Recording &recording : recordings) {
+        evaluate(recording, out);
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Session history: adding a summary row and the indexed queries the History
+ * dock and the CLI run, over a fleet of packs with a few hundred charges
+ * each, and summarizing a session log as importing one does.
+ */
+
+#include <QTemporaryDir>
+#include "benchmark.h"
+#include "sessionhistory.h"
+#include "sessionlog.h"
+
+static const int PACKS = 100;
+static const int CHARGES_PER_PACK = 200;
+static const int CELLS = 6;
+
+static ChargeSummary fleetCharge(int index) {
+    // a pack is charged every day or so, all packs over the same months
+    const int pack = index % PACKS;
+    ChargeSummary summary;
+    summary.pack = "pack-" + std::to_string(pack);
+    summary.location = "1-" + std::to_string(pack % 4 + 1);
+    summary.log = "/bench/" + std::to_string(index) + ".cglog";
+    summary.startedAtMs = 1527811200000LL + static_cast<int64_t>(index / PACKS) * 86400000LL + pack * 60000LL;
+    summary.batteryType = pack % 7;
+    summary.mode = 0;
+    summary.cellCount = CELLS;
+    summary.outcome = index % 50 == 0 ? ChargeSummary::STOPPED : ChargeSummary::COMPLETED;
+    summary.capacity = 2200 - index / PACKS + (index * 7919) % 40;
+    summary.durationS = 3600 + (index * 104729) % 900;
+    summary.energyWh = summary.capacity * 3.8 * CELLS / 1000.0;
+    summary.maxTemp = 30 + (index * 31) % 12;
+    summary.resistance = 8.0 + (index * 13) % 50 / 10.0;
+    summary.maxCellDelta = 5 + (index * 17) % 40;
+    summary.endVoltage = 4200 * CELLS;
+    return summary;
+}
+
+void Bench::historyBenchmarks(Runner &runner) {
+    const int charges = PACKS * CHARGES_PER_PACK;
+    const QString fleet = QString("%1 charges").arg(charges);
+    SessionHistory history;
+    if (!history.open(":memory:")) {
+        std::fprintf(stderr, "history benchmarks skipped: %s\n", qPrintable(history.errorString()));
+        return;
+    }
+    for (int i = 0; i < charges; i++) {
+        history.add(fleetCharge(i));
+    }
+
+    int next = charges;
+    runner.run("history/add", fleet, [&]() {
+        keep(history.add(fleetCharge(next++)));
+    }, 1);
+
+    SessionHistory::Query query;
+    query.pack = "pack-42";
+    runner.run("history/find", "pack trend", [&]() {
+        keep(history.find(query));
+    }, CHARGES_PER_PACK);
+
+    query = SessionHistory::Query();
+    SessionHistory::parseQuery("type=lihv, min-cell-delta=30", query);
+    runner.run("history/find", "type + cell delta", [&]() {
+        keep(history.find(query));
+    });
+
+    query = SessionHistory::Query();
+    SessionHistory::parseQuery("since=2018-09-01, limit=100", query);
+    runner.run("history/find", "latest 100", [&]() {
+        keep(history.find(query));
+    }, 100);
+
+    // what importing costs per log
+    const Session hour = sessions().first();
+    const std::vector<b6::ChargeInfo> samples = chargeSamples(hour.samples(), CELLS);
+    QTemporaryDir dir;
+    const std::string path = (dir.path() + "/bench.cglog").toStdString();
+    SessionLogWriter writer;
+    writer.create(path, CELLS, 0);
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        writer.append(SessionLog::makeRecord(hour.timeMs(i), samples[i]));
+    }
+    writer.finish();
+    runner.run("history/from_log", hour.params, [&]() {
+        ChargeSummary summary;
+        keep(ChargeSummary::fromLog(path, summary));
+    }, static_cast<double>(samples.size()), static_cast<double>(samples.size() * sizeof(SessionLog::Record)));
+}
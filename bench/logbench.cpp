@@ -0,0 +1,131 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Session log and export throughput: appending records, the batched flush
+ * the worker does every second, crash recovery, reading a log back, seeking
+ * through a replay and the CSV/JSON encodings.
+ */
+
+#include <sstream>
+#include <QTemporaryDir>
+#include "benchmark.h"
+#include "sessionlog.h"
+#include "sessionreplay.h"
+#include "telemetryformat.h"
+
+static const int CELLS = 6;
+
+void Bench::logBenchmarks(Runner &runner) {
+    const QVector<Session> lengths = sessions();
+    const std::vector<b6::ChargeInfo> samples = chargeSamples(lengths.last().samples(), CELLS);
+    QTemporaryDir dir;
+    const std::string path = (dir.path() + "/bench.cglog").toStdString();
+
+    runner.run("log/make_record", "", [&]() {
+        for (std::size_t i = 0; i < 3600; i++) {
+            keep(SessionLog::makeRecord(static_cast<uint32_t>(i * 1000), samples[i]));
+        }
+    }, 3600, 3600 * sizeof(SessionLog::Record));
+
+    // what AcquisitionWorker::onLogTimer() costs at 1 Hz sampling: 1 record, written and synced
+    SessionLogWriter writer;
+    writer.create(path, CELLS, 0);
+    std::size_t next = 0;
+    runner.run("log/flush_sync", "batch=1", [&]() {
+        writer.append(SessionLog::makeRecord(static_cast<uint32_t>(next * 1000), samples[next % samples.size()]));
+        next++;
+        writer.flush(true);
+    }, 1, sizeof(SessionLog::Record));
+    runner.run("log/flush_sync", "batch=64", [&]() {
+        for (int i = 0; i < 64; i++, next++) {
+            writer.append(SessionLog::makeRecord(static_cast<uint32_t>(next * 1000), samples[next % samples.size()]));
+        }
+        writer.flush(true);
+    }, 64, 64 * sizeof(SessionLog::Record));
+    writer.close();
+
+    for (const Session &session : lengths) {
+        const std::size_t count = session.samples();
+        const double bytes = sizeof(SessionLog::Header) + count * sizeof(SessionLog::Record);
+
+        runner.run("log/write_session", session.params, [&]() {
+            writer.create(path, CELLS, 0);
+            for (std::size_t i = 0; i < count; i++) {
+                writer.append(SessionLog::makeRecord(session.timeMs(i), samples[i]));
+                if (writer.pending() >= 64) {
+                    writer.flush(false);
+                }
+            }
+            writer.finish();
+        }, count, bytes);
+
+        runner.run("log/recover", session.params, [&]() {
+            keep(SessionLog::recover(path));
+        }, count, bytes);
+
+        SessionLogReader reader;
+        runner.run("log/read_validate", session.params, [&]() {
+            reader.open(path);
+            std::size_t valid = 0;
+            while (valid < reader.size() && SessionLog::isValid(reader.record(valid))) {
+                valid++;
+            }
+            keep(valid);
+            reader.close();
+        }, count, bytes);
+
+        reader.open(path);
+        std::ostringstream csv;
+        reader.exportCsv(csv);
+        const double csvBytes = csv.tellp();
+        runner.run("export/csv", session.params, [&]() {
+            std::ostringstream out;
+            reader.exportCsv(out);
+            keep(out);
+        }, count, csvBytes);
+
+        // opening builds the keyframes; a jump anywhere then costs the same however long the charge
+        SessionReplay replay;
+        runner.run("replay/open", session.params, [&]() {
+            keep(replay.open(path));
+        }, count, bytes);
+        uint32_t seed = 1;
+        runner.run("replay/seek", session.params, [&]() {
+            seed = seed * 1103515245 + 12345;
+            replay.seek(replay.indexAt(seed % (replay.endMs() + 1)));
+            keep(replay.analytics());
+        }, 1);
+        runner.run("replay/step", session.params, [&]() {
+            replay.seek(replay.position() + 1 < replay.size() ? replay.position() + 1 : 0);
+            keep(replay.analytics());
+        }, 1);
+    }
+
+    const QString location = "1-2";
+    runner.run("export/sample_json", "", [&]() {
+        for (std::size_t i = 0; i < 3600; i++) {
+            keep(TelemetryFormat::sampleJson(location, samples[i].time * 1000, samples[i], CELLS));
+        }
+    }, 3600);
+    runner.run("export/sample_csv", "", [&]() {
+        for (std::size_t i = 0; i < 3600; i++) {
+            keep(TelemetryFormat::sampleCsv(location, samples[i], CELLS));
+        }
+    }, 3600);
+}
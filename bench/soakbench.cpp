@@ -0,0 +1,183 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Soak test: hundreds of simulated charges back to back through the same
+ * ChargerSession and SessionCharts the GUI uses, charging and discharging in
+ * turn, with the charts on screen. The resident set is sampled after every
+ * charge; once the first few charges have warmed up the pools and caches it
+ * has to stay flat.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QTimer>
+#include <QtCharts>
+#include "acquisitionworker.h"
+#include "benchmark.h"
+#include "chargersession.h"
+#include "sessioncharts.h"
+#include "telemetrystore.h"
+
+using namespace QtCharts;
+
+static const int CELLS = 3;
+// 100 mAh cells at 2 A take a few hundred samples per charge
+static const char DEVICE_SPEC[] = "sim,cells=3,capacity=100,soc=0.2,speed=0";
+static const char LOCATION[] = "bench-soak";
+static const int SESSION_TIMEOUT_MS = 60000;
+static const int CHART_WIDTH = 1000;
+static const int CHART_HEIGHT = 300;
+// growth allowed after the warm-up: the larger of this and 2% of the resident set
+static const long SLACK_KB = 1024;
+
+static long residentKb() {
+    // /proc files report a size of 0, read them to the end instead of line by line
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).simplified().split(' ').at(0).toLong();
+        }
+    }
+    return -1;
+}
+
+static void removeLogs() {
+    QDir dir(AcquisitionWorker::logDirectory());
+    for (const QString &name : dir.entryList(QStringList(QString(LOCATION) + "_*.cglog"), QDir::Files)) {
+        dir.remove(name);
+    }
+}
+
+// runs the event loop until done() holds, false if that takes longer than timeoutMs
+static bool waitFor(const std::function<bool()> &done, int timeoutMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.hasExpired(timeoutMs)) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+bool Bench::soak(int sessions, FILE *out) {
+    removeLogs();
+    std::unique_ptr<ChargerSession> charger(new ChargerSession(LOCATION, DEVICE_SPEC));
+    SessionCharts *charts = new SessionCharts(charger.get());
+
+    // a repeating timer so waitFor() notices a charger that went quiet
+    QTimer wakeUp;
+    wakeUp.start(100);
+
+    const QList<QChart*> chartList = { charts->chartCurrent(), charts->chartVoltage(), charts->chartCapacity(),
+                                       charts->chartTemp(), charts->chartCellsVoltage() };
+    std::vector<std::unique_ptr<QChartView>> views;
+    for (QChart *chart : chartList) {
+        views.push_back(std::unique_ptr<QChartView>(new QChartView(chart)));
+        views.back()->resize(CHART_WIDTH, CHART_HEIGHT);
+        charts->renderScheduler()->setChartVisible(chart, true);
+    }
+    QImage image(CHART_WIDTH, CHART_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+
+    charger->attach();
+    bool ok = waitFor([&]() { return charger->isConnected(); }, SESSION_TIMEOUT_MS);
+    if (!ok) {
+        std::fprintf(stderr, "soak: the simulated charger did not connect\n");
+    }
+
+    b6::ChargeProfile profile;
+    std::memset(&profile, 0, sizeof(profile));
+    profile.batteryType = b6::BATTERY_TYPE::LIPO;
+    profile.cellCount = CELLS;
+    profile.chargeCurrent = 2000;
+    profile.dischargeCurrent = 2000;
+    profile.cellDischargeVoltage = 3300;
+    profile.endVoltage = 4200;
+
+    const int warmUp = std::min(sessions, std::max(10, sessions / 10));
+    const int progressEvery = std::max(1, sessions / 20);
+    long warmKb = -1, peakKb = 0, rssKb = -1;
+    std::size_t samples = 0;
+    for (int i = 0; ok && i < sessions; i++) {
+        profile.mode.li = i % 2 == 0 ? b6::CHARGING_MODE_LI::BALANCE : b6::CHARGING_MODE_LI::DISCHARGE;
+        charger->startCharging(profile.batteryType, profile);
+        ok = waitFor([&]() { return charger->isCharging(); }, SESSION_TIMEOUT_MS) &&
+             waitFor([&]() { return !charger->isCharging(); }, SESSION_TIMEOUT_MS);
+        if (!ok) {
+            std::fprintf(stderr, "soak: charge %d did not finish\n", i + 1);
+            break;
+        }
+        samples += charger->store().size();
+
+        // let the scheduler commit the last frame, then paint it
+        charts->renderScheduler()->commit();
+        for (auto &view : views) {
+            QPainter painter(&image);
+            view->render(&painter);
+        }
+
+        rssKb = residentKb();
+        if (i + 1 == warmUp) {
+            warmKb = rssKb;
+        }
+        peakKb = std::max(peakKb, rssKb);
+        if ((i + 1) % progressEvery == 0) {
+            std::fprintf(stderr, "soak: %d/%d charges, %zu samples, rss %ld kB, store pool %zu kB\n", i + 1, sessions,
+                         samples, rssKb, TelemetryChunkPool::instance().bytes() / 1024);
+        }
+    }
+
+    // the views own the charts they show, hand them back to SessionCharts
+    for (auto &view : views) {
+        view->setChart(new QChart());
+    }
+    charger.reset();
+    removeLogs();
+    if (!ok) {
+        return false;
+    }
+
+    const long growthKb = rssKb - warmKb;
+    const long allowedKb = std::max(SLACK_KB, warmKb / 50);
+    std::fprintf(out, "soak: %d charges, %zu samples, rss %ld kB after %d charges, %ld kB at the end (%+ld kB, "
+                      "%ld kB allowed), peak %ld kB\n",
+                 sessions, samples, warmKb, warmUp, rssKb, growthKb, allowedKb, peakKb);
+    if (warmKb < 0 || rssKb < 0) {
+        std::fprintf(out, "soak: cannot read the resident set size on this system\n");
+        return false;
+    }
+    if (growthKb > allowedKb) {
+        std::fprintf(out, "soak: memory keeps growing\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,174 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sample ingestion: the worker to GUI hand-off, appending to the
+ * TelemetryStore with and without a memory budget, reading it back
+ * column-wise, the running charge analytics and forecast and building the
+ * chart LOD.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "acquisitionworker.h"
+#include "benchmark.h"
+#include "chargeanalytics.h"
+#include "chargeforecast.h"
+#include "lodseries.h"
+#include "samplingpolicy.h"
+#include "telemetrystore.h"
+
+static const int CELLS = 6;
+
+void Bench::storeBenchmarks(Runner &runner) {
+    const QVector<Session> lengths = sessions();
+    const std::vector<b6::ChargeInfo> samples = chargeSamples(lengths.last().samples(), CELLS);
+
+    // one batch through the SPSC queue, as ChargerSession::onSamplesReady() drains it
+    AcquisitionWorker::Queue queue;
+    TelemetryStore handoff(CELLS);
+    std::size_t next = 0;
+    runner.run("ingest/queue_to_store", "batch=256", [&]() {
+        if (handoff.size() >= samples.size()) {
+            handoff.reset(CELLS);
+        }
+        for (int i = 0; i < 256; i++) {
+            AcquisitionWorker::Sample sample;
+            sample.info = samples[next++ % samples.size()];
+            sample.timeMs = static_cast<uint32_t>(sample.info.time * 1000);
+            queue.push(sample);
+        }
+        AcquisitionWorker::Sample sample;
+        while (queue.pop(sample)) {
+            handoff.append(sample.timeMs, sample.info);
+        }
+    }, 256);
+
+    // what the acquisition thread adds to every poll: the read timing, the stamp and the adaptive interval
+    SamplingPolicy sampling;
+    SampleClock clock;
+    sampling.reset(1000, 0);
+    int64_t hostMs = 0;
+    std::size_t polled = 0;
+    runner.run("ingest/sampling", "batch=256", [&]() {
+        for (int i = 0; i < 256; i++) {
+            const b6::ChargeInfo &info = samples[polled++ % samples.size()];
+            hostMs += 1000;
+            sampling.recordRead(6000000);
+            keep(sampling.update(clock.stamp(info.time, hostMs), info));
+        }
+    }, 256);
+
+    TelemetryStore store(CELLS);
+    for (const Session &session : lengths) {
+        const std::size_t count = session.samples();
+        runner.run("ingest/store_append", session.params, [&]() {
+            store.reset(CELLS);
+            for (std::size_t i = 0; i < count; i++) {
+                store.append(session.timeMs(i), samples[i]);
+            }
+        }, count, count * sizeof(b6::ChargeInfo));
+
+        // the same with a budget a fraction of the session, so most of it gets coarsened on the way
+        TelemetryStore budgeted(CELLS);
+        budgeted.setBudget(count * budgeted.bytesPerSample() / 8);
+        runner.run("ingest/store_append_budget", session.params, [&]() {
+            budgeted.reset(CELLS);
+            for (std::size_t i = 0; i < count; i++) {
+                budgeted.append(session.timeMs(i), samples[i]);
+            }
+        }, count, count * sizeof(b6::ChargeInfo));
+
+        // wherever the capacity only counted up, over both buckets of a pair of rows, it has to read back that
+        // way, CapacityAxis stops at the first step back
+        std::vector<std::size_t> drops(count, 0);
+        for (std::size_t i = 1; i < count; i++) {
+            drops[i] = drops[i - 1] + (samples[i].capacity < samples[i - 1].capacity ? 1 : 0);
+        }
+        for (std::size_t i = 1; i < budgeted.size(); i++) {
+            const std::size_t first = (i - 1) / budgeted.resolution(i - 1) * budgeted.resolution(i - 1);
+            const std::size_t last = std::min(i / budgeted.resolution(i) * budgeted.resolution(i) +
+                                              budgeted.resolution(i) - 1, count - 1);
+            if (drops[last] == drops[first] && budgeted.capacity(i) < budgeted.capacity(i - 1)) {
+                std::fprintf(stderr, "ingest/store_append_budget %s: capacity goes back at sample %zu\n",
+                             qPrintable(session.params), i);
+                break;
+            }
+        }
+
+        // what ChargerSession adds to every sample
+        ChargeAnalytics analytics;
+        runner.run("analytics/update", session.params, [&]() {
+            analytics.reset();
+            for (std::size_t i = 0; i < count; i++) {
+                analytics.update(session.timeMs(i), samples[i]);
+            }
+            keep(analytics.figures().energyWh);
+        }, count);
+
+        // see --forecast for how good the forecast is
+        b6::ChargeProfile profile;
+        std::memset(&profile, 0, sizeof(profile));
+        profile.cellCount = CELLS;
+        profile.mode.li = b6::CHARGING_MODE_LI::BALANCE;
+        ChargeForecast forecast;
+        runner.run("forecast/update", session.params, [&]() {
+            forecast.configure(b6::BATTERY_TYPE::LIPO, profile);
+            for (std::size_t i = 0; i < count; i++) {
+                forecast.update(session.timeMs(i), samples[i], analytics.figures());
+            }
+            keep(forecast.forecast());
+        }, count);
+
+        AnalyticsColumn slope(&store, AnalyticsColumn::VOLTAGE_SLOPE);
+        runner.run("analytics/slope_scan", session.params, [&]() {
+            double sum = 0.0;
+            for (std::size_t i = 0; i < slope.size(); i++) {
+                sum += slope.at(i).y;
+            }
+            keep(sum);
+        }, count);
+
+        TelemetryColumn voltage(&store, TelemetryStore::VOLTAGE, 0, 0.001);
+        runner.run("store/column_scan", session.params, [&]() {
+            double sum = 0.0;
+            for (std::size_t i = 0; i < voltage.size(); i++) {
+                sum += voltage.at(i).y;
+            }
+            keep(sum);
+        }, count, count * 2);
+
+        runner.run("lod/build", session.params, [&]() {
+            LodSeries lod(&voltage);
+            lod.update();
+            keep(lod);
+        }, count);
+
+        LodSeries lod(&voltage);
+        lod.update();
+        std::vector<LodSeries::Point> points;
+        const double end = store.timeMs(count - 1) / 1000.0;
+        runner.run("lod/query_full", session.params, [&]() {
+            lod.query(0.0, end, 1000, points);
+        }, 1);
+        runner.run("lod/query_last_10min", session.params, [&]() {
+            lod.query(end - 600.0, end, 1000, points);
+        }, 1);
+    }
+}
@@ -0,0 +1,201 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "chargeanalytics.h"
+#include "telemetrystore.h"
+
+// time constants of the smoothing, ms
+static const double VOLTAGE_TAU_MS = 5000.0;
+static const double SLOPE_TAU_MS = 30000.0;
+static const double TEMP_TAU_MS = 120000.0;
+// a step further apart than this is a gap in the data, not a step
+static const uint32_t STEP_MAX_MS = 5000;
+// how much a new resistance estimate moves the running one
+static const float RESISTANCE_WEIGHT = 0.3f;
+// -dV right after the start is the pack settling, not the end of the charge
+static const uint32_t DELTA_V_HOLDOFF_MS = 120000;
+static const int EMPTY_CELL_MV = 400;
+
+static double smoothing(double dtMs, double tauMs) {
+    return dtMs / (tauMs + dtMs);
+}
+
+ChargeAnalytics::ChargeAnalytics() {
+    reset();
+}
+
+void ChargeAnalytics::reset() {
+    m_figures = Figures();
+    m_samples = 0;
+    m_fromRest = false;
+    m_lastTime = 0;
+    m_lastCurrent = 0;
+    m_lastVoltage = 0;
+    std::fill(m_lastCells, m_lastCells + CELLS, 0.0f);
+    m_voltage = 0.0;
+    m_temp = 0.0;
+}
+
+void ChargeAnalytics::startCharge() {
+    if (m_samples == 0) {
+        return;
+    }
+    m_figures = Figures();
+    m_fromRest = true;
+}
+
+int ChargeAnalytics::cellSpread(const int *cells, int count, int *active) {
+    int high = 0, low = 65535, connected = 0;
+    for (int i = 0; i < count; i++) {
+        const bool on = cells[i] > EMPTY_CELL_MV;
+        high = std::max(high, on ? cells[i] : 0);
+        low = std::min(low, on ? cells[i] : 65535);
+        connected += on;
+    }
+    if (active != nullptr) {
+        *active = connected;
+    }
+    return connected > 0 ? high - low : 0;
+}
+
+void ChargeAnalytics::update(uint32_t timeMs, const b6::ChargeInfo &info) {
+    Figures &f = m_figures;
+    const int temp = info.tempExt > 0 ? info.tempExt : info.tempInt;
+
+    float cells[CELLS];
+    for (int i = 0; i < CELLS; i++) {
+        cells[i] = static_cast<float>(info.cells[i]);
+    }
+    f.cellSpread = cellSpread(info.cells, CELLS, &f.cellCount);
+    f.maxCellSpread = std::max(f.maxCellSpread, f.cellSpread);
+
+    if (m_samples == 0) {
+        m_voltage = info.voltage;
+        m_temp = temp;
+        f.peakVoltage = info.voltage;
+    } else if (m_fromRest) {
+        // the charger's clock starts over with the charge, only the step is of use
+        m_estimateResistance(info, cells);
+        m_voltage = info.voltage;
+        m_temp = temp;
+        f.peakVoltage = info.voltage;
+    } else if (timeMs > m_lastTime) {
+        const double dt = timeMs - m_lastTime;
+
+        // trapezoid of V * I, mV * mA * ms = 1e-9 J
+        const double power = (static_cast<double>(m_lastVoltage) * std::abs(m_lastCurrent) +
+                              static_cast<double>(info.voltage) * std::abs(info.current)) / 2.0;
+        f.energyWh += power * dt / 3.6e12;
+
+        if (dt <= STEP_MAX_MS) {
+            m_estimateResistance(info, cells);
+        }
+
+        const double voltage = m_voltage + smoothing(dt, VOLTAGE_TAU_MS) * (info.voltage - m_voltage);
+        const double slope = (voltage - m_voltage) * 60000.0 / dt;
+        f.voltageSlope += smoothing(dt, SLOPE_TAU_MS) * (slope - f.voltageSlope);
+        m_voltage = voltage;
+
+        const double smoothedTemp = m_temp + smoothing(dt, TEMP_TAU_MS) * (temp - m_temp);
+        f.tempSlope = (smoothedTemp - m_temp) * 60000.0 / dt;
+        m_temp = smoothedTemp;
+
+        f.peakVoltage = std::max(f.peakVoltage, m_voltage);
+        f.dropFromPeak = f.peakVoltage - m_voltage;
+        if (m_deltaVThreshold > 0 && timeMs >= DELTA_V_HOLDOFF_MS && f.dropFromPeak >= m_deltaVThreshold) {
+            f.deltaV = true;
+        }
+    }
+
+    m_samples++;
+    m_fromRest = false;
+    m_lastTime = timeMs;
+    m_lastCurrent = info.current;
+    m_lastVoltage = info.voltage;
+    std::copy(cells, cells + CELLS, m_lastCells);
+}
+
+void ChargeAnalytics::m_estimateResistance(const b6::ChargeInfo &info, const float *cells) {
+    // R = dV / dI across a current step, mV / mA = Ohm
+    const int step = info.current - m_lastCurrent;
+    if (std::abs(step) < STEP_MA) {
+        return;
+    }
+    Figures &f = m_figures;
+    const float perMa = 1000.0f / static_cast<float>(step);
+    const float pack = (info.voltage - m_lastVoltage) * perMa;
+    if (pack > 0.0f) {
+        f.resistance = f.resistance > 0.0 ? f.resistance + RESISTANCE_WEIGHT * (pack - f.resistance) : pack;
+    }
+    for (int i = 0; i < CELLS; i++) {
+        const float estimate = std::max((cells[i] - m_lastCells[i]) * perMa, 0.0f);
+        const float weight = f.cellResistance[i] > 0.0f ? RESISTANCE_WEIGHT : 1.0f;
+        const bool on = cells[i] > EMPTY_CELL_MV && m_lastCells[i] > EMPTY_CELL_MV;
+        f.cellResistance[i] = on ? f.cellResistance[i] + weight * (estimate - f.cellResistance[i]) : 0.0f;
+    }
+}
+
+std::size_t AnalyticsColumn::size() const {
+    return m_store->size();
+}
+
+std::size_t AnalyticsColumn::resolution(std::size_t index) const {
+    return m_store->resolution(index);
+}
+
+LodSeries::Point AnalyticsColumn::at(std::size_t index) const {
+    const uint32_t time = m_store->timeMs(index);
+    LodSeries::Point point = { time / 1000.0, 0.0 };
+    if (m_figure == CELL_SPREAD) {
+        int cells[ChargeAnalytics::CELLS] = {};
+        for (int i = 0; i < m_store->cellCount(); i++) {
+            cells[i] = m_store->cell(i, index);
+        }
+        point.y = ChargeAnalytics::cellSpread(cells, m_store->cellCount());
+        return point;
+    }
+
+    // the first row less than a window back: gallop, then bisect
+    if (index == 0 || time < WINDOW_MS) {
+        return point;
+    }
+    const uint32_t from = time - WINDOW_MS;
+    std::size_t high = index, step = 1;
+    while (step <= high && m_store->timeMs(high - step) > from) {
+        high -= step;
+        step *= 2;
+    }
+    std::size_t low = step <= high ? high - step : 0;
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        if (m_store->timeMs(middle) > from) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    const std::size_t first = low > 0 ? low - 1 : 0;
+    const uint32_t span = time - m_store->timeMs(first);
+    if (span > 0) {
+        point.y = (m_store->voltage(index) - m_store->voltage(first)) * 60000.0 / span;
+    }
+    return point;
+}
@@ -0,0 +1,115 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARGEANALYTICS_H
+#define CHARGEANALYTICS_H
+
+#include <cstdint>
+#include <b6/Device.hh>
+#include "lodseries.h"
+
+class TelemetryStore;
+
+/*
+ * Running figures of one charge, updated in constant time per sample: energy,
+ * pack and per-cell internal resistance from current steps, smoothed dV/dt,
+ * the voltage peak and -dV for the Ni modes, the temperature rise rate and
+ * the spread between the cells. Smoothing is exponential with time constants
+ * in seconds, so it does not depend on the sample rate.
+ *
+ * The per-cell figures are kept as arrays of all eight balance ports and
+ * computed without branches over every lane, unused ports included, which
+ * the compiler turns into vector code.
+ */
+class ChargeAnalytics {
+public:
+    static const int CELLS = 8;
+
+    struct Figures {
+        double energyWh = 0.0;
+        double resistance = 0.0;            // pack, mOhm, 0 until the first current step
+        float cellResistance[CELLS] = {};   // mOhm, 0 until the first current step
+        double voltageSlope = 0.0;          // mV/min
+        double peakVoltage = 0.0;           // highest smoothed pack voltage, mV
+        double dropFromPeak = 0.0;          // mV below the peak
+        bool deltaV = false;                // dropped by the -dV threshold since the peak
+        double tempSlope = 0.0;             // degrees C/min, the external probe if there is one
+        int cellCount = 0;                  // balance ports with a cell on them
+        int cellSpread = 0;                 // mV between the highest and the lowest cell
+        int maxCellSpread = 0;
+    };
+
+    // a current change at least this big between two samples gives a resistance estimate
+    static const int STEP_MA = 200;
+    // -dV per cell that counts as the end of a Ni charge, mV
+    static const int NI_DELTA_V_PER_CELL = 3;
+
+    ChargeAnalytics();
+
+    void reset();
+    // clears the figures for a new charge but remembers the last sample, so the
+    // step from rest onto the charge current gives the first resistance estimate
+    void startCharge();
+    // -dV that ends a Ni charge, mV for the whole pack; 0 to only track the peak
+    void setDeltaVThreshold(int mV) { m_deltaVThreshold = mV; }
+    void update(uint32_t timeMs, const b6::ChargeInfo &info);
+
+    bool empty() const { return m_samples == 0; }
+    const Figures &figures() const { return m_figures; }
+
+    // spread of the cells in mV, ports below 0.4 V count as empty
+    static int cellSpread(const int *cells, int count, int *active = nullptr);
+
+private:
+    Figures m_figures;
+    int m_deltaVThreshold = 0;
+    uint64_t m_samples = 0;
+    bool m_fromRest = false;            // the next sample is the first of a charge
+    uint32_t m_lastTime = 0;
+    int m_lastCurrent = 0;
+    int m_lastVoltage = 0;
+    float m_lastCells[CELLS] = {};
+    double m_voltage = 0.0;             // smoothed, mV
+    double m_temp = 0.0;                // smoothed, degrees C
+
+    void m_estimateResistance(const b6::ChargeInfo &info, const float *cells);
+};
+
+/*
+ * A figure of ChargeAnalytics over a whole TelemetryStore, for the charts:
+ * the spread between the cells, or dV/dt over the last WINDOW_MS. Computed
+ * from the stored rows when asked, so it takes no memory of its own.
+ */
+class AnalyticsColumn : public LodSeries::Source {
+public:
+    enum Figure { CELL_SPREAD, VOLTAGE_SLOPE };
+
+    static const uint32_t WINDOW_MS = 60000;
+
+    AnalyticsColumn(const TelemetryStore *store, Figure figure) : m_store(store), m_figure(figure) {}
+
+    std::size_t size() const override;
+    std::size_t resolution(std::size_t index) const override;
+    LodSeries::Point at(std::size_t index) const override;
+
+private:
+    const TelemetryStore *m_store;
+    Figure m_figure;
+};
+
+#endif // CHARGEANALYTICS_H
@@ -0,0 +1,169 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <QCoreApplication>
+#include "chargedaemon.h"
+#include "telemetryformat.h"
+
+ChargeDaemon::ChargeDaemon(const Options &options, QObject *parent) : QObject(parent), m_options(options) {
+    m_devices = new DeviceManager(this);
+    connect(m_devices, SIGNAL(sessionAdded(ChargerSession*)), this, SLOT(onSessionAdded(ChargerSession*)));
+    m_history = new SessionHistory(this);
+    m_history->watch(m_devices);
+}
+
+bool ChargeDaemon::start() {
+    if (!m_history->open(SessionHistory::defaultPath())) {
+        // charging does not depend on it
+        std::fprintf(stderr, "cannot open the session history: %s\n", qPrintable(m_history->errorString()));
+    }
+    if (!m_options.listen.isEmpty()) {
+        m_server = new TelemetryServer(m_devices, this);
+        if (!m_server->listen(m_options.listen)) {
+            std::fprintf(stderr, "cannot listen on %s\n", qPrintable(m_options.listen));
+            return false;
+        }
+    }
+
+    if (!m_options.jobs.isEmpty()) {
+        m_scheduler = new ChargeScheduler(m_devices, this);
+        connect(m_scheduler, SIGNAL(jobChanged(int)), this, SLOT(onJobChanged(int)));
+        connect(m_scheduler, SIGNAL(jobFinished(int)), this, SLOT(onJobFinished(int)));
+        for (const QString &steps : m_options.jobs) {
+            ChargeScheduler::Job job;
+            job.batteryType = m_options.batteryType;
+            job.profile = m_options.profile;
+            job.location = m_options.location;
+            job.pack = m_options.pack;
+            QString error = "unknown steps";
+            if (!ChargeScheduler::parseSteps(steps, job.steps) || m_scheduler->addJob(job, &error) < 0) {
+                std::fprintf(stderr, "cannot queue job %s: %s\n", qPrintable(steps), qPrintable(error));
+                return false;
+            }
+        }
+    }
+
+    if (m_options.format == CSV) {
+        m_write(TelemetryFormat::csvHeader(8));
+    }
+    m_devices->start();
+    for (const QString &spec : m_options.virtualDevices) {
+        m_devices->addVirtualDevice(spec);
+    }
+    return true;
+}
+
+void ChargeDaemon::onSessionAdded(ChargerSession *session) {
+    if (!m_options.location.isEmpty() && session->location() != m_options.location) {
+        return;
+    }
+
+    connect(session, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(session, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(session, SIGNAL(chargeInfoUpdated()), this, SLOT(onChargeInfoUpdated()));
+    connect(session, SIGNAL(chargingCompleted(b6::ChargeInfo)), this, SLOT(onChargingCompleted(b6::ChargeInfo)));
+    connect(session, SIGNAL(chargingError(QString)), this, SLOT(onChargingError(QString)));
+}
+
+void ChargeDaemon::onConnected() {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    m_event(session, "connected", session->deviceInfo().coreType);
+
+    // a charger that comes back after an unplug is not commanded twice
+    if (m_commanded.contains(session) || m_scheduler != nullptr) {
+        return;
+    }
+    m_commanded.insert(session);
+    if (m_options.start) {
+        session->startCharging(m_options.batteryType, m_options.profile, m_options.pack);
+    } else if (m_options.stop) {
+        session->stopCharging();
+    }
+}
+
+void ChargeDaemon::onDisconnected() {
+    m_event(static_cast<ChargerSession*>(sender()), "disconnected");
+}
+
+void ChargeDaemon::onChargeInfoUpdated() {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    if (m_options.format == CSV) {
+        m_write(TelemetryFormat::sampleCsv(session->location(), session->chargeInfo(), 8));
+    } else {
+        m_write(TelemetryFormat::sampleJson(session->location(), session->chargeTimeMs(), session->chargeInfo(), session->deviceInfo().cellCount));
+    }
+
+    if (!m_options.exitWhenDone || m_scheduler != nullptr) {
+        return;
+    }
+    if (session->isCharging()) {
+        m_seenCharging.insert(session);
+    } else if (m_seenCharging.contains(session) || !m_options.start) {
+        QCoreApplication::quit();
+    }
+}
+
+void ChargeDaemon::onChargingCompleted(b6::ChargeInfo) {
+    m_event(static_cast<ChargerSession*>(sender()), "completed");
+}
+
+void ChargeDaemon::onChargingError(QString message) {
+    m_event(static_cast<ChargerSession*>(sender()), "error", message);
+}
+
+void ChargeDaemon::onJobChanged(int id) {
+    const ChargeScheduler::Job *job = m_scheduler->job(id);
+    ChargerSession *session = m_devices->session(job->charger);
+    if (job->state != ChargeScheduler::RUNNING || session == nullptr) {
+        return;
+    }
+
+    const QVector<ChargeScheduler::Step> step = { job->steps[job->step] };
+    m_event(session, "job-step", QString("%1: step %2 of %3, %4").arg(job->name).arg(job->step + 1)
+                                    .arg(job->steps.size()).arg(ChargeScheduler::describeSteps(step)));
+}
+
+void ChargeDaemon::onJobFinished(int id) {
+    const ChargeScheduler::Job *job = m_scheduler->job(id);
+    ChargerSession *session = m_devices->session(job->charger);
+    if (session != nullptr) {
+        const QString results = ChargeScheduler::describeResults(*job);
+        if (job->state == ChargeScheduler::DONE) {
+            m_event(session, "job-done", QString("%1: %2").arg(job->name, results));
+        } else {
+            m_event(session, "job-failed", QString("%1: %2").arg(job->name, job->message));
+        }
+    }
+
+    if (m_options.exitWhenDone && m_scheduler->isIdle()) {
+        QCoreApplication::quit();
+    }
+}
+
+void ChargeDaemon::m_write(const QByteArray &data) {
+    std::fwrite(data.constData(), 1, static_cast<std::size_t>(data.size()), stdout);
+    std::fflush(stdout);
+}
+
+void ChargeDaemon::m_event(ChargerSession *session, const QString &event, const QString &message) {
+    // CSV carries samples only
+    if (m_options.format == JSON) {
+        m_write(TelemetryFormat::eventJson(session->location(), event, message));
+    }
+}
@@ -0,0 +1,84 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARGEDAEMON_H
+#define CHARGEDAEMON_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include "chargescheduler.h"
+#include "chargersession.h"
+#include "devicemanager.h"
+#include "sessionhistory.h"
+#include "telemetryserver.h"
+
+/*
+ * Headless front end: attaches to chargers like the GUI does, optionally
+ * starts or stops a charge on them or runs a queue of jobs through a
+ * ChargeScheduler, and streams their telemetry to stdout and, if asked to,
+ * to local socket clients through a TelemetryServer. Every charge that ends
+ * is added to the SessionHistory.
+ */
+class ChargeDaemon : public QObject {
+    Q_OBJECT
+public:
+    enum Format { JSON, CSV };
+
+    struct Options {
+        QString location;            // only this charger, any if empty
+        bool start = false;
+        b6::BATTERY_TYPE batteryType = b6::BATTERY_TYPE::LIPO;
+        b6::ChargeProfile profile = {};
+        QString pack;                // battery pack charged, for the session history
+        bool stop = false;
+        Format format = JSON;
+        bool exitWhenDone = false;   // quit once the charger is no longer charging, or the jobs are done
+        QStringList jobs;            // steps of jobs to queue, see ChargeScheduler::parseSteps()
+        QString listen;              // local socket to serve telemetry on, none if empty
+        QStringList virtualDevices;  // specs of simulated or replayed chargers to add
+    };
+
+    explicit ChargeDaemon(const Options &options, QObject *parent = 0);
+
+    bool start();
+
+private slots:
+    void onSessionAdded(ChargerSession *session);
+    void onConnected();
+    void onDisconnected();
+    void onChargeInfoUpdated();
+    void onChargingCompleted(b6::ChargeInfo info);
+    void onChargingError(QString message);
+    void onJobChanged(int id);
+    void onJobFinished(int id);
+
+private:
+    Options m_options;
+    DeviceManager *m_devices;
+    TelemetryServer *m_server = nullptr;
+    ChargeScheduler *m_scheduler = nullptr;
+    SessionHistory *m_history;
+    QSet<ChargerSession*> m_commanded;
+    QSet<ChargerSession*> m_seenCharging;
+
+    void m_write(const QByteArray &data);
+    void m_event(ChargerSession *session, const QString &event, const QString &message = QString());
+};
+
+#endif // CHARGEDAEMON_H
@@ -0,0 +1,354 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cmath>
+#include "chargeforecast.h"
+
+static const double CURRENT_TAU_MS = 10000.0;
+// points this much older than the newest count e^-1 as much in the fits
+static const double FIT_MEMORY_MS = 600000.0;
+// nothing is forecast before the fit spans this long
+static const uint32_t SETTLE_MS = 60000;
+// CV starts once the current falls below this much of the CC current, and ends at TERMINATION of it
+static const double CV_CURRENT_FRACTION = 0.9;
+static const double TERMINATION_FRACTION = 0.1;
+// CV time constant before anything better is known, s
+static const double CV_TAU_PRIOR_S = 900.0;
+static const double CV_TAU_MIN_S = 60.0;
+static const double CV_TAU_MAX_S = 4 * 3600.0;
+// how long a Ni charge runs past the peak until -dV ends it, min
+static const double NI_TAIL_MIN = 5.0;
+// the band: standard deviations of the fitted slope, plus how far the model itself may be off
+static const double SIGMAS = 2.0;
+static const double CC_MARGIN = 0.25;
+// the CV current decays slower than exponential towards the end, more so above than below
+static const double CV_MARGIN_LOW = 0.2;
+static const double CV_MARGIN_HIGH = 1.0;
+static const double NI_MARGIN = 0.4;
+// beyond this a forecast says nothing
+static const double HORIZON_MIN = 24 * 60.0;
+
+enum { EXPECTED, LOW, HIGH };
+
+static double smoothing(double dtMs, double tauMs) {
+    return dtMs / (tauMs + dtMs);
+}
+
+int ChargeForecast::endVoltage(b6::BATTERY_TYPE type) {
+    switch (type) {
+    case b6::BATTERY_TYPE::LIIO: return 4100;
+    case b6::BATTERY_TYPE::LIFE: return 3600;
+    case b6::BATTERY_TYPE::LIHV: return 4350;
+    case b6::BATTERY_TYPE::NIMH: return 1450;
+    case b6::BATTERY_TYPE::NICD: return 1450;
+    case b6::BATTERY_TYPE::PB:   return 2400;
+    default:                     return 4200;
+    }
+}
+
+void ChargeForecast::configure(b6::BATTERY_TYPE type, const b6::ChargeProfile &profile) {
+    const int cells = std::max<int>(profile.cellCount, 1);
+    m_kind = NO_FORECAST;
+    m_deltaV = 0;
+    m_cellTarget = 0;
+    if (b6::Device::isBatteryLi(type)) {
+        const bool charge = profile.mode.li != b6::CHARGING_MODE_LI::DISCHARGE &&
+                            profile.mode.li != b6::CHARGING_MODE_LI::STORAGE;
+        m_kind = charge ? CC_CV : NO_FORECAST;
+        const int cellTarget = profile.endVoltage > 0 ? profile.endVoltage : endVoltage(type);
+        m_targetVoltage = cells * cellTarget;
+        // the balancer holds back whichever cell gets there first
+        m_cellTarget = profile.mode.li == b6::CHARGING_MODE_LI::BALANCE ? cellTarget : 0;
+    } else if (b6::Device::isBatteryNi(type)) {
+        // a cycle starts with a discharge
+        const bool charge = profile.mode.ni != b6::CHARGING_MODE_NI::DISCHARGE &&
+                            profile.mode.ni != b6::CHARGING_MODE_NI::CYCLE;
+        m_kind = charge ? DELTA_V : NO_FORECAST;
+        m_targetVoltage = cells * endVoltage(type);
+        m_deltaV = cells * ChargeAnalytics::NI_DELTA_V_PER_CELL;
+    } else {
+        m_kind = profile.mode.pb == b6::CHARGING_MODE_PB::CHARGE ? CC_CV : NO_FORECAST;
+        m_targetVoltage = cells * endVoltage(type);
+    }
+    reset();
+}
+
+void ChargeForecast::setLimits(int capacity, uint32_t timeS) {
+    m_capacityLimit = capacity;
+    m_timeLimitS = timeS;
+}
+
+void ChargeForecast::reset() {
+    m_forecast = Forecast();
+    m_fit.reset(2);
+    m_samples = 0;
+    m_lastTime = 0;
+    m_phaseStart = 0;
+    m_current = 0.0;
+    m_ccCurrent = 0.0;
+}
+
+void ChargeForecast::clear() {
+    m_kind = NO_FORECAST;
+    reset();
+}
+
+void ChargeForecast::update(uint32_t timeMs, const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures) {
+    if (m_kind == NO_FORECAST) {
+        return;
+    }
+    Forecast &f = m_forecast;
+
+    double forget = 1.0;
+    if (m_samples == 0 || timeMs < m_lastTime) {
+        reset();
+        f.phase = CONSTANT_CURRENT;
+        m_phaseStart = timeMs;
+        m_byCell = m_cellTarget > 0 && *std::max_element(info.cells, info.cells + 8) > 0;
+        // the voltage bends up towards the end, the CV current is fitted as a straight line in log space
+        m_fit.reset(3);
+        m_current = info.current;
+    } else {
+        const double dt = timeMs - m_lastTime;
+        m_current += smoothing(dt, CURRENT_TAU_MS) * (info.current - m_current);
+        forget = std::exp(-dt / FIT_MEMORY_MS);
+    }
+    m_ccCurrent = std::max(m_ccCurrent, m_current);
+    m_samples++;
+    m_lastTime = timeMs;
+
+    // phases only ever advance
+    if (f.phase == CONSTANT_CURRENT && m_kind == CC_CV && timeMs - m_phaseStart >= SETTLE_MS &&
+            m_current < CV_CURRENT_FRACTION * m_ccCurrent) {
+        f.phase = CONSTANT_VOLTAGE;
+        m_phaseStart = timeMs;
+        m_fit.reset(2);
+    } else if (f.phase == CONSTANT_CURRENT && m_kind == DELTA_V && timeMs - m_phaseStart >= SETTLE_MS &&
+               (figures.peakVoltage >= m_targetVoltage || figures.dropFromPeak * 3 >= m_deltaV)) {
+        f.phase = PEAK;
+    }
+
+    const double minutes = (timeMs - m_phaseStart) / 60000.0;
+    if (f.phase == CONSTANT_CURRENT) {
+        m_fit.add(minutes, m_byCell ? *std::max_element(info.cells, info.cells + 8) : info.voltage, forget);
+    } else if (f.phase == CONSTANT_VOLTAGE) {
+        m_fit.add(minutes, std::log(std::max(info.current, 1)), forget);
+    }
+
+    Estimate e;
+    const bool settled = f.phase == PEAK || (m_fit.count >= 3 && m_fit.last - m_fit.first >= SETTLE_MS / 60000.0);
+    f.valid = settled && (m_kind == CC_CV ? m_predictCcCv(minutes, info, figures, e)
+                                          : m_predictDeltaV(minutes, info, figures, e));
+    if (!f.valid) {
+        return;
+    }
+    m_applyLimits(timeMs, info, e);
+    if (e.minutes[EXPECTED] > HORIZON_MIN) {
+        f.valid = false;
+        return;
+    }
+
+    f.remainingS = static_cast<uint32_t>(std::lround(e.minutes[EXPECTED] * 60.0));
+    f.remainingLowS = static_cast<uint32_t>(std::lround(std::min(e.minutes[LOW], e.minutes[EXPECTED]) * 60.0));
+    f.remainingHighS = static_cast<uint32_t>(std::lround(std::min(std::max(e.minutes[HIGH], e.minutes[EXPECTED]), HORIZON_MIN) * 60.0));
+    f.finalCapacity = static_cast<int>(std::lround(e.capacity[EXPECTED]));
+    f.finalCapacityLow = static_cast<int>(std::lround(std::min(e.capacity[LOW], e.capacity[EXPECTED])));
+    f.finalCapacityHigh = static_cast<int>(std::lround(std::max(e.capacity[HIGH], e.capacity[EXPECTED])));
+}
+
+bool ChargeForecast::m_extrapolate(double minutes, double margin, double *left, double *slopeAtEnd) const {
+    const int target = m_byCell ? m_cellTarget : m_targetVoltage;
+    const double end = m_fit.reach(target, minutes);
+    if (target == 0 || end < 0.0) {
+        return false;
+    }
+    const double now = m_fit.at(minutes);
+    const double slope = end > minutes ? (target - now) / (end - minutes) : m_fit.slopeAt(minutes);
+    if (slope <= 0.0) {
+        return false;
+    }
+    // the uncertainty of the fitted voltage where it meets the target, as time
+    const double spread = SIGMAS * m_fit.sigmaAt(end) / slope;
+    left[EXPECTED] = end - minutes;
+    left[LOW] = std::max(left[EXPECTED] - spread, 0.0) * (1.0 - margin);
+    left[HIGH] = (left[EXPECTED] + spread) * (1.0 + margin);
+    *slopeAtEnd = std::max(m_fit.slopeAt(end), slope);
+    return true;
+}
+
+bool ChargeForecast::m_predictCcCv(double minutes, const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures,
+                                   Estimate &e) const {
+    const double capacity = info.capacity;
+
+    if (m_forecast.phase == CONSTANT_VOLTAGE) {
+        // I = I0 * e^(c1 * t), c1 < 0, down to the termination current
+        const double slope = m_fit.c[1];
+        if (slope >= 0.0) {
+            return false;
+        }
+        const double sigma = SIGMAS * m_fit.slopeSigma();
+        const double current = std::exp(m_fit.at(minutes));
+        const double end = TERMINATION_FRACTION * m_ccCurrent;
+        const double slopes[3] = { slope, slope - sigma, slope + sigma };
+        for (int i = EXPECTED; i <= HIGH; i++) {
+            const double margin = i == LOW ? 1.0 - CV_MARGIN_LOW : i == HIGH ? 1.0 + CV_MARGIN_HIGH : 1.0;
+            if (slopes[i] >= 0.0) {
+                e.minutes[i] = HORIZON_MIN;
+                e.capacity[i] = capacity + current * HORIZON_MIN / 60.0;
+            } else if (current > end) {
+                e.minutes[i] = std::log(current / end) / -slopes[i] * margin;
+                e.capacity[i] = capacity + (current - end) / -slopes[i] / 60.0 * margin;
+            } else {
+                e.minutes[i] = 0.0;
+                e.capacity[i] = capacity;
+            }
+        }
+        return true;
+    }
+
+    // CC: the voltage up to the setpoint
+    double cc[3], slope;
+    if (m_current <= 0.0 || !m_extrapolate(minutes, CC_MARGIN, cc, &slope)) {
+        return false;
+    }
+
+    // then CV with tau = R * dQ/dV, the incremental capacity taken from the slope at the top
+    double tau = CV_TAU_PRIOR_S;
+    const double resistance = m_byCell && figures.cellCount > 0 ? figures.resistance / figures.cellCount : figures.resistance;
+    if (resistance > 0.0) {
+        const double mvPerMah = slope / (m_current / 60.0);
+        tau = std::min(std::max(resistance / 1000.0 * 3600.0 / mvPerMah, CV_TAU_MIN_S), CV_TAU_MAX_S);
+    }
+    const double cvMinutes = tau * std::log(1.0 / TERMINATION_FRACTION) / 60.0;
+    const double cvCapacity = m_ccCurrent * tau * (1.0 - TERMINATION_FRACTION) / 3600.0;
+    const double cvScale[3] = { 1.0, 0.5, 2.0 };
+    for (int i = EXPECTED; i <= HIGH; i++) {
+        e.minutes[i] = cc[i] + cvMinutes * cvScale[i];
+        e.capacity[i] = capacity + m_current * cc[i] / 60.0 + cvCapacity * cvScale[i];
+    }
+    return true;
+}
+
+bool ChargeForecast::m_predictDeltaV(double minutes, const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures,
+                                     Estimate &e) const {
+    const double capacity = info.capacity;
+    const double tailScale[3] = { 1.0, 0.5, 2.0 };
+
+    double rise[3] = { 0.0, 0.0, 0.0 }, slope;
+    double left = 1.0;
+    if (m_forecast.phase == PEAK) {
+        // past the peak, the rest is how far -dV still has to go
+        left = m_deltaV > 0 ? std::max(1.0 - figures.dropFromPeak / m_deltaV, 0.0) : 1.0;
+    } else if (m_current <= 0.0 || !m_extrapolate(minutes, NI_MARGIN, rise, &slope)) {
+        return false;
+    }
+    for (int i = EXPECTED; i <= HIGH; i++) {
+        e.minutes[i] = rise[i] + NI_TAIL_MIN * left * tailScale[i];
+        e.capacity[i] = capacity + m_current * e.minutes[i] / 60.0;
+    }
+    return true;
+}
+
+void ChargeForecast::m_applyLimits(uint32_t timeMs, const b6::ChargeInfo &info, Estimate &e) const {
+    for (int i = EXPECTED; i <= HIGH; i++) {
+        if (m_capacityLimit > 0 && e.capacity[i] > m_capacityLimit) {
+            const double left = std::max(m_capacityLimit - info.capacity, 0);
+            e.minutes[i] = std::min(e.minutes[i], m_current > 0.0 ? left / m_current * 60.0 : 0.0);
+            e.capacity[i] = m_capacityLimit;
+        }
+        if (m_timeLimitS > 0) {
+            const double left = std::max<double>(m_timeLimitS - timeMs / 1000.0, 0.0) / 60.0;
+            if (e.minutes[i] > left) {
+                e.capacity[i] = std::min(e.capacity[i], info.capacity + m_current * left / 60.0);
+                e.minutes[i] = left;
+            }
+        }
+    }
+}
+
+void ChargeForecast::Fit::reset(int count) {
+    *this = Fit();
+    terms = count;
+}
+
+void ChargeForecast::Fit::add(double x, double y, double forget) {
+    if (count == 0) {
+        c[0] = y;
+        for (int i = 0; i < terms; i++) {
+            p[i][i] = 1e6;
+        }
+        first = x;
+    }
+
+    // gain k = P phi / (forget + phi' P phi), phi = (1, x, x^2)
+    const double phi[3] = { 1.0, x, terms > 2 ? x * x : 0.0 };
+    double pPhi[3] = { 0.0, 0.0, 0.0 };
+    double denominator = forget;
+    for (int i = 0; i < terms; i++) {
+        for (int j = 0; j < terms; j++) {
+            pPhi[i] += p[i][j] * phi[j];
+        }
+        denominator += phi[i] * pPhi[i];
+    }
+    const double error = y - at(x);
+    for (int i = 0; i < terms; i++) {
+        c[i] += pPhi[i] / denominator * error;
+    }
+    // P = (P - k phi' P) / forget
+    for (int i = 0; i < terms; i++) {
+        for (int j = 0; j < terms; j++) {
+            p[i][j] = (p[i][j] - pPhi[i] * pPhi[j] / denominator) / forget;
+        }
+    }
+
+    weight = forget * weight + 1.0;
+    if (count > 0) {
+        variance += (error * error - variance) / weight;
+    }
+    last = x;
+    count++;
+}
+
+double ChargeForecast::Fit::sigmaAt(double x) const {
+    const double phi[3] = { 1.0, x, terms > 2 ? x * x : 0.0 };
+    double spread = 0.0;
+    for (int i = 0; i < terms; i++) {
+        for (int j = 0; j < terms; j++) {
+            spread += phi[i] * p[i][j] * phi[j];
+        }
+    }
+    return std::sqrt(std::max(spread * variance, 0.0));
+}
+
+double ChargeForecast::Fit::slopeSigma() const {
+    return std::sqrt(std::max(p[1][1] * variance, 0.0));
+}
+
+double ChargeForecast::Fit::reach(double y, double from) const {
+    if (at(from) >= y) {
+        return from;
+    }
+    if (c[2] > 0.0) {
+        // opens upwards and is below y at from, so the larger root is ahead
+        const double root = (-c[1] + std::sqrt(c[1] * c[1] - 4.0 * c[2] * (c[0] - y))) / (2.0 * c[2]);
+        return std::max(root, from);
+    }
+    // bending down or straight: on along the slope at from
+    const double slope = slopeAt(from);
+    return slope > 0.0 ? from + (y - at(from)) / slope : -1.0;
+}
@@ -0,0 +1,120 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHARGEFORECAST_H
+#define CHARGEFORECAST_H
+
+#include <cstdint>
+#include <b6/Device.hh>
+#include "chargeanalytics.h"
+
+/*
+ * Online forecast of when a charge ends and how much it will have put in,
+ * updated in constant time per sample. Li and Pb charge CC/CV: during CC the
+ * pack voltage (the highest cell's in a balance charge) is fitted by
+ * recursive least squares and extrapolated to the CV setpoint, the CV phase
+ * is estimated from the internal resistance and the incremental capacity
+ * near the top; once in CV the decay of the current is fitted instead and
+ * extrapolated to the termination current. Ni charges are extrapolated to
+ * the voltage peak, plus the time -dV takes to show.
+ *
+ * Every forecast comes with a band from the uncertainty of the fit and of the
+ * model. Discharges, and charges started from the charger's own buttons, get
+ * no forecast.
+ */
+class ChargeForecast {
+public:
+    enum Phase { NONE, CONSTANT_CURRENT, CONSTANT_VOLTAGE, PEAK };
+
+    struct Forecast {
+        Phase phase = NONE;
+        bool valid = false;
+        uint32_t remainingS = 0;
+        uint32_t remainingLowS = 0, remainingHighS = 0;
+        int finalCapacity = 0;                  // mAh
+        int finalCapacityLow = 0, finalCapacityHigh = 0;
+    };
+
+    ChargeForecast() {}
+
+    // what the coming charge is, resets the forecast
+    void configure(b6::BATTERY_TYPE type, const b6::ChargeProfile &profile);
+    // the charger's own capacity and time limits end a charge too, 0 for none
+    void setLimits(int capacity, uint32_t timeS);
+    void reset();
+    // forgets what the charge was, no forecasts until the next configure()
+    void clear();
+    void update(uint32_t timeMs, const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures);
+
+    const Forecast &forecast() const { return m_forecast; }
+
+    // CV setpoint of a cell of the type, mV; for Ni the voltage it peaks around
+    static int endVoltage(b6::BATTERY_TYPE type);
+
+private:
+    enum Kind { NO_FORECAST, CC_CV, DELTA_V };
+
+    // y = c0 + c1 * x (+ c2 * x^2) by recursive least squares, older points fading out
+    struct Fit {
+        int terms = 2;
+        double c[3] = {};
+        double p[3][3] = {};
+        double variance = 0.0;                  // of the residuals
+        double weight = 0.0;                    // of the points still remembered
+        double first = 0.0, last = 0.0;         // x range seen
+        uint64_t count = 0;
+
+        void reset(int terms);
+        void add(double x, double y, double forget);
+        double at(double x) const { return c[0] + c[1] * x + c[2] * x * x; }
+        double slopeAt(double x) const { return c[1] + 2.0 * c[2] * x; }
+        // standard deviations of at(x) and of c1
+        double sigmaAt(double x) const;
+        double slopeSigma() const;
+        // the first x from `from` on where the fit rises to y, negative if it does not
+        double reach(double y, double from) const;
+    };
+
+    Kind m_kind = NO_FORECAST;
+    int m_targetVoltage = 0;                    // pack, mV
+    int m_cellTarget = 0;                       // balance charges, mV
+    bool m_byCell = false;                      // fitting the highest cell rather than the pack
+    int m_deltaV = 0;                           // pack, mV
+    int m_capacityLimit = 0;
+    uint32_t m_timeLimitS = 0;
+
+    Forecast m_forecast;
+    Fit m_fit;
+    uint64_t m_samples = 0;
+    uint32_t m_lastTime = 0;
+    uint32_t m_phaseStart = 0;
+    double m_current = 0.0;                     // smoothed, mA
+    double m_ccCurrent = 0.0;                   // the highest smoothed current of the charge
+
+    // minutes left and mAh at the end: expected, low, high
+    struct Estimate {
+        double minutes[3];
+        double capacity[3];
+    };
+
+    bool m_extrapolate(double minutes, double margin, double *left, double *slopeAtEnd) const;
+    bool m_predictCcCv(double minutes, const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures, Estimate &e) const;
+    bool m_predictDeltaV(double minutes, const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures, Estimate &e) const;
+    void m_applyLimits(uint32_t timeMs, const b6::ChargeInfo &info, Estimate &e) const;
+};
+
+#endif // CHARGEFORECAST_H
@@ -0,0 +1,117 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include "chargeoverlay.h"
+
+static double maxCell(const SessionLog::Record &record, int cellCount) {
+    uint16_t max = 0;
+    for (int i = 0; i < cellCount; i++) {
+        max = std::max(max, record.cells[i]);
+    }
+    return max / 1000.0;
+}
+
+void ChargeOverlay::Extent::merge(const Extent &other) {
+    if (other.empty) {
+        return;
+    }
+    timeS = std::max(timeS, other.timeS);
+    capacity = std::max(capacity, other.capacity);
+    for (int i = 0; i < FIGURES; i++) {
+        min[i] = empty ? other.min[i] : std::min(min[i], other.min[i]);
+        max[i] = empty ? other.max[i] : std::max(max[i], other.max[i]);
+    }
+    empty = false;
+}
+
+LodSeries::Point ChargeOverlay::Column::at(std::size_t index) const {
+    const SessionLog::Record &record = m_reader->record(index);
+    LodSeries::Point point;
+    point.x = m_alignment == ALIGN_TIME ? record.timeMs / 1000.0 : static_cast<double>(record.capacity);
+    switch (m_figure) {
+    case VOLTAGE:
+        point.y = record.voltage / 1000.0;
+        break;
+    case CAPACITY:
+        point.y = record.capacity;
+        break;
+    case MAX_CELL:
+        point.y = maxCell(record, m_cellCount);
+        break;
+    }
+    return point;
+}
+
+bool ChargeOverlay::add(const std::string &path) {
+    std::unique_ptr<Curve> curve(new Curve());
+    if (!curve->reader.open(path)) {
+        return false;
+    }
+
+    // the valid records, and the ones before the capacity counter first went back
+    const SessionLogReader &reader = curve->reader;
+    const int cellCount = static_cast<int>(std::min<uint32_t>(reader.header().cellCount, 8));
+    std::size_t size = 0, rising = 0;
+    uint32_t lastCapacity = 0;
+    Extent extent;
+    for (; size < reader.size() && SessionLog::isValid(reader.record(size)); size++) {
+        const SessionLog::Record &record = reader.record(size);
+        if (rising == size && record.capacity >= lastCapacity) {
+            rising++;
+            lastCapacity = record.capacity;
+        }
+        const double values[FIGURES] = { record.voltage / 1000.0, static_cast<double>(record.capacity),
+                                         maxCell(record, cellCount) };
+        for (int i = 0; i < FIGURES; i++) {
+            extent.min[i] = extent.empty ? values[i] : std::min(extent.min[i], values[i]);
+            extent.max[i] = extent.empty ? values[i] : std::max(extent.max[i], values[i]);
+        }
+        extent.timeS = record.timeMs / 1000.0;
+        extent.empty = false;
+    }
+    if (size == 0) {
+        return false;
+    }
+    extent.capacity = lastCapacity;
+
+    for (int figure = 0; figure < FIGURES; figure++) {
+        for (int alignment = 0; alignment < ALIGNMENTS; alignment++) {
+            curve->columns[figure][alignment].reset(new Column(&curve->reader, alignment == ALIGN_TIME ? size : rising,
+                                                               cellCount, static_cast<Figure>(figure),
+                                                               static_cast<Alignment>(alignment)));
+        }
+    }
+    m_extent.merge(extent);
+    m_curves.push_back(std::move(curve));
+    return true;
+}
+
+void ChargeOverlay::clear() {
+    m_curves.clear();
+    m_extent = Extent();
+}
+
+void ChargeOverlay::resample(std::size_t curve, Figure figure, Alignment alignment, double xMin, double xMax,
+                             std::size_t buckets, std::vector<LodSeries::Point> &out) {
+    std::unique_ptr<LodSeries> &lod = m_curves[curve]->lods[figure][alignment];
+    if (!lod) {
+        lod.reset(new LodSeries(m_curves[curve]->columns[figure][alignment].get()));
+        lod->update();
+    }
+    lod->query(xMin, xMax, buckets, out);
+}
@@ -0,0 +1,98 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHARGEOVERLAY_H
+#define CHARGEOVERLAY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "lodseries.h"
+#include "sessionlog.h"
+
+/*
+ * Past charges laid over a live one. Each curve reads its session log through
+ * a memory map and keeps a LodSeries per figure and alignment, built the first
+ * time it is asked for, so resampling a curve to the width of a chart costs
+ * the same however long the charge was. A curve is aligned either by the time
+ * since its start or by the capacity charged; the latter only follows the
+ * first phase of a log, up to where the charger's capacity counter restarted.
+ *
+ * Not thread safe: the curves are built lazily, so one thread at a time.
+ */
+class ChargeOverlay {
+public:
+    enum Alignment { ALIGN_TIME, ALIGN_CAPACITY };
+    enum Figure { VOLTAGE, CAPACITY, MAX_CELL };
+    static const int ALIGNMENTS = 2;
+    static const int FIGURES = 3;
+
+    // what the curves span, for the charts' ranges
+    struct Extent {
+        double timeS = 0.0;                  // longest charge
+        double capacity = 0.0;               // highest capacity reached before a restart
+        double min[FIGURES] = {};
+        double max[FIGURES] = {};
+        bool empty = true;
+
+        double x(Alignment alignment) const { return alignment == ALIGN_TIME ? timeS : capacity; }
+        void merge(const Extent &other);
+    };
+
+    ChargeOverlay() {}
+    ChargeOverlay(const ChargeOverlay&) = delete;
+    ChargeOverlay &operator=(const ChargeOverlay&) = delete;
+
+    // maps the log and checks its records, false if it cannot be read or holds none
+    bool add(const std::string &path);
+    void clear();
+    std::size_t size() const { return m_curves.size(); }
+    const Extent &extent() const { return m_extent; }
+
+    // volts, mAh or volts against seconds or mAh, about 2 * buckets points covering [xMin, xMax]
+    void resample(std::size_t curve, Figure figure, Alignment alignment, double xMin, double xMax,
+                  std::size_t buckets, std::vector<LodSeries::Point> &out);
+
+private:
+    class Column : public LodSeries::Source {
+    public:
+        Column(const SessionLogReader *reader, std::size_t size, int cellCount, Figure figure, Alignment alignment)
+            : m_reader(reader), m_size(size), m_cellCount(cellCount), m_figure(figure), m_alignment(alignment) {}
+
+        std::size_t size() const override { return m_size; }
+        LodSeries::Point at(std::size_t index) const override;
+
+    private:
+        const SessionLogReader *m_reader;
+        std::size_t m_size;
+        int m_cellCount;
+        Figure m_figure;
+        Alignment m_alignment;
+    };
+
+    struct Curve {
+        SessionLogReader reader;
+        std::unique_ptr<Column> columns[FIGURES][ALIGNMENTS];
+        std::unique_ptr<LodSeries> lods[FIGURES][ALIGNMENTS];
+    };
+
+    std::vector<std::unique_ptr<Curve>> m_curves;
+    Extent m_extent;
+};
+
+#endif // CHARGEOVERLAY_H
@@ -0,0 +1,115 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chargeprofiles.h"
+
+static QString normalized(const QString &name) {
+    return name.toLower().remove('-');
+}
+
+template <typename T>
+static QString nameOf(const std::vector<std::pair<QString, T>> &table, int value) {
+    for (const auto &it : table) {
+        if (static_cast<int>(it.second) == value) {
+            return it.first;
+        }
+    }
+    return QString();
+}
+
+template <typename T>
+static bool lookup(const std::vector<std::pair<QString, T>> &table, const QString &name, T &value) {
+    for (const auto &it : table) {
+        if (normalized(it.first) == normalized(name)) {
+            value = it.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<std::pair<QString, b6::BATTERY_TYPE>> &ChargeProfiles::batteryTypes() {
+    static const std::vector<std::pair<QString, b6::BATTERY_TYPE>> types = {
+        { "Li-Po", b6::BATTERY_TYPE::LIPO },
+        { "Li-Ion", b6::BATTERY_TYPE::LIIO },
+        { "Li-Fe", b6::BATTERY_TYPE::LIFE },
+        { "Li-Hv", b6::BATTERY_TYPE::LIHV },
+        { "Ni-Mh", b6::BATTERY_TYPE::NIMH },
+        { "Ni-Cd", b6::BATTERY_TYPE::NICD },
+        { "Pb", b6::BATTERY_TYPE::PB },
+    };
+    return types;
+}
+
+const std::vector<std::pair<QString, b6::CHARGING_MODE_LI>> &ChargeProfiles::modesLi() {
+    static const std::vector<std::pair<QString, b6::CHARGING_MODE_LI>> modes = {
+        { "Standard", b6::CHARGING_MODE_LI::STANDARD },
+        { "Discharge", b6::CHARGING_MODE_LI::DISCHARGE },
+        { "Storage", b6::CHARGING_MODE_LI::STORAGE },
+        { "Fast", b6::CHARGING_MODE_LI::FAST },
+        { "Balance", b6::CHARGING_MODE_LI::BALANCE },
+    };
+    return modes;
+}
+
+const std::vector<std::pair<QString, b6::CHARGING_MODE_NI>> &ChargeProfiles::modesNi() {
+    static const std::vector<std::pair<QString, b6::CHARGING_MODE_NI>> modes = {
+        { "Standard", b6::CHARGING_MODE_NI::STANDARD },
+        { "Auto", b6::CHARGING_MODE_NI::AUTO },
+        { "Discharge", b6::CHARGING_MODE_NI::DISCHARGE },
+        { "Re-peak", b6::CHARGING_MODE_NI::REPEAK },
+        { "Cycle", b6::CHARGING_MODE_NI::CYCLE },
+    };
+    return modes;
+}
+
+const std::vector<std::pair<QString, b6::CHARGING_MODE_PB>> &ChargeProfiles::modesPb() {
+    static const std::vector<std::pair<QString, b6::CHARGING_MODE_PB>> modes = {
+        { "Charge", b6::CHARGING_MODE_PB::CHARGE },
+        { "Discharge", b6::CHARGING_MODE_PB::DISCHARGE },
+    };
+    return modes;
+}
+
+bool ChargeProfiles::parseBatteryType(const QString &name, b6::BATTERY_TYPE &type) {
+    return lookup(batteryTypes(), name, type);
+}
+
+bool ChargeProfiles::parseMode(b6::BATTERY_TYPE type, const QString &name, b6::ChargeProfile &profile) {
+    if (b6::Device::isBatteryLi(type)) {
+        return lookup(modesLi(), name, profile.mode.li);
+    } else if (b6::Device::isBatteryNi(type)) {
+        return lookup(modesNi(), name, profile.mode.ni);
+    }
+    return lookup(modesPb(), name, profile.mode.pb);
+}
+
+QString ChargeProfiles::batteryTypeName(int type) {
+    return nameOf(batteryTypes(), type);
+}
+
+QString ChargeProfiles::modeName(int type, int mode) {
+    if (type < 0) {
+        return QString();
+    } else if (b6::Device::isBatteryLi(static_cast<b6::BATTERY_TYPE>(type))) {
+        return nameOf(modesLi(), mode);
+    } else if (b6::Device::isBatteryNi(static_cast<b6::BATTERY_TYPE>(type))) {
+        return nameOf(modesNi(), mode);
+    }
+    return nameOf(modesPb(), mode);
+}
@@ -0,0 +1,46 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARGEPROFILES_H
+#define CHARGEPROFILES_H
+
+#include <utility>
+#include <vector>
+#include <QString>
+#include <b6/Device.hh>
+
+/*
+ * Display names of battery types and charging modes, shared by the GUI combo
+ * boxes and the command line. Parsing ignores case and dashes, so "lipo",
+ * "Li-Po" and "LIPO" all name the same type.
+ */
+namespace ChargeProfiles {
+    const std::vector<std::pair<QString, b6::BATTERY_TYPE>> &batteryTypes();
+    const std::vector<std::pair<QString, b6::CHARGING_MODE_LI>> &modesLi();
+    const std::vector<std::pair<QString, b6::CHARGING_MODE_NI>> &modesNi();
+    const std::vector<std::pair<QString, b6::CHARGING_MODE_PB>> &modesPb();
+
+    bool parseBatteryType(const QString &name, b6::BATTERY_TYPE &type);
+    bool parseMode(b6::BATTERY_TYPE type, const QString &name, b6::ChargeProfile &profile);
+
+    // display names of a type and a mode stored as numbers, empty for ones not known
+    QString batteryTypeName(int type);
+    QString modeName(int type, int mode);
+}
+
+#endif // CHARGEPROFILES_H
@@ -0,0 +1,82 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <sstream>
+#include "chargerdevice.h"
+#include "replaydevice.h"
+#include "simulateddevice.h"
+
+static double toNumber(const std::string &key, const std::string &value) {
+    char *end = nullptr;
+    const double number = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0') {
+        throw std::invalid_argument("bad value for " + key + ": " + value);
+    }
+    return number;
+}
+
+ChargerDevice *ChargerDevice::fromSpec(const std::string &spec) {
+    std::istringstream in(spec);
+    std::string kind;
+    std::getline(in, kind, ',');
+
+    std::string replayPath;
+    if (kind.compare(0, 7, "replay=") == 0) {
+        replayPath = kind.substr(7);
+    } else if (kind != "sim") {
+        throw std::invalid_argument("unknown device: " + kind);
+    }
+
+    SimulatedDevice::Options options;
+    std::string option;
+    while (std::getline(in, option, ',')) {
+        const std::size_t equals = option.find('=');
+        const std::string key = option.substr(0, equals);
+        const std::string value = equals == std::string::npos ? std::string() : option.substr(equals + 1);
+
+        if (key == "speed") {
+            options.speed = toNumber(key, value);
+        } else if (!replayPath.empty()) {
+            throw std::invalid_argument("unknown replay option: " + key);
+        } else if (key == "cells") {
+            options.cells = static_cast<int>(toNumber(key, value));
+        } else if (key == "capacity") {
+            options.capacity = static_cast<int>(toNumber(key, value));
+        } else if (key == "soc") {
+            options.soc = toNumber(key, value);
+        } else if (key == "ambient") {
+            options.ambient = toNumber(key, value);
+        } else if (key == "ext") {
+            options.extSensor = true;
+        } else if (key == "seed") {
+            options.seed = static_cast<unsigned>(toNumber(key, value));
+        } else if (key == "error") {
+            options.errorAt = static_cast<int>(toNumber(key, value));
+        } else if (key == "disconnect") {
+            options.disconnectAt = static_cast<int>(toNumber(key, value));
+        } else {
+            throw std::invalid_argument("unknown simulator option: " + key);
+        }
+    }
+
+    if (!replayPath.empty()) {
+        return new ReplayDevice(replayPath, options.speed);
+    }
+    return new SimulatedDevice(options);
+}
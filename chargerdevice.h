@@ -0,0 +1,100 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARGERDEVICE_H
+#define CHARGERDEVICE_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <b6/Device.hh>
+
+/*
+ * A charger as the acquisition worker sees it. B6ChargerDevice talks to real
+ * hardware; SimulatedDevice and ReplayDevice stand in for it in tests, demos
+ * and load runs. Read failures are thrown as std::exception, errors reported
+ * by the charger itself as b6::ChargingError or ChargerError.
+ */
+class ChargerDevice {
+public:
+    virtual ~ChargerDevice() {}
+
+    virtual std::string getCoreType() = 0;
+    virtual double getHWVersion() = 0;
+    virtual double getSWVersion() = 0;
+    virtual int getCellCount() = 0;
+
+    virtual b6::SysInfo getSysInfo() = 0;
+    virtual b6::ChargeInfo getChargeInfo() = 0;
+    virtual b6::ChargeProfile getDefaultChargeProfile(b6::BATTERY_TYPE type) = 0;
+    virtual bool startCharging(const b6::ChargeProfile &profile) = 0;
+    virtual bool stopCharging() = 0;
+
+    virtual void setTimeLimit(bool enabled, unsigned minutes) = 0;
+    virtual void setCapacityLimit(bool enabled, unsigned capacity) = 0;
+    virtual void setTempLimit(unsigned temp) = 0;
+    virtual void setCycleTime(unsigned minutes) = 0;
+    virtual void setBuzzers(bool system, bool key) = 0;
+
+    // how often getChargeInfo() is worth calling
+    virtual int pollIntervalMs() const { return 1000; }
+    // shortest interval getChargeInfo() takes, 0 if it has to be measured; see SamplingPolicy
+    virtual int minPollIntervalMs() const { return pollIntervalMs(); }
+    // charge time of the last sample read in ms, -1 if the charger only counts seconds
+    virtual int64_t sampleTimeMs() const { return -1; }
+    // false while getChargeInfo() has nothing new to report until the next startCharging(), so polling can pause
+    virtual bool hasMoreSamples() const { return true; }
+
+    // "sim[,key=value...]" or "replay=<log>[,speed=N]", see README; throws std::invalid_argument
+    static ChargerDevice *fromSpec(const std::string &spec);
+};
+
+class ChargerError : public std::runtime_error {
+public:
+    explicit ChargerError(const std::string &message) : std::runtime_error(message) {}
+};
+
+class B6ChargerDevice : public ChargerDevice {
+public:
+    explicit B6ChargerDevice(libusb_device *device) : m_dev(device) {}
+
+    std::string getCoreType() override { return m_dev.getCoreType(); }
+    double getHWVersion() override { return m_dev.getHWVersion(); }
+    double getSWVersion() override { return m_dev.getSWVersion(); }
+    int getCellCount() override { return m_dev.getCellCount(); }
+
+    b6::SysInfo getSysInfo() override { return m_dev.getSysInfo(); }
+    b6::ChargeInfo getChargeInfo() override { return m_dev.getChargeInfo(); }
+    b6::ChargeProfile getDefaultChargeProfile(b6::BATTERY_TYPE type) override { return m_dev.getDefaultChargeProfile(type); }
+    bool startCharging(const b6::ChargeProfile &profile) override { return m_dev.startCharging(profile); }
+    bool stopCharging() override { return m_dev.stopCharging(); }
+
+    void setTimeLimit(bool enabled, unsigned minutes) override { m_dev.setTimeLimit(enabled, minutes); }
+    void setCapacityLimit(bool enabled, unsigned capacity) override { m_dev.setCapacityLimit(enabled, capacity); }
+    void setTempLimit(unsigned temp) override { m_dev.setTempLimit(temp); }
+    void setCycleTime(unsigned minutes) override { m_dev.setCycleTime(minutes); }
+    void setBuzzers(bool system, bool key) override { m_dev.setBuzzers(system, key); }
+
+    // a B6 answers well within a second, how fast depends on the firmware
+    int minPollIntervalMs() const override { return 0; }
+
+private:
+    b6::Device m_dev;
+};
+
+#endif // CHARGERDEVICE_H
@@ -0,0 +1,274 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <QDateTime>
+#include "chargersession.h"
+#include "diagnostics.h"
+
+ChargerSession::ChargerSession(const QString &location, const QString &deviceSpec, QObject *parent) :
+        QObject(parent), m_location(location), m_deviceSpec(deviceSpec) {
+    m_thread = new QThread(this);
+    m_worker = new AcquisitionWorker(location, deviceSpec);
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, SIGNAL(started()), m_worker, SLOT(start()));
+    connect(m_thread, SIGNAL(finished()), m_worker, SLOT(deleteLater()));
+    connect(m_worker, SIGNAL(deviceConnected(DeviceInfo)), this, SLOT(onDeviceConnected(DeviceInfo)));
+    connect(m_worker, SIGNAL(deviceDisconnected()), this, SLOT(onDeviceDisconnected()));
+    connect(m_worker, SIGNAL(sysInfoLoaded(b6::SysInfo)), this, SLOT(onSysInfoLoaded(b6::SysInfo)));
+    connect(m_worker, SIGNAL(chargingStarted()), this, SLOT(onChargingStarted()));
+    connect(m_worker, SIGNAL(chargingStopped()), this, SLOT(onChargingStopped()));
+    connect(m_worker, SIGNAL(chargingError(QString)), this, SLOT(onChargingError(QString)));
+    connect(m_worker, SIGNAL(readFailed()), this, SLOT(onReadFailed()));
+    connect(m_worker, SIGNAL(samplingChanged(int,int)), this, SLOT(onSamplingChanged(int,int)));
+
+    m_samplesNotifier = new QSocketNotifier(m_worker->notifyFd(), QSocketNotifier::Read, this);
+    connect(m_samplesNotifier, SIGNAL(activated(int)), this, SLOT(onSamplesReady()));
+
+    if (!isVirtual()) {
+        m_recoverLog();
+    }
+
+    m_thread->start();
+}
+
+ChargerSession::~ChargerSession() {
+    m_thread->quit();
+    m_thread->wait();
+}
+
+void ChargerSession::attach() {
+    QMetaObject::invokeMethod(m_worker, "attach", Qt::QueuedConnection);
+}
+
+void ChargerSession::detach() {
+    QMetaObject::invokeMethod(m_worker, "detach", Qt::QueuedConnection);
+}
+
+bool ChargerSession::showLog(const QString &path) {
+    SessionLogReader log;
+    if (!log.open(path.toStdString()) || log.size() == 0 || !SessionLog::isValid(log.record(0))) {
+        return false;
+    }
+
+    m_deviceSpec = "replay=" + path;
+    // no charger tells the cell count, the log does
+    m_deviceInfo.cellCount = std::min<int>(static_cast<int>(log.header().cellCount), 8);
+    const std::size_t count = m_loadLog(log);
+    const SessionLog::Record &last = log.record(count - 1);
+    m_chargeInfo = SessionLog::toChargeInfo(last);
+    m_chargeTimeMs = last.timeMs;
+    m_hasChargeInfo = true;
+    emit samplesCleared();
+    emit samplesAppended();
+    emit chargeInfoUpdated();
+    return true;
+}
+
+void ChargerSession::loadSysInfo() {
+    QMetaObject::invokeMethod(m_worker, "loadSysInfo", Qt::QueuedConnection);
+}
+
+void ChargerSession::saveSysInfo(const b6::SysInfo &info) {
+    QMetaObject::invokeMethod(m_worker, "saveSysInfo", Qt::QueuedConnection, Q_ARG(b6::SysInfo, info));
+}
+
+void ChargerSession::startCharging(b6::BATTERY_TYPE battType, const b6::ChargeProfile &settings, const QString &pack) {
+    m_resetStore();
+    const int cells = std::max<int>(settings.cellCount, 1);
+    m_analytics.setDeltaVThreshold(b6::Device::isBatteryNi(battType) ? ChargeAnalytics::NI_DELTA_V_PER_CELL * cells : 0);
+    m_forecast.configure(battType, settings);
+
+    const int mode = b6::Device::isBatteryLi(battType) ? static_cast<int>(settings.mode.li)
+                   : b6::Device::isBatteryNi(battType) ? static_cast<int>(settings.mode.ni)
+                                                       : static_cast<int>(settings.mode.pb);
+    m_summary.pack = pack.toStdString();
+    m_summary.location = m_location.toStdString();
+    m_summary.begin(QDateTime::currentMSecsSinceEpoch(), static_cast<int>(battType), mode, settings.cellCount);
+
+    QMetaObject::invokeMethod(m_worker, "startCharging", Qt::QueuedConnection,
+                              Q_ARG(b6::BATTERY_TYPE, battType), Q_ARG(b6::ChargeProfile, settings));
+}
+
+void ChargerSession::stopCharging() {
+    QMetaObject::invokeMethod(m_worker, "stopCharging", Qt::QueuedConnection);
+}
+
+void ChargerSession::onDeviceConnected(DeviceInfo info) {
+    m_deviceInfo = info;
+    m_connected = true;
+    if (m_store.empty()) {
+        m_store.reset(info.cellCount);
+    }
+    emit connected();
+
+    // samples queued before the connection was announced
+    onSamplesReady();
+}
+
+void ChargerSession::onDeviceDisconnected() {
+    m_connected = false;
+    if (m_charging) {
+        m_summary.fail();
+    }
+    m_setCharging(false);
+    m_hasChargeInfo = false;
+
+    AcquisitionWorker::Sample sample;
+    while (m_worker->queue().pop(sample)) {
+    }
+    emit disconnected();
+}
+
+void ChargerSession::onSysInfoLoaded(b6::SysInfo info) {
+    m_forecast.setLimits(info.capLimitOn ? static_cast<int>(info.capLimit) : 0, info.timeLimitOn ? info.timeLimit * 60 : 0);
+    emit sysInfoLoaded(info);
+}
+
+void ChargerSession::onSamplesReady() {
+    m_worker->acknowledge();
+    if (!m_connected) {
+        return;
+    }
+
+    static LatencyHistogram &ingestTime = Diagnostics::histogram("session.ingest");
+    LatencyHistogram::Scope timing(ingestTime);
+
+    const std::size_t stored = m_store.size();
+    AcquisitionWorker::Sample sample;
+    while (m_worker->queue().pop(sample)) {
+        m_processSample(sample);
+    }
+    if (m_store.size() != stored) {
+        emit samplesAppended();
+    }
+}
+
+void ChargerSession::onChargingStarted() {
+    m_setCharging(true);
+}
+
+void ChargerSession::onChargingStopped() {
+    m_setCharging(false);
+}
+
+void ChargerSession::onChargingError(QString message) {
+    if (!m_charging) {
+        return;
+    }
+
+    m_summary.fail();
+    emit chargingError(message);
+    stopCharging();
+}
+
+void ChargerSession::onReadFailed() {
+    if (m_charging) {
+        stopCharging();
+    }
+}
+
+void ChargerSession::onSamplingChanged(int intervalMs, int sustainableMs) {
+    m_sampleIntervalMs = intervalMs;
+    m_sustainableIntervalMs = sustainableMs;
+    emit samplingChanged();
+}
+
+void ChargerSession::m_setCharging(bool charging) {
+    if (m_charging == charging) {
+        return;
+    }
+
+    m_charging = charging;
+    if (charging && !m_summary.isActive()) {
+        // started on the charger itself, nothing is known about the battery
+        m_summary.pack.clear();
+        m_summary.location = m_location.toStdString();
+        m_summary.begin(QDateTime::currentMSecsSinceEpoch(), -1, -1, 0);
+    }
+    if (!charging) {
+        m_forecast.clear();
+    }
+    emit chargingChanged(charging);
+
+    if (!charging && m_summary.isActive()) {
+        const bool completed = m_hasChargeInfo && m_chargeInfo.state == 0x03;
+        m_summary.log = isVirtual() ? std::string() : AcquisitionWorker::lastLog(m_location).toStdString();
+        m_summary.finish(completed ? ChargeSummary::COMPLETED : ChargeSummary::STOPPED, m_analytics.figures());
+        emit chargeEnded();
+    }
+}
+
+void ChargerSession::m_processSample(const AcquisitionWorker::Sample &sample) {
+    const b6::ChargeInfo &info = sample.info;
+    m_chargeInfo = info;
+    m_chargeTimeMs = sample.timeMs;
+    m_hasChargeInfo = true;
+    // samples at rest too, the step onto the charge current is a resistance estimate
+    m_analytics.update(sample.timeMs, info);
+    if (!m_charging && info.state != static_cast<uint8_t>(b6::STATE::CHARGING)) {
+        emit chargeInfoUpdated();
+        return;
+    }
+
+    if (info.state == static_cast<uint8_t>(b6::STATE::CHARGING)) {
+        m_setCharging(true);
+    } else if (info.state == 0x03) {
+        m_summary.update(info);
+        m_setCharging(false);
+        emit chargingCompleted(info);
+    }
+
+    if (m_charging) {
+        m_store.append(sample.timeMs, info);
+        m_summary.update(info);
+        m_forecast.update(sample.timeMs, info, m_analytics.figures());
+    }
+    emit chargeInfoUpdated();
+}
+
+void ChargerSession::m_recoverLog() {
+    QString path = AcquisitionWorker::lastLog(m_location);
+    SessionLogReader log;
+    if (path.isEmpty() || !log.open(path.toStdString()) || (log.header().flags & SessionLog::FLAG_CLOSED)) {
+        return;
+    }
+
+    // the last charge never finished, most likely we crashed or were killed while it ran
+    const std::size_t count = m_loadLog(log);
+    qInfo("%s: recovered %zu samples from %s", qPrintable(m_location), count, qPrintable(path));
+}
+
+std::size_t ChargerSession::m_loadLog(const SessionLogReader &log) {
+    m_store.reset(static_cast<int>(log.header().cellCount));
+    m_analytics.reset();
+    std::size_t count = 0;
+    for (; count < log.size() && SessionLog::isValid(log.record(count)); count++) {
+        const SessionLog::Record &record = log.record(count);
+        const b6::ChargeInfo info = SessionLog::toChargeInfo(record);
+        m_store.append(record.timeMs, info);
+        m_analytics.update(record.timeMs, info);
+    }
+    return count;
+}
+
+void ChargerSession::m_resetStore() {
+    m_store.reset(m_deviceInfo.cellCount);
+    m_analytics.startCharge();
+    emit samplesCleared();
+}
@@ -0,0 +1,132 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARGERSESSION_H
+#define CHARGERSESSION_H
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QThread>
+#include "acquisitionworker.h"
+#include "chargeanalytics.h"
+#include "chargeforecast.h"
+#include "chargesummary.h"
+#include "telemetrystore.h"
+
+/*
+ * State of one charger: its acquisition pipeline and the data of the charge
+ * in progress. Samples of the charge are kept in a TelemetryStore, anything
+ * that presents them (charts, the CLI) follows it through samplesAppended()
+ * and samplesCleared(). Every sample also goes through ChargeAnalytics and,
+ * for charges started here, ChargeForecast; both are current when
+ * chargeInfoUpdated() is emitted. When a charge ends its ChargeSummary is
+ * complete and chargeEnded() emitted. Needs nothing beyond QtCore.
+ */
+class ChargerSession : public QObject {
+    Q_OBJECT
+public:
+    // a non-empty deviceSpec makes it a virtual charger, see ChargerDevice::fromSpec()
+    explicit ChargerSession(const QString &location, const QString &deviceSpec = QString(), QObject *parent = 0);
+    ~ChargerSession();
+
+    QString location() const { return m_location; }
+    QString deviceSpec() const { return m_deviceSpec; }
+    // simulated or replayed, such a charger keeps no session log and stays out of the history
+    bool isVirtual() const { return !m_deviceSpec.isEmpty(); }
+    // plays a recorded charge back, it only pretends to charge
+    bool isReplay() const { return m_deviceSpec.startsWith("replay="); }
+    const DeviceInfo &deviceInfo() const { return m_deviceInfo; }
+    bool isConnected() const { return m_connected; }
+    bool isCharging() const { return m_charging; }
+    bool hasChargeInfo() const { return m_hasChargeInfo; }
+    const b6::ChargeInfo &chargeInfo() const { return m_chargeInfo; }
+    // charge time of chargeInfo() in ms, finer than its seconds when the charger is polled faster
+    uint32_t chargeTimeMs() const { return m_chargeTimeMs; }
+    // how often the charger is polled now and the shortest interval it was measured to take, 0 if unknown
+    int sampleIntervalMs() const { return m_sampleIntervalMs; }
+    int sustainableIntervalMs() const { return m_sustainableIntervalMs; }
+    const TelemetryStore &store() const { return m_store; }
+    const ChargeAnalytics &analytics() const { return m_analytics; }
+    const ChargeForecast &forecast() const { return m_forecast; }
+    // of the charge running or the last one
+    const ChargeSummary &summary() const { return m_summary; }
+
+    void attach();
+    void detach();
+    // fills the store with the charge recorded in a session log, for a session that is not attached to a charger;
+    // the replay controls find the log in deviceSpec()
+    bool showLog(const QString &path);
+
+    void loadSysInfo();
+    void saveSysInfo(const b6::SysInfo &info);
+    // pack names the battery in the session history, if given
+    void startCharging(b6::BATTERY_TYPE battType, const b6::ChargeProfile &settings, const QString &pack = QString());
+    void stopCharging();
+
+signals:
+    void connected();
+    void disconnected();
+    void sysInfoLoaded(b6::SysInfo info);
+    void chargingChanged(bool charging);
+    void chargeInfoUpdated();
+    void samplesAppended();
+    void samplesCleared();
+    void chargingCompleted(b6::ChargeInfo info);
+    void chargingError(QString message);
+    void chargeEnded();
+    void samplingChanged();
+
+private slots:
+    void onDeviceConnected(DeviceInfo info);
+    void onDeviceDisconnected();
+    void onSysInfoLoaded(b6::SysInfo info);
+    void onSamplesReady();
+    void onChargingStarted();
+    void onChargingStopped();
+    void onChargingError(QString message);
+    void onReadFailed();
+    void onSamplingChanged(int intervalMs, int sustainableMs);
+
+private:
+    QString m_location;
+    QString m_deviceSpec;
+    QThread *m_thread;
+    AcquisitionWorker *m_worker;
+    QSocketNotifier *m_samplesNotifier;
+
+    DeviceInfo m_deviceInfo;
+    bool m_connected = false;
+    bool m_charging = false;
+    bool m_hasChargeInfo = false;
+    b6::ChargeInfo m_chargeInfo;
+    uint32_t m_chargeTimeMs = 0;
+    int m_sampleIntervalMs = 0;
+    int m_sustainableIntervalMs = 0;
+    TelemetryStore m_store;
+    ChargeAnalytics m_analytics;
+    ChargeForecast m_forecast;
+    ChargeSummary m_summary;
+
+    void m_setCharging(bool charging);
+    void m_processSample(const AcquisitionWorker::Sample &sample);
+    void m_recoverLog();
+    std::size_t m_loadLog(const SessionLogReader &log);
+    void m_resetStore();
+};
+
+#endif // CHARGERSESSION_H
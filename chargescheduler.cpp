@@ -0,0 +1,406 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QStringList>
+#include <QTime>
+#include "chargescheduler.h"
+
+// how long a charger may take to report it started a step
+static const qint64 START_TIMEOUT_MS = 30 * 1000;
+// a completion is reported right after the charger stops, give it this long to show up
+static const qint64 STOP_GRACE_MS = 5 * 1000;
+static const int TICK_MS = 1000;
+
+ChargeScheduler::ChargeScheduler(DeviceManager *devices, QObject *parent) :
+    QObject(parent),
+    m_devices(devices),
+    m_tick(new QTimer(this))
+{
+    m_clock.start();
+    m_tick->setInterval(TICK_MS);
+    connect(m_tick, SIGNAL(timeout()), this, SLOT(onTick()));
+    connect(m_devices, SIGNAL(sessionAdded(ChargerSession*)), this, SLOT(onSessionAdded(ChargerSession*)));
+    for (ChargerSession *session : m_devices->sessions()) {
+        onSessionAdded(session);
+    }
+}
+
+bool ChargeScheduler::parseSteps(const QString &text, QVector<Step> &steps) {
+    steps.clear();
+    for (const QString &part : text.split(',', QString::SkipEmptyParts)) {
+        const QString name = part.section('=', 0, 0).trimmed().toLower();
+        const QString value = part.section('=', 1).trimmed();
+        Step step;
+        if (name == "charge") {
+            step.kind = CHARGE;
+        } else if (name == "discharge") {
+            step.kind = DISCHARGE;
+        } else if (name == "storage") {
+            step.kind = STORAGE;
+        } else if (name == "rest") {
+            bool ok = false;
+            const int minutes = value.toInt(&ok);
+            if (!ok || minutes <= 0) {
+                return false;
+            }
+            step.kind = REST;
+            step.restS = minutes * 60;
+        } else {
+            return false;
+        }
+        if (step.kind != REST && !value.isEmpty()) {
+            return false;
+        }
+        steps << step;
+    }
+    return !steps.isEmpty();
+}
+
+QString ChargeScheduler::describeSteps(const QVector<Step> &steps) {
+    QStringList parts;
+    for (const Step &step : steps) {
+        switch (step.kind) {
+        case CHARGE: parts << "charge"; break;
+        case DISCHARGE: parts << "discharge"; break;
+        case STORAGE: parts << "storage"; break;
+        case REST: parts << QString("rest=%1").arg(step.restS / 60); break;
+        }
+    }
+    return parts.join(", ");
+}
+
+QString ChargeScheduler::describeResults(const Job &job) {
+    QStringList parts;
+    for (int i = 0; i < job.results.size() && i < job.steps.size(); i++) {
+        const StepResult &result = job.results[i];
+        if (result.timeS == 0) {
+            continue;
+        }
+        const QString time = QTime(0, 0, 0).addSecs(result.timeS).toString("hh:mm:ss");
+        switch (job.steps[i].kind) {
+        case CHARGE: parts << QString("charge %1 mAh in %2").arg(result.capacity).arg(time); break;
+        case DISCHARGE: parts << QString("discharge %1 mAh in %2").arg(result.capacity).arg(time); break;
+        case STORAGE: parts << QString("storage %1 mAh in %2").arg(result.capacity).arg(time); break;
+        case REST: parts << QString("rest %1 min").arg(result.timeS / 60); break;
+        }
+    }
+    return parts.join(", ");
+}
+
+QString ChargeScheduler::stateName(JobState state) {
+    switch (state) {
+    case QUEUED: return "queued";
+    case RUNNING: return "running";
+    case DONE: return "done";
+    case FAILED: return "failed";
+    case CANCELLED: return "cancelled";
+    }
+    return QString();
+}
+
+bool ChargeScheduler::validate(const Job &job, QString *error) {
+    if (job.steps.isEmpty()) {
+        if (error) {
+            *error = "the job has no steps";
+        }
+        return false;
+    }
+    for (const Step &step : job.steps) {
+        if (step.kind == STORAGE && !b6::Device::isBatteryLi(job.batteryType)) {
+            if (error) {
+                *error = "only lithium batteries have a storage mode";
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+int ChargeScheduler::addJob(const Job &job, QString *error) {
+    if (!validate(job, error)) {
+        return -1;
+    }
+    const ChargerSession *session = job.location.isEmpty() ? nullptr : m_devices->session(job.location);
+    if (session != nullptr && session->isReplay()) {
+        if (error) {
+            *error = "a replay cannot charge anything";
+        }
+        return -1;
+    }
+
+    Job queued = job;
+    queued.id = m_nextId++;
+    if (queued.name.isEmpty()) {
+        queued.name = QString("Job %1").arg(queued.id);
+    }
+    queued.state = QUEUED;
+    queued.step = -1;
+    queued.charger.clear();
+    queued.results.clear();
+    queued.message.clear();
+    m_jobs << queued;
+    emit jobChanged(queued.id);
+
+    m_dispatch();
+    return queued.id;
+}
+
+void ChargeScheduler::cancelJob(int id) {
+    Job *job = m_job(id);
+    if (job == nullptr || (job->state != QUEUED && job->state != RUNNING)) {
+        return;
+    }
+
+    ChargerSession *session = m_sessionOf(*job);
+    const bool charging = session != nullptr && session->isCharging();
+    m_finish(*job, CANCELLED);
+    if (charging) {
+        session->stopCharging();
+    }
+}
+
+void ChargeScheduler::removeFinished() {
+    for (int i = m_jobs.size() - 1; i >= 0; i--) {
+        if (m_jobs[i].state != QUEUED && m_jobs[i].state != RUNNING) {
+            m_jobs.removeAt(i);
+        }
+    }
+}
+
+const ChargeScheduler::Job *ChargeScheduler::job(int id) const {
+    for (const Job &job : m_jobs) {
+        if (job.id == id) {
+            return &job;
+        }
+    }
+    return nullptr;
+}
+
+bool ChargeScheduler::isIdle() const {
+    for (const Job &job : m_jobs) {
+        if (job.state == QUEUED || job.state == RUNNING) {
+            return false;
+        }
+    }
+    return true;
+}
+
+b6::ChargeProfile ChargeScheduler::profileFor(const Job &job, StepKind kind) {
+    b6::ChargeProfile profile = job.profile;
+    if (b6::Device::isBatteryLi(job.batteryType)) {
+        const b6::CHARGING_MODE_LI mode = job.profile.mode.li;
+        const bool charge = mode == b6::CHARGING_MODE_LI::STANDARD || mode == b6::CHARGING_MODE_LI::FAST ||
+                mode == b6::CHARGING_MODE_LI::BALANCE;
+        switch (kind) {
+        case CHARGE: profile.mode.li = charge ? mode : b6::CHARGING_MODE_LI::STANDARD; break;
+        case DISCHARGE: profile.mode.li = b6::CHARGING_MODE_LI::DISCHARGE; break;
+        default: profile.mode.li = b6::CHARGING_MODE_LI::STORAGE; break;
+        }
+    } else if (b6::Device::isBatteryNi(job.batteryType)) {
+        const b6::CHARGING_MODE_NI mode = job.profile.mode.ni;
+        const bool charge = mode == b6::CHARGING_MODE_NI::STANDARD || mode == b6::CHARGING_MODE_NI::AUTO;
+        profile.mode.ni = kind == DISCHARGE ? b6::CHARGING_MODE_NI::DISCHARGE
+                                            : charge ? mode : b6::CHARGING_MODE_NI::STANDARD;
+    } else {
+        profile.mode.pb = kind == DISCHARGE ? b6::CHARGING_MODE_PB::DISCHARGE : b6::CHARGING_MODE_PB::CHARGE;
+    }
+    return profile;
+}
+
+void ChargeScheduler::onSessionAdded(ChargerSession *session) {
+    connect(session, SIGNAL(connected()), this, SLOT(onSessionConnected()));
+    connect(session, SIGNAL(disconnected()), this, SLOT(onSessionDisconnected()));
+    connect(session, SIGNAL(chargingChanged(bool)), this, SLOT(onChargingChanged(bool)));
+    connect(session, SIGNAL(chargingCompleted(b6::ChargeInfo)), this, SLOT(onChargingCompleted(b6::ChargeInfo)));
+    connect(session, SIGNAL(chargingError(QString)), this, SLOT(onChargingError(QString)));
+    m_dispatch();
+}
+
+void ChargeScheduler::onSessionConnected() {
+    m_dispatch();
+}
+
+void ChargeScheduler::onSessionDisconnected() {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    Job *job = m_job(jobOn(session));
+    if (job != nullptr) {
+        m_finish(*job, FAILED, "the charger was disconnected");
+    }
+}
+
+void ChargeScheduler::onChargingChanged(bool charging) {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    const int id = jobOn(session);
+    if (id < 0) {
+        if (!charging) {
+            m_dispatch();
+        }
+        return;
+    }
+
+    Progress &progress = m_progress[id];
+    if (charging && progress.state == STARTING) {
+        progress.state = CHARGING;
+    }
+    // a stop without a completion is noticed by onTick()
+    progress.stoppedMs = charging ? -1 : m_clock.elapsed();
+}
+
+void ChargeScheduler::onChargingCompleted(b6::ChargeInfo info) {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    Job *job = m_job(jobOn(session));
+    if (job == nullptr) {
+        emit chargeCompleted(session, info);
+        return;
+    }
+    // an empty store means a sample left over from the previous step, the new one has not begun
+    if (m_progress.value(job->id).state != CHARGING || session->store().empty()) {
+        return;
+    }
+
+    StepResult &result = job->results[job->step];
+    result.capacity = info.capacity;
+    result.timeS = info.time;
+    m_nextStep(*job);
+}
+
+void ChargeScheduler::onChargingError(QString message) {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    Job *job = m_job(jobOn(session));
+    if (job != nullptr) {
+        m_finish(*job, FAILED, message);
+    } else {
+        emit chargeFailed(session, message);
+    }
+}
+
+void ChargeScheduler::onTick() {
+    const qint64 now = m_clock.elapsed();
+    // finishing a job can start or drop others, so go by id
+    const QList<int> running = m_running.values();
+    for (int id : running) {
+        Job *job = m_job(id);
+        if (job == nullptr || job->state != RUNNING) {
+            continue;
+        }
+
+        const Progress progress = m_progress.value(id);
+        ChargerSession *session = m_sessionOf(*job);
+        switch (progress.state) {
+        case STARTING:
+            if (now >= progress.deadlineMs) {
+                m_finish(*job, FAILED, "the charger did not start");
+            }
+            break;
+        case CHARGING:
+            if (!session->isCharging() && progress.stoppedMs >= 0 && now - progress.stoppedMs >= STOP_GRACE_MS) {
+                m_finish(*job, FAILED, "charging was stopped");
+            }
+            break;
+        case RESTING:
+            if (now >= progress.deadlineMs) {
+                job->results[job->step].timeS = job->steps[job->step].restS;
+                m_nextStep(*job);
+            }
+            break;
+        }
+    }
+}
+
+ChargeScheduler::Job *ChargeScheduler::m_job(int id) {
+    for (Job &job : m_jobs) {
+        if (job.id == id) {
+            return &job;
+        }
+    }
+    return nullptr;
+}
+
+ChargerSession *ChargeScheduler::m_sessionOf(const Job &job) const {
+    return job.charger.isEmpty() ? nullptr : m_devices->session(job.charger);
+}
+
+void ChargeScheduler::m_dispatch() {
+    for (Job &job : m_jobs) {
+        if (job.state != QUEUED) {
+            continue;
+        }
+
+        for (ChargerSession *session : m_devices->sessions()) {
+            if (!session->isConnected() || session->isCharging() || session->isReplay() || m_running.contains(session) ||
+                    (!job.location.isEmpty() && job.location != session->location())) {
+                continue;
+            }
+
+            job.state = RUNNING;
+            job.charger = session->location();
+            job.results.fill(StepResult(), job.steps.size());
+            m_running.insert(session, job.id);
+            m_nextStep(job);
+            break;
+        }
+    }
+
+    if (!isIdle()) {
+        m_tick->start();
+    }
+}
+
+void ChargeScheduler::m_startStep(Job &job) {
+    ChargerSession *session = m_sessionOf(job);
+    const Step &step = job.steps[job.step];
+    Progress &progress = m_progress[job.id];
+    progress.stoppedMs = -1;
+    if (step.kind == REST) {
+        progress.state = RESTING;
+        progress.deadlineMs = m_clock.elapsed() + step.restS * qint64(1000);
+    } else {
+        progress.state = STARTING;
+        progress.deadlineMs = m_clock.elapsed() + START_TIMEOUT_MS;
+        session->startCharging(job.batteryType, profileFor(job, step.kind), job.pack);
+    }
+    emit jobChanged(job.id);
+}
+
+void ChargeScheduler::m_nextStep(Job &job) {
+    job.step++;
+    if (job.step < job.steps.size()) {
+        m_startStep(job);
+    } else {
+        job.step = job.steps.size() - 1;
+        m_finish(job, DONE);
+    }
+}
+
+void ChargeScheduler::m_finish(Job &job, JobState state, const QString &message) {
+    const int id = job.id;
+    ChargerSession *session = m_sessionOf(job);
+    if (job.state == RUNNING && session != nullptr) {
+        m_running.remove(session);
+    }
+    m_progress.remove(id);
+    job.state = state;
+    job.message = message;
+    emit jobChanged(id);
+    emit jobFinished(id);
+
+    // the charger is free for the next job
+    m_dispatch();
+    if (isIdle()) {
+        m_tick->stop();
+    }
+}
@@ -0,0 +1,138 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHARGESCHEDULER_H
+#define CHARGESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include "chargersession.h"
+#include "devicemanager.h"
+
+/*
+ * Queue of charge jobs run without anyone watching. A job is a battery and its
+ * ChargeProfile plus a sequence of steps (charge, discharge, storage, rest);
+ * jobs are handed out in order to whichever charger is connected and idle, or
+ * to the one they ask for, and each step starts as soon as the one before it
+ * completed. Replays only pretend to charge and never get a job. A step that
+ * errors out, is stopped or loses its charger fails the job and frees the
+ * charger for the next one. Needs nothing beyond QtCore.
+ */
+class ChargeScheduler : public QObject {
+    Q_OBJECT
+public:
+    enum StepKind { CHARGE, DISCHARGE, STORAGE, REST };
+
+    struct Step {
+        StepKind kind = CHARGE;
+        int restS = 0;
+    };
+
+    struct StepResult {
+        int capacity = 0;                    // mAh
+        int timeS = 0;
+    };
+
+    enum JobState { QUEUED, RUNNING, DONE, FAILED, CANCELLED };
+
+    struct Job {
+        int id = 0;
+        QString name;
+        b6::BATTERY_TYPE batteryType = b6::BATTERY_TYPE::LIPO;
+        b6::ChargeProfile profile = {};       // the mode is set by each step
+        QVector<Step> steps;
+        QString location;                     // charger to run on, whichever is free if empty
+        QString pack;                         // battery pack, for the session history
+
+        JobState state = QUEUED;
+        QString charger;                      // where it runs or ran
+        int step = -1;
+        QVector<StepResult> results;
+        QString message;                      // why it failed
+    };
+
+    explicit ChargeScheduler(DeviceManager *devices, QObject *parent = 0);
+
+    // "charge, rest=30, discharge, storage", rest in minutes
+    static bool parseSteps(const QString &text, QVector<Step> &steps);
+    static QString describeSteps(const QVector<Step> &steps);
+    static QString stateName(JobState state);
+    // "charge 1450 mAh in 01:02:03, rest 30 min, ..." for the steps done so far
+    static QString describeResults(const Job &job);
+    // false with the reason if the battery type cannot do one of the steps
+    static bool validate(const Job &job, QString *error);
+    // the job's profile with the mode of the step
+    static b6::ChargeProfile profileFor(const Job &job, StepKind kind);
+
+    // queues the job, returns its id or -1 if it does not validate
+    int addJob(const Job &job, QString *error = nullptr);
+    void cancelJob(int id);
+    void removeFinished();
+
+    const QList<Job> &jobs() const { return m_jobs; }
+    const Job *job(int id) const;
+    // the job running on the charger, -1 if none
+    int jobOn(ChargerSession *session) const { return m_running.value(session, -1); }
+    bool isIdle() const;
+
+signals:
+    void jobChanged(int id);
+    void jobFinished(int id);
+    // of a charge no job runs, a job's own are reported by jobFinished()
+    void chargeCompleted(ChargerSession *session, b6::ChargeInfo info);
+    void chargeFailed(ChargerSession *session, QString message);
+
+private slots:
+    void onSessionAdded(ChargerSession *session);
+    void onSessionConnected();
+    void onSessionDisconnected();
+    void onChargingChanged(bool charging);
+    void onChargingCompleted(b6::ChargeInfo info);
+    void onChargingError(QString message);
+    void onTick();
+
+private:
+    // what a running step waits for
+    enum StepState { STARTING, CHARGING, RESTING };
+
+    struct Progress {
+        StepState state = STARTING;
+        qint64 deadlineMs = 0;                // to start charging, or the end of a rest
+        qint64 stoppedMs = -1;                // when the charger stopped without completing
+    };
+
+    DeviceManager *m_devices;
+    QTimer *m_tick;
+    QElapsedTimer m_clock;
+    QList<Job> m_jobs;
+    int m_nextId = 1;
+    QHash<ChargerSession*, int> m_running;
+    QHash<int, Progress> m_progress;
+
+    Job *m_job(int id);
+    ChargerSession *m_sessionOf(const Job &job) const;
+    void m_dispatch();
+    void m_startStep(Job &job);
+    void m_nextStep(Job &job);
+    void m_finish(Job &job, JobState state, const QString &message = QString());
+};
+
+#endif // CHARGESCHEDULER_H
@@ -0,0 +1,81 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include "chargesummary.h"
+#include "sessionlog.h"
+
+static const uint8_t STATE_COMPLETE = 0x03;
+
+void ChargeSummary::begin(int64_t startedAtMs, int batteryType, int mode, int cellCount) {
+    id = 0;
+    log.clear();
+    this->startedAtMs = startedAtMs;
+    this->batteryType = batteryType;
+    this->mode = mode;
+    this->cellCount = cellCount;
+    outcome = STOPPED;
+    capacity = 0;
+    durationS = 0;
+    energyWh = 0.0;
+    maxTemp = 0;
+    resistance = 0.0;
+    maxCellDelta = 0;
+    endVoltage = 0;
+    m_active = true;
+    m_failed = false;
+}
+
+void ChargeSummary::update(const b6::ChargeInfo &info) {
+    capacity = info.capacity;
+    durationS = info.time;
+    endVoltage = info.voltage;
+    maxTemp = std::max(maxTemp, static_cast<int>(std::max(info.tempInt, info.tempExt)));
+}
+
+void ChargeSummary::finish(Outcome outcome, const ChargeAnalytics::Figures &figures) {
+    this->outcome = m_failed ? FAILED : outcome;
+    energyWh = figures.energyWh;
+    resistance = figures.resistance;
+    maxCellDelta = figures.maxCellSpread;
+    if (cellCount == 0) {
+        cellCount = figures.cellCount;
+    }
+    m_active = false;
+}
+
+bool ChargeSummary::fromLog(const std::string &path, ChargeSummary &summary) {
+    SessionLogReader reader;
+    if (!reader.open(path) || !(reader.header().flags & SessionLog::FLAG_CLOSED)) {
+        return false;
+    }
+
+    summary = ChargeSummary();
+    summary.log = path;
+    summary.begin(reader.header().startedAtMs, -1, -1, static_cast<int>(reader.header().cellCount));
+    ChargeAnalytics analytics;
+    uint8_t state = 0;
+    for (std::size_t i = 0; i < reader.size() && SessionLog::isValid(reader.record(i)); i++) {
+        const SessionLog::Record &record = reader.record(i);
+        const b6::ChargeInfo info = SessionLog::toChargeInfo(record);
+        analytics.update(record.timeMs, info);
+        summary.update(info);
+        state = record.state;
+    }
+    summary.finish(state == STATE_COMPLETE ? COMPLETED : STOPPED, analytics.figures());
+    return true;
+}
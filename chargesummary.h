@@ -0,0 +1,69 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHARGESUMMARY_H
+#define CHARGESUMMARY_H
+
+#include <cstdint>
+#include <string>
+#include <b6/Device.hh>
+#include "chargeanalytics.h"
+
+/*
+ * One row of the session history: what a charge was and how it went, without
+ * its samples (those stay in the session log at log). Built while the charge
+ * runs, begin() then update() for every sample and finish() at the end, or
+ * afterwards from a session log with fromLog(). begin() leaves pack and
+ * location as they were set.
+ */
+struct ChargeSummary {
+    enum Outcome { COMPLETED, STOPPED, FAILED };
+
+    int64_t id = 0;                 // in the history, 0 until added
+    std::string pack;               // battery pack the charge was for, empty if not given
+    std::string location;
+    std::string log;                // the session log with the samples
+    int64_t startedAtMs = 0;        // wall clock, ms since epoch
+    int batteryType = -1;           // b6::BATTERY_TYPE, -1 if not known
+    int mode = -1;                  // CHARGING_MODE_LI/NI/PB of the battery type, -1 if not known
+    int cellCount = 0;
+    Outcome outcome = STOPPED;
+    int capacity = 0;               // mAh
+    int durationS = 0;
+    double energyWh = 0.0;
+    int maxTemp = 0;                // degrees C, the higher of the two probes
+    double resistance = 0.0;        // pack, mOhm, 0 if never measured
+    int maxCellDelta = 0;           // mV between the highest and the lowest cell
+    int endVoltage = 0;             // pack, mV
+
+    bool isActive() const { return m_active; }
+
+    void begin(int64_t startedAtMs, int batteryType, int mode, int cellCount);
+    void update(const b6::ChargeInfo &info);
+    // outcome is only taken if nothing failed before
+    void finish(Outcome outcome, const ChargeAnalytics::Figures &figures);
+    void fail() { m_failed = true; }
+
+    // summarizes a session log written by AcquisitionWorker, false if it cannot be read or is still being written
+    static bool fromLog(const std::string &path, ChargeSummary &summary);
+
+private:
+    bool m_active = false;
+    bool m_failed = false;
+};
+
+#endif // CHARGESUMMARY_H
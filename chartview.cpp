@@ -0,0 +1,95 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "chartview.h"
+
+// range kept per wheel step towards the pointer
+static const qreal ZOOM_STEP = 0.8;
+
+ChartView::ChartView(QWidget *parent) : QChartView(parent) {
+}
+
+void ChartView::wheelEvent(QWheelEvent *event) {
+    QValueAxis *axis = m_axis();
+    if (axis == nullptr || event->angleDelta().y() == 0) {
+        QChartView::wheelEvent(event);
+        return;
+    }
+    const qreal factor = event->angleDelta().y() > 0 ? ZOOM_STEP : 1.0 / ZOOM_STEP;
+    const qreal at = axis->min() + m_fraction(event->pos()) * (axis->max() - axis->min());
+    emit rangeRequested(at - (at - axis->min()) * factor, at + (axis->max() - at) * factor);
+    event->accept();
+}
+
+void ChartView::mousePressEvent(QMouseEvent *event) {
+    QValueAxis *axis = m_axis();
+    if (axis == nullptr || event->button() != Qt::LeftButton) {
+        QChartView::mousePressEvent(event);
+        return;
+    }
+    m_dragging = true;
+    m_dragX = m_fraction(event->pos());
+    m_dragMin = axis->min();
+    m_dragMax = axis->max();
+    setCursor(Qt::ClosedHandCursor);
+    event->accept();
+}
+
+void ChartView::mouseMoveEvent(QMouseEvent *event) {
+    if (!m_dragging) {
+        QChartView::mouseMoveEvent(event);
+        return;
+    }
+    const qreal shift = (m_dragX - m_fraction(event->pos())) * (m_dragMax - m_dragMin);
+    emit rangeRequested(m_dragMin + shift, m_dragMax + shift);
+    event->accept();
+}
+
+void ChartView::mouseReleaseEvent(QMouseEvent *event) {
+    if (!m_dragging) {
+        QChartView::mouseReleaseEvent(event);
+        return;
+    }
+    m_dragging = false;
+    unsetCursor();
+    event->accept();
+}
+
+void ChartView::mouseDoubleClickEvent(QMouseEvent *event) {
+    if (event->button() != Qt::LeftButton) {
+        QChartView::mouseDoubleClickEvent(event);
+        return;
+    }
+    emit followRequested();
+    event->accept();
+}
+
+QValueAxis *ChartView::m_axis() const {
+    if (chart() == nullptr || chart()->axes(Qt::Horizontal).isEmpty()) {
+        return nullptr;
+    }
+    return qobject_cast<QValueAxis*>(chart()->axes(Qt::Horizontal).at(0));
+}
+
+qreal ChartView::m_fraction(const QPoint &pos) const {
+    const QRectF plot = chart()->plotArea();
+    if (plot.width() <= 0.0) {
+        return 0.5;
+    }
+    const QPointF at = chart()->mapFromScene(mapToScene(pos));
+    return (at.x() - plot.left()) / plot.width();
+}
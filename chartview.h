@@ -0,0 +1,57 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHARTVIEW_H
+#define CHARTVIEW_H
+
+#include <QtCharts>
+
+using namespace QtCharts;
+
+/*
+ * Chart view that zooms the time axis with the wheel, around the pointer,
+ * and pans it by dragging. It does not touch the axis itself but asks for
+ * the new range through rangeRequested(), so whoever feeds the chart can stop
+ * following the live end; a double click asks to follow it again.
+ */
+class ChartView : public QChartView {
+    Q_OBJECT
+public:
+    explicit ChartView(QWidget *parent = 0);
+
+signals:
+    void rangeRequested(qreal min, qreal max);
+    void followRequested();
+
+protected:
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+
+private:
+    bool m_dragging = false;
+    qreal m_dragX = 0.0;
+    qreal m_dragMin = 0.0, m_dragMax = 0.0;
+
+    QValueAxis *m_axis() const;
+    // position in the plot as a fraction of its width
+    qreal m_fraction(const QPoint &pos) const;
+};
+
+#endif // CHARTVIEW_H
@@ -0,0 +1,149 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include "acquisitionworker.h"
+#include "chargedaemon.h"
+#include "chargeprofiles.h"
+#include "diagnostics.h"
+#include "samplingpolicy.h"
+#include "sessionhistory.h"
+#include "telemetryformat.h"
+#include "telemetrystore.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("ChargeGuru");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless ChargeGuru: controls SkyRC B6 chargers and streams their telemetry to stdout.");
+    parser.addHelpOption();
+    QCommandLineOption locationOption("location", "Only use the charger at this USB location (bus-port.port).", "location");
+    QCommandLineOption startOption("start", "Start charging once the charger is connected.");
+    QCommandLineOption stopOption("stop", "Stop charging once the charger is connected.");
+    QCommandLineOption typeOption("type", "Battery type: lipo, liion, life, lihv, nimh, nicd or pb.", "type", "lipo");
+    QCommandLineOption modeOption("mode", "Charging mode, e.g. balance, storage, discharge, auto, repeak, cycle.", "mode", "standard");
+    QCommandLineOption cellsOption("cells", "Number of cells.", "count", "1");
+    QCommandLineOption chargeCurrentOption("charge-current", "Charge current in mA.", "mA", "100");
+    QCommandLineOption dischargeCurrentOption("discharge-current", "Discharge current in mA.", "mA", "100");
+    QCommandLineOption cellDischargeOption("cell-discharge-voltage", "Discharge cut-off per cell in mV.", "mV", "3000");
+    QCommandLineOption endVoltageOption("end-voltage", "End voltage per cell in mV.", "mV", "4100");
+    QCommandLineOption repeakOption("repeak", "Re-peak count.", "count", "1");
+    QCommandLineOption cyclesOption("cycles", "Cycle count.", "count", "1");
+    QCommandLineOption formatOption("format", "Output format: json or csv.", "format", "json");
+    QCommandLineOption exitOption("exit-when-done", "Exit once the charger is no longer charging, or all jobs are done.");
+    QCommandLineOption jobOption("job", "Queue a job of steps run one after another on the first free charger, e.g. "
+                                 "charge,rest=30,discharge,storage (rest in minutes). Takes the battery and profile "
+                                 "options; repeat for more jobs.", "steps");
+    QCommandLineOption listenOption("listen", "Also serve telemetry and accept commands on this local socket.", "name");
+    QCommandLineOption simulateOption("simulate", "Add a simulated charger, e.g. sim,cells=3,speed=100.", "spec");
+    QCommandLineOption diagnosticsOption("diagnostics", "Write timings and sample counters to this file on exit.", "file");
+    QCommandLineOption replayOption("replay", "Add a charger replaying a session log, e.g. charge.cglog,speed=100.", "log");
+    QCommandLineOption budgetOption("memory-budget", "Samples kept in memory per charger, MiB; older ones are thinned out "
+                                    "beyond it. 0 for no limit.", "MiB", "0");
+    QCommandLineOption packOption("pack", "Name of the battery pack charged, recorded in the session history.", "id");
+    QCommandLineOption historyOption("history", "Print the charges in the session history that match, e.g. "
+                                     "pack=42,type=lihv,min-cell-delta=30,since=2018-06-01,until=...,completed,limit=10 "
+                                     "(empty for all), as JSON lines and exit.", "query");
+    QCommandLineOption importOption("import-logs", "Add the session logs not in the session history yet to it and exit.");
+    QCommandLineOption samplingOption("sampling", "How often chargers are polled: fixed (1 s), fast (as fast as they "
+                                      "answer) or adaptive (fast only around CV transitions and the end of a charge).",
+                                      "mode", "adaptive");
+    parser.addOptions({ locationOption, startOption, stopOption, typeOption, modeOption, cellsOption,
+                        chargeCurrentOption, dischargeCurrentOption, cellDischargeOption, endVoltageOption,
+                        repeakOption, cyclesOption, formatOption, exitOption, listenOption, simulateOption, replayOption,
+                        diagnosticsOption, budgetOption, jobOption, packOption, historyOption, importOption,
+                        samplingOption });
+    parser.process(a);
+    TelemetryStore::setDefaultBudget(parser.value(budgetOption).toULongLong() * 1024 * 1024);
+    SamplingPolicy::Mode sampling;
+    if (!SamplingPolicy::parseMode(parser.value(samplingOption).toStdString(), sampling)) {
+        std::fprintf(stderr, "unknown sampling mode: %s\n", qPrintable(parser.value(samplingOption)));
+        return 2;
+    }
+    SamplingPolicy::setDefaultMode(sampling);
+
+    if (parser.isSet(historyOption) || parser.isSet(importOption)) {
+        SessionHistory history;
+        SessionHistory::Query query;
+        if (!history.open(SessionHistory::defaultPath())) {
+            std::fprintf(stderr, "cannot open the session history: %s\n", qPrintable(history.errorString()));
+            return 1;
+        }
+        if (parser.isSet(importOption)) {
+            std::fprintf(stderr, "imported %d session logs\n", history.importLogs(AcquisitionWorker::logDirectory()));
+        }
+        if (!parser.isSet(historyOption)) {
+            return 0;
+        }
+        if (!SessionHistory::parseQuery(parser.value(historyOption), query)) {
+            std::fprintf(stderr, "bad history query: %s\n", qPrintable(parser.value(historyOption)));
+            return 2;
+        }
+        for (const ChargeSummary &summary : history.find(query)) {
+            const QByteArray line = TelemetryFormat::summaryJson(summary);
+            std::fwrite(line.constData(), 1, static_cast<std::size_t>(line.size()), stdout);
+        }
+        return 0;
+    }
+
+    ChargeDaemon::Options options;
+    options.location = parser.value(locationOption);
+    options.start = parser.isSet(startOption);
+    options.stop = parser.isSet(stopOption);
+    options.exitWhenDone = parser.isSet(exitOption);
+    options.listen = parser.value(listenOption);
+    options.pack = parser.value(packOption);
+    options.jobs = parser.values(jobOption);
+    options.virtualDevices = parser.values(simulateOption);
+    for (const QString &log : parser.values(replayOption)) {
+        options.virtualDevices << "replay=" + log;
+    }
+    options.format = parser.value(formatOption) == "csv" ? ChargeDaemon::CSV : ChargeDaemon::JSON;
+
+    if (!ChargeProfiles::parseBatteryType(parser.value(typeOption), options.batteryType)) {
+        std::fprintf(stderr, "unknown battery type: %s\n", qPrintable(parser.value(typeOption)));
+        return 2;
+    }
+    if (!ChargeProfiles::parseMode(options.batteryType, parser.value(modeOption), options.profile)) {
+        std::fprintf(stderr, "unknown charging mode for %s: %s\n", qPrintable(parser.value(typeOption)),
+                     qPrintable(parser.value(modeOption)));
+        return 2;
+    }
+    options.profile.cellCount = parser.value(cellsOption).toInt();
+    options.profile.chargeCurrent = parser.value(chargeCurrentOption).toInt();
+    options.profile.dischargeCurrent = parser.value(dischargeCurrentOption).toInt();
+    options.profile.cellDischargeVoltage = parser.value(cellDischargeOption).toInt();
+    options.profile.endVoltage = parser.value(endVoltageOption).toInt();
+    options.profile.rPeakCount = parser.value(repeakOption).toInt();
+    options.profile.cycleCount = parser.value(cyclesOption).toInt();
+
+    ChargeDaemon daemon(options);
+    if (!daemon.start()) {
+        return 1;
+    }
+
+    const int status = a.exec();
+    if (parser.isSet(diagnosticsOption) && !Diagnostics::dump(parser.value(diagnosticsOption).toStdString())) {
+        std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(diagnosticsOption)));
+    }
+    return status;
+}
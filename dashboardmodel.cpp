@@ -0,0 +1,142 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QTime>
+#include "dashboardmodel.h"
+#include "diagnostics.h"
+
+// cells under 0.4 V are balance ports with nothing on them
+static const int MIN_CELL_MV = 400;
+
+DashboardModel::DashboardModel(QObject *parent) : QAbstractTableModel(parent) {
+}
+
+int DashboardModel::addSession(ChargerSession *session) {
+    const int row = addRow(session->location());
+    m_rows[row].session = session;
+    m_sessionRows.insert(session, row);
+
+    connect(session, SIGNAL(connected()), this, SLOT(onSessionChanged()));
+    connect(session, SIGNAL(disconnected()), this, SLOT(onSessionChanged()));
+    connect(session, SIGNAL(chargeInfoUpdated()), this, SLOT(onSessionChanged()));
+    m_update(row);
+    return row;
+}
+
+int DashboardModel::addRow(const QString &location) {
+    const int row = m_rows.size();
+    beginInsertRows(QModelIndex(), row, row);
+    Row added;
+    added.location = location;
+    m_rows.append(added);
+    endInsertRows();
+    return row;
+}
+
+void DashboardModel::setReadout(int row, const Readout &readout) {
+    Readout &shown = m_rows[row].readout;
+    if (readout.state != shown.state) {
+        shown.state = readout.state;
+        emit dataChanged(index(row, STATE), index(row, STATE));
+    }
+    // one signal per run of changed columns
+    int first = -1;
+    for (int column = VOLTAGE; column <= COLUMN_COUNT; column++) {
+        const bool changed = column < COLUMN_COUNT && readout.values[column] != shown.values[column];
+        if (changed && first < 0) {
+            first = column;
+        } else if (!changed && first >= 0) {
+            std::copy(readout.values + first, readout.values + column, shown.values + first);
+            emit dataChanged(index(row, first), index(row, column - 1));
+            first = -1;
+        }
+    }
+}
+
+int DashboardModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int DashboardModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant DashboardModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || (role != Qt::DisplayRole && role != VALUE_ROLE)) {
+        return QVariant();
+    }
+    const Row &row = m_rows.at(index.row());
+    const int column = index.column();
+    if (column == LOCATION || column == STATE) {
+        return role == Qt::DisplayRole ? (column == LOCATION ? row.location : row.readout.state) : QVariant();
+    }
+
+    const int value = row.readout.values[column];
+    if (role == VALUE_ROLE) {
+        return value;
+    }
+    switch (column) {
+    case VOLTAGE:
+        return QString("%1 V").arg((double)(value) / 1000.0, 0, 'f', 3);
+    case CURRENT:
+        return QString("%1 A").arg((double)(value) / 1000.0, 0, 'f', 3);
+    case CAPACITY:
+        return QString("%1 mAh").arg(value);
+    case TIME:
+        return QTime(0, 0, 0).addSecs(value).toString("hh:mm:ss");
+    default:
+        return value > MIN_CELL_MV ? QString::number((double)(value) / 1000.0, 'f', 3) : QString("-");
+    }
+}
+
+QVariant DashboardModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    static const char *const names[] = { "Charger", "State", "Voltage", "Current", "Capacity", "Time" };
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    return section < CELL ? QString(names[section]) : QString("Cell %1").arg(section - CELL + 1);
+}
+
+void DashboardModel::onSessionChanged() {
+    m_update(m_sessionRows.value(static_cast<ChargerSession*>(sender())));
+}
+
+void DashboardModel::m_update(int row) {
+    static LatencyHistogram &updateTime = Diagnostics::histogram("dashboard.update");
+    LatencyHistogram::Scope timer(updateTime);
+
+    const ChargerSession *session = m_rows.at(row).session;
+    // a charger that went away keeps showing what it read last
+    Readout readout = m_rows.at(row).readout;
+    if (!session->isConnected()) {
+        readout.state = "NOT CONNECTED";
+    } else if (!session->hasChargeInfo()) {
+        readout.state = session->deviceInfo().coreType;
+    } else {
+        const b6::ChargeInfo &info = session->chargeInfo();
+        readout.state = session->isCharging() ? QString("CHARGING") : QString("STATUS: %1").arg(info.state);
+        readout.values[VOLTAGE] = info.voltage;
+        readout.values[CURRENT] = info.current;
+        readout.values[CAPACITY] = info.capacity;
+        readout.values[TIME] = info.time;
+        for (int i = 0; i < MAX_CELLS; i++) {
+            readout.values[CELL + i] = i < session->deviceInfo().cellCount ? info.cells[i] : 0;
+        }
+    }
+    setReadout(row, readout);
+}
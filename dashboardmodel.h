@@ -0,0 +1,80 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DASHBOARDMODEL_H
+#define DASHBOARDMODEL_H
+
+#include <algorithm>
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QVector>
+#include "chargersession.h"
+
+/*
+ * The live readings of every charger, one row each. A row keeps the figures
+ * it last reported and an update only emits dataChanged() for the columns
+ * whose value actually changed, a cell only when its millivolts did. Text is
+ * formatted in data(), so only for what a view paints.
+ */
+class DashboardModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    static const int MAX_CELLS = 8;
+    enum Column { LOCATION, STATE, VOLTAGE, CURRENT, CAPACITY, TIME, CELL, COLUMN_COUNT = CELL + MAX_CELLS };
+    // the figure behind a column as an int: mV, mA, mAh or seconds
+    enum Role { VALUE_ROLE = Qt::UserRole };
+
+    struct Readout {
+        QString state;
+        int values[COLUMN_COUNT];   // by column, from VOLTAGE on
+
+        Readout() { std::fill(values, values + COLUMN_COUNT, 0); }
+    };
+
+    explicit DashboardModel(QObject *parent = 0);
+
+    int addSession(ChargerSession *session);
+    // a row fed through setReadout() instead of by a session
+    int addRow(const QString &location);
+    void setReadout(int row, const Readout &readout);
+
+    ChargerSession *session(int row) const { return m_rows.at(row).session; }
+    int rowOf(ChargerSession *session) const { return m_sessionRows.value(session, -1); }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private slots:
+    void onSessionChanged();
+
+private:
+    struct Row {
+        ChargerSession *session = nullptr;
+        QString location;
+        Readout readout;
+    };
+
+    QVector<Row> m_rows;
+    QHash<ChargerSession*, int> m_sessionRows;
+
+    void m_update(int row);
+};
+
+#endif // DASHBOARDMODEL_H
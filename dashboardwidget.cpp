@@ -0,0 +1,132 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <QApplication>
+#include <QPainter>
+#include <QStyledItemDelegate>
+#include "dashboardwidget.h"
+
+static const int TILE_WIDTH = 336;
+static const int TILE_MARGIN = 6;
+static const int BAR_HEIGHT = 32;
+// the span a cell bar covers, empty to full for a lithium cell
+static const int CELL_EMPTY_MV = 3000;
+static const int CELL_FULL_MV = 4200;
+static const int MIN_CELL_MV = 400;
+
+/*
+ * Paints a whole row of the model as one tile: charger and state, the pack
+ * figures, and a bar with the voltage of every cell that is connected.
+ */
+class TileDelegate : public QStyledItemDelegate {
+public:
+    explicit TileDelegate(QObject *parent) : QStyledItemDelegate(parent) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &) const override;
+};
+
+static QString columnText(const QModelIndex &index, int column) {
+    return index.sibling(index.row(), column).data().toString();
+}
+
+void TileDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    QStyle *style = option.widget != nullptr ? option.widget->style() : QApplication::style();
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &option, painter, option.widget);
+
+    painter->save();
+    const bool selected = option.state & QStyle::State_Selected;
+    const QColor foreground = option.palette.color(selected ? QPalette::HighlightedText : QPalette::Text);
+    painter->setPen(foreground);
+    const QRect tile = option.rect.adjusted(TILE_MARGIN, TILE_MARGIN, -TILE_MARGIN, -TILE_MARGIN);
+    const int line = option.fontMetrics.height();
+
+    QRect header(tile.left(), tile.top(), tile.width(), line);
+    QFont bold = option.font;
+    bold.setBold(true);
+    painter->setFont(bold);
+    painter->drawText(header, Qt::AlignLeft | Qt::AlignVCenter, columnText(index, DashboardModel::LOCATION));
+    painter->setFont(option.font);
+    painter->drawText(header, Qt::AlignRight | Qt::AlignVCenter, columnText(index, DashboardModel::STATE));
+    const QString figures = QString("%1   %2   %3   %4").arg(columnText(index, DashboardModel::VOLTAGE))
+            .arg(columnText(index, DashboardModel::CURRENT)).arg(columnText(index, DashboardModel::CAPACITY))
+            .arg(columnText(index, DashboardModel::TIME));
+    painter->drawText(header.translated(0, line), Qt::AlignLeft | Qt::AlignVCenter, figures);
+
+    const int slot = tile.width() / DashboardModel::MAX_CELLS;
+    const int barsTop = tile.top() + 2 * line + 2;
+    for (int i = 0; i < DashboardModel::MAX_CELLS; i++) {
+        const QModelIndex cell = index.sibling(index.row(), DashboardModel::CELL + i);
+        const int mv = cell.data(DashboardModel::VALUE_ROLE).toInt();
+        if (mv <= MIN_CELL_MV) {
+            continue;
+        }
+        const QRect frame(tile.left() + i * slot + 2, barsTop, slot - 4, BAR_HEIGHT);
+        const double fraction = std::max(0.0, std::min(1.0, (double)(mv - CELL_EMPTY_MV) / (CELL_FULL_MV - CELL_EMPTY_MV)));
+        const int height = static_cast<int>(fraction * (frame.height() - 1));
+        painter->fillRect(QRect(frame.left(), frame.bottom() - height, frame.width(), height + 1), QColor(0x00, 0xa0, 0x00));
+        painter->drawRect(frame.adjusted(0, 0, -1, -1));
+        painter->drawText(QRect(frame.left() - 2, frame.bottom() + 1, slot, line), Qt::AlignHCenter | Qt::AlignVCenter,
+                          cell.data().toString());
+    }
+    painter->restore();
+}
+
+QSize TileDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &) const {
+    return QSize(TILE_WIDTH, 2 * TILE_MARGIN + 3 * option.fontMetrics.height() + BAR_HEIGHT + 3);
+}
+
+DashboardWidget::DashboardWidget(QWidget *parent) : QListView(parent), m_model(new DashboardModel(this)) {
+    setModel(m_model);
+    setItemDelegate(new TileDelegate(this));
+    setFlow(QListView::LeftToRight);
+    setWrapping(true);
+    setResizeMode(QListView::Adjust);
+    setUniformItemSizes(true);
+    setSpacing(2);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    connect(selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)), this, SLOT(onCurrentRowChanged(QModelIndex)));
+}
+
+void DashboardWidget::addSession(ChargerSession *session) {
+    m_model->addSession(session);
+}
+
+void DashboardWidget::selectSession(ChargerSession *session) {
+    int row = m_model->rowOf(session);
+    if (row >= 0 && row != currentIndex().row()) {
+        setCurrentIndex(m_model->index(row, DashboardModel::LOCATION));
+    }
+}
+
+void DashboardWidget::dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &) {
+    // a tile paints every column of its row, the list view would only repaint the one it shows;
+    // update() leaves alone the tiles scrolled out of view
+    for (int row = topLeft.row(); row <= bottomRight.row(); row++) {
+        update(m_model->index(row, modelColumn()));
+    }
+}
+
+void DashboardWidget::onCurrentRowChanged(const QModelIndex &current) {
+    if (current.isValid() && m_model->session(current.row()) != nullptr) {
+        emit sessionSelected(m_model->session(current.row()));
+    }
+}
@@ -0,0 +1,56 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DASHBOARDWIDGET_H
+#define DASHBOARDWIDGET_H
+
+#include <QListView>
+#include "chargersession.h"
+#include "dashboardmodel.h"
+
+/*
+ * One compact tile per charger with its live readings and a bar per cell,
+ * laid out in a grid that wraps with the width, for a wall of chargers.
+ * A tile is repainted only when its row changed and only while it is in
+ * view. Selecting a tile picks the charger shown and controlled by the main
+ * window.
+ */
+class DashboardWidget : public QListView {
+    Q_OBJECT
+public:
+    explicit DashboardWidget(QWidget *parent = 0);
+
+    DashboardModel *dashboardModel() const { return m_model; }
+    void addSession(ChargerSession *session);
+    void selectSession(ChargerSession *session);
+
+signals:
+    void sessionSelected(ChargerSession *session);
+
+protected slots:
+    void dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                     const QVector<int> &roles = QVector<int>()) override;
+
+private slots:
+    void onCurrentRowChanged(const QModelIndex &current);
+
+private:
+    DashboardModel *m_model;
+};
+
+#endif // DASHBOARDWIDGET_H
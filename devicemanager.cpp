@@ -0,0 +1,71 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devicemanager.h"
+
+DeviceManager::DeviceManager(QObject *parent) : QObject(parent) {
+    // queued, so chargers are never opened from inside a libusb callback
+    m_hotplug = new UsbHotplugMonitor(this);
+    connect(m_hotplug, SIGNAL(deviceArrived(QString)), this, SLOT(onDeviceArrived(QString)), Qt::QueuedConnection);
+    connect(m_hotplug, SIGNAL(deviceLeft(QString)), this, SLOT(onDeviceLeft(QString)), Qt::QueuedConnection);
+}
+
+void DeviceManager::start() {
+    m_hotplug->start();
+}
+
+ChargerSession *DeviceManager::addVirtualDevice(const QString &spec) {
+    QString location = QString("%1-%2").arg(spec.startsWith("replay=") ? "replay" : "sim").arg(++m_virtualDevices);
+    ChargerSession *session = new ChargerSession(location, spec, this);
+    m_sessions.insert(location, session);
+    emit sessionAdded(session);
+    session->attach();
+    return session;
+}
+
+ChargerSession *DeviceManager::openLog(const QString &path) {
+    SessionLogReader log;
+    if (!log.open(path.toStdString()) || log.size() == 0) {
+        return nullptr;
+    }
+
+    if (m_logSession == nullptr) {
+        m_logSession = new ChargerSession("log", "replay=" + path, this);
+        m_sessions.insert(m_logSession->location(), m_logSession);
+        emit sessionAdded(m_logSession);
+    }
+    m_logSession->showLog(path);
+    return m_logSession;
+}
+
+void DeviceManager::onDeviceArrived(QString location) {
+    ChargerSession *session = m_sessions.value(location);
+    if (session == nullptr) {
+        session = new ChargerSession(location, QString(), this);
+        m_sessions.insert(location, session);
+        emit sessionAdded(session);
+    }
+    session->attach();
+}
+
+void DeviceManager::onDeviceLeft(QString location) {
+    ChargerSession *session = m_sessions.value(location);
+    if (session != nullptr) {
+        session->detach();
+    }
+}
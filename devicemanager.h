@@ -0,0 +1,62 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEVICEMANAGER_H
+#define DEVICEMANAGER_H
+
+#include <QMap>
+#include <QObject>
+#include "chargersession.h"
+#include "usbhotplugmonitor.h"
+
+/*
+ * Keeps one ChargerSession per USB location a charger has been seen at.
+ * Sessions outlive unplugging so their data stays viewable and are re-attached
+ * when a charger shows up at the same location again. Simulated and replayed
+ * chargers get locations of their own, sim-N and replay-N, and keep no
+ * session logs. Logs opened for viewing share a single session, "log".
+ */
+class DeviceManager : public QObject {
+    Q_OBJECT
+public:
+    explicit DeviceManager(QObject *parent = 0);
+
+    void start();
+    // adds and attaches a virtual charger, see ChargerDevice::fromSpec()
+    ChargerSession *addVirtualDevice(const QString &spec);
+    // shows the charge recorded in a log in the one replay session kept for that, read straight from the log
+    // without a charger attached; nullptr if the log cannot be read
+    ChargerSession *openLog(const QString &path);
+    QList<ChargerSession*> sessions() const { return m_sessions.values(); }
+    ChargerSession *session(const QString &location) const { return m_sessions.value(location); }
+
+signals:
+    void sessionAdded(ChargerSession *session);
+
+private slots:
+    void onDeviceArrived(QString location);
+    void onDeviceLeft(QString location);
+
+private:
+    UsbHotplugMonitor *m_hotplug;
+    QMap<QString, ChargerSession*> m_sessions;
+    int m_virtualDevices = 0;
+    ChargerSession *m_logSession = nullptr;
+};
+
+#endif // DEVICEMANAGER_H
@@ -0,0 +1,114 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "diagnostics.h"
+
+namespace {
+    struct Registry {
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+        std::map<std::string, std::unique_ptr<std::atomic<uint64_t>>> counters;
+    };
+
+    Registry &registry() {
+        static Registry instance;
+        return instance;
+    }
+}
+
+LatencyHistogram &Diagnostics::histogram(const std::string &name) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::unique_ptr<LatencyHistogram> &histogram = r.histograms[name];
+    if (!histogram) {
+        histogram.reset(new LatencyHistogram());
+    }
+    return *histogram;
+}
+
+std::atomic<uint64_t> &Diagnostics::counter(const std::string &name) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::unique_ptr<std::atomic<uint64_t>> &counter = r.counters[name];
+    if (!counter) {
+        counter.reset(new std::atomic<uint64_t>(0));
+    }
+    return *counter;
+}
+
+void Diagnostics::forEachHistogram(const std::function<void(const std::string&, const LatencyHistogram&)> &fn) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &it : r.histograms) {
+        fn(it.first, *it.second);
+    }
+}
+
+void Diagnostics::forEachCounter(const std::function<void(const std::string&, uint64_t)> &fn) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &it : r.counters) {
+        fn(it.first, it.second->load(std::memory_order_relaxed));
+    }
+}
+
+void Diagnostics::reset() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &it : r.histograms) {
+        it.second->reset();
+    }
+    for (const auto &it : r.counters) {
+        it.second->store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string Diagnostics::report() {
+    std::string out;
+    char line[200];
+
+    std::snprintf(line, sizeof(line), "%-28s %10s %10s %10s %10s %10s %10s %10s\n",
+                  "timing (ms)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    out += line;
+    forEachHistogram([&](const std::string &name, const LatencyHistogram &h) {
+        std::snprintf(line, sizeof(line), "%-28s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name.c_str(),
+                      static_cast<unsigned long long>(h.count()), h.mean() / 1e6, h.percentile(0.5) / 1e6,
+                      h.percentile(0.9) / 1e6, h.percentile(0.99) / 1e6, h.percentile(0.999) / 1e6, h.max() / 1e6);
+        out += line;
+    });
+
+    out += "\n";
+    std::snprintf(line, sizeof(line), "%-28s %10s\n", "counter", "value");
+    out += line;
+    forEachCounter([&](const std::string &name, uint64_t value) {
+        std::snprintf(line, sizeof(line), "%-28s %10llu\n", name.c_str(), static_cast<unsigned long long>(value));
+        out += line;
+    });
+    return out;
+}
+
+bool Diagnostics::dump(const std::string &path) {
+    std::ofstream file(path);
+    file << report();
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,50 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "latencyhistogram.h"
+
+/*
+ * Process wide, always-on timings and event counters of the hot paths,
+ * aggregated over all chargers. Look a metric up once and keep the reference,
+ * lookups take a lock but recording does not:
+ *
+ *   static LatencyHistogram &poll = Diagnostics::histogram("device.getChargeInfo");
+ *   LatencyHistogram::Scope timing(poll);
+ */
+namespace Diagnostics {
+    LatencyHistogram &histogram(const std::string &name);
+    std::atomic<uint64_t> &counter(const std::string &name);
+
+    // in name order
+    void forEachHistogram(const std::function<void(const std::string&, const LatencyHistogram&)> &fn);
+    void forEachCounter(const std::function<void(const std::string&, uint64_t)> &fn);
+    void reset();
+
+    // all metrics as a plain text table, durations in ms
+    std::string report();
+    bool dump(const std::string &path);
+}
+
+#endif // DIAGNOSTICS_H
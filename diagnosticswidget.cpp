@@ -0,0 +1,148 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include "diagnostics.h"
+#include "diagnosticswidget.h"
+
+namespace {
+    /*
+     * Filters can't wrap an event, so the paint event is sent again from
+     * inside the filter, timed, and the original swallowed.
+     */
+    class PaintTimer : public QObject {
+    public:
+        PaintTimer(QObject *parent, LatencyHistogram &histogram) : QObject(parent), m_histogram(histogram) {}
+
+    protected:
+        bool eventFilter(QObject *watched, QEvent *event) override {
+            if (event->type() != QEvent::Paint || m_painting) {
+                return false;
+            }
+
+            m_painting = true;
+            {
+                LatencyHistogram::Scope timing(m_histogram);
+                QCoreApplication::sendEvent(watched, event);
+            }
+            m_painting = false;
+            return true;
+        }
+
+    private:
+        LatencyHistogram &m_histogram;
+        bool m_painting = false;
+    };
+
+    QString ms(double nanoseconds) {
+        return QString::number(nanoseconds / 1e6, 'f', 3);
+    }
+}
+
+DiagnosticsWidget::DiagnosticsWidget(QWidget *parent) : QWidget(parent) {
+    m_table = new QTableWidget(0, 7, this);
+    m_table->setHorizontalHeaderLabels({ "Timing (ms)", "Count", "p50", "p90", "p99", "p99.9", "Max" });
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionMode(QAbstractItemView::NoSelection);
+
+    QPushButton *btDump = new QPushButton("Save…", this);
+    QPushButton *btReset = new QPushButton("Reset", this);
+    connect(btDump, SIGNAL(clicked()), this, SLOT(onDumpClicked()));
+    connect(btReset, SIGNAL(clicked()), this, SLOT(onResetClicked()));
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addStretch();
+    buttons->addWidget(btReset);
+    buttons->addWidget(btDump);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_table);
+    layout->addLayout(buttons);
+
+    m_timer = new QTimer(this);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+    m_timer->start(1000);
+}
+
+void DiagnosticsWidget::timePaints(QWidget *widget, const std::string &name) {
+    widget->installEventFilter(new PaintTimer(widget, Diagnostics::histogram(name)));
+}
+
+void DiagnosticsWidget::refresh() {
+    uint64_t late = 0, missed = 0, dropped = 0;
+    Diagnostics::forEachCounter([&](const std::string &name, uint64_t value) {
+        if (name == "samples.late") {
+            late = value;
+        } else if (name == "samples.missed") {
+            missed = value;
+        } else if (name == "samples.dropped") {
+            dropped = value;
+        }
+    });
+    const LatencyHistogram &paint = Diagnostics::histogram("paint.charts");
+    emit summaryChanged(QString("late %1 · missed %2 · dropped %3 · paint p99 %4 ms")
+                           .arg(late).arg(missed).arg(dropped).arg(ms(paint.percentile(0.99))));
+
+    if (!isVisible()) {
+        return;
+    }
+
+    int row = 0;
+    auto setRow = [&](const QStringList &cells) {
+        if (row >= m_table->rowCount()) {
+            m_table->insertRow(row);
+            for (int column = 0; column < m_table->columnCount(); column++) {
+                m_table->setItem(row, column, new QTableWidgetItem());
+            }
+        }
+        for (int column = 0; column < m_table->columnCount(); column++) {
+            m_table->item(row, column)->setText(column < cells.size() ? cells.at(column) : QString());
+        }
+        row++;
+    };
+    Diagnostics::forEachHistogram([&](const std::string &name, const LatencyHistogram &h) {
+        setRow({ QString::fromStdString(name), QString::number(h.count()), ms(h.percentile(0.5)), ms(h.percentile(0.9)),
+                 ms(h.percentile(0.99)), ms(h.percentile(0.999)), ms(h.max()) });
+    });
+    Diagnostics::forEachCounter([&](const std::string &name, uint64_t value) {
+        setRow({ QString::fromStdString(name), QString::number(value) });
+    });
+    m_table->setRowCount(row);
+}
+
+void DiagnosticsWidget::onDumpClicked() {
+    QString path = QFileDialog::getSaveFileName(this, "Save diagnostics", "chargeguru-diagnostics.txt", "Text files (*.txt)");
+    if (!path.isEmpty() && !Diagnostics::dump(path.toStdString())) {
+        QMessageBox::critical(this, "Save diagnostics", "Could not write " + path);
+    }
+}
+
+void DiagnosticsWidget::onResetClicked() {
+    Diagnostics::reset();
+    refresh();
+}
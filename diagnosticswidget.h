@@ -0,0 +1,53 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIAGNOSTICSWIDGET_H
+#define DIAGNOSTICSWIDGET_H
+
+#include <string>
+#include <QTableWidget>
+#include <QTimer>
+#include <QWidget>
+
+/*
+ * Live view of the Diagnostics timings and counters, refreshed once a second
+ * while shown, with buttons to save them to a file and to start over.
+ * summaryChanged() carries a one line digest for the status bar.
+ */
+class DiagnosticsWidget : public QWidget {
+    Q_OBJECT
+public:
+    explicit DiagnosticsWidget(QWidget *parent = 0);
+
+    // records how long every paint event of widget takes under the given name
+    static void timePaints(QWidget *widget, const std::string &name);
+
+signals:
+    void summaryChanged(QString summary);
+
+private slots:
+    void refresh();
+    void onDumpClicked();
+    void onResetClicked();
+
+private:
+    QTableWidget *m_table;
+    QTimer *m_timer;
+};
+
+#endif // DIAGNOSTICSWIDGET_H
@@ -0,0 +1,380 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include "fleetanalysis.h"
+#include "sessionlog.h"
+#include "workstealingpool.h"
+
+// capacity fitted at the last charge this much below the one fitted at the first is reported
+static const double FADE_ALERT = 0.2;
+// resistance this much above
+static const double RESISTANCE_ALERT = 0.5;
+// mV between the cells at the end of a charge
+static const double CELL_DELTA_ALERT = 30.0;
+// a cell this many mV below the average cell and lowest in this share of the charges is drifting
+static const double DRIFT_OFFSET = -10.0;
+static const double DRIFT_SHARE = 0.6;
+// charges a trend needs before it is reported
+static const std::size_t TREND_MIN = 3;
+
+static const uint8_t STATE_COMPLETE = 0x03;
+static const double MS_PER_DAY = 86400000.0;
+
+static std::string format(const char *pattern, double a, double b = 0.0, double c = 0.0) {
+    char text[160];
+    std::snprintf(text, sizeof(text), pattern, a, b, c);
+    return text;
+}
+
+static std::string jsonString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+void FleetAnalysis::Trend::add(double t, double y) {
+    if (n == 0 || t < firstT) {
+        firstT = t;
+    }
+    if (n == 0 || t > lastT) {
+        lastT = t;
+    }
+    n++;
+    st += t;
+    sy += y;
+    stt += t * t;
+    sty += t * y;
+}
+
+void FleetAnalysis::Trend::merge(const Trend &other) {
+    if (other.n == 0) {
+        return;
+    }
+    firstT = n == 0 ? other.firstT : std::min(firstT, other.firstT);
+    lastT = n == 0 ? other.lastT : std::max(lastT, other.lastT);
+    n += other.n;
+    st += other.st;
+    sy += other.sy;
+    stt += other.stt;
+    sty += other.sty;
+}
+
+double FleetAnalysis::Trend::slope() const {
+    const double d = n * stt - st * st;
+    return n < 2 || d <= 0.0 ? 0.0 : (n * sty - st * sy) / d;
+}
+
+double FleetAnalysis::Trend::at(double t) const {
+    if (n == 0) {
+        return 0.0;
+    }
+    return sy / n + slope() * (t - st / n);
+}
+
+double FleetAnalysis::Trend::change() const {
+    const double first = at(firstT);
+    return first == 0.0 ? 0.0 : (at(lastT) - first) / first;
+}
+
+void FleetAnalysis::Group::add(const Charge &charge) {
+    const ChargeSummary &summary = charge.summary;
+    const double day = summary.startedAtMs / MS_PER_DAY;
+    firstMs = charges == 0 ? summary.startedAtMs : std::min(firstMs, static_cast<int64_t>(summary.startedAtMs));
+    lastMs = charges == 0 ? summary.startedAtMs : std::max(lastMs, static_cast<int64_t>(summary.startedAtMs));
+    charges++;
+    if (summary.outcome == ChargeSummary::COMPLETED) {
+        completed++;
+        if (charge.discharge) {
+            discharged.add(day, summary.capacity);
+        } else {
+            capacity.add(day, summary.capacity);
+            if (charge.lowestCell >= 0) {
+                cellDelta.add(day, charge.endCellDelta);
+            }
+        }
+    }
+    if (summary.resistance > 0.0) {
+        resistance.add(day, summary.resistance);
+    }
+
+    maxCellDelta = std::max(maxCellDelta, summary.maxCellDelta);
+    maxTemp = std::max(maxTemp, summary.maxTemp);
+    cellCount = std::max(cellCount, summary.cellCount);
+    if (charge.lowestCell >= 0) {
+        lowest[charge.lowestCell]++;
+    }
+    bool measured = false;
+    for (int i = 0; i < CELLS; i++) {
+        cellOffset[i] += charge.cellOffset[i];
+        cellResistance[i] += charge.cellResistance[i];
+        measured = measured || charge.cellResistance[i] > 0.0f;
+    }
+    cellResistanceCount += measured ? 1 : 0;
+    energyWh += summary.energyWh;
+    durationS += summary.durationS;
+    records += charge.records;
+}
+
+void FleetAnalysis::Group::merge(const Group &other) {
+    if (other.charges == 0) {
+        return;
+    }
+    firstMs = charges == 0 ? other.firstMs : std::min(firstMs, other.firstMs);
+    lastMs = charges == 0 ? other.lastMs : std::max(lastMs, other.lastMs);
+    charges += other.charges;
+    completed += other.completed;
+    capacity.merge(other.capacity);
+    discharged.merge(other.discharged);
+    resistance.merge(other.resistance);
+    cellDelta.merge(other.cellDelta);
+    maxCellDelta = std::max(maxCellDelta, other.maxCellDelta);
+    maxTemp = std::max(maxTemp, other.maxTemp);
+    cellCount = std::max(cellCount, other.cellCount);
+    for (int i = 0; i < CELLS; i++) {
+        lowest[i] += other.lowest[i];
+        cellOffset[i] += other.cellOffset[i];
+        cellResistance[i] += other.cellResistance[i];
+    }
+    cellResistanceCount += other.cellResistanceCount;
+    energyWh += other.energyWh;
+    durationS += other.durationS;
+    records += other.records;
+}
+
+int FleetAnalysis::Group::driftingCell() const {
+    if (charges < static_cast<int>(TREND_MIN) || cellCount < 2) {
+        return -1;
+    }
+    const int cell = static_cast<int>(std::max_element(lowest, lowest + cellCount) - lowest);
+    const bool below = cellOffset[cell] / charges <= DRIFT_OFFSET;
+    return below && lowest[cell] >= DRIFT_SHARE * charges ? cell : -1;
+}
+
+std::vector<std::string> FleetAnalysis::Group::alerts() const {
+    std::vector<std::string> found;
+    // what comes out of the pack tells more than what goes in, if it was measured
+    const Trend &fade = discharged.n >= TREND_MIN ? discharged : capacity;
+    if (fade.n >= TREND_MIN && fade.change() <= -FADE_ALERT) {
+        found.push_back(format("capacity down %.0f%% (%.0f mAh/30 days)", -100.0 * fade.change(), 30.0 * fade.slope()));
+    }
+    if (resistance.n >= TREND_MIN && resistance.change() >= RESISTANCE_ALERT) {
+        found.push_back(format("resistance up %.0f%% (%.1f to %.1f mOhm)", 100.0 * resistance.change(),
+                               resistance.at(resistance.firstT), resistance.at(resistance.lastT)));
+    }
+    if (cellDelta.n >= TREND_MIN && cellDelta.at(cellDelta.lastT) >= CELL_DELTA_ALERT) {
+        found.push_back(format("cells end %.0f mV apart", cellDelta.at(cellDelta.lastT)));
+    }
+    const int cell = driftingCell();
+    if (cell >= 0) {
+        found.push_back(format("cell %.0f drifts low, %.1f mV below average, lowest in %.0f%% of charges", cell + 1,
+                               -cellOffset[cell] / charges, 100.0 * lowest[cell] / charges));
+    }
+    return found;
+}
+
+void FleetAnalysis::Report::merge(const Report &other) {
+    for (const auto &it : other.groups) {
+        Group &group = groups[it.first];
+        group.name = it.first;
+        group.merge(it.second);
+    }
+    files += other.files;
+    unreadable += other.unreadable;
+    records += other.records;
+    bytes += other.bytes;
+}
+
+bool FleetAnalysis::analyzeLog(const std::string &path, Charge &charge) {
+    SessionLogReader reader;
+    if (!reader.open(path) || !(reader.header().flags & SessionLog::FLAG_CLOSED)) {
+        return false;
+    }
+
+    charge = Charge();
+    ChargeSummary &summary = charge.summary;
+    summary.log = path;
+    summary.begin(reader.header().startedAtMs, -1, -1, static_cast<int>(reader.header().cellCount));
+    ChargeAnalytics analytics;
+    double offsets[CELLS] = {};
+    std::size_t balanced = 0;
+    uint8_t state = 0;
+    int firstVoltage = -1;
+    b6::ChargeInfo info = {};
+    for (; charge.records < reader.size() && SessionLog::isValid(reader.record(charge.records)); charge.records++) {
+        const SessionLog::Record &record = reader.record(charge.records);
+        info = SessionLog::toChargeInfo(record);
+        analytics.update(record.timeMs, info);
+        summary.update(info);
+        state = record.state;
+        if (firstVoltage < 0) {
+            firstVoltage = info.voltage;
+        }
+
+        // how far each cell sits from the average one, over the ports with a cell on them
+        int cells = 0, sum = 0;
+        for (int i = 0; i < CELLS; i++) {
+            cells += info.cells[i] > 0 ? 1 : 0;
+            sum += info.cells[i];
+        }
+        if (cells >= 2) {
+            const double mean = static_cast<double>(sum) / cells;
+            for (int i = 0; i < cells; i++) {
+                offsets[i] += info.cells[i] - mean;
+            }
+            balanced++;
+        }
+    }
+    summary.finish(state == STATE_COMPLETE ? ChargeSummary::COMPLETED : ChargeSummary::STOPPED, analytics.figures());
+    charge.discharge = info.voltage < firstVoltage;
+
+    const ChargeAnalytics::Figures &figures = analytics.figures();
+    for (int i = 0; i < CELLS; i++) {
+        charge.cellOffset[i] = balanced > 0 ? static_cast<float>(offsets[i] / balanced) : 0.0f;
+        charge.cellResistance[i] = figures.cellResistance[i];
+    }
+    if (figures.cellCount >= 2) {
+        const int *cells = info.cells;
+        const int high = static_cast<int>(std::max_element(cells, cells + figures.cellCount) - cells);
+        charge.lowestCell = static_cast<int>(std::min_element(cells, cells + figures.cellCount) - cells);
+        charge.endCellDelta = cells[high] - cells[charge.lowestCell];
+    }
+    return true;
+}
+
+FleetAnalysis::Report FleetAnalysis::run(const std::vector<Input> &inputs, int threads) {
+    const auto started = std::chrono::steady_clock::now();
+    Report report;
+    {
+        WorkStealingPool pool(threads);
+        // one set of totals per worker, merged once they are done
+        std::vector<std::unique_ptr<Report>> partial;
+        for (int i = 0; i < pool.size(); i++) {
+            partial.emplace_back(new Report());
+        }
+
+        for (const Input &input : inputs) {
+            const Input *job = &input;
+            pool.submit([job, &pool, &partial]() {
+                Report &totals = *partial[pool.currentWorker()];
+                Charge charge;
+                totals.files++;
+                if (!analyzeLog(job->path, charge)) {
+                    totals.unreadable++;
+                    return;
+                }
+                Group &group = totals.groups[job->group];
+                group.name = job->group;
+                group.add(charge);
+                totals.records += charge.records;
+                totals.bytes += sizeof(SessionLog::Header) + charge.records * sizeof(SessionLog::Record);
+            });
+        }
+        pool.wait();
+
+        for (const auto &it : partial) {
+            report.merge(*it);
+        }
+        report.threads = pool.size();
+        report.steals = pool.steals();
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+void FleetAnalysis::writeText(const Report &report, std::ostream &out) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%zu logs (%zu unreadable), %zu samples, %.1f MiB in %.2f s on %d threads\n\n",
+                  report.files, report.unreadable, report.records, report.bytes / 1048576.0, report.seconds,
+                  report.threads);
+    out << line;
+    std::snprintf(line, sizeof(line), "%-16s %7s %9s %11s %9s %12s %9s %8s %6s\n", "pack", "charges", "capacity",
+                  "mAh/30d", "IR mOhm", "IR/30d", "cell dV", "max dV", "max C");
+    out << line;
+    for (const auto &it : report.groups) {
+        const Group &group = it.second;
+        std::snprintf(line, sizeof(line), "%-16s %7d %9.0f %11.1f %9.1f %12.2f %9.0f %8d %6d\n", group.name.c_str(),
+                      group.charges, group.capacity.at(group.capacity.lastT), 30.0 * group.capacity.slope(),
+                      group.resistance.at(group.resistance.lastT), 30.0 * group.resistance.slope(),
+                      group.cellDelta.at(group.cellDelta.lastT), group.maxCellDelta, group.maxTemp);
+        out << line;
+    }
+
+    bool header = false;
+    for (const auto &it : report.groups) {
+        for (const std::string &alert : it.second.alerts()) {
+            if (!header) {
+                out << "\nneeds attention:\n";
+                header = true;
+            }
+            out << "  " << it.first << ": " << alert << '\n';
+        }
+    }
+}
+
+void FleetAnalysis::writeJson(const Report &report, std::ostream &out) {
+    char number[64];
+    auto num = [&](double value) {
+        std::snprintf(number, sizeof(number), "%.6g", std::isfinite(value) ? value : 0.0);
+        return std::string(number);
+    };
+
+    out << "{\"files\":" << report.files << ",\"unreadable\":" << report.unreadable << ",\"records\":"
+        << report.records << ",\"bytes\":" << report.bytes << ",\"seconds\":" << num(report.seconds)
+        << ",\"threads\":" << report.threads << ",\"steals\":" << report.steals << ",\"packs\":[";
+    bool first = true;
+    for (const auto &it : report.groups) {
+        const Group &group = it.second;
+        out << (first ? "" : ",") << "{\"pack\":" << jsonString(group.name) << ",\"charges\":" << group.charges
+            << ",\"completed\":" << group.completed << ",\"first\":" << group.firstMs << ",\"last\":" << group.lastMs
+            << ",\"capacity\":" << num(group.capacity.at(group.capacity.lastT))
+            << ",\"capacityPerDay\":" << num(group.capacity.slope())
+            << ",\"capacityChange\":" << num(group.capacity.change())
+            << ",\"discharged\":" << num(group.discharged.at(group.discharged.lastT))
+            << ",\"dischargedPerDay\":" << num(group.discharged.slope())
+            << ",\"resistance\":" << num(group.resistance.at(group.resistance.lastT))
+            << ",\"resistancePerDay\":" << num(group.resistance.slope())
+            << ",\"resistanceChange\":" << num(group.resistance.change())
+            << ",\"cellDelta\":" << num(group.cellDelta.at(group.cellDelta.lastT))
+            << ",\"maxCellDelta\":" << group.maxCellDelta << ",\"maxTemp\":" << group.maxTemp
+            << ",\"energy\":" << num(group.energyWh) << ",\"duration\":" << group.durationS << ",\"cells\":[";
+        for (int i = 0; i < group.cellCount && i < CELLS; i++) {
+            out << (i ? "," : "") << "{\"offset\":" << num(group.cellOffset[i] / group.charges)
+                << ",\"lowest\":" << group.lowest[i] << ",\"resistance\":"
+                << num(group.cellResistanceCount ? group.cellResistance[i] / group.cellResistanceCount : 0.0) << "}";
+        }
+        out << "],\"alerts\":[";
+        const std::vector<std::string> alerts = group.alerts();
+        for (std::size_t i = 0; i < alerts.size(); i++) {
+            out << (i ? "," : "") << jsonString(alerts[i]);
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "]}\n";
+}
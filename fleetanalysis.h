@@ -0,0 +1,123 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FLEETANALYSIS_H
+#define FLEETANALYSIS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "chargesummary.h"
+
+/*
+ * Health report over many session logs: per pack (or charger, for logs with
+ * no pack) the capacity, internal resistance and cell delta over time as
+ * least-squares trends, and which cell keeps ending up lowest. The charger
+ * reports the current unsigned, a log whose voltage fell is taken for a
+ * discharge. Every log is
+ * read once, front to back, by one task of a WorkStealingPool and folded
+ * into the running totals of its worker, so memory does not grow with the
+ * number of logs; the workers' totals are merged at the end.
+ */
+class FleetAnalysis {
+public:
+    static const int CELLS = 8;
+
+    struct Input {
+        std::string path;
+        std::string group;                   // pack, or the charger's location
+    };
+
+    // what one log adds
+    struct Charge {
+        ChargeSummary summary;
+        std::size_t records = 0;
+        bool discharge = false;              // the pack voltage fell over the log
+        int endCellDelta = 0;                // mV between the highest and the lowest cell at the end
+        int lowestCell = -1;                 // balance port of the lowest cell at the end, -1 without cells
+        float cellOffset[CELLS] = {};        // mean mV of each cell above the average cell
+        float cellResistance[CELLS] = {};    // mOhm
+    };
+
+    // least squares line through (days, value) points, mergeable
+    struct Trend {
+        std::size_t n = 0;
+        double st = 0.0, sy = 0.0, stt = 0.0, sty = 0.0;
+        double firstT = 0.0, lastT = 0.0;
+
+        void add(double t, double y);
+        void merge(const Trend &other);
+        double slope() const;                // per day
+        double at(double t) const;
+        // from the fitted value at the first point to the one at the last, relative
+        double change() const;
+    };
+
+    struct Group {
+        std::string name;
+        int charges = 0;
+        int completed = 0;
+        int64_t firstMs = 0, lastMs = 0;
+        Trend capacity;                      // completed charges only
+        Trend discharged;                    // capacity of completed discharges
+        Trend resistance;                    // logs with a resistance estimate
+        Trend cellDelta;                     // at the end of completed charges
+        int maxCellDelta = 0;
+        int maxTemp = 0;
+        int cellCount = 0;
+        int lowest[CELLS] = {};              // charges each cell ended lowest
+        double cellOffset[CELLS] = {};       // summed over the charges
+        double cellResistance[CELLS] = {};
+        int cellResistanceCount = 0;
+        double energyWh = 0.0;
+        int64_t durationS = 0;
+        std::size_t records = 0;
+
+        void add(const Charge &charge);
+        void merge(const Group &other);
+        // the cell that keeps ending up well below the others, -1 if none
+        int driftingCell() const;
+        // capacity fading, resistance growing, cells ending apart or a drifting cell
+        std::vector<std::string> alerts() const;
+    };
+
+    struct Report {
+        std::map<std::string, Group> groups;
+        std::size_t files = 0;
+        std::size_t unreadable = 0;
+        std::size_t records = 0;
+        std::size_t bytes = 0;
+        double seconds = 0.0;
+        int threads = 0;
+        std::size_t steals = 0;
+
+        void merge(const Report &other);
+    };
+
+    // one pass over a closed session log, false if it cannot be read or is still being written
+    static bool analyzeLog(const std::string &path, Charge &charge);
+    // 0 threads for one per core
+    static Report run(const std::vector<Input> &inputs, int threads = 0);
+
+    static void writeText(const Report &report, std::ostream &out);
+    static void writeJson(const Report &report, std::ostream &out);
+};
+
+#endif // FLEETANALYSIS_H
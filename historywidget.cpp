@@ -0,0 +1,158 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QCursor>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTime>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include "acquisitionworker.h"
+#include "chargeprofiles.h"
+#include "historywidget.h"
+
+// rows shown for a query without a limit of its own
+static const int DEFAULT_LIMIT = 1000;
+// charges laid over the charts at most, the first ones listed
+static const int MAX_OVERLAY = 50;
+
+HistoryWidget::HistoryWidget(SessionHistory *history, QWidget *parent) :
+    QWidget(parent),
+    m_history(history)
+{
+    m_query = new QLineEdit(this);
+    m_query->setPlaceholderText("pack=42, type=lihv, min-cell-delta=30, since=2018-06-01, completed, limit=100");
+    QPushButton *btSearch = new QPushButton("Search", this);
+    QPushButton *btImport = new QPushButton("Import logs", this);
+    btImport->setToolTip("Add the session logs that are not in the history yet");
+    connect(m_query, SIGNAL(returnPressed()), this, SLOT(refresh()));
+    connect(btSearch, SIGNAL(clicked()), this, SLOT(refresh()));
+    connect(btImport, SIGNAL(clicked()), this, SLOT(onImportClicked()));
+
+    m_alignment = new QComboBox(this);
+    m_alignment->addItems({ "time", "capacity" });
+    m_alignment->setToolTip("Line the charges up by the time since they started or by the capacity charged");
+    QPushButton *btOverlay = new QPushButton("Overlay", this);
+    btOverlay->setToolTip(QString("Lay the first %1 charges listed over the charts of the selected charger, "
+                                  "e.g. for pack=42, limit=10").arg(MAX_OVERLAY));
+    QPushButton *btClearOverlay = new QPushButton("Clear overlay", this);
+    connect(m_alignment, SIGNAL(currentIndexChanged(int)), this, SIGNAL(alignmentChanged(int)));
+    connect(btOverlay, SIGNAL(clicked()), this, SLOT(onOverlayClicked()));
+    connect(btClearOverlay, SIGNAL(clicked()), this, SLOT(onClearOverlayClicked()));
+
+    m_table = new QTableWidget(0, COLUMN_COUNT, this);
+    m_table->setHorizontalHeaderLabels({ "Started", "Pack", "Type", "Mode", "Cells", "Outcome", "Capacity (mAh)",
+                                         "Duration", "Energy (Wh)", "Max temp (°C)", "IR (mΩ)", "Cell Δ (mV)" });
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setToolTip("Double click a charge to open it");
+    connect(m_table, SIGNAL(cellDoubleClicked(int,int)), this, SLOT(onCellDoubleClicked(int)));
+
+    QHBoxLayout *search = new QHBoxLayout();
+    search->addWidget(new QLabel("Query:", this));
+    search->addWidget(m_query, 1);
+    search->addWidget(btSearch);
+    search->addWidget(btImport);
+    search->addWidget(new QLabel("Align by:", this));
+    search->addWidget(m_alignment);
+    search->addWidget(btOverlay);
+    search->addWidget(btClearOverlay);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(search);
+    layout->addWidget(m_table);
+
+    connect(m_history, SIGNAL(changed()), this, SLOT(refresh()));
+    refresh();
+}
+
+ChargeOverlay::Alignment HistoryWidget::alignment() const {
+    return static_cast<ChargeOverlay::Alignment>(m_alignment->currentIndex());
+}
+
+void HistoryWidget::refresh() {
+    SessionHistory::Query query;
+    if (!SessionHistory::parseQuery(m_query->text(), query)) {
+        QToolTip::showText(m_query->mapToGlobal(QPoint(0, m_query->height())), "Cannot read this query", m_query);
+        return;
+    }
+    if (query.limit == 0) {
+        query.limit = DEFAULT_LIMIT;
+    }
+
+    static const char *outcomes[] = { "completed", "stopped", "failed" };
+    const QVector<ChargeSummary> summaries = m_history->find(query);
+    m_table->setRowCount(summaries.size());
+    for (int row = 0; row < summaries.size(); row++) {
+        const ChargeSummary &summary = summaries[row];
+        const QStringList cells = {
+            QDateTime::fromMSecsSinceEpoch(summary.startedAtMs).toString("yyyy-MM-dd hh:mm"),
+            QString::fromStdString(summary.pack),
+            ChargeProfiles::batteryTypeName(summary.batteryType),
+            ChargeProfiles::modeName(summary.batteryType, summary.mode),
+            QString::number(summary.cellCount),
+            outcomes[summary.outcome],
+            QString::number(summary.capacity),
+            QTime(0, 0, 0).addSecs(summary.durationS).toString("hh:mm:ss"),
+            QString::number(summary.energyWh, 'f', 2),
+            QString::number(summary.maxTemp),
+            summary.resistance > 0.0 ? QString::number(summary.resistance, 'f', 1) : QString(),
+            QString::number(summary.maxCellDelta),
+        };
+        for (int column = 0; column < COLUMN_COUNT; column++) {
+            if (m_table->item(row, column) == nullptr) {
+                m_table->setItem(row, column, new QTableWidgetItem());
+            }
+            m_table->item(row, column)->setText(cells[column]);
+        }
+        m_table->item(row, STARTED)->setData(Qt::UserRole, QString::fromStdString(summary.log));
+    }
+}
+
+void HistoryWidget::onImportClicked() {
+    const int added = m_history->importLogs(AcquisitionWorker::logDirectory());
+    QToolTip::showText(QCursor::pos(), QString("Imported %1 session logs").arg(added), this);
+    refresh();
+}
+
+void HistoryWidget::onCellDoubleClicked(int row) {
+    const QString log = m_table->item(row, STARTED)->data(Qt::UserRole).toString();
+    if (!log.isEmpty()) {
+        emit openRequested(log);
+    }
+}
+
+void HistoryWidget::onOverlayClicked() {
+    QStringList logs;
+    for (int row = 0; row < m_table->rowCount() && logs.size() < MAX_OVERLAY; row++) {
+        const QString log = m_table->item(row, STARTED)->data(Qt::UserRole).toString();
+        if (!log.isEmpty()) {
+            logs << log;
+        }
+    }
+    emit overlayRequested(logs);
+}
+
+void HistoryWidget::onClearOverlayClicked() {
+    emit overlayRequested(QStringList());
+}
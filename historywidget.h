@@ -0,0 +1,68 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HISTORYWIDGET_H
+#define HISTORYWIDGET_H
+
+#include <QComboBox>
+#include <QLineEdit>
+#include <QStringList>
+#include <QTableWidget>
+#include <QWidget>
+#include "chargeoverlay.h"
+#include "sessionhistory.h"
+
+/*
+ * Search of the SessionHistory: a query line in the syntax of
+ * SessionHistory::parseQuery() and a row per charge found. Only the summary
+ * rows are read; opening a charge (double click) asks for its log through
+ * openRequested(). The charges found can also be laid over the charts of the
+ * selected charger, see SessionCharts::setPastCharges().
+ */
+class HistoryWidget : public QWidget {
+    Q_OBJECT
+public:
+    explicit HistoryWidget(SessionHistory *history, QWidget *parent = 0);
+
+    ChargeOverlay::Alignment alignment() const;
+
+signals:
+    void openRequested(QString log);
+    // logs of the charges to lay over the charts, none to take them off
+    void overlayRequested(QStringList logs);
+    void alignmentChanged(int alignment);
+
+public slots:
+    void refresh();
+
+private slots:
+    void onImportClicked();
+    void onCellDoubleClicked(int row);
+    void onOverlayClicked();
+    void onClearOverlayClicked();
+
+private:
+    enum Column { STARTED, PACK, TYPE, MODE, CELLS, OUTCOME, CAPACITY, DURATION, ENERGY, MAX_TEMP, RESISTANCE,
+                  CELL_DELTA, COLUMN_COUNT };
+
+    SessionHistory *m_history;
+    QLineEdit *m_query;
+    QComboBox *m_alignment;
+    QTableWidget *m_table;
+};
+
+#endif // HISTORYWIDGET_H
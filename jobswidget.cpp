@@ -0,0 +1,142 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTime>
+#include <QVBoxLayout>
+#include "jobswidget.h"
+
+// notices kept in the list, the oldest go first
+static const int MAX_NOTICES = 200;
+
+JobsWidget::JobsWidget(ChargeScheduler *scheduler, QWidget *parent) :
+    QWidget(parent),
+    m_scheduler(scheduler)
+{
+    m_steps = new QLineEdit("charge", this);
+    m_steps->setPlaceholderText("charge, rest=30, discharge, storage");
+    m_steps->setToolTip("Steps of the job in order; rest takes minutes.");
+    m_selectedOnly = new QCheckBox("Selected charger only", this);
+    QPushButton *btAdd = new QPushButton("Add job", this);
+    connect(btAdd, SIGNAL(clicked()), this, SLOT(onAddClicked()));
+    connect(m_steps, SIGNAL(returnPressed()), this, SLOT(onAddClicked()));
+
+    m_table = new QTableWidget(0, COLUMN_COUNT, this);
+    m_table->setHorizontalHeaderLabels({ "Job", "Charger", "Steps", "State", "Results" });
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    m_notices = new QListWidget(this);
+    m_notices->setMaximumHeight(80);
+
+    QPushButton *btCancel = new QPushButton("Cancel", this);
+    QPushButton *btClear = new QPushButton("Clear finished", this);
+    connect(btCancel, SIGNAL(clicked()), this, SLOT(onCancelClicked()));
+    connect(btClear, SIGNAL(clicked()), this, SLOT(onClearClicked()));
+
+    QHBoxLayout *add = new QHBoxLayout();
+    add->addWidget(new QLabel("Steps:", this));
+    add->addWidget(m_steps, 1);
+    add->addWidget(m_selectedOnly);
+    add->addWidget(btAdd);
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addStretch();
+    buttons->addWidget(btClear);
+    buttons->addWidget(btCancel);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(add);
+    layout->addWidget(m_table);
+    layout->addLayout(buttons);
+    layout->addWidget(m_notices);
+
+    connect(m_scheduler, SIGNAL(jobChanged(int)), this, SLOT(onJobChanged(int)));
+    m_rebuild();
+}
+
+void JobsWidget::addNotice(const QString &text) {
+    m_notices->addItem(QTime::currentTime().toString("hh:mm:ss") + "  " + text);
+    while (m_notices->count() > MAX_NOTICES) {
+        delete m_notices->takeItem(0);
+    }
+    m_notices->scrollToBottom();
+}
+
+void JobsWidget::onJobChanged(int id) {
+    const ChargeScheduler::Job *job = m_scheduler->job(id);
+    for (int row = 0; row < m_table->rowCount(); row++) {
+        if (m_table->item(row, ID)->data(Qt::UserRole).toInt() == id) {
+            if (job != nullptr) {
+                m_updateRow(row, *job);
+            }
+            return;
+        }
+    }
+    m_rebuild();
+}
+
+void JobsWidget::onAddClicked() {
+    emit addRequested(m_steps->text(), m_selectedOnly->isChecked());
+}
+
+void JobsWidget::onCancelClicked() {
+    const int row = m_table->currentRow();
+    if (row >= 0) {
+        m_scheduler->cancelJob(m_table->item(row, ID)->data(Qt::UserRole).toInt());
+    }
+}
+
+void JobsWidget::onClearClicked() {
+    m_scheduler->removeFinished();
+    m_rebuild();
+}
+
+void JobsWidget::m_rebuild() {
+    const QList<ChargeScheduler::Job> &jobs = m_scheduler->jobs();
+    m_table->setRowCount(jobs.size());
+    for (int row = 0; row < jobs.size(); row++) {
+        for (int column = 0; column < COLUMN_COUNT; column++) {
+            if (m_table->item(row, column) == nullptr) {
+                m_table->setItem(row, column, new QTableWidgetItem());
+            }
+        }
+        m_updateRow(row, jobs[row]);
+    }
+}
+
+void JobsWidget::m_updateRow(int row, const ChargeScheduler::Job &job) {
+    QString state = ChargeScheduler::stateName(job.state);
+    if (job.state == ChargeScheduler::RUNNING) {
+        state += QString(" (step %1 of %2)").arg(job.step + 1).arg(job.steps.size());
+    } else if (!job.message.isEmpty()) {
+        state += ": " + job.message;
+    }
+
+    m_table->item(row, ID)->setText(job.name);
+    m_table->item(row, ID)->setData(Qt::UserRole, job.id);
+    m_table->item(row, CHARGER)->setText(!job.charger.isEmpty() ? job.charger : !job.location.isEmpty() ? job.location : "any");
+    m_table->item(row, STEPS)->setText(ChargeScheduler::describeSteps(job.steps));
+    m_table->item(row, STATE)->setText(state);
+    m_table->item(row, RESULTS)->setText(ChargeScheduler::describeResults(job));
+}
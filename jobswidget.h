@@ -0,0 +1,64 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef JOBSWIDGET_H
+#define JOBSWIDGET_H
+
+#include <QCheckBox>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QTableWidget>
+#include <QWidget>
+#include "chargescheduler.h"
+
+/*
+ * The ChargeScheduler's queue: a row per job with its charger, steps and
+ * results, a line to queue more and a list of notices. New jobs take their
+ * battery and profile from the main window, which is asked for them through
+ * addRequested().
+ */
+class JobsWidget : public QWidget {
+    Q_OBJECT
+public:
+    explicit JobsWidget(ChargeScheduler *scheduler, QWidget *parent = 0);
+
+    void addNotice(const QString &text);
+
+signals:
+    // steps as typed, selectedOnly to pin the job to the charger shown
+    void addRequested(QString steps, bool selectedOnly);
+
+private slots:
+    void onJobChanged(int id);
+    void onAddClicked();
+    void onCancelClicked();
+    void onClearClicked();
+
+private:
+    enum Column { ID, CHARGER, STEPS, STATE, RESULTS, COLUMN_COUNT };
+
+    ChargeScheduler *m_scheduler;
+    QLineEdit *m_steps;
+    QCheckBox *m_selectedOnly;
+    QTableWidget *m_table;
+    QListWidget *m_notices;
+
+    void m_rebuild();
+    void m_updateRow(int row, const ChargeScheduler::Job &job);
+};
+
+#endif // JOBSWIDGET_H
@@ -0,0 +1,93 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "latencyhistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+    for (std::atomic<uint64_t> &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    m_buckets[m_index(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<uint64_t> &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return n == 0 ? 0.0 : (double)(m_sum.load(std::memory_order_relaxed)) / n;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    const uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * n + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return i == BUCKETS - 1 ? max() : std::min(m_value(i), max());
+        }
+    }
+    return max();
+}
+
+int LatencyHistogram::m_index(uint64_t value) {
+    if (value < (1u << LINEAR_BITS)) {
+        return static_cast<int>(value);
+    }
+
+    // the top LINEAR_BITS - 1 bits below the most significant one pick the sub-bucket
+    const int msb = 63 - __builtin_clzll(value);
+    const int octave = msb - LINEAR_BITS + 1;
+    if (octave > OCTAVES) {
+        return BUCKETS - 1;
+    }
+    const int sub = static_cast<int>(value >> octave) - SUB_BUCKETS;
+    return (1 << LINEAR_BITS) + (octave - 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::m_value(int index) {
+    if (index < (1 << LINEAR_BITS)) {
+        return static_cast<uint64_t>(index);
+    }
+
+    // upper edge of the bucket, so percentiles never understate
+    const int octave = (index - (1 << LINEAR_BITS)) / SUB_BUCKETS + 1;
+    const int sub = (index - (1 << LINEAR_BITS)) % SUB_BUCKETS;
+    return ((static_cast<uint64_t>(SUB_BUCKETS + sub + 1)) << octave) - 1;
+}
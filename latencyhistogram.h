@@ -0,0 +1,79 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Histogram of durations in nanoseconds with log-linear buckets, like an HDR
+ * histogram: values below 32 ns are exact, above that every power of two is
+ * split into 16 buckets, so any value is known within about 6%. Recording is
+ * a handful of relaxed atomic operations and safe from any thread; readers
+ * see a slightly racy but never torn view.
+ */
+class LatencyHistogram {
+public:
+    // times the enclosing scope
+    class Scope {
+    public:
+        explicit Scope(LatencyHistogram &histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            m_histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - m_start).count()));
+        }
+
+        Scope(const Scope&) = delete;
+        Scope &operator=(const Scope&) = delete;
+
+    private:
+        LatencyHistogram &m_histogram;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+    double mean() const;
+    // smallest value that p (0..1) of the recorded values do not exceed, 0 if empty
+    uint64_t percentile(double p) const;
+
+private:
+    static const int LINEAR_BITS = 5;
+    static const int SUB_BUCKETS = 1 << (LINEAR_BITS - 1);
+    static const int OCTAVES = 40 - LINEAR_BITS;     // up to 2^40 ns, about 18 minutes
+    static const int BUCKETS = (1 << LINEAR_BITS) + OCTAVES * SUB_BUCKETS;
+
+    std::atomic<uint64_t> m_buckets[BUCKETS];
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+
+    static int m_index(uint64_t value);
+    static uint64_t m_value(int index);
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,206 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "lodseries.h"
+
+void LodSeries::update() {
+    if (m_source == nullptr) {
+        return;
+    }
+    const std::size_t size = m_source->size();
+    if (size < m_size) {
+        // the source was cleared under us, start over
+        clear();
+    }
+    while (m_size < size) {
+        m_append(m_size);
+    }
+    m_trim();
+}
+
+void LodSeries::clear() {
+    m_size = 0;
+    while (!m_levels.empty()) {
+        m_levels.back().buckets.clear();
+        m_spareLevels.push_back(std::move(m_levels.back().buckets));
+        m_levels.pop_back();
+    }
+}
+
+void LodSeries::m_append(std::size_t point) {
+    m_size++;
+
+    std::size_t index = point;
+    for (Level &level : m_levels) {
+        index /= FANOUT;
+        if (index == level.end()) {
+            Bucket bucket = { static_cast<uint32_t>(point), static_cast<uint32_t>(point) };
+            level.buckets.push_back(bucket);
+        } else {
+            m_merge(level.buckets.back(), static_cast<uint32_t>(point));
+        }
+    }
+
+    if (m_levels.empty() ? m_size > FANOUT : m_levels.back().buckets.size() > FANOUT) {
+        m_addLevel();
+    }
+}
+
+void LodSeries::query(double xMin, double xMax, std::size_t buckets, std::vector<Point> &out) const {
+    out.clear();
+    if (m_size == 0) {
+        return;
+    }
+
+    std::size_t first = m_lowerBound(xMin);
+    std::size_t last = m_lowerBound(xMax);
+    // one point past each edge keeps the line running to the border of the plot
+    if (first > 0) {
+        first--;
+    }
+    if (last >= m_size) {
+        last = m_size - 1;
+    }
+    if (last < first) {
+        return;
+    }
+
+    const std::size_t count = last - first + 1;
+    buckets = std::max<std::size_t>(buckets, 1);
+    // points of a coarsened part of the source are not worth more than their buckets
+    if (m_levels.empty() || (count <= 2 * buckets && m_source->resolution(first) == 1)) {
+        out.reserve(count);
+        for (std::size_t i = first; i <= last; i++) {
+            out.push_back(m_source->at(i));
+        }
+        return;
+    }
+
+    std::size_t level = 0;
+    std::size_t span = FANOUT;
+    while (level + 1 < m_levels.size() && count / span > buckets) {
+        level++;
+        span *= FANOUT;
+    }
+
+    out.reserve(2 * (last / span + 1 - first / span));
+    std::size_t point = first;
+    while (point <= last) {
+        // up to where the chosen level was dropped, the first coarser one left stands in
+        std::size_t used = level, usedSpan = span;
+        while (used + 1 < m_levels.size() && point / usedSpan < m_levels[used].first) {
+            used++;
+            usedSpan *= FANOUT;
+        }
+        const std::size_t stop = used == level ? last + 1 : std::min(last + 1, m_levels[level].first * span);
+        const Level &data = m_levels[used];
+        std::size_t i = point / usedSpan;
+        const std::size_t end = std::min((stop + usedSpan - 1) / usedSpan, data.end());
+        if (i >= end) {
+            break;
+        }
+        for (; i < end; i++) {
+            const Bucket &bucket = data.buckets[i - data.first];
+            if (bucket.min == bucket.max) {
+                out.push_back(m_source->at(bucket.min));
+            } else {
+                out.push_back(m_source->at(std::min(bucket.min, bucket.max)));
+                out.push_back(m_source->at(std::max(bucket.min, bucket.max)));
+            }
+        }
+        point = i * usedSpan;
+    }
+}
+
+void LodSeries::m_merge(Bucket &bucket, uint32_t index) const {
+    const double y = m_source->at(index).y;
+    if (y < m_source->at(bucket.min).y) {
+        bucket.min = index;
+    }
+    if (y > m_source->at(bucket.max).y) {
+        bucket.max = index;
+    }
+}
+
+void LodSeries::m_merge(Bucket &bucket, const Bucket &other) const {
+    if (m_source->at(other.min).y < m_source->at(bucket.min).y) {
+        bucket.min = other.min;
+    }
+    if (m_source->at(other.max).y > m_source->at(bucket.max).y) {
+        bucket.max = other.max;
+    }
+}
+
+std::size_t LodSeries::m_lowerBound(double x) const {
+    std::size_t first = 0, count = m_size;
+    while (count > 0) {
+        const std::size_t step = count / 2;
+        if (m_source->at(first + step).x < x) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+void LodSeries::m_trim() {
+    // the top level stays whole, it is what the new levels are built from
+    std::size_t span = FANOUT;
+    for (std::size_t i = 0; i + 1 < m_levels.size(); i++, span *= FANOUT) {
+        Level &level = m_levels[i];
+        std::size_t drop = 0;
+        while (drop < level.buckets.size() && m_source->resolution((level.first + drop) * span) > span) {
+            drop++;
+        }
+        if (drop > 0) {
+            level.buckets.erase(level.buckets.begin(), level.buckets.begin() + drop);
+            level.first += drop;
+        }
+    }
+}
+
+void LodSeries::m_addLevel() {
+    Level level;
+    if (!m_spareLevels.empty()) {
+        level.buckets.swap(m_spareLevels.back());
+        m_spareLevels.pop_back();
+    }
+    if (m_levels.empty()) {
+        for (std::size_t i = 0; i < m_size; i++) {
+            if (i % FANOUT == 0) {
+                Bucket bucket = { static_cast<uint32_t>(i), static_cast<uint32_t>(i) };
+                level.buckets.push_back(bucket);
+            } else {
+                m_merge(level.buckets.back(), static_cast<uint32_t>(i));
+            }
+        }
+    } else {
+        const std::vector<Bucket> &below = m_levels.back().buckets;
+        for (std::size_t i = 0; i < below.size(); i++) {
+            if (i % FANOUT == 0) {
+                level.buckets.push_back(below[i]);
+            } else {
+                m_merge(level.buckets.back(), below[i]);
+            }
+        }
+    }
+    m_levels.push_back(std::move(level));
+}
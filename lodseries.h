@@ -0,0 +1,92 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LODSERIES_H
+#define LODSERIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Level-of-detail pyramid over a series with ascending x. Level n groups
+ * FANOUT^(n+1) consecutive points and remembers the lowest and the highest
+ * one, so a query can hand a chart about two points per horizontal pixel
+ * without losing peaks such as the -dV knee of a NiMH charge.
+ *
+ * The points themselves live in a Source (normally a TelemetryStore column);
+ * the pyramid only keeps their indices. Where the source keeps several points
+ * per stored value (see TelemetryStore's budget), the levels finer than that
+ * are dropped and queries there use the first level that is left. clear()
+ * keeps the level buffers for the next series rather than freeing them.
+ */
+class LodSeries {
+public:
+    struct Point {
+        double x, y;
+    };
+
+    class Source {
+    public:
+        virtual ~Source() {}
+        virtual std::size_t size() const = 0;
+        virtual Point at(std::size_t index) const = 0;
+        // points that share one stored value at index, 1 at full resolution
+        virtual std::size_t resolution(std::size_t) const { return 1; }
+    };
+
+    static const std::size_t FANOUT = 4;
+
+    explicit LodSeries(const Source *source = nullptr) : m_source(source) {}
+
+    // picks up points added to the source since the last call
+    void update();
+    void clear();
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    Point front() const { return m_source->at(0); }
+    Point back() const { return m_source->at(m_size - 1); }
+
+    // points covering [xMin, xMax], at most about 2 * buckets of them
+    void query(double xMin, double xMax, std::size_t buckets, std::vector<Point> &out) const;
+
+private:
+    struct Bucket {
+        uint32_t min, max;
+    };
+    struct Level {
+        std::size_t first = 0;          // index of buckets[0], the ones before were dropped
+        std::vector<Bucket> buckets;
+        std::size_t end() const { return first + buckets.size(); }
+    };
+
+    const Source *m_source;
+    std::size_t m_size = 0;
+    std::vector<Level> m_levels;
+    std::vector<std::vector<Bucket>> m_spareLevels;
+
+    void m_append(std::size_t index);
+    void m_trim();
+    void m_merge(Bucket &bucket, uint32_t index) const;
+    void m_merge(Bucket &bucket, const Bucket &other) const;
+    std::size_t m_lowerBound(double x) const;
+    void m_addLevel();
+};
+
+#endif // LODSERIES_H
@@ -16,14 +16,63 @@
  *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "diagnostics.h"
 #include "mainwindow.h"
+#include "renderscheduler.h"
+#include "samplingpolicy.h"
+#include "telemetrystore.h"
 #include <QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    QApplication::setApplicationName("ChargeGuru");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption fpsOption("fps", "Maximum chart refresh rate.", "fps", "20");
+    parser.addOption(fpsOption);
+    QCommandLineOption listenOption("listen", "Serve telemetry and accept commands on this local socket.", "name");
+    parser.addOption(listenOption);
+    QCommandLineOption simulateOption("simulate", "Add a simulated charger, e.g. sim,cells=3,speed=100.", "spec");
+    parser.addOption(simulateOption);
+    QCommandLineOption replayOption("replay", "Add a charger replaying a session log, e.g. charge.cglog,speed=100.", "log");
+    parser.addOption(replayOption);
+    QCommandLineOption diagnosticsOption("diagnostics", "Write timings and sample counters to this file on exit.", "file");
+    parser.addOption(diagnosticsOption);
+    QCommandLineOption budgetOption("memory-budget", "Samples kept in memory per charger, MiB; older ones are thinned out "
+                                    "beyond it. 0 for no limit.", "MiB", "0");
+    parser.addOption(budgetOption);
+    QCommandLineOption samplingOption("sampling", "How often chargers are polled: fixed (1 s), fast (as fast as they "
+                                      "answer) or adaptive (fast only around CV transitions and the end of a charge).",
+                                      "mode", "adaptive");
+    parser.addOption(samplingOption);
+    parser.process(a);
+    RenderScheduler::setDefaultFps(parser.value(fpsOption).toInt());
+    TelemetryStore::setDefaultBudget(parser.value(budgetOption).toULongLong() * 1024 * 1024);
+    SamplingPolicy::Mode sampling;
+    if (SamplingPolicy::parseMode(parser.value(samplingOption).toStdString(), sampling)) {
+        SamplingPolicy::setDefaultMode(sampling);
+    } else {
+        qWarning("unknown sampling mode %s", qPrintable(parser.value(samplingOption)));
+    }
+
     MainWindow w;
+    if (parser.isSet(listenOption) && !w.serveTelemetry(parser.value(listenOption))) {
+        qWarning("cannot listen on %s", qPrintable(parser.value(listenOption)));
+    }
+    for (const QString &spec : parser.values(simulateOption)) {
+        w.addVirtualDevice(spec);
+    }
+    for (const QString &log : parser.values(replayOption)) {
+        w.addVirtualDevice("replay=" + log);
+    }
     w.show();
 
-    return a.exec();
+    const int status = a.exec();
+    if (parser.isSet(diagnosticsOption) && !Diagnostics::dump(parser.value(diagnosticsOption).toStdString())) {
+        qWarning("cannot write %s", qPrintable(parser.value(diagnosticsOption)));
+    }
+    return status;
 }
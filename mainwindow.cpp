@@ -16,46 +16,23 @@
  *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fstream>
 #include <iostream>
+#include <QApplication>
+#include <QDockWidget>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
 #include <QMessageBox>
+#include "chargeprofiles.h"
+#include "diagnostics.h"
 #include "mainwindow.h"
+#include "sessionlog.h"
 #include "ui_mainwindow.h"
 
-std::vector<std::pair<QString, b6::BATTERY_TYPE>> MainWindow::m_batteryTypes = {
-    { "Li-Po", b6::BATTERY_TYPE::LIPO },
-    { "Li-Ion", b6::BATTERY_TYPE::LIIO },
-    { "Li-Fe", b6::BATTERY_TYPE::LIFE },
-    { "Li-Hv", b6::BATTERY_TYPE::LIHV },
-    { "Ni-Mh", b6::BATTERY_TYPE::NIMH },
-    { "Ni-Cd", b6::BATTERY_TYPE::NICD },
-    { "Pb", b6::BATTERY_TYPE::PB },
-};
-std::vector<std::pair<QString, b6::CHARGING_MODE_LI>> MainWindow::m_chargingModesLi = {
-    { "Standard", b6::CHARGING_MODE_LI::STANDARD },
-    { "Discharge", b6::CHARGING_MODE_LI::DISCHARGE },
-    { "Storage", b6::CHARGING_MODE_LI::STORAGE },
-    { "Fast", b6::CHARGING_MODE_LI::FAST },
-    { "Balance", b6::CHARGING_MODE_LI::BALANCE },
-};
-std::vector<std::pair<QString, b6::CHARGING_MODE_NI>> MainWindow::m_chargingModesNi = {
-    { "Standard", b6::CHARGING_MODE_NI::STANDARD },
-    { "Auto", b6::CHARGING_MODE_NI::AUTO },
-    { "Discharge", b6::CHARGING_MODE_NI::DISCHARGE },
-    { "Re-peak", b6::CHARGING_MODE_NI::REPEAK },
-    { "Cycle", b6::CHARGING_MODE_NI::CYCLE },
-};
-std::vector<std::pair<QString, b6::CHARGING_MODE_PB>> MainWindow::m_chargingModesPb = {
-    { "Charge", b6::CHARGING_MODE_PB::CHARGE },
-    { "Discharge", b6::CHARGING_MODE_PB::DISCHARGE },
-};
-
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow) {
     ui->setupUi(this);
 
-    timer = new QTimer(this);
-    connect(timer, SIGNAL(timeout()), this, SLOT(onTimer()));
-    timer->start(std::chrono::milliseconds(1000));
-
     lblCore = new QLabel(this);
     lblCore->setText("NOT CONNECTED!");
 
@@ -68,119 +45,151 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     lblCells = new QLabel(this);
     lblCells->setText("");
 
+    lblSampling = new QLabel(this);
+    lblSampling->setText("");
+
     lblStatus = new QLabel(this);
     lblStatus->setText("STATUS: IDLE");
 
+    lblDiagnostics = new QLabel(this);
+    lblDiagnostics->setText("");
+
     ui->statusBar->addWidget(lblCore);
     ui->statusBar->addWidget(lblHW);
     ui->statusBar->addWidget(lblSW);
     ui->statusBar->addWidget(lblCells);
+    ui->statusBar->addWidget(lblSampling);
+    ui->statusBar->addPermanentWidget(lblDiagnostics);
     ui->statusBar->addPermanentWidget(lblStatus);
 
     ui->cbBatteryType->clear();
-    for (const auto &it : m_batteryTypes) {
+    for (const auto &it : ChargeProfiles::batteryTypes()) {
         ui->cbBatteryType->addItem(QString(it.first), QVariant::fromValue(it.second));
     }
 
     ui->tbCells->setFocusPolicy(Qt::NoFocus);
 
-    m_seriesCurrent = new QLineSeries();
-    m_seriesCurrent->setName("Current (mA)");
-    m_seriesCurrent->setColor(QColor(0xff, 0x00, 0x00));
-
-    m_seriesVoltage = new QLineSeries();
-    m_seriesVoltage->setName("Voltage (mV)");
-    m_seriesVoltage->setColor(QColor(0x00, 0x00, 0xff));
-
-    m_seriesCapacity = new QLineSeries();
-    m_seriesCapacity->setName("Capacity (mAh)");
-    m_seriesCapacity->setColor(QColor(0x00, 0xff, 0x00));
-
-    m_seriesTempExt = new QLineSeries();
-    m_seriesTempExt->setName("Temperature External");
-
-    m_seriesTempInt = new QLineSeries();
-    m_seriesTempInt->setName("Temperature Internal");
-
-    m_chartCurrent = new QChart();
-    m_chartCurrent->addSeries(m_seriesCurrent);
-
-    m_chartVoltage = new QChart();
-    m_chartVoltage->addSeries(m_seriesVoltage);
-
-    m_chartCapacity = new QChart();
-    m_chartCapacity->addSeries(m_seriesCapacity);
-
-    m_chartTemp = new QChart();
-    m_chartTemp->addSeries(m_seriesTempInt);
-    //m_chartTemp->addSeries(m_seriesTempExt);
-
-    m_chartCellsVoltage = new QChart();
-
-    m_chartCurrent->createDefaultAxes();
-    m_chartCurrent->axes(Qt::Vertical).at(0)->setRange(0.0, 6.0);
-    m_chartCurrent->setTitle("Current (A)");
-    m_chartCurrent->legend()->hide();
-
-    m_chartVoltage->createDefaultAxes();
-    m_chartVoltage->axes(Qt::Vertical).at(0)->setRange(0.0, 4.5);
-    m_chartVoltage->setTitle("Voltage (V)");
-    m_chartVoltage->legend()->hide();
-
-    m_chartCapacity->createDefaultAxes();
-    m_chartCapacity->axes(Qt::Vertical).at(0)->setRange(0, 6000);
-    m_chartCapacity->setTitle("Capacity (mAh)");
-    m_chartCapacity->legend()->hide();
-
-    m_chartTemp->createDefaultAxes();
-    m_chartTemp->axes(Qt::Vertical).at(0)->setRange(20, 80);
-
-    ui->ctCurrent->setChart(m_chartCurrent);
     ui->ctCurrent->setRenderHint(QPainter::Antialiasing);
-
-    ui->ctVoltage->setChart(m_chartVoltage);
     ui->ctVoltage->setRenderHint(QPainter::Antialiasing);
-
-    ui->ctCapacity->setChart(m_chartCapacity);
     ui->ctCapacity->setRenderHint(QPainter::Antialiasing);
-
-    ui->ctTemp->setChart(m_chartTemp);
     ui->ctTemp->setRenderHint(QPainter::Antialiasing);
-
-    ui->ctCellsVoltage->setChart(m_chartCellsVoltage);
     ui->ctCellsVoltage->setRenderHint(QPainter::Antialiasing);
 
+    DiagnosticsWidget::timePaints(ui->ctCurrent->viewport(), "paint.charts");
+    DiagnosticsWidget::timePaints(ui->ctVoltage->viewport(), "paint.charts");
+    DiagnosticsWidget::timePaints(ui->ctCapacity->viewport(), "paint.charts");
+    DiagnosticsWidget::timePaints(ui->ctTemp->viewport(), "paint.charts");
+    DiagnosticsWidget::timePaints(ui->ctCellsVoltage->viewport(), "paint.charts");
+    DiagnosticsWidget::timePaints(ui->tbCells->viewport(), "paint.cells");
+    StripChart *strips[] = { ui->scCurrent, ui->scVoltage, ui->scCapacity, ui->scTemp, ui->scCellsVoltage };
+    for (StripChart *strip : strips) {
+        strip->setToolTip("Wheel to change how far back the chart goes");
+        DiagnosticsWidget::timePaints(strip, "paint.strips");
+    }
+
     connect(ui->ckChartCurrent, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
     connect(ui->ckChartVoltage, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
     connect(ui->ckChartCapacity, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
     connect(ui->ckChartCellsVoltage, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
     connect(ui->ckChartTemp, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
+    connect(ui->ckChartAnalytics, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
+    connect(ui->ckStripCharts, SIGNAL(toggled(bool)), this, SLOT(onCkChartToggled(bool)));
 
+    ui->tbCells->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     for (int i = 0; i < 8; i++) {
         m_cells[i] = ui->tbCells->item(0, i);
-        m_seriesCellsVoltage[i] = new QLineSeries();
-        m_seriesCellsVoltage[i]->setName(QString("Cell %1 (V)").arg(i+1));
+        m_cellMv[i] = -1;
+        m_cellResistance[i] = -1.0f;
     }
+
+    m_dashboard = new DashboardWidget(this);
+    QDockWidget *dashboardDock = new QDockWidget("Chargers", this);
+    dashboardDock->setObjectName("dockChargers");
+    dashboardDock->setWidget(m_dashboard);
+    addDockWidget(Qt::BottomDockWidgetArea, dashboardDock);
+    connect(m_dashboard, SIGNAL(sessionSelected(ChargerSession*)), this, SLOT(onSessionSelected(ChargerSession*)));
+
+    m_diagnostics = new DiagnosticsWidget(this);
+    QDockWidget *diagnosticsDock = new QDockWidget("Diagnostics", this);
+    diagnosticsDock->setObjectName("dockDiagnostics");
+    diagnosticsDock->setWidget(m_diagnostics);
+    addDockWidget(Qt::BottomDockWidgetArea, diagnosticsDock);
+    tabifyDockWidget(dashboardDock, diagnosticsDock);
+    dashboardDock->raise();
+    connect(m_diagnostics, SIGNAL(summaryChanged(QString)), lblDiagnostics, SLOT(setText(QString)));
+
+    m_devices = new DeviceManager(this);
+    connect(m_devices, SIGNAL(sessionAdded(ChargerSession*)), this, SLOT(onSessionAdded(ChargerSession*)));
+    m_scheduler = new ChargeScheduler(m_devices, this);
+    connect(m_scheduler, SIGNAL(jobFinished(int)), this, SLOT(onJobFinished(int)));
+    connect(m_scheduler, SIGNAL(chargeCompleted(ChargerSession*,b6::ChargeInfo)),
+            this, SLOT(onChargeCompleted(ChargerSession*,b6::ChargeInfo)));
+    connect(m_scheduler, SIGNAL(chargeFailed(ChargerSession*,QString)), this, SLOT(onChargeFailed(ChargerSession*,QString)));
+
+    m_jobs = new JobsWidget(m_scheduler, this);
+    QDockWidget *jobsDock = new QDockWidget("Jobs", this);
+    jobsDock->setObjectName("dockJobs");
+    jobsDock->setWidget(m_jobs);
+    addDockWidget(Qt::BottomDockWidgetArea, jobsDock);
+    tabifyDockWidget(dashboardDock, jobsDock);
+    dashboardDock->raise();
+    connect(m_jobs, SIGNAL(addRequested(QString,bool)), this, SLOT(onJobAddRequested(QString,bool)));
+
+    m_history = new SessionHistory(this);
+    if (!m_history->open(SessionHistory::defaultPath())) {
+        m_notify("Cannot open the session history: " + m_history->errorString());
+    }
+    m_history->watch(m_devices);
+    m_historyView = new HistoryWidget(m_history, this);
+    QDockWidget *historyDock = new QDockWidget("History", this);
+    historyDock->setObjectName("dockHistory");
+    historyDock->setWidget(m_historyView);
+    addDockWidget(Qt::BottomDockWidgetArea, historyDock);
+    tabifyDockWidget(dashboardDock, historyDock);
+    dashboardDock->raise();
+    connect(m_historyView, SIGNAL(openRequested(QString)), this, SLOT(onHistoryOpenRequested(QString)));
+    connect(m_historyView, SIGNAL(overlayRequested(QStringList)), this, SLOT(onHistoryOverlayRequested(QStringList)));
+    connect(m_historyView, SIGNAL(alignmentChanged(int)), this, SLOT(onHistoryAlignmentChanged(int)));
+
+    m_replay = new ReplayWidget(this);
+    m_replayDock = new QDockWidget("Replay", this);
+    m_replayDock->setObjectName("dockReplay");
+    m_replayDock->setWidget(m_replay);
+    addDockWidget(Qt::BottomDockWidgetArea, m_replayDock);
+    tabifyDockWidget(dashboardDock, m_replayDock);
+    dashboardDock->raise();
+    connect(m_replay, SIGNAL(positionChanged()), this, SLOT(onReplayPositionChanged()));
+    connect(m_replay, SIGNAL(activeChanged(bool)), this, SLOT(onReplayActiveChanged(bool)));
+
+    ChartView *views[] = { ui->ctCurrent, ui->ctVoltage, ui->ctCapacity, ui->ctTemp, ui->ctCellsVoltage };
+    for (ChartView *view : views) {
+        view->setToolTip("Wheel to zoom, drag to pan, double click to follow the charge again");
+        connect(view, SIGNAL(rangeRequested(qreal,qreal)), this, SLOT(onChartRangeRequested(qreal,qreal)));
+        connect(view, SIGNAL(followRequested()), this, SLOT(onChartFollowRequested()));
+    }
+    m_updateChartVisibility();
+
+    m_devices->start();
 }
 
 MainWindow::~MainWindow() {
+    // the views own whatever chart they show, hand the sessions' charts back first
+    m_showCharts(nullptr);
+    delete m_server;
+    delete m_scheduler;
+    delete m_devices;
     delete ui;
 }
 
-void MainWindow::onTimer() {
-    if (m_dev == nullptr) {
-        m_createDevice();
-    } else if (m_charging) {
-        m_loadChargeInfo();
-    } else {
-        try {
-            b6::ChargeInfo info = m_dev->getChargeInfo();
-            if (info.state == static_cast<uint8_t>(b6::STATE::CHARGING)) {
-                m_loadChargeInfo();
-            }
-        } catch (...) {
-        }
+bool MainWindow::serveTelemetry(const QString &name) {
+    if (m_server == nullptr) {
+        m_server = new TelemetryServer(m_devices, this);
     }
+    return m_server->listen(name);
+}
+
+void MainWindow::addVirtualDevice(const QString &spec) {
+    m_devices->addVirtualDevice(spec);
 }
 
 void MainWindow::on_btLoad_clicked() {
@@ -199,20 +208,45 @@ void MainWindow::on_btStopCharging_clicked() {
     m_stopCharging();
 }
 
+void MainWindow::on_btExportCsv_clicked() {
+    QString start = m_session != nullptr ? AcquisitionWorker::lastLog(m_session->location()) : QString();
+    QString logPath = QFileDialog::getOpenFileName(this, "Export charge", start.isEmpty() ? AcquisitionWorker::logDirectory() : start,
+                                                   "Charge logs (*.cglog)");
+    if (logPath.isEmpty()) {
+        return;
+    }
+    QString csvPath = QFileDialog::getSaveFileName(this, "Export charge", QFileInfo(logPath).completeBaseName() + ".csv",
+                                                   "CSV files (*.csv)");
+    if (csvPath.isEmpty()) {
+        return;
+    }
+
+    SessionLogReader log;
+    std::ofstream out(csvPath.toStdString());
+    if (!log.open(logPath.toStdString()) || !out) {
+        QMessageBox::critical(this, "Export charge", "Could not open " + (log.isOpen() ? csvPath : logPath));
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    log.exportCsv(out);
+    QApplication::restoreOverrideCursor();
+}
+
 void MainWindow::on_cbBatteryType_currentIndexChanged(int index) {
     b6::BATTERY_TYPE battType = ui->cbBatteryType->itemData(index).value<b6::BATTERY_TYPE>();
     ui->cbChargingMode->clear();
 
     if (b6::Device::isBatteryLi(battType)) {
-        for (const auto &it : m_chargingModesLi) {
+        for (const auto &it : ChargeProfiles::modesLi()) {
             ui->cbChargingMode->addItem(QString(it.first), QVariant::fromValue(it.second));
         }
     } else if (b6::Device::isBatteryNi(battType)) {
-        for (const auto &it : m_chargingModesNi) {
+        for (const auto &it : ChargeProfiles::modesNi()) {
             ui->cbChargingMode->addItem(QString(it.first), QVariant::fromValue(it.second));
         }
     } else {
-        for (const auto &it : m_chargingModesPb) {
+        for (const auto &it : ChargeProfiles::modesPb()) {
             ui->cbChargingMode->addItem(QString(it.first), QVariant::fromValue(it.second));
         }
     }
@@ -228,182 +262,446 @@ void MainWindow::on_sbCellCount_valueChanged(int value) {
     ui->lbCellCount->setText(QString("%1").arg(value));
 }
 
-void MainWindow::onCkChartToggled(bool value) {
-    QString oName = ((QCheckBox *) sender())->objectName();
-    if (oName == "ckChartCurrent") {
-        ui->ctCurrent->setVisible(value);
-    } else if (oName == "ckChartVoltage") {
-        ui->ctVoltage->setVisible(value);
-    } else if (oName == "ckChartCapacity") {
-        ui->ctCapacity->setVisible(value);
-    } else if (oName == "ckChartTemp") {
-        ui->ctTemp->setVisible(value);
-    } else if (oName == "ckChartCellsVoltage") {
-        ui->ctCellsVoltage->setVisible(value);
+void MainWindow::onCkChartToggled(bool) {
+    m_updateChartVisibility();
+}
+
+void MainWindow::onSessionAdded(ChargerSession *session) {
+    m_charts.insert(session, new SessionCharts(session));
+    m_charts.value(session)->setAlignment(m_historyView->alignment());
+    m_dashboard->addSession(session);
+
+    connect(session, SIGNAL(connected()), this, SLOT(onSessionConnected()));
+    connect(session, SIGNAL(disconnected()), this, SLOT(onSessionDisconnected()));
+    connect(session, SIGNAL(sysInfoLoaded(b6::SysInfo)), this, SLOT(onSysInfoLoaded(b6::SysInfo)));
+    connect(session, SIGNAL(chargingChanged(bool)), this, SLOT(onChargingChanged(bool)));
+    connect(session, SIGNAL(chargeInfoUpdated()), this, SLOT(onChargeInfoUpdated()));
+    connect(session, SIGNAL(samplingChanged()), this, SLOT(onSessionSamplingChanged()));
+
+    if (m_session == nullptr) {
+        m_dashboard->selectSession(session);
     }
 }
 
+void MainWindow::onSessionSelected(ChargerSession *session) {
+    if (session == m_session) {
+        return;
+    }
 
-void MainWindow::m_createDevice() {
-    try {
-        m_dev = new b6::Device();
-        lblCore->setText(QString("Core: %1").arg(QString::fromStdString(m_dev->getCoreType())));
-        lblHW->setText(QString("HW: %1").arg(m_dev->getHWVersion(), 0, 'f', 2));
-        lblSW->setText(QString("SW: %1").arg(m_dev->getSWVersion(), 0, 'f', 2));
-        lblCells->setText(QString("Cells: %1").arg(m_dev->getCellCount()));
+    if (m_session != nullptr) {
+        SessionCharts *charts = m_charts.value(m_session);
+        charts->renderScheduler()->setChartVisible(charts->chartCurrent(), false);
+        charts->renderScheduler()->setChartVisible(charts->chartVoltage(), false);
+        charts->renderScheduler()->setChartVisible(charts->chartCapacity(), false);
+        charts->renderScheduler()->setChartVisible(charts->chartTemp(), false);
+        charts->renderScheduler()->setChartVisible(charts->chartCellsVoltage(), false);
+    }
+    // hands the charts of the session left back to it
+    m_replay->setSession(session);
+    m_showCharts(session);
+    m_session = session;
+    m_updateChartVisibility();
+
+    m_showDeviceInfo();
+    m_showChargeInfo();
+    m_updateUI();
+    if (m_session->isConnected()) {
+        m_loadSysInfo();
+    }
+}
 
-        ui->sbCellCount->setMaximum(m_dev->getCellCount());
+void MainWindow::onSessionConnected() {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    if (session->deviceInfo().attachToReadyMs >= 0) {
+        qInfo("charger %s ready %lld ms after attach", qPrintable(session->location()),
+              session->deviceInfo().attachToReadyMs);
+    }
 
-        ui->gbChargingParameters->setEnabled(true);
-        ui->gbSystemSettings->setEnabled(true);
+    if (session == m_session) {
+        m_showDeviceInfo();
+    }
+    // the store takes the charger's cell count on connection
+    if (session == m_stripSession) {
+        m_showStrips(session);
+    }
+}
 
-        m_resizeCellTable();
+void MainWindow::onSessionSamplesCleared() {
+    if (sender() == m_stripSession) {
+        m_showStrips(m_stripSession);
+    }
+}
 
-        m_loadSysInfo();
-        m_loadChargeInfo();
-    } catch (std::runtime_error& e) {
-        m_dev = nullptr;
+void MainWindow::onSessionSamplingChanged() {
+    if (sender() == m_session) {
+        m_showSampling();
+    }
+}
+
+void MainWindow::onSessionDisconnected() {
+    if (sender() != m_session) {
+        return;
+    }
+
+    m_showDeviceInfo();
+    m_updateUI();
+}
+
+void MainWindow::onSysInfoLoaded(b6::SysInfo info) {
+    if (sender() != m_session) {
+        return;
+    }
+
+    ui->ckTimeLimit->setCheckState(info.timeLimitOn ? Qt::Checked : Qt::Unchecked);
+    ui->sbTimeLimit->setValue(info.timeLimit);
+
+    ui->ckCapacityLimit->setCheckState(info.capLimitOn ? Qt::Checked : Qt::Unchecked);
+    ui->sbCapacityLimit->setValue(info.capLimit);
+
+    ui->sbTemperatureLimit->setValue(info.tempLimit);
+    ui->sbCycleTime->setValue(info.cycleTime);
+
+    ui->ckKeyBuzzer->setCheckState(info.keyBuzzer ? Qt::Checked : Qt::Unchecked);
+    ui->ckSystemBuzzer->setCheckState(info.systemBuzzer ? Qt::Checked : Qt::Unchecked);
+}
+
+void MainWindow::onChargingChanged(bool) {
+    if (sender() == m_session) {
+        m_updateUI();
+    }
+}
+
+void MainWindow::onChargeInfoUpdated() {
+    static LatencyHistogram &showTime = Diagnostics::histogram("ui.chargeInfo");
+    if (sender() == m_session) {
+        LatencyHistogram::Scope timing(showTime);
+        m_showChargeInfo();
+    }
+}
+
+void MainWindow::onChargeCompleted(ChargerSession *session, b6::ChargeInfo info) {
+    // a notice in the status bar, it does not wait to be clicked away; jobs report in onJobFinished()
+    QTime cTime(0, 0, 0);
+    cTime = cTime.addSecs(info.time);
+    m_notify(QString("%1: charging completed in %2, capacity: %3 mAh.")
+                .arg(session->location())
+                .arg(cTime.toString("hh:mm:ss"))
+                .arg(info.capacity));
+}
+
+void MainWindow::onChargeFailed(ChargerSession *session, QString message) {
+    m_notify(QString("%1: error! %2").arg(session->location(), message));
+}
+
+void MainWindow::onJobAddRequested(QString steps, bool selectedOnly) {
+    ChargeScheduler::Job job;
+    if (!ChargeScheduler::parseSteps(steps, job.steps)) {
+        m_notify(QString("Cannot queue a job: unknown steps \"%1\".").arg(steps));
+        return;
+    }
+    if (selectedOnly) {
+        if (m_session == nullptr) {
+            m_notify("Cannot queue a job: no charger is selected.");
+            return;
+        }
+        job.location = m_session->location();
+    }
+    m_readChargeProfile(job.batteryType, job.profile);
+    job.pack = ui->lePack->text().trimmed();
+
+    QString error;
+    if (m_scheduler->addJob(job, &error) < 0) {
+        m_notify("Cannot queue a job: " + error + ".");
+    }
+}
+
+void MainWindow::onJobFinished(int id) {
+    const ChargeScheduler::Job *job = m_scheduler->job(id);
+    QString text = QString("%1 %2 on %3").arg(job->name, ChargeScheduler::stateName(job->state),
+                                              job->charger.isEmpty() ? "no charger" : job->charger);
+    if (!job->message.isEmpty()) {
+        text += ": " + job->message;
+    }
+    const QString results = ChargeScheduler::describeResults(*job);
+    if (!results.isEmpty()) {
+        text += " (" + results + ")";
     }
+    m_notify(text + ".");
+}
+
+void MainWindow::onHistoryOpenRequested(QString log) {
+    // the samples are only read now, straight into the session's store
+    ChargerSession *session = m_devices->openLog(log);
+    if (session == nullptr) {
+        m_notify("Cannot read " + log + ".");
+        return;
+    }
+    if (session == m_session) {
+        // the session stays selected, its replay controls move on to the new log
+        m_replay->setSession(session);
+        m_showChargeInfo();
+    }
+    m_dashboard->selectSession(session);
+    m_replayDock->raise();
+}
+
+void MainWindow::onHistoryOverlayRequested(QStringList logs) {
+    if (m_session == nullptr) {
+        if (!logs.isEmpty()) {
+            m_notify("Select a charger to lay past charges over.");
+        }
+        return;
+    }
+    m_charts.value(m_session)->setPastCharges(logs);
+}
+
+void MainWindow::onHistoryAlignmentChanged(int alignment) {
+    for (SessionCharts *charts : m_charts) {
+        charts->setAlignment(static_cast<ChargeOverlay::Alignment>(alignment));
+    }
+}
+
+void MainWindow::onChartRangeRequested(qreal min, qreal max) {
+    ChartView *view = static_cast<ChartView*>(sender());
+    if (m_session != nullptr) {
+        m_charts.value(m_session)->setViewRange(view->chart(), min, max);
+    }
+}
+
+void MainWindow::onChartFollowRequested() {
+    ChartView *view = static_cast<ChartView*>(sender());
+    if (m_session != nullptr) {
+        m_charts.value(m_session)->followLive(view->chart());
+    }
+}
+
+void MainWindow::onReplayPositionChanged() {
+    if (m_session == nullptr) {
+        return;
+    }
+    const b6::ChargeInfo info = m_replay->replay().chargeInfo();
+    m_charts.value(m_session)->setPlayhead(m_replay->replay().timeMs(m_replay->replay().position()) / 1000.0,
+                                           info.capacity);
+    m_showChargeInfo();
+}
+
+void MainWindow::onReplayActiveChanged(bool active) {
+    if (active && m_session != nullptr) {
+        m_showCellColumns();
+    } else if (m_session != nullptr) {
+        m_charts.value(m_session)->clearPlayhead();
+        m_showChargeInfo();
+    }
+    // strip charts only follow the live end, the playhead needs the chart views
+    m_updateChartVisibility();
+    m_updateUI();
 }
 
 void MainWindow::m_loadSysInfo() {
-    try {
-        b6::SysInfo info = m_dev->getSysInfo();
-        ui->ckTimeLimit->setCheckState(info.timeLimitOn ? Qt::Checked : Qt::Unchecked);
-        ui->sbTimeLimit->setValue(info.timeLimit);
+    if (m_session != nullptr) {
+        m_session->loadSysInfo();
+    }
+}
+
+void MainWindow::m_showDeviceInfo() {
+    bool connected = m_session != nullptr && m_session->isConnected();
+    if (connected) {
+        const DeviceInfo &info = m_session->deviceInfo();
+        lblCore->setText(QString("Core: %1 @ %2").arg(info.coreType).arg(m_session->location()));
+        lblHW->setText(QString("HW: %1").arg(info.hwVersion, 0, 'f', 2));
+        lblSW->setText(QString("SW: %1").arg(info.swVersion, 0, 'f', 2));
+        lblCells->setText(QString("Cells: %1").arg(info.cellCount));
+        lblCore->setToolTip(info.attachToReadyMs >= 0 ?
+                                QString("Ready %1 ms after the charger was plugged in").arg(info.attachToReadyMs) : "");
+
+        ui->sbCellCount->setMaximum(info.cellCount);
+        m_showCellColumns();
+    } else {
+        lblCore->setText("NOT CONNECTED!");
+        lblCore->setToolTip("");
+        lblHW->setText("");
+        lblSW->setText("");
+        lblCells->setText("");
+    }
+    m_showSampling();
+
+    ui->gbChargingParameters->setEnabled(connected);
+    ui->gbSystemSettings->setEnabled(connected);
+}
+
+void MainWindow::m_showSampling() {
+    if (m_session == nullptr || !m_session->isConnected() || m_session->sampleIntervalMs() <= 0) {
+        lblSampling->setText("");
+        lblSampling->setToolTip("");
+        return;
+    }
+
+    lblSampling->setText(QString("Poll: %1 ms").arg(m_session->sampleIntervalMs()));
+    lblSampling->setToolTip(m_session->sustainableIntervalMs() > 0 ?
+                                QString("The charger was measured to take a poll every %1 ms").arg(m_session->sustainableIntervalMs()) : "");
+}
+
+void MainWindow::m_showChargeInfo() {
+    if (m_session == nullptr || !m_session->hasChargeInfo()) {
+        lblStatus->setText("STATUS: IDLE");
+        return;
+    }
 
-        ui->ckCapacityLimit->setCheckState(info.capLimitOn ? Qt::Checked : Qt::Unchecked);
-        ui->sbCapacityLimit->setValue(info.capLimit);
+    // a replay being scrubbed through shows the charge as it stood at its position
+    if (m_replay->isActive()) {
+        const b6::ChargeInfo info = m_replay->replay().chargeInfo();
+        lblStatus->setText(QString("STATUS: %1 (replay)").arg(info.state));
+        m_showChargeFigures(info, m_replay->replay().analytics().figures(), ChargeForecast::Forecast());
+        return;
+    }
 
-        m_chartCapacity->axes(Qt::Vertical).at(0)->setRange(0, info.capLimitOn ? info.capLimit : 10000);
+    const b6::ChargeInfo &info = m_session->chargeInfo();
+    lblStatus->setText(QString("STATUS: %1").arg(info.state));
+    if (!m_session->isCharging()) {
+        return;
+    }
+    m_showChargeFigures(info, m_session->analytics().figures(), m_session->forecast().forecast());
+}
 
-        ui->sbTemperatureLimit->setValue(info.tempLimit);
-        ui->sbCycleTime->setValue(info.cycleTime);
+void MainWindow::m_showChargeFigures(const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures,
+                                     const ChargeForecast::Forecast &forecast) {
+    QTime cTime(0, 0, 0);
+    cTime = cTime.addSecs(info.time);
 
-        ui->ckKeyBuzzer->setCheckState(info.keyBuzzer ? Qt::Checked : Qt::Unchecked);
-        ui->ckSystemBuzzer->setCheckState(info.systemBuzzer ? Qt::Checked : Qt::Unchecked);
-    } catch (std::exception& e) {
+    for (int i = 0; i < m_session->deviceInfo().cellCount; i++) {
+        const int cellMv = info.cells[i] > 400 ? info.cells[i] : 0;
+        if (cellMv != m_cellMv[i]) {
+            m_cellMv[i] = cellMv;
+            m_cells[i]->setText(QString("%1V").arg((double)(cellMv) / 1000.0, 0, 'f', 3));
+        }
+        if (figures.cellResistance[i] != m_cellResistance[i]) {
+            m_cellResistance[i] = figures.cellResistance[i];
+            m_cells[i]->setToolTip(figures.cellResistance[i] > 0 ?
+                                       QString("%1 mΩ").arg(figures.cellResistance[i], 0, 'f', 1) : QString());
+        }
+    }
 
+    ui->lbChargeTime->setText(cTime.toString("hh:mm:ss"));
+    if (forecast.valid) {
+        ui->lbChargeRemaining->setText(QString("%1 (%2 - %3)").arg(QTime(0, 0, 0).addSecs(forecast.remainingS).toString("hh:mm:ss"))
+                                       .arg(QTime(0, 0, 0).addSecs(forecast.remainingLowS).toString("hh:mm"))
+                                       .arg(QTime(0, 0, 0).addSecs(forecast.remainingHighS).toString("hh:mm")));
+        ui->lbChargeFinalCapacity->setText(QString("%1 mAh (%2 - %3)").arg(forecast.finalCapacity)
+                                           .arg(forecast.finalCapacityLow).arg(forecast.finalCapacityHigh));
+    } else {
+        ui->lbChargeRemaining->setText("-");
+        ui->lbChargeFinalCapacity->setText("-");
     }
+    ui->lbChargeCurrent->setText(QString("%1 A").arg((double)(info.current) / 1000.0, 0, 'f', 3));
+    ui->lbChargeVoltage->setText(QString("%1 V").arg((double)(info.voltage) / 1000.0, 0, 'f', 3));
+    ui->lbChargeCapacity->setText(QString("%1 mAh").arg(info.capacity));
+    ui->lbChargeTempExt->setText(QString("%1°C").arg(info.tempExt));
+    ui->lbChargeTempInt->setText(QString("%1°C").arg(info.tempInt));
+    ui->lbChargeEnergy->setText(QString("%1 Wh").arg(figures.energyWh, 0, 'f', 2));
+    ui->lbChargeResistance->setText(figures.resistance > 0 ?
+                                        QString("%1 mΩ").arg(figures.resistance, 0, 'f', 1) : QString("- mΩ"));
+    ui->lbChargeVoltageSlope->setText(QString("%1 mV/min").arg(figures.voltageSlope, 0, 'f', 1));
+    ui->lbChargeDeltaV->setText(QString("%1 V / %2 mV%3").arg(figures.peakVoltage / 1000.0, 0, 'f', 3)
+                                .arg(figures.dropFromPeak, 0, 'f', 0).arg(figures.deltaV ? " (-ΔV)" : ""));
+    ui->lbChargeTempSlope->setText(QString("%1°C/min").arg(figures.tempSlope, 0, 'f', 2));
+    ui->lbChargeCellSpread->setText(QString("%1 mV (max %2)").arg(figures.cellSpread).arg(figures.maxCellSpread));
 }
 
-void MainWindow::m_loadChargeInfo() {
-    try {
-        b6::ChargeInfo info = m_dev->getChargeInfo();
-        lblStatus->setText(QString("STATUS: %1").arg(info.state));
+void MainWindow::m_updateChartVisibility() {
+    const bool strips = ui->ckStripCharts->isChecked() && !m_replay->isActive();
+    const bool shown[] = { ui->ckChartCurrent->isChecked(), ui->ckChartVoltage->isChecked(), ui->ckChartCapacity->isChecked(),
+                           ui->ckChartTemp->isChecked(), ui->ckChartCellsVoltage->isChecked() };
+    QWidget *views[] = { ui->ctCurrent, ui->ctVoltage, ui->ctCapacity, ui->ctTemp, ui->ctCellsVoltage };
+    QWidget *stripViews[] = { ui->scCurrent, ui->scVoltage, ui->scCapacity, ui->scTemp, ui->scCellsVoltage };
+    for (int i = 0; i < 5; i++) {
+        views[i]->setVisible(shown[i] && !strips);
+        stripViews[i]->setVisible(shown[i] && strips);
+    }
+    ChargerSession *stripSession = strips ? m_session : nullptr;
+    if (stripSession != m_stripSession) {
+        m_showStrips(stripSession);
+    }
+    if (m_session == nullptr) {
+        return;
+    }
+
+    // charts behind the strip charts are not rendered at all
+    SessionCharts *charts = m_charts.value(m_session);
+    RenderScheduler *render = charts->renderScheduler();
+    render->setChartVisible(charts->chartCurrent(), shown[0] && !strips);
+    render->setChartVisible(charts->chartVoltage(), shown[1] && !strips);
+    render->setChartVisible(charts->chartCapacity(), shown[2] && !strips);
+    render->setChartVisible(charts->chartTemp(), shown[3] && !strips);
+    render->setChartVisible(charts->chartCellsVoltage(), shown[4] && !strips);
+    charts->setOverlaysVisible(ui->ckChartAnalytics->isChecked());
+}
 
-        QTime cTime(0, 0, 0);
-        cTime = cTime.addSecs(info.time);
+void MainWindow::m_showCharts(ChargerSession *session) {
+    QChartView *views[] = { ui->ctCurrent, ui->ctVoltage, ui->ctCapacity, ui->ctTemp, ui->ctCellsVoltage };
+    QChart *charts[5];
+    if (session != nullptr) {
+        SessionCharts *sessionCharts = m_charts.value(session);
+        charts[0] = sessionCharts->chartCurrent();
+        charts[1] = sessionCharts->chartVoltage();
+        charts[2] = sessionCharts->chartCapacity();
+        charts[3] = sessionCharts->chartTemp();
+        charts[4] = sessionCharts->chartCellsVoltage();
+    } else {
+        for (int i = 0; i < 5; i++) {
+            charts[i] = new QChart();
+        }
+    }
 
-        if (info.state == static_cast<uint8_t>(b6::STATE::CHARGING)) {
-            m_charging = true;
-            m_updateUI();
-        } else if (info.state == 0x03) {
-            m_charging = false;
-            QMessageBox::information(this, "Charging complete",
-                                     QString("Charging completed in %1, capacity: %2 mAh.")
-                                        .arg(cTime.toString("hh:mm:ss"))
-                                        .arg(info.capacity));
+    for (int i = 0; i < 5; i++) {
+        QChart *previous = views[i]->chart();
+        views[i]->setChart(charts[i]);
+        // charts of a session are owned by the session, anything else was the view's placeholder
+        if (m_session == nullptr) {
+            delete previous;
         }
+    }
+}
 
-        if (m_charging) {
-            double cCurrent = (double)(info.current) / 1000.0;
-            double cVoltage = (double)(info.voltage) / 1000.0;
-            if(info.time < m_minTime) m_minTime = info.time;
-            m_seriesCurrent->append(info.time, cCurrent);
-            m_seriesVoltage->append(info.time, cVoltage);
-            m_seriesCapacity->append(info.time, info.capacity);
-            m_seriesTempInt->append(info.time, info.tempInt);
-
-            if (cCurrent < m_minCurrent) m_minCurrent = cCurrent;
-            if (cCurrent > m_maxCurrent) m_maxCurrent = cCurrent;
-            if (cVoltage < m_minVoltage) m_minVoltage = cVoltage;
-            if (cVoltage > m_maxVoltage) m_maxVoltage = cVoltage;
-            if (info.capacity < m_minCapacity) m_minCapacity = info.capacity;
-            if (info.capacity > m_maxCapacity) m_maxCapacity = info.capacity;
-            if (info.tempInt < m_minTempInt) m_minTempInt = info.tempInt;
-            if (info.tempInt > m_maxTempInt) m_maxTempInt = info.tempInt;
-            if (info.tempExt < m_minTempExt) m_minTempExt = info.tempExt;
-            if (info.tempExt > m_maxTempExt) m_maxTempExt = info.tempExt;
-
-            if(m_maxTempExt > 0){
-                if(!m_extTempAvailable){
-                    m_extTempAvailable = true;
-                    m_chartTemp->addSeries(m_seriesTempExt);
-                    m_chartTemp->createDefaultAxes();
-                }
-                m_seriesTempExt->append(info.time, info.tempExt);
-            }
-
-            m_chartCurrent->axes(Qt::Horizontal).at(0)->setRange(m_minTime, info.time);
-            m_chartCurrent->axes(Qt::Vertical).at(0)->setRange(std::max(0.0, m_minCurrent - 0.5), m_maxCurrent + 0.5);
-
-            m_chartVoltage->axes(Qt::Horizontal).at(0)->setRange(m_minTime, info.time);
-            m_chartVoltage->axes(Qt::Vertical).at(0)->setRange(std::max(0.0, m_minVoltage - 0.5), m_maxVoltage + 0.5);
-
-            m_chartCapacity->axes(Qt::Horizontal).at(0)->setRange(m_minTime, info.time);
-            m_chartCapacity->axes(Qt::Vertical).at(0)->setRange(std::max(0.0, m_minCapacity - 0.5), m_maxCapacity + 0.5);
-
-            m_chartTemp->axes(Qt::Horizontal).at(0)->setRange(m_minTime, info.time);
-            if(!m_extTempAvailable){
-                m_chartTemp->axes(Qt::Vertical).at(0)->setRange(std::max(0.0, m_minTempInt - 0.5), m_maxTempInt + 0.5);
-            }else{
-                m_chartTemp->axes(Qt::Vertical).at(0)->setRange(std::max(0.0, std::min(m_minTempInt, m_minTempExt) - 0.5), std::max(m_maxTempInt, m_maxTempExt) + 0.5);
-            }
-
-            for (int i = 0; i < m_dev->getCellCount(); i++) {
-                double cellV = (double)(info.cells[i]) / 1000.0;
-                m_cells[i]->setText(QString("%1V").arg(cellV > 0.4 ? cellV : 0.0, 0, 'f', 3));
-            }
-            if(!m_CellsAvailable){
-                for (int i = 0; i < m_dev->getCellCount(); i++) {
-                    double cellV = (double)(info.cells[i]) / 1000.0;
-                    if(cellV > 0.4){
-                        m_chartCellsVoltage->addSeries(m_seriesCellsVoltage[i]);
-                        m_CellsAvailable = true;
-                    }
-                }
-                if(m_CellsAvailable){
-                    m_chartCellsVoltage->createDefaultAxes();
-                    m_chartCellsVoltage->axes(Qt::Vertical).at(0)->setRange(2.0, 4.5);
-                }
-            }
-            if(m_CellsAvailable){
-                m_chartCellsVoltage->axes(Qt::Horizontal).at(0)->setRange(m_minTime, info.time);
-                double min = 10.0;
-                double max = 0.0;
-                for (int i = 0; i < m_dev->getCellCount(); i++) {
-                    double cellV = (double)(info.cells[i]) / 1000.0;
-                    if(cellV > 0.4){
-                        m_seriesCellsVoltage[i]->append(info.time, cellV);
-                        if(cellV < min) min = cellV;
-                        if(cellV > max) max = cellV;
-                    }
-                }
-                if(max > m_maxCellVoltage) m_maxCellVoltage = max;
-                if(min < m_minCellVoltage) m_minCellVoltage = min;
-                double diff = m_maxCellVoltage-m_minCellVoltage;
-                m_chartCellsVoltage->axes(Qt::Vertical).at(0)->setRange(m_minCellVoltage - std::max(0.02,diff), m_maxCellVoltage + std::max(0.02,diff));
-            }
-
-            ui->lbChargeTime->setText(cTime.toString("hh:mm:ss"));
-            ui->lbChargeCurrent->setText(QString("%1 A").arg((double)(info.current) / 1000.0, 0, 'f', 3));
-            ui->lbChargeVoltage->setText(QString("%1 V").arg((double)(info.voltage) / 1000.0, 0, 'f', 3));
-            ui->lbChargeCapacity->setText(QString("%1 mAh").arg(info.capacity));
-            ui->lbChargeTempExt->setText(QString("%1°C").arg(info.tempExt));
-            ui->lbChargeTempInt->setText(QString("%1°C").arg(info.tempInt));
+void MainWindow::m_showStrips(ChargerSession *session) {
+    StripChart *strips[] = { ui->scCurrent, ui->scVoltage, ui->scCapacity, ui->scTemp, ui->scCellsVoltage };
+    if (m_stripSession != nullptr) {
+        disconnect(m_stripSession, SIGNAL(samplesCleared()), this, SLOT(onSessionSamplesCleared()));
+        for (StripChart *strip : strips) {
+            disconnect(m_stripSession, SIGNAL(samplesAppended()), strip, SLOT(appendSamples()));
         }
+    }
+    for (StripChart *strip : strips) {
+        strip->clearTraces();
+    }
+    m_stripSession = session;
+    if (session == nullptr) {
         return;
-    } catch (b6::ChargingError& e) {
-        QMessageBox::critical(this, "Error!", QString::fromStdString(e.message()));
-    } catch (std::exception& e) {
+    }
 
+    const TelemetryStore *store = &session->store();
+    ui->scCurrent->setTitle("Current (A)");
+    ui->scCurrent->addTrace(new TelemetryColumn(store, TelemetryStore::CURRENT, 0, 0.001), QColor(0xff, 0x00, 0x00));
+    ui->scVoltage->setTitle("Voltage (V)");
+    ui->scVoltage->addTrace(new TelemetryColumn(store, TelemetryStore::VOLTAGE, 0, 0.001), QColor(0x00, 0x00, 0xff));
+    ui->scCapacity->setTitle("Capacity (mAh)");
+    ui->scCapacity->addTrace(new TelemetryColumn(store, TelemetryStore::CAPACITY), QColor(0x00, 0xc0, 0x00));
+    ui->scTemp->setTitle("Temperature");
+    ui->scTemp->addTrace(new TelemetryColumn(store, TelemetryStore::TEMP_INT), QColor(0xff, 0x80, 0x00));
+    ui->scCellsVoltage->setTitle("Cells (V)");
+    for (int i = 0; i < store->cellCount(); i++) {
+        ui->scCellsVoltage->addTrace(new TelemetryColumn(store, TelemetryStore::CELL, i, 0.001),
+                                     QColor::fromHsv(i * 360 / TelemetryStore::MAX_CELLS, 0xff, 0xc0));
+    }
+
+    connect(session, SIGNAL(samplesCleared()), this, SLOT(onSessionSamplesCleared()));
+    for (StripChart *strip : strips) {
+        connect(session, SIGNAL(samplesAppended()), strip, SLOT(appendSamples()));
     }
-    m_stopCharging();
 }
 
 void MainWindow::m_updateUI() {
-    if (m_charging) {
+    bool charging = m_session != nullptr && m_session->isCharging();
+    if (charging) {
         ui->cbBatteryType->setEnabled(false);
         ui->cbChargingMode->setEnabled(false);
         ui->sbCellCount->setEnabled(false);
@@ -414,8 +712,9 @@ void MainWindow::m_updateUI() {
         ui->sbRepeakCount->setEnabled(false);
         ui->sbCycleCount->setEnabled(false);
 
-        m_chartCurrent->axes(Qt::Vertical).at(0)->setRange(0, (double)(ui->sbChargeCurrent->value()) / 1000.0 + 1.0);
-        m_chartVoltage->axes(Qt::Vertical).at(0)->setRange(0, (double)(ui->sbEndVoltage->value()) *
+        SessionCharts *charts = m_charts.value(m_session);
+        charts->chartCurrent()->axes(Qt::Vertical).at(0)->setRange(0, (double)(ui->sbChargeCurrent->value()) / 1000.0 + 1.0);
+        charts->chartVoltage()->axes(Qt::Vertical).at(0)->setRange(0, (double)(ui->sbEndVoltage->value()) *
                                              (double)(ui->sbCellCount->value()) / 1000.0 + 1.0);
     } else {
         ui->cbBatteryType->setEnabled(true);
@@ -454,97 +753,83 @@ void MainWindow::m_updateUI() {
             ui->sbCycleCount->setEnabled(false);
         }
     }
-    ui->btStartCharging->setEnabled(!m_charging);
-    ui->btStopCharging->setEnabled(m_charging);
-    ui->gbChargingInfo->setEnabled(m_charging);
+    ui->btStartCharging->setEnabled(!charging);
+    ui->btStopCharging->setEnabled(charging);
+    // a replay shows the charge as it stood, whether or not the charger is still at it
+    ui->gbChargingInfo->setEnabled(charging || m_replay->isActive());
 }
 
 void MainWindow::m_saveSysInfo() {
-    try {
-        m_dev->setTimeLimit(
-                    ui->ckTimeLimit->checkState() == Qt::Checked,
-                    ui->sbTimeLimit->value());
-        m_dev->setCapacityLimit(
-                    ui->ckCapacityLimit->checkState() == Qt::Checked,
-                    ui->sbCapacityLimit->value());
-        m_dev->setTempLimit(ui->sbTemperatureLimit->value());
-        m_dev->setCycleTime(ui->sbCycleTime->value());
-        m_dev->setBuzzers(
-                    ui->ckSystemBuzzer->checkState() == Qt::Checked,
-                    ui->ckKeyBuzzer->checkState() == Qt::Checked);
-
-
+    if (m_session == nullptr) {
+        return;
+    }
 
-        m_chartCapacity->axes(Qt::Vertical).at(0)->setRange(0, ui->ckCapacityLimit->checkState() == Qt::Checked ?
-                                               ui->sbCapacityLimit->value() : 10000);
-    } catch (std::exception& e) {
+    b6::SysInfo info = {};
+    info.timeLimitOn = ui->ckTimeLimit->checkState() == Qt::Checked;
+    info.timeLimit = ui->sbTimeLimit->value();
+    info.capLimitOn = ui->ckCapacityLimit->checkState() == Qt::Checked;
+    info.capLimit = ui->sbCapacityLimit->value();
+    info.tempLimit = ui->sbTemperatureLimit->value();
+    info.cycleTime = ui->sbCycleTime->value();
+    info.systemBuzzer = ui->ckSystemBuzzer->checkState() == Qt::Checked;
+    info.keyBuzzer = ui->ckKeyBuzzer->checkState() == Qt::Checked;
+    m_session->saveSysInfo(info);
+    m_charts.value(m_session)->setCapacityLimit(info.capLimitOn ? info.capLimit : 10000);
+}
 
+void MainWindow::m_readChargeProfile(b6::BATTERY_TYPE &battType, b6::ChargeProfile &settings) {
+    battType = ui->cbBatteryType->currentData().value<b6::BATTERY_TYPE>();
+    settings = {};
+    if (b6::Device::isBatteryLi(battType)) {
+        settings.mode.li = ui->cbChargingMode->currentData().value<b6::CHARGING_MODE_LI>();
+    } else if (b6::Device::isBatteryNi(battType)) {
+        settings.mode.ni = ui->cbChargingMode->currentData().value<b6::CHARGING_MODE_NI>();
+    } else {
+        settings.mode.pb = ui->cbChargingMode->currentData().value<b6::CHARGING_MODE_PB>();
     }
+    settings.cellCount = ui->sbCellCount->value();
+    settings.chargeCurrent = ui->sbChargeCurrent->value();
+    settings.dischargeCurrent = ui->sbDischargeCurrent->value();
+    settings.cellDischargeVoltage = ui->sbCellDischargeVoltage->value();
+    settings.endVoltage = ui->sbEndVoltage->value();
+    settings.rPeakCount = ui->sbRepeakCount->value();
+    settings.cycleCount = ui->sbCycleCount->value();
 }
 
 void MainWindow::m_startCharging() {
-    try {
-        b6::BATTERY_TYPE battType = ui->cbBatteryType->currentData().value<b6::BATTERY_TYPE>();
-        b6::ChargeProfile profile = m_dev->getDefaultChargeProfile(battType);
-        if (b6::Device::isBatteryLi(battType)) {
-            profile.mode.li = ui->cbChargingMode->currentData().value<b6::CHARGING_MODE_LI>();
-        } else if (b6::Device::isBatteryNi(battType)) {
-            profile.mode.ni = ui->cbChargingMode->currentData().value<b6::CHARGING_MODE_NI>();
-        } else {
-            profile.mode.pb = ui->cbChargingMode->currentData().value<b6::CHARGING_MODE_PB>();
-        }
-        profile.cellCount = ui->sbCellCount->value();
-        profile.chargeCurrent = ui->sbChargeCurrent->value();
-        profile.dischargeCurrent = ui->sbDischargeCurrent->value();
-        profile.cellDischargeVoltage = ui->sbCellDischargeVoltage->value();
-        profile.endVoltage = ui->sbEndVoltage->value();
-        profile.rPeakCount = ui->sbRepeakCount->value();
-        profile.cycleCount = ui->sbCycleCount->value();
-
-        m_seriesCurrent->clear();
-        m_seriesVoltage->clear();
-        m_seriesCapacity->clear();
-        m_seriesTempExt->clear();
-        m_seriesTempInt->clear();
-
-        m_chartCellsVoltage->removeAllSeries();
-        for (int i = 0; i < 8; i++) {
-            m_seriesCellsVoltage[i] = new QLineSeries();
-            m_seriesCellsVoltage[i]->setName(QString("Cell %1 (V)").arg(i+1));
-        }
-        m_CellsAvailable = false;
-        m_maxCellVoltage = 0;
-        m_minCellVoltage = 10;
-
-        m_dev->startCharging(profile);
-        m_charging = true;
-        m_updateUI();
-    } catch (std::exception& e) {
-
+    if (m_session == nullptr) {
+        return;
+    }
+    if (m_scheduler->jobOn(m_session) >= 0) {
+        m_notify(QString("%1 is running a job, cancel it first.").arg(m_session->location()));
+        return;
     }
+
+    b6::BATTERY_TYPE battType;
+    b6::ChargeProfile settings;
+    m_readChargeProfile(battType, settings);
+    m_session->startCharging(battType, settings, ui->lePack->text().trimmed());
 }
 
 void MainWindow::m_stopCharging() {
-    try {
-        m_dev->stopCharging();
-        m_charging = false;
-        m_updateUI();
-    } catch (std::exception& e) {
-
+    if (m_session != nullptr) {
+        m_session->stopCharging();
     }
 }
 
-void MainWindow::m_resizeCellTable() {
-    if (m_dev == nullptr) {
+void MainWindow::m_notify(const QString &text) {
+    m_jobs->addNotice(text);
+    ui->statusBar->showMessage(text, 10000);
+    QApplication::alert(this);
+}
+
+void MainWindow::m_showCellColumns() {
+    if (m_session == nullptr || m_session->deviceInfo().cellCount == 0) {
         return;
     }
 
-    int cellWidth = ui->tbCells->width() / m_dev->getCellCount();
-    for (int i = 0; i < m_dev->getCellCount(); i++) {
-        ui->tbCells->horizontalHeader()->resizeSection(i, cellWidth);
+    // the header stretches the columns left over the table's width on its own
+    for (int i = 0; i < 8; i++) {
+        ui->tbCells->setColumnHidden(i, i >= m_session->deviceInfo().cellCount);
     }
 }
-
-void MainWindow::resizeEvent(QResizeEvent*) {
-    m_resizeCellTable();
-}
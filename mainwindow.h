@@ -19,20 +19,27 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QHash>
 #include <QLabel>
 #include <QMainWindow>
-#include <QTimer>
 #include <QtCharts>
 #include <QTableWidgetItem>
 #include <b6/Device.hh>
+#include "chargescheduler.h"
+#include "chartview.h"
+#include "chargersession.h"
+#include "dashboardwidget.h"
+#include "devicemanager.h"
+#include "diagnosticswidget.h"
+#include "historywidget.h"
+#include "jobswidget.h"
+#include "replaywidget.h"
+#include "sessioncharts.h"
+#include "stripchart.h"
+#include "telemetryserver.h"
 
 using namespace QtCharts;
 
-Q_DECLARE_METATYPE(b6::BATTERY_TYPE)
-Q_DECLARE_METATYPE(b6::CHARGING_MODE_LI)
-Q_DECLARE_METATYPE(b6::CHARGING_MODE_NI)
-Q_DECLARE_METATYPE(b6::CHARGING_MODE_PB)
-
 namespace Ui {
 class MainWindow;
 }
@@ -43,60 +50,84 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
-public slots:
-    void onTimer();
+    bool serveTelemetry(const QString &name);
+    void addVirtualDevice(const QString &spec);
 
 private slots:
     void on_btLoad_clicked();
     void on_btSave_clicked();
     void on_btStartCharging_clicked();
     void on_btStopCharging_clicked();
+    void on_btExportCsv_clicked();
     void on_cbBatteryType_currentIndexChanged(int index);
     void on_cbChargingMode_currentIndexChanged(int);
     void on_sbCellCount_valueChanged(int value);
-    void onCkChartToggled(bool value);
+    void onCkChartToggled(bool);
+    void onSessionAdded(ChargerSession *session);
+    void onSessionSelected(ChargerSession *session);
+    void onSessionConnected();
+    void onSessionDisconnected();
+    void onSessionSamplesCleared();
+    void onSessionSamplingChanged();
+    void onSysInfoLoaded(b6::SysInfo info);
+    void onChargingChanged(bool);
+    void onChargeInfoUpdated();
+    void onChargeCompleted(ChargerSession *session, b6::ChargeInfo info);
+    void onChargeFailed(ChargerSession *session, QString message);
+    void onJobAddRequested(QString steps, bool selectedOnly);
+    void onJobFinished(int id);
+    void onHistoryOpenRequested(QString log);
+    void onHistoryOverlayRequested(QStringList logs);
+    void onHistoryAlignmentChanged(int alignment);
+    void onChartRangeRequested(qreal min, qreal max);
+    void onChartFollowRequested();
+    void onReplayPositionChanged();
+    void onReplayActiveChanged(bool active);
 
 private:
-    static std::vector<std::pair<QString, b6::BATTERY_TYPE>> m_batteryTypes;
-    static std::vector<std::pair<QString, b6::CHARGING_MODE_LI>> m_chargingModesLi;
-    static std::vector<std::pair<QString, b6::CHARGING_MODE_NI>> m_chargingModesNi;
-    static std::vector<std::pair<QString, b6::CHARGING_MODE_PB>> m_chargingModesPb;
-
-    QTimer *timer;
     Ui::MainWindow *ui;
-    QLabel *lblCore, *lblSW, *lblHW, *lblCells;
-    QLabel *lblStatus;
+    QLabel *lblCore, *lblSW, *lblHW, *lblCells, *lblSampling;
+    QLabel *lblStatus, *lblDiagnostics;
     QTableWidgetItem *m_cells[8];
-    QChart *m_chartCurrent, *m_chartVoltage, *m_chartCapacity, *m_chartTemp, *m_chartCellsVoltage;
-    QLineSeries *m_seriesCurrent, *m_seriesVoltage, *m_seriesCapacity,
-                *m_seriesTempExt, *m_seriesTempInt, *m_seriesCellsVoltage[8];
-
-    double m_minCurrent = 100.0, m_maxCurrent = 0.0,
-           m_minVoltage = 100.0, m_maxVoltage = 0.0,
-           m_minCellVoltage = 100.0, m_maxCellVoltage = 0.0;
-    int m_minCapacity = 10000, m_maxCapacity = 0,
-        m_minTempExt = 80, m_maxTempExt = 0,
-        m_minTempInt = 80, m_maxTempInt = 0,
-        m_minTime = 100000;
+    // what the cell table shows, so unchanged cells are not formatted again every tick
+    int m_cellMv[8];
+    float m_cellResistance[8];
+
+    DeviceManager *m_devices;
+    DashboardWidget *m_dashboard;
+    DiagnosticsWidget *m_diagnostics;
+    ChargeScheduler *m_scheduler;
+    JobsWidget *m_jobs;
+    SessionHistory *m_history;
+    HistoryWidget *m_historyView;
+    ReplayWidget *m_replay;
+    QDockWidget *m_replayDock;
+    TelemetryServer *m_server = nullptr;
+    QHash<ChargerSession*, SessionCharts*> m_charts;
+    ChargerSession *m_session = nullptr;
+    ChargerSession *m_stripSession = nullptr;   // the one the strip charts follow, if they are shown
 
-    b6::Device *m_dev = nullptr;
-    bool m_charging = false;
-    bool m_extTempAvailable = false;
-    bool m_CellsAvailable = false;
-
-    void m_createDevice();
     void m_loadSysInfo();
-    void m_loadChargeInfo();
+    void m_showDeviceInfo();
+    void m_showChargeInfo();
+    void m_showSampling();
+    void m_showChargeFigures(const b6::ChargeInfo &info, const ChargeAnalytics::Figures &figures,
+                             const ChargeForecast::Forecast &forecast);
+    void m_showCharts(ChargerSession *session);
+    void m_showStrips(ChargerSession *session);
+    void m_updateChartVisibility();
 
     void m_updateUI();
 
     void m_saveSysInfo();
+    void m_readChargeProfile(b6::BATTERY_TYPE &battType, b6::ChargeProfile &settings);
     void m_startCharging();
     void m_stopCharging();
 
-    void m_resizeCellTable();
-protected:
-    void resizeEvent(QResizeEvent*);
+    // non-modal, so nothing waits on someone to click a dialog away
+    void m_notify(const QString &text);
+
+    void m_showCellColumns();
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,65 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "diagnostics.h"
+#include "overlayresampler.h"
+
+OverlayResampler::OverlayResampler(QObject *parent) : QObject(parent) {
+    qRegisterMetaType<OverlayRequest>();
+    qRegisterMetaType<OverlayCurves>();
+    qRegisterMetaType<ChargeOverlay::Extent>();
+}
+
+void OverlayResampler::load(int generation, QStringList logs) {
+    static LatencyHistogram &loadTime = Diagnostics::histogram("overlay.load");
+    LatencyHistogram::Scope timing(loadTime);
+
+    m_generation = generation;
+    m_overlay.clear();
+    for (const QString &log : logs) {
+        m_overlay.add(log.toStdString());
+    }
+    emit loaded(generation, static_cast<int>(m_overlay.size()), m_overlay.extent());
+}
+
+void OverlayResampler::resample(OverlayRequest request) {
+    if (request.generation != m_generation) {
+        return;
+    }
+    static LatencyHistogram &resampleTime = Diagnostics::histogram("overlay.resample");
+    LatencyHistogram::Scope timing(resampleTime);
+
+    OverlayCurves curves;
+    curves.generation = request.generation;
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        if (request.buckets[figure] <= 0) {
+            continue;
+        }
+        curves.points[figure].resize(static_cast<int>(m_overlay.size()));
+        for (std::size_t curve = 0; curve < m_overlay.size(); curve++) {
+            m_overlay.resample(curve, static_cast<ChargeOverlay::Figure>(figure), request.alignment[figure],
+                               request.xMin[figure], request.xMax[figure],
+                               static_cast<std::size_t>(request.buckets[figure]), m_buffer);
+            QVector<QPointF> &points = curves.points[figure][static_cast<int>(curve)];
+            points.reserve(static_cast<int>(m_buffer.size()));
+            for (const LodSeries::Point &point : m_buffer) {
+                points.append(QPointF(point.x, point.y));
+            }
+        }
+    }
+    emit resampled(curves);
+}
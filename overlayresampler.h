@@ -0,0 +1,70 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OVERLAYRESAMPLER_H
+#define OVERLAYRESAMPLER_H
+
+#include <QObject>
+#include <QPointF>
+#include <QStringList>
+#include <QVector>
+#include "chargeoverlay.h"
+
+// what the charts show of each figure; 0 buckets skips a figure
+struct OverlayRequest {
+    int generation = 0;
+    ChargeOverlay::Alignment alignment[ChargeOverlay::FIGURES] = {};
+    double xMin[ChargeOverlay::FIGURES] = {};
+    double xMax[ChargeOverlay::FIGURES] = {};
+    int buckets[ChargeOverlay::FIGURES] = {};
+};
+
+// a point list per curve of each figure asked for
+struct OverlayCurves {
+    int generation = 0;
+    QVector<QVector<QPointF>> points[ChargeOverlay::FIGURES];
+};
+
+Q_DECLARE_METATYPE(OverlayRequest)
+Q_DECLARE_METATYPE(OverlayCurves)
+Q_DECLARE_METATYPE(ChargeOverlay::Extent)
+
+/*
+ * Keeps a ChargeOverlay on a thread of its own, so neither mapping the logs
+ * nor resampling them ever holds up the GUI. Every load() starts a new
+ * generation; requests and results of an older one are dropped.
+ */
+class OverlayResampler : public QObject {
+    Q_OBJECT
+public:
+    explicit OverlayResampler(QObject *parent = 0);
+
+public slots:
+    void load(int generation, QStringList logs);
+    void resample(OverlayRequest request);
+
+signals:
+    void loaded(int generation, int curves, ChargeOverlay::Extent extent);
+    void resampled(OverlayCurves curves);
+
+private:
+    ChargeOverlay m_overlay;
+    int m_generation = 0;
+    std::vector<LodSeries::Point> m_buffer;
+};
+
+#endif // OVERLAYRESAMPLER_H
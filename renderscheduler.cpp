@@ -0,0 +1,181 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "diagnostics.h"
+#include "renderscheduler.h"
+
+int RenderScheduler::m_defaultFps = 20;
+
+RenderScheduler::RenderScheduler(QObject *parent) : QObject(parent), m_fps(m_defaultFps) {
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(commit()));
+}
+
+void RenderScheduler::setDefaultFps(int fps) {
+    m_defaultFps = std::max(1, fps);
+}
+
+void RenderScheduler::setFps(int fps) {
+    m_fps = std::max(1, fps);
+}
+
+void RenderScheduler::setChartVisible(QChart *chart, bool visible) {
+    if (visible) {
+        if (m_hiddenCharts.remove(chart)) {
+            m_schedule();
+            emit viewChanged(chart);
+        }
+    } else {
+        m_hiddenCharts.insert(chart);
+    }
+}
+
+void RenderScheduler::addSeries(QXYSeries *series, const LodSeries::Source *source) {
+    m_data.insert(series, LodSeries(source));
+    m_dirtySeries.insert(series);
+}
+
+void RenderScheduler::removeSeries(QXYSeries *series) {
+    m_data.remove(series);
+    m_dirtySeries.remove(series);
+}
+
+void RenderScheduler::update() {
+    for (auto it = m_data.begin(); it != m_data.end(); ++it) {
+        const std::size_t size = it.value().size();
+        it.value().update();
+        if (it.value().size() == size) {
+            continue;
+        }
+        QXYSeries *series = it.key();
+        m_dirtySeries.insert(series);
+        if (series->chart() != nullptr && !m_hiddenCharts.contains(series->chart())) {
+            m_schedule();
+        }
+    }
+}
+
+void RenderScheduler::setRange(QChart *chart, Qt::Orientation orientation, qreal min, qreal max) {
+    Range &range = orientation == Qt::Horizontal ? m_pendingRanges[chart].horizontal : m_pendingRanges[chart].vertical;
+    range.pending = true;
+    range.min = min;
+    range.max = max;
+    if (!m_hiddenCharts.contains(chart)) {
+        m_schedule();
+    }
+}
+
+void RenderScheduler::setRange(QChart *chart, QAbstractAxis *axis, qreal min, qreal max) {
+    Range &range = m_pendingRanges[chart].axes[axis];
+    range.pending = true;
+    range.min = min;
+    range.max = max;
+    if (!m_hiddenCharts.contains(chart)) {
+        m_schedule();
+    }
+}
+
+void RenderScheduler::reset() {
+    m_pendingRanges.clear();
+    for (auto it = m_data.begin(); it != m_data.end(); ++it) {
+        it.value().clear();
+        m_dirtySeries.insert(it.key());
+    }
+    m_schedule();
+}
+
+void RenderScheduler::commit() {
+    static LatencyHistogram &commitTime = Diagnostics::histogram("render.commit");
+    LatencyHistogram::Scope timing(commitTime);
+
+    for (auto it = m_pendingRanges.begin(); it != m_pendingRanges.end();) {
+        QChart *chart = it.key();
+        if (m_hiddenCharts.contains(chart)) {
+            ++it;
+            continue;
+        }
+        if (it.value().horizontal.pending && !chart->axes(Qt::Horizontal).isEmpty()) {
+            chart->axes(Qt::Horizontal).at(0)->setRange(it.value().horizontal.min, it.value().horizontal.max);
+            // the visible window moved, every series on the chart needs a new selection of points
+            for (QAbstractSeries *series : chart->series()) {
+                QXYSeries *xySeries = qobject_cast<QXYSeries*>(series);
+                if (xySeries != nullptr && m_data.contains(xySeries)) {
+                    m_dirtySeries.insert(xySeries);
+                }
+            }
+            emit viewChanged(chart);
+        }
+        if (it.value().vertical.pending && !chart->axes(Qt::Vertical).isEmpty()) {
+            chart->axes(Qt::Vertical).at(0)->setRange(it.value().vertical.min, it.value().vertical.max);
+        }
+        // an axis may have been taken off the chart since
+        const QList<QAbstractAxis*> axes = chart->axes();
+        for (auto axis = it.value().axes.constBegin(); axis != it.value().axes.constEnd(); ++axis) {
+            if (axes.contains(axis.key())) {
+                axis.key()->setRange(axis.value().min, axis.value().max);
+            }
+        }
+        it = m_pendingRanges.erase(it);
+    }
+
+    for (auto it = m_dirtySeries.begin(); it != m_dirtySeries.end();) {
+        QXYSeries *series = *it;
+        // a series that is not on a chart yet is refreshed once it is added and gets new data
+        if (series->chart() == nullptr || m_hiddenCharts.contains(series->chart())) {
+            ++it;
+            continue;
+        }
+        m_refresh(series);
+        it = m_dirtySeries.erase(it);
+    }
+}
+
+void RenderScheduler::m_schedule() {
+    if (!m_timer->isActive()) {
+        m_timer->start(1000 / m_fps);
+    }
+}
+
+void RenderScheduler::m_refresh(QXYSeries *series) {
+    const LodSeries &data = m_data[series];
+    if (data.empty()) {
+        series->clear();
+        return;
+    }
+
+    QChart *chart = series->chart();
+    double xMin = data.front().x, xMax = data.back().x;
+    QValueAxis *axis = chart->axes(Qt::Horizontal).isEmpty() ? nullptr :
+                       qobject_cast<QValueAxis*>(chart->axes(Qt::Horizontal).at(0));
+    if (axis != nullptr) {
+        xMin = axis->min();
+        xMax = axis->max();
+    }
+    int pixels = static_cast<int>(chart->plotArea().width());
+    if (pixels <= 0) {
+        pixels = 1000;
+    }
+
+    data.query(xMin, xMax, pixels, m_queryBuffer);
+    m_replaceBuffer.resize(static_cast<int>(m_queryBuffer.size()));
+    for (std::size_t i = 0; i < m_queryBuffer.size(); i++) {
+        m_replaceBuffer[static_cast<int>(i)] = QPointF(m_queryBuffer[i].x, m_queryBuffer[i].y);
+    }
+    series->replace(m_replaceBuffer);
+}
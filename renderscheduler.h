@@ -0,0 +1,93 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QtCharts>
+#include "lodseries.h"
+
+using namespace QtCharts;
+
+/*
+ * Collects chart updates and commits them at most once per frame. Every chart
+ * series is bound to a LodSeries over its data source; update() picks up new
+ * samples from all of them and axis ranges are batched per chart
+ * (last one wins). On commit each changed series gets one replace() with
+ * roughly two points per horizontal pixel of the visible range, so both the
+ * layout and the paint cost stay flat however long the charge runs. Charts
+ * that are not visible keep their pending updates until they are shown again.
+ */
+class RenderScheduler : public QObject {
+    Q_OBJECT
+public:
+    explicit RenderScheduler(QObject *parent = 0);
+
+    static void setDefaultFps(int fps);
+    void setFps(int fps);
+    int fps() const { return m_fps; }
+
+    void setChartVisible(QChart *chart, bool visible);
+    bool isChartVisible(QChart *chart) const { return !m_hiddenCharts.contains(chart); }
+
+    void addSeries(QXYSeries *series, const LodSeries::Source *source);
+    void removeSeries(QXYSeries *series);
+    void update();
+    void setRange(QChart *chart, Qt::Orientation orientation, qreal min, qreal max);
+    // for axes beyond the first one of their orientation, e.g. an overlay's own scale
+    void setRange(QChart *chart, QAbstractAxis *axis, qreal min, qreal max);
+
+    void reset();
+
+signals:
+    // the chart's horizontal range was committed, or the chart was shown again
+    void viewChanged(QChart *chart);
+
+public slots:
+    void commit();
+
+private:
+    struct Range {
+        bool pending = false;
+        qreal min = 0.0, max = 0.0;
+    };
+    struct ChartRanges {
+        Range horizontal, vertical;
+        QHash<QAbstractAxis*, Range> axes;
+    };
+
+    static int m_defaultFps;
+
+    int m_fps;
+    QTimer *m_timer;
+    QSet<QChart*> m_hiddenCharts;
+    QHash<QXYSeries*, LodSeries> m_data;
+    QSet<QXYSeries*> m_dirtySeries;
+    QHash<QChart*, ChartRanges> m_pendingRanges;
+    QVector<QPointF> m_replaceBuffer;
+    std::vector<LodSeries::Point> m_queryBuffer;
+
+    void m_schedule();
+    void m_refresh(QXYSeries *series);
+};
+
+#endif // RENDERSCHEDULER_H
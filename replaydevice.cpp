@@ -0,0 +1,99 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "replaydevice.h"
+
+ReplayDevice::ReplayDevice(const std::string &path, double speed) : m_speed(speed) {
+    if (!m_log.open(path)) {
+        throw std::runtime_error("cannot read session log " + path);
+    }
+    while (m_records < m_log.size() && SessionLog::isValid(m_log.record(m_records))) {
+        m_records++;
+    }
+    if (m_records == 0) {
+        throw std::runtime_error("session log " + path + " is empty");
+    }
+
+    if (m_records > 1) {
+        const double spanMs = m_log.record(m_records - 1).timeMs - m_log.record(0).timeMs;
+        m_recordIntervalMs = std::min(std::max(spanMs / (m_records - 1), 1.0), 1000.0);
+    }
+
+    std::memset(&m_sysInfo, 0, sizeof(m_sysInfo));
+    m_started = std::chrono::steady_clock::now();
+    m_info = SessionLog::toChargeInfo(m_log.record(0));
+}
+
+b6::ChargeInfo ReplayDevice::getChargeInfo() {
+    if (m_stopped || m_next >= m_records) {
+        return m_info;
+    }
+
+    const SessionLog::Record &record = m_log.record(m_next);
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_started).count();
+    const double dueMs = record.timeMs - m_log.record(0).timeMs;
+    if (m_speed > 0.0 && elapsedMs * m_speed < dueMs) {
+        return m_info;
+    }
+
+    m_info = SessionLog::toChargeInfo(record);
+    m_next++;
+    if (m_next == m_records && m_info.state == static_cast<uint8_t>(b6::STATE::CHARGING)) {
+        // the recording was cut short, the charge ends with it
+        m_info.state = 0;
+    }
+    return m_info;
+}
+
+b6::ChargeProfile ReplayDevice::getDefaultChargeProfile(b6::BATTERY_TYPE type) {
+    b6::ChargeProfile profile;
+    std::memset(&profile, 0, sizeof(profile));
+    profile.batteryType = type;
+    return profile;
+}
+
+bool ReplayDevice::startCharging(const b6::ChargeProfile &) {
+    m_started = std::chrono::steady_clock::now();
+    m_next = 0;
+    m_stopped = false;
+    return true;
+}
+
+bool ReplayDevice::stopCharging() {
+    m_stopped = true;
+    m_info.state = 0;
+    m_info.current = 0;
+    return true;
+}
+
+int ReplayDevice::pollIntervalMs() const {
+    if (m_speed <= 0.0) {
+        return 1;
+    }
+    return std::max(1, static_cast<int>(m_recordIntervalMs / m_speed));
+}
+
+int64_t ReplayDevice::sampleTimeMs() const {
+    if (m_next == 0) {
+        return m_log.record(0).timeMs;
+    }
+    return m_log.record(m_next - 1).timeMs;
+}
@@ -0,0 +1,74 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYDEVICE_H
+#define REPLAYDEVICE_H
+
+#include <chrono>
+#include <string>
+#include "chargerdevice.h"
+#include "sessionlog.h"
+
+/*
+ * Plays a recorded session log back as if the charger was reporting it
+ * again, starting as soon as it is opened. Records are handed out one per
+ * getChargeInfo() once the scaled clock reaches their time, never skipped,
+ * so at high speeds the pace is bounded by the reader. The recording is polled
+ * as often as it was sampled, scaled by speed. startCharging() restarts the
+ * recording, stopCharging() ends it. Once it has run out it is not polled
+ * until it is started again.
+ */
+class ReplayDevice : public ChargerDevice {
+public:
+    // throws std::runtime_error if the log cannot be read
+    ReplayDevice(const std::string &path, double speed);
+
+    std::string getCoreType() override { return "REPLAY"; }
+    double getHWVersion() override { return 0.0; }
+    double getSWVersion() override { return 0.0; }
+    int getCellCount() override { return static_cast<int>(m_log.header().cellCount); }
+
+    b6::SysInfo getSysInfo() override { return m_sysInfo; }
+    b6::ChargeInfo getChargeInfo() override;
+    b6::ChargeProfile getDefaultChargeProfile(b6::BATTERY_TYPE type) override;
+    bool startCharging(const b6::ChargeProfile &profile) override;
+    bool stopCharging() override;
+
+    void setTimeLimit(bool, unsigned) override {}
+    void setCapacityLimit(bool, unsigned) override {}
+    void setTempLimit(unsigned) override {}
+    void setCycleTime(unsigned) override {}
+    void setBuzzers(bool, bool) override {}
+
+    int pollIntervalMs() const override;
+    int64_t sampleTimeMs() const override;
+    bool hasMoreSamples() const override { return !m_stopped && m_next < m_records; }
+
+private:
+    SessionLogReader m_log;
+    std::size_t m_records = 0;     // intact records
+    double m_speed;
+    double m_recordIntervalMs = 1000.0;  // mean spacing of the records
+    b6::SysInfo m_sysInfo;
+    std::chrono::steady_clock::time_point m_started;
+    std::size_t m_next = 0;
+    bool m_stopped = false;
+    b6::ChargeInfo m_info;
+};
+
+#endif // REPLAYDEVICE_H
@@ -0,0 +1,131 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QHBoxLayout>
+#include <QTime>
+#include "replaywidget.h"
+
+static QString clock(double timeMs) {
+    return QTime(0, 0, 0).addSecs(static_cast<int>(timeMs / 1000)).toString("hh:mm:ss");
+}
+
+ReplayWidget::ReplayWidget(QWidget *parent) : QWidget(parent) {
+    m_timer = new QTimer(this);
+    m_timer->setInterval(TICK_MS);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(onTick()));
+
+    m_play = new QPushButton("Play", this);
+    m_play->setCheckable(true);
+    m_slider = new QSlider(Qt::Horizontal, this);
+    m_slider->setToolTip("Drag to any point of the charge");
+    m_speed = new QSpinBox(this);
+    m_speed->setRange(1, 1000);
+    m_speed->setValue(60);
+    m_speed->setSuffix("x");
+    m_speed->setToolTip("Playback speed");
+    m_time = new QLabel(this);
+    m_showAll = new QPushButton("Show all", this);
+    m_showAll->setToolTip("Show the whole charge again");
+    connect(m_play, SIGNAL(toggled(bool)), this, SLOT(onPlayToggled(bool)));
+    connect(m_slider, SIGNAL(valueChanged(int)), this, SLOT(onSliderMoved(int)));
+    connect(m_showAll, SIGNAL(clicked()), this, SLOT(onShowAllClicked()));
+
+    QHBoxLayout *layout = new QHBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_play);
+    layout->addWidget(m_slider, 1);
+    layout->addWidget(m_time);
+    layout->addWidget(m_speed);
+    layout->addWidget(m_showAll);
+
+    setSession(nullptr);
+}
+
+void ReplayWidget::setSession(ChargerSession *session) {
+    m_play->setChecked(false);
+    m_setActive(false);
+    m_replay.close();
+
+    // the log of a replay session is named in its spec, see ChargerDevice::fromSpec()
+    if (session != nullptr && session->isReplay()) {
+        m_replay.open(session->deviceSpec().mid(7).section(',', 0, 0).toStdString());
+    }
+    setEnabled(m_replay.isOpen());
+    m_slider->blockSignals(true);
+    m_slider->setRange(0, m_replay.isOpen() ? static_cast<int>(m_replay.endMs() / 1000) : 0);
+    m_slider->setValue(m_slider->maximum());
+    m_slider->blockSignals(false);
+    m_positionMs = m_replay.isOpen() ? m_replay.endMs() : 0.0;
+    m_time->setText(m_replay.isOpen() ? clock(m_positionMs) + " / " + clock(m_replay.endMs()) : QString("-"));
+}
+
+void ReplayWidget::onSliderMoved(int value) {
+    m_setPosition(value * 1000.0);
+}
+
+void ReplayWidget::onPlayToggled(bool playing) {
+    if (!playing) {
+        m_timer->stop();
+        m_play->setText("Play");
+        return;
+    }
+    // from the start again once it ran to the end
+    if (m_positionMs >= m_replay.endMs()) {
+        m_positionMs = m_replay.startMs();
+    }
+    m_play->setText("Pause");
+    m_clock.start();
+    m_timer->start();
+    m_setPosition(m_positionMs);
+}
+
+void ReplayWidget::onShowAllClicked() {
+    m_play->setChecked(false);
+    m_setActive(false);
+}
+
+void ReplayWidget::onTick() {
+    // by the wall clock, so a late tick does not slow the playback down
+    const double positionMs = m_positionMs + m_clock.restart() * static_cast<double>(m_speed->value());
+    if (positionMs >= m_replay.endMs()) {
+        m_setPosition(m_replay.endMs());
+        m_play->setChecked(false);
+        return;
+    }
+    m_setPosition(positionMs);
+}
+
+void ReplayWidget::m_setPosition(double timeMs) {
+    if (!m_replay.isOpen()) {
+        return;
+    }
+    m_positionMs = timeMs;
+    m_replay.seek(m_replay.indexAt(static_cast<uint32_t>(timeMs)));
+    m_slider->blockSignals(true);
+    m_slider->setValue(static_cast<int>(timeMs / 1000));
+    m_slider->blockSignals(false);
+    m_time->setText(clock(timeMs) + " / " + clock(m_replay.endMs()));
+    m_setActive(true);
+    emit positionChanged();
+}
+
+void ReplayWidget::m_setActive(bool active) {
+    if (active != m_active) {
+        m_active = active;
+        emit activeChanged(active);
+    }
+}
@@ -0,0 +1,75 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef REPLAYWIDGET_H
+#define REPLAYWIDGET_H
+
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QPushButton>
+#include <QSlider>
+#include <QSpinBox>
+#include <QTimer>
+#include <QWidget>
+#include "chargersession.h"
+#include "sessionreplay.h"
+
+/*
+ * Scrubbing through the charge of a replay session: a slider over the whole
+ * recording and playback at 1x to 1000x. Moves go through a SessionReplay,
+ * so a jump anywhere costs the same as a step. Once it is moved the replay
+ * is active and the main window shows the charge as it stood at its
+ * position, until Show all hands the view back to the session.
+ */
+class ReplayWidget : public QWidget {
+    Q_OBJECT
+public:
+    explicit ReplayWidget(QWidget *parent = 0);
+
+    // replay sessions can be scrubbed through, the controls are disabled for any other
+    void setSession(ChargerSession *session);
+    bool isActive() const { return m_active; }
+    const SessionReplay &replay() const { return m_replay; }
+
+signals:
+    void positionChanged();
+    void activeChanged(bool active);
+
+private slots:
+    void onSliderMoved(int value);
+    void onPlayToggled(bool playing);
+    void onShowAllClicked();
+    void onTick();
+
+private:
+    static const int TICK_MS = 50;
+
+    SessionReplay m_replay;
+    bool m_active = false;
+    double m_positionMs = 0.0;
+    QElapsedTimer m_clock;
+    QTimer *m_timer;
+    QPushButton *m_play, *m_showAll;
+    QSlider *m_slider;
+    QSpinBox *m_speed;
+    QLabel *m_time;
+
+    void m_setPosition(double timeMs);
+    void m_setActive(bool active);
+};
+
+#endif // REPLAYWIDGET_H
@@ -0,0 +1,178 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "samplingpolicy.h"
+
+// measured interval per read time, so a poll never waits on the one before
+static const double READ_HEADROOM = 2.0;
+static const std::size_t MIN_TIMED_READS = 8;
+
+static const double CURRENT_TAU_MS = 10000.0;
+static const double CURRENT_STEP_MA = 30.0;
+static const double CURRENT_STEP_FRACTION = 0.03;
+static const int CELL_STEP_MV = 10;
+static const int EMPTY_CELL_MV = 400;
+static const uint32_t HOLD_MS = 10000;
+// the current ramps and the voltage jumps at the start, taper and peak only count after this
+static const uint32_t SETTLE_MS = 60000;
+static const double TAPER_FRACTION = 0.9;
+// a rise smaller than this is noise, not a new peak
+static const int PEAK_STEP_MV = 2;
+static const uint32_t PEAK_HOLD_MS = 60000;
+// below the peak by more than this the voltage is falling away, e.g. in a discharge
+static const double NEAR_PEAK_FRACTION = 0.005;
+
+SamplingPolicy::Mode SamplingPolicy::m_defaultMode = SamplingPolicy::ADAPTIVE;
+
+void SamplingPolicy::setDefaultMode(Mode mode) {
+    m_defaultMode = mode;
+}
+
+bool SamplingPolicy::parseMode(const std::string &name, Mode &mode) {
+    static const char *const names[] = { "fixed", "adaptive", "fast" };
+    for (int i = 0; i < 3; i++) {
+        if (name == names[i]) {
+            mode = static_cast<Mode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+SamplingPolicy::SamplingPolicy() : m_mode(m_defaultMode) {
+}
+
+void SamplingPolicy::reset(int slowMs, int fastLimitMs) {
+    m_slowMs = slowMs;
+    m_fastLimitMs = fastLimitMs;
+    m_fast = m_mode == FAST;
+    m_readCount = 0;
+    m_sustainableMs = 0;
+    m_charging = false;
+}
+
+void SamplingPolicy::recordRead(uint64_t nanoseconds) {
+    m_reads[m_readCount % READS] = static_cast<uint32_t>(std::min<uint64_t>(nanoseconds / 1000, std::numeric_limits<uint32_t>::max()));
+    m_readCount++;
+    if (m_readCount < MIN_TIMED_READS) {
+        return;
+    }
+
+    uint32_t reads[READS];
+    const std::size_t count = std::min(m_readCount, static_cast<std::size_t>(READS));
+    std::copy(m_reads, m_reads + count, reads);
+    std::nth_element(reads, reads + count * 9 / 10, reads + count);
+    m_sustainableMs = std::max(1, static_cast<int>(std::ceil(reads[count * 9 / 10] * READ_HEADROOM / 1000.0)));
+}
+
+int SamplingPolicy::update(uint32_t timeMs, const b6::ChargeInfo &info) {
+    if (m_mode != ADAPTIVE) {
+        m_fast = m_mode == FAST;
+        return intervalMs();
+    }
+    if (info.state != static_cast<uint8_t>(b6::STATE::CHARGING)) {
+        m_charging = false;
+        m_fast = false;
+        return intervalMs();
+    }
+
+    if (!m_charging || timeMs < m_lastTime) {
+        m_startCharge(timeMs, info);
+    }
+    m_fast = m_wantsFast(timeMs, info);
+    m_last = info;
+    m_lastTime = timeMs;
+    return intervalMs();
+}
+
+int SamplingPolicy::fastIntervalMs() const {
+    const int limit = m_fastLimitMs > 0 ? m_fastLimitMs : m_sustainableMs;
+    if (limit <= 0) {
+        return m_slowMs;
+    }
+    return std::min(m_slowMs, std::max(static_cast<int>(MIN_INTERVAL_MS), limit));
+}
+
+void SamplingPolicy::m_startCharge(uint32_t timeMs, const b6::ChargeInfo &info) {
+    m_charging = true;
+    m_last = info;
+    m_lastTime = timeMs;
+    m_averageCurrent = info.current;
+    m_peakCurrent = info.current;
+    m_holdUntil = 0;
+    m_peakVoltage = info.voltage;
+    m_peakTime = timeMs;
+}
+
+bool SamplingPolicy::m_wantsFast(uint32_t timeMs, const b6::ChargeInfo &info) {
+    bool step = std::fabs(info.current - m_averageCurrent) > std::max(CURRENT_STEP_MA, CURRENT_STEP_FRACTION * m_averageCurrent);
+    for (int i = 0; i < 8; i++) {
+        if (info.cells[i] > EMPTY_CELL_MV && m_last.cells[i] > EMPTY_CELL_MV &&
+                std::abs(info.cells[i] - m_last.cells[i]) > CELL_STEP_MV) {
+            step = true;
+        }
+    }
+
+    const double dt = timeMs - m_lastTime;
+    m_averageCurrent += (info.current - m_averageCurrent) * (1.0 - std::exp(-dt / CURRENT_TAU_MS));
+    m_peakCurrent = std::max(m_peakCurrent, static_cast<int>(info.current));
+
+    const bool settled = timeMs >= SETTLE_MS;
+    const bool taper = settled && info.current < TAPER_FRACTION * m_peakCurrent;
+    if (info.voltage > m_peakVoltage + PEAK_STEP_MV) {
+        m_peakVoltage = info.voltage;
+        m_peakTime = timeMs;
+    }
+    const bool atPeak = settled && timeMs - m_peakTime >= PEAK_HOLD_MS &&
+                        info.voltage >= m_peakVoltage * (1.0 - NEAR_PEAK_FRACTION);
+    // every trigger holds fast polling for a while, so a reading hovering on a threshold does not flap it
+    if (step || taper || atPeak) {
+        m_holdUntil = timeMs + HOLD_MS;
+    }
+    return timeMs < m_holdUntil;
+}
+
+uint32_t SampleClock::stamp(int chargeSeconds, int64_t hostMs) {
+    const int64_t first = static_cast<int64_t>(chargeSeconds) * 1000;
+    const int64_t last = first + 999;
+    if (!m_valid || chargeSeconds < m_lastSeconds) {
+        m_valid = true;
+        m_offset = hostMs - first;
+        m_lastStamp = -1;
+    }
+
+    int64_t time = hostMs - m_offset;
+    if (time < first) {
+        // the charger ticked on before the host clock did
+        m_offset = hostMs - first;
+        time = first;
+    } else if (time > last) {
+        m_offset = hostMs - last;
+        time = last;
+    }
+    if (time <= m_lastStamp) {
+        time = std::min(m_lastStamp + 1, last);
+    }
+    m_lastSeconds = chargeSeconds;
+    m_lastStamp = time;
+    return static_cast<uint32_t>(time);
+}
@@ -0,0 +1,116 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SAMPLINGPOLICY_H
+#define SAMPLINGPOLICY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <b6/Device.hh>
+
+/*
+ * Picks how often the acquisition worker polls a charger. FIXED keeps the
+ * charger's own interval (1 s for a B6). FAST polls at the shortest interval
+ * the charger sustains. ADAPTIVE, the default, polls fast only while the
+ * charge is doing something worth resolving:
+ * - a current step or a cell dip between two samples, held for a few seconds;
+ * - the current tapering below its peak, as in the CV phase or towards the
+ *   end of a charge;
+ * - the voltage holding near its peak without rising, as before the -dV
+ *   knee of a NiMH charge or in the CV phase.
+ * It stays at the slow interval while idle or in a steady CC phase.
+ *
+ * A charger that does not state its shortest interval is measured instead:
+ * the 90th percentile of its recent reads times READ_HEADROOM. It is held at
+ * the slow interval until enough reads have been timed.
+ */
+class SamplingPolicy {
+public:
+    enum Mode { FIXED, ADAPTIVE, FAST };
+
+    // no faster than 50 Hz, whatever the charger answers
+    static const int MIN_INTERVAL_MS = 20;
+
+    // mode of policies created from now on
+    static void setDefaultMode(Mode mode);
+    // "fixed", "adaptive" or "fast"
+    static bool parseMode(const std::string &name, Mode &mode);
+
+    SamplingPolicy();
+
+    Mode mode() const { return m_mode; }
+    // slowMs is the charger's own interval, fastLimitMs the shortest it takes or 0 to measure it
+    void reset(int slowMs, int fastLimitMs);
+    void recordRead(uint64_t nanoseconds);
+    // takes a new sample and returns the interval until the next poll
+    int update(uint32_t timeMs, const b6::ChargeInfo &info);
+
+    int intervalMs() const { return m_fast ? fastIntervalMs() : m_slowMs; }
+    int fastIntervalMs() const;
+    // shortest interval the charger was measured to sustain, 0 until known
+    int sustainableMs() const { return m_sustainableMs; }
+    bool isFast() const { return m_fast; }
+
+private:
+    static const std::size_t READS = 64;
+    static Mode m_defaultMode;
+
+    Mode m_mode;
+    int m_slowMs = 1000;
+    int m_fastLimitMs = 0;
+    bool m_fast = false;
+
+    uint32_t m_reads[READS];        // read times in µs, a ring
+    std::size_t m_readCount = 0;
+    int m_sustainableMs = 0;
+
+    // the charge as the adaptive mode follows it
+    bool m_charging = false;
+    b6::ChargeInfo m_last;
+    uint32_t m_lastTime = 0;
+    double m_averageCurrent = 0.0;
+    int m_peakCurrent = 0;
+    uint32_t m_holdUntil = 0;
+    int m_peakVoltage = 0;
+    uint32_t m_peakTime = 0;        // when the voltage last rose past its peak
+
+    void m_startCharge(uint32_t timeMs, const b6::ChargeInfo &info);
+    bool m_wantsFast(uint32_t timeMs, const b6::ChargeInfo &info);
+};
+
+/*
+ * Stamps samples with the time of the charge in ms. The charger only counts
+ * whole seconds, so the host's monotonic clock places each sample within the
+ * second the charger reported: its offset is pulled back into that second
+ * whenever it drifts out, so stamps never contradict the charger and keep
+ * ascending within a second. A charge time that goes backwards starts over.
+ */
+class SampleClock {
+public:
+    void reset() { m_valid = false; }
+    uint32_t stamp(int chargeSeconds, int64_t hostMs);
+
+private:
+    bool m_valid = false;
+    int64_t m_offset = 0;           // host ms at charge time 0
+    int m_lastSeconds = 0;
+    int64_t m_lastStamp = -1;
+};
+
+#endif // SAMPLINGPOLICY_H
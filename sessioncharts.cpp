@@ -0,0 +1,617 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "diagnostics.h"
+#include "sessioncharts.h"
+
+SessionCharts::SessionCharts(ChargerSession *session) : QObject(session), m_session(session) {
+    connect(session, SIGNAL(samplesAppended()), this, SLOT(onSamplesAppended()));
+    connect(session, SIGNAL(samplesCleared()), this, SLOT(onSamplesCleared()));
+    connect(session, SIGNAL(sysInfoLoaded(b6::SysInfo)), this, SLOT(onSysInfoLoaded(b6::SysInfo)));
+
+    m_render = new RenderScheduler(this);
+    connect(m_render, SIGNAL(viewChanged(QChart*)), this, SLOT(onViewChanged(QChart*)));
+
+    m_seriesCurrent = new QLineSeries();
+    m_seriesCurrent->setName("Current (mA)");
+    m_seriesCurrent->setColor(QColor(0xff, 0x00, 0x00));
+
+    m_seriesVoltage = new QLineSeries();
+    m_seriesVoltage->setName("Voltage (mV)");
+    m_seriesVoltage->setColor(QColor(0x00, 0x00, 0xff));
+
+    m_seriesCapacity = new QLineSeries();
+    m_seriesCapacity->setName("Capacity (mAh)");
+    m_seriesCapacity->setColor(QColor(0x00, 0xff, 0x00));
+
+    m_seriesTempExt = new QLineSeries();
+    m_seriesTempExt->setName("Temperature External");
+
+    m_seriesTempInt = new QLineSeries();
+    m_seriesTempInt->setName("Temperature Internal");
+
+    m_chartCurrent = new QChart();
+    m_chartCurrent->addSeries(m_seriesCurrent);
+
+    m_chartVoltage = new QChart();
+    m_chartVoltage->addSeries(m_seriesVoltage);
+
+    m_chartCapacity = new QChart();
+    m_chartCapacity->addSeries(m_seriesCapacity);
+
+    m_chartTemp = new QChart();
+    m_chartTemp->addSeries(m_seriesTempInt);
+
+    m_chartCellsVoltage = new QChart();
+
+    m_chartCurrent->createDefaultAxes();
+    m_chartCurrent->axes(Qt::Vertical).at(0)->setRange(0.0, 6.0);
+    m_chartCurrent->setTitle("Current (A)");
+    m_chartCurrent->legend()->hide();
+
+    m_chartVoltage->createDefaultAxes();
+    m_chartVoltage->axes(Qt::Vertical).at(0)->setRange(0.0, 4.5);
+    m_chartVoltage->setTitle("Voltage (V)");
+    m_chartVoltage->legend()->hide();
+
+    m_chartCapacity->createDefaultAxes();
+    m_chartCapacity->axes(Qt::Vertical).at(0)->setRange(0, 6000);
+    m_chartCapacity->setTitle("Capacity (mAh)");
+    m_chartCapacity->legend()->hide();
+
+    // from the last sample to the forecast end of the charge, see m_plotForecast()
+    m_seriesForecast = new QLineSeries();
+    m_seriesForecast->setName("Forecast (mAh)");
+    m_seriesForecast->setPen(QPen(QColor(0x00, 0xa0, 0x00), 1.0, Qt::DashLine));
+    m_seriesForecastLow = new QLineSeries(this);
+    m_seriesForecastHigh = new QLineSeries(this);
+    m_seriesForecastBand = new QAreaSeries(m_seriesForecastHigh, m_seriesForecastLow);
+    m_seriesForecastBand->setName("Forecast band");
+    m_seriesForecastBand->setPen(Qt::NoPen);
+    m_seriesForecastBand->setBrush(QColor(0x00, 0xff, 0x00, 0x30));
+    QAbstractSeries *forecastSeries[] = { m_seriesForecastBand, m_seriesForecast };
+    for (QAbstractSeries *series : forecastSeries) {
+        m_chartCapacity->addSeries(series);
+        series->attachAxis(m_chartCapacity->axes(Qt::Horizontal).at(0));
+        series->attachAxis(m_chartCapacity->axes(Qt::Vertical).at(0));
+    }
+
+    m_chartTemp->createDefaultAxes();
+    m_chartTemp->axes(Qt::Vertical).at(0)->setRange(20, 80);
+
+    // nothing is on screen until the main window selects this session
+    m_render->setChartVisible(m_chartCurrent, false);
+    m_render->setChartVisible(m_chartVoltage, false);
+    m_render->setChartVisible(m_chartCapacity, false);
+    m_render->setChartVisible(m_chartTemp, false);
+    m_render->setChartVisible(m_chartCellsVoltage, false);
+
+    for (int i = 0; i < 8; i++) {
+        m_seriesCellsVoltage[i] = new QLineSeries();
+        m_seriesCellsVoltage[i]->setName(QString("Cell %1 (V)").arg(i+1));
+        m_columnCells[i] = m_addColumn(TelemetryStore::CELL, i, 0.001);
+        m_addAligned(m_seriesCellsVoltage[i], m_columnCells[i]);
+    }
+
+    // the cell spread goes on its chart with the cells, see m_plotSample()
+    m_columnVoltageSlope = m_addColumn(AnalyticsColumn::VOLTAGE_SLOPE);
+    m_seriesVoltageSlope = m_createOverlay("dV/dt (mV/min)", QColor(0x80, 0x80, 0xff), &m_axisVoltageSlope);
+    m_addOverlay(m_chartVoltage, m_seriesVoltageSlope, m_axisVoltageSlope);
+    m_addAligned(m_seriesVoltageSlope, m_columnVoltageSlope);
+    m_columnCellSpread = m_addColumn(AnalyticsColumn::CELL_SPREAD);
+    m_seriesCellSpread = m_createOverlay("Cell spread (mV)", QColor(0x80, 0x80, 0x80), &m_axisCellSpread);
+    m_addAligned(m_seriesCellSpread, m_columnCellSpread);
+
+    m_render->addSeries(m_seriesCurrent, m_addColumn(TelemetryStore::CURRENT, 0, 0.001));
+    m_addAligned(m_seriesVoltage, m_addColumn(TelemetryStore::VOLTAGE, 0, 0.001));
+    m_render->addSeries(m_seriesCapacity, m_addColumn(TelemetryStore::CAPACITY));
+    m_render->addSeries(m_seriesTempInt, m_addColumn(TelemetryStore::TEMP_INT));
+
+    // the session may already hold a charge, e.g. one recovered from its log
+    onSamplesAppended();
+}
+
+SessionCharts::~SessionCharts() {
+    if (m_pastThread != nullptr) {
+        m_pastThread->quit();
+        m_pastThread->wait();
+    }
+
+    // series that are not on a chart at the moment are still ours
+    for (int i = 0; i < 8; i++) {
+        if (m_seriesCellsVoltage[i]->chart() == nullptr) {
+            delete m_seriesCellsVoltage[i];
+        }
+    }
+    if (m_seriesTempExt->chart() == nullptr) {
+        delete m_seriesTempExt;
+    }
+    if (m_seriesCellSpread->chart() == nullptr) {
+        delete m_seriesCellSpread;
+        delete m_axisCellSpread;
+    }
+
+    delete m_chartCurrent;
+    delete m_chartVoltage;
+    delete m_chartCapacity;
+    delete m_chartTemp;
+    delete m_chartCellsVoltage;
+}
+
+void SessionCharts::setCapacityLimit(int capacity) {
+    m_chartCapacity->axes(Qt::Vertical).at(0)->setRange(0, capacity);
+}
+
+void SessionCharts::setOverlaysVisible(bool visible) {
+    m_overlaysVisible = visible;
+    m_seriesVoltageSlope->setVisible(visible);
+    m_axisVoltageSlope->setVisible(visible);
+    m_seriesCellSpread->setVisible(visible);
+    m_axisCellSpread->setVisible(visible);
+    m_seriesForecast->setVisible(visible);
+    m_seriesForecastBand->setVisible(visible);
+}
+
+void SessionCharts::setPastCharges(const QStringList &logs) {
+    m_pastGeneration++;
+    m_resampling = false;
+    m_resamplePending = false;
+    m_clearPastSeries();
+    m_pastExtent = ChargeOverlay::Extent();
+    m_replot();
+
+    if (m_resampler == nullptr) {
+        if (logs.isEmpty()) {
+            return;
+        }
+        m_pastThread = new QThread(this);
+        m_resampler = new OverlayResampler();
+        m_resampler->moveToThread(m_pastThread);
+        connect(m_pastThread, SIGNAL(finished()), m_resampler, SLOT(deleteLater()));
+        connect(m_resampler, SIGNAL(loaded(int,int,ChargeOverlay::Extent)),
+                this, SLOT(onPastChargesLoaded(int,int,ChargeOverlay::Extent)));
+        connect(m_resampler, SIGNAL(resampled(OverlayCurves)), this, SLOT(onPastChargesResampled(OverlayCurves)));
+        m_pastThread->start();
+    }
+    // an empty list unmaps the logs of the previous one
+    QMetaObject::invokeMethod(m_resampler, "load", Qt::QueuedConnection,
+                              Q_ARG(int, m_pastGeneration), Q_ARG(QStringList, logs));
+}
+
+void SessionCharts::setAlignment(ChargeOverlay::Alignment alignment) {
+    if (alignment == m_alignment) {
+        return;
+    }
+    m_alignment = alignment;
+    for (const Aligned &aligned : m_aligned) {
+        m_render->removeSeries(aligned.series);
+        m_render->addSeries(aligned.series, alignment == ChargeOverlay::ALIGN_TIME ? aligned.time : aligned.capacity);
+    }
+    m_render->update();
+    // a range held on the other scale means nothing on this one
+    m_heldCharts.remove(m_chartVoltage);
+    m_heldCharts.remove(m_chartCellsVoltage);
+    m_replot();
+}
+
+void SessionCharts::setViewRange(QChart *chart, qreal min, qreal max) {
+    if (max <= min) {
+        return;
+    }
+    m_heldCharts.insert(chart);
+    m_render->setRange(chart, Qt::Horizontal, min, max);
+}
+
+void SessionCharts::followLive(QChart *chart) {
+    if (m_heldCharts.remove(chart)) {
+        m_replot();
+    }
+}
+
+void SessionCharts::setPlayhead(double timeS, int capacity) {
+    m_playheadS = std::max(0.0, timeS);
+    m_playheadCapacity = capacity;
+    m_replot();
+}
+
+void SessionCharts::clearPlayhead() {
+    if (m_playheadS >= 0.0) {
+        m_playheadS = -1.0;
+        m_replot();
+    }
+}
+
+void SessionCharts::onSysInfoLoaded(b6::SysInfo info) {
+    setCapacityLimit(info.capLimitOn ? info.capLimit : 10000);
+}
+
+void SessionCharts::onSamplesAppended() {
+    const TelemetryStore &store = m_session->store();
+    if (m_plotted == store.size()) {
+        return;
+    }
+
+    // axis tracking and LOD updates, the painting is timed separately
+    static LatencyHistogram &plotTime = Diagnostics::histogram("charts.plot");
+    LatencyHistogram::Scope timing(plotTime);
+    for (; m_plotted < store.size(); m_plotted++) {
+        m_plotSample(m_plotted);
+    }
+    m_plotForecast();
+    m_render->update();
+}
+
+void SessionCharts::onSamplesCleared() {
+    // the series, their LOD pyramids and the store's chunks are all kept for the next charge
+    m_plotted = 0;
+    for (const Aligned &aligned : m_aligned) {
+        aligned.capacity->reset();
+    }
+    m_render->reset();
+    m_heldCharts.clear();
+
+    for (int i = 0; i < 8; i++) {
+        if (m_seriesCellsVoltage[i]->chart() != nullptr) {
+            m_chartCellsVoltage->removeSeries(m_seriesCellsVoltage[i]);
+        }
+        m_seriesCellsVoltage[i]->clear();
+    }
+    if (m_seriesCellSpread->chart() != nullptr) {
+        // createDefaultAxes() would take the overlay's axis with it
+        m_chartCellsVoltage->removeSeries(m_seriesCellSpread);
+        m_chartCellsVoltage->removeAxis(m_axisCellSpread);
+    }
+    m_seriesCellSpread->clear();
+    m_seriesForecast->clear();
+    m_seriesForecastLow->clear();
+    m_seriesForecastHigh->clear();
+    m_CellsAvailable = false;
+    if (m_extTempAvailable) {
+        m_chartTemp->removeSeries(m_seriesTempExt);
+        m_seriesTempExt->clear();
+        m_chartTemp->createDefaultAxes();
+        m_extTempAvailable = false;
+    }
+
+    m_minCurrent = 100.0; m_maxCurrent = 0.0;
+    m_minVoltage = 100.0; m_maxVoltage = 0.0;
+    m_minCellVoltage = 10.0; m_maxCellVoltage = 0.0;
+    m_minCapacity = 10000; m_maxCapacity = 0;
+    m_minTempExt = 80; m_maxTempExt = 0;
+    m_minTempInt = 80; m_maxTempInt = 0;
+    m_minTime = 100000;
+    m_minVoltageSlope = 0.0; m_maxVoltageSlope = 0.0;
+    m_maxCellSpread = 0;
+}
+
+TelemetryColumn *SessionCharts::m_addColumn(TelemetryStore::Column column, int cell, double scale) {
+    TelemetryColumn *source = new TelemetryColumn(&m_session->store(), column, cell, scale);
+    m_columns.push_back(std::unique_ptr<LodSeries::Source>(source));
+    return source;
+}
+
+AnalyticsColumn *SessionCharts::m_addColumn(AnalyticsColumn::Figure figure) {
+    AnalyticsColumn *source = new AnalyticsColumn(&m_session->store(), figure);
+    m_columns.push_back(std::unique_ptr<LodSeries::Source>(source));
+    return source;
+}
+
+QLineSeries *SessionCharts::m_createOverlay(const QString &name, const QColor &color, QValueAxis **axis) {
+    QLineSeries *series = new QLineSeries();
+    series->setName(name);
+    series->setPen(QPen(color, 1.0, Qt::DashLine));
+    *axis = new QValueAxis();
+    (*axis)->setTitleText(name);
+    (*axis)->setLinePenColor(color);
+    (*axis)->setLabelsColor(color);
+    return series;
+}
+
+void SessionCharts::m_addOverlay(QChart *chart, QLineSeries *series, QValueAxis *axis) {
+    // after the chart's default axes exist, sharing their time axis
+    chart->addSeries(series);
+    chart->addAxis(axis, Qt::AlignRight);
+    series->attachAxis(chart->axes(Qt::Horizontal).at(0));
+    series->attachAxis(axis);
+    series->setVisible(m_overlaysVisible);
+    axis->setVisible(m_overlaysVisible);
+}
+
+void SessionCharts::m_addAligned(QXYSeries *series, const LodSeries::Source *source) {
+    CapacityAxis *capacity = new CapacityAxis(&m_session->store(), source);
+    m_columns.push_back(std::unique_ptr<LodSeries::Source>(capacity));
+    m_aligned.push_back({ series, source, capacity });
+    m_render->addSeries(series, m_alignment == ChargeOverlay::ALIGN_TIME ? source : capacity);
+}
+
+void SessionCharts::m_plotSample(std::size_t index) {
+    const TelemetryStore &store = m_session->store();
+    const int time = static_cast<int>(store.timeMs(index) / 1000);
+    const int capacity = store.capacity(index);
+    const int tempInt = store.tempInt(index);
+    const int tempExt = store.tempExt(index);
+    double cCurrent = (double)(store.current(index)) / 1000.0;
+    double cVoltage = (double)(store.voltage(index)) / 1000.0;
+    if(time < m_minTime) m_minTime = time;
+
+    if (cCurrent < m_minCurrent) m_minCurrent = cCurrent;
+    if (cCurrent > m_maxCurrent) m_maxCurrent = cCurrent;
+    if (cVoltage < m_minVoltage) m_minVoltage = cVoltage;
+    if (cVoltage > m_maxVoltage) m_maxVoltage = cVoltage;
+    if (capacity < m_minCapacity) m_minCapacity = capacity;
+    if (capacity > m_maxCapacity) m_maxCapacity = capacity;
+    if (tempInt < m_minTempInt) m_minTempInt = tempInt;
+    if (tempInt > m_maxTempInt) m_maxTempInt = tempInt;
+    if (tempExt < m_minTempExt) m_minTempExt = tempExt;
+    if (tempExt > m_maxTempExt) m_maxTempExt = tempExt;
+
+    if(m_maxTempExt > 0){
+        if(!m_extTempAvailable){
+            m_extTempAvailable = true;
+            m_chartTemp->addSeries(m_seriesTempExt);
+            m_chartTemp->createDefaultAxes();
+        }
+    }
+
+    // the voltage and cell charts run against time or the capacity charged
+    const bool playhead = m_playheadS >= 0.0;
+    const double now = playhead ? m_playheadS : time;
+    const bool byCapacity = m_alignment == ChargeOverlay::ALIGN_CAPACITY;
+    const double alignedMin = byCapacity ? m_minCapacity : m_minTime;
+    const double alignedMax = byCapacity ? (playhead ? m_playheadCapacity : m_maxCapacity) : now;
+
+    m_setHorizontalRange(m_chartCurrent, m_minTime, now);
+    m_render->setRange(m_chartCurrent, Qt::Vertical, std::max(0.0, m_minCurrent - 0.5), m_maxCurrent + 0.5);
+
+    m_setHorizontalRange(m_chartVoltage, alignedMin, alignedMax);
+    m_setVerticalRange(m_chartVoltage, std::max(0.0, m_minVoltage - 0.5), m_maxVoltage + 0.5);
+    const double voltageSlope = m_columnVoltageSlope->at(index).y;
+    if (voltageSlope < m_minVoltageSlope) m_minVoltageSlope = voltageSlope;
+    if (voltageSlope > m_maxVoltageSlope) m_maxVoltageSlope = voltageSlope;
+    m_render->setRange(m_chartVoltage, m_axisVoltageSlope, m_minVoltageSlope - 1.0, m_maxVoltageSlope + 1.0);
+
+    m_setHorizontalRange(m_chartCapacity, m_minTime, now);
+    m_setVerticalRange(m_chartCapacity, std::max(0.0, m_minCapacity - 0.5), m_maxCapacity + 0.5);
+
+    m_setHorizontalRange(m_chartTemp, m_minTime, now);
+    if(!m_extTempAvailable){
+        m_render->setRange(m_chartTemp, Qt::Vertical, std::max(0.0, m_minTempInt - 0.5), m_maxTempInt + 0.5);
+    }else{
+        m_render->setRange(m_chartTemp, Qt::Vertical, std::max(0.0, std::min(m_minTempInt, m_minTempExt) - 0.5), std::max(m_maxTempInt, m_maxTempExt) + 0.5);
+    }
+
+    if(!m_CellsAvailable){
+        for (int i = 0; i < store.cellCount(); i++) {
+            double cellV = (double)(store.cell(i, index)) / 1000.0;
+            if(cellV > 0.4){
+                m_chartCellsVoltage->addSeries(m_seriesCellsVoltage[i]);
+                m_CellsAvailable = true;
+            }
+        }
+        if(m_CellsAvailable){
+            m_chartCellsVoltage->createDefaultAxes();
+            m_render->setRange(m_chartCellsVoltage, Qt::Vertical, 2.0, 4.5);
+            m_addOverlay(m_chartCellsVoltage, m_seriesCellSpread, m_axisCellSpread);
+        }
+    }
+    if(m_CellsAvailable){
+        m_setHorizontalRange(m_chartCellsVoltage, alignedMin, alignedMax);
+        double min = 10.0;
+        double max = 0.0;
+        for (int i = 0; i < store.cellCount(); i++) {
+            double cellV = (double)(store.cell(i, index)) / 1000.0;
+            if(cellV > 0.4){
+                if(cellV < min) min = cellV;
+                if(cellV > max) max = cellV;
+            }
+        }
+        if(max > m_maxCellVoltage) m_maxCellVoltage = max;
+        if(min < m_minCellVoltage) m_minCellVoltage = min;
+        double diff = m_maxCellVoltage-m_minCellVoltage;
+        m_setVerticalRange(m_chartCellsVoltage, m_minCellVoltage - std::max(0.02,diff), m_maxCellVoltage + std::max(0.02,diff));
+        m_maxCellSpread = std::max(m_maxCellSpread, static_cast<int>(m_columnCellSpread->at(index).y));
+        m_render->setRange(m_chartCellsVoltage, m_axisCellSpread, 0, std::max(10, m_maxCellSpread * 5 / 4));
+    }
+}
+
+void SessionCharts::m_plotForecast() {
+    // a handful of points, replaced as a whole every time
+    const ChargeForecast::Forecast &forecast = m_session->forecast().forecast();
+    const TelemetryStore &store = m_session->store();
+    // a forecast is of the last sample, not of a playhead somewhere before it
+    if (!forecast.valid || store.empty() || m_playheadS >= 0.0) {
+        if (m_seriesForecast->count() > 0) {
+            m_seriesForecast->clear();
+            m_seriesForecastLow->clear();
+            m_seriesForecastHigh->clear();
+        }
+        return;
+    }
+
+    const double time = store.timeMs(store.size() - 1) / 1000.0;
+    const QPointF now(time, store.capacity(store.size() - 1));
+    m_seriesForecast->replace(QVector<QPointF>({ now, QPointF(time + forecast.remainingS, forecast.finalCapacity) }));
+    m_seriesForecastLow->replace(QVector<QPointF>({ now, QPointF(time + forecast.remainingLowS, forecast.finalCapacityLow) }));
+    m_seriesForecastHigh->replace(QVector<QPointF>({ now, QPointF(time + forecast.remainingHighS, forecast.finalCapacityHigh) }));
+
+    m_setHorizontalRange(m_chartCapacity, m_minTime, time + forecast.remainingHighS);
+    m_setVerticalRange(m_chartCapacity, std::max(0.0, m_minCapacity - 0.5),
+                       std::max(m_maxCapacity, forecast.finalCapacityHigh) + 0.5);
+}
+
+void SessionCharts::m_replot() {
+    // the last sample again, for ranges that changed without new samples
+    const TelemetryStore &store = m_session->store();
+    if (!store.empty()) {
+        m_plotSample(store.size() - 1);
+        m_plotForecast();
+        return;
+    }
+    if (m_pastExtent.empty) {
+        return;
+    }
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        QChart *chart = m_pastChart(figure);
+        m_setHorizontalRange(chart, 0.0, 0.0);
+        m_setVerticalRange(chart, m_pastExtent.min[figure], m_pastExtent.max[figure]);
+    }
+}
+
+void SessionCharts::m_setHorizontalRange(QChart *chart, double min, double max) {
+    // past charges are shown from their start to their end
+    if (!m_pastExtent.empty && m_pastFigure(chart) >= 0) {
+        min = std::min(min, 0.0);
+        max = std::max(max, m_pastExtent.x(m_chartAlignment(chart)));
+    }
+    if (!m_heldCharts.contains(chart)) {
+        m_render->setRange(chart, Qt::Horizontal, min, max);
+    }
+}
+
+void SessionCharts::m_setVerticalRange(QChart *chart, double min, double max) {
+    const int figure = m_pastFigure(chart);
+    if (!m_pastExtent.empty && figure >= 0) {
+        min = std::min(min, m_pastExtent.min[figure]);
+        max = std::max(max, m_pastExtent.max[figure]);
+    }
+    m_render->setRange(chart, Qt::Vertical, min, max);
+}
+
+void SessionCharts::onViewChanged(QChart *chart) {
+    if (m_pastFigure(chart) >= 0) {
+        m_requestResample();
+    }
+}
+
+void SessionCharts::onPastChargesLoaded(int generation, int curves, ChargeOverlay::Extent extent) {
+    if (generation != m_pastGeneration) {
+        return;
+    }
+    m_pastExtent = extent;
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        QChart *chart = m_pastChart(figure);
+        for (int i = 0; i < curves; i++) {
+            // newest first, the older a charge the fainter its curve
+            QLineSeries *series = new QLineSeries();
+            series->setPen(QPen(QColor(0x60, 0x60, 0x60, 0xa0 - 0x70 * i / std::max(1, curves - 1)), 1.0));
+            chart->addSeries(series);
+            if (!chart->axes(Qt::Horizontal).isEmpty() && !chart->axes(Qt::Vertical).isEmpty()) {
+                series->attachAxis(chart->axes(Qt::Horizontal).at(0));
+                series->attachAxis(chart->axes(Qt::Vertical).at(0));
+            }
+            for (QLegendMarker *marker : chart->legend()->markers(series)) {
+                marker->setVisible(false);
+            }
+            m_pastSeries[figure].push_back(series);
+        }
+        // the cell chart has no axes before the first cell voltage comes in
+        if (curves > 0 && chart->axes(Qt::Horizontal).isEmpty()) {
+            chart->createDefaultAxes();
+        }
+    }
+    m_replot();
+    m_requestResample();
+}
+
+void SessionCharts::onPastChargesResampled(OverlayCurves curves) {
+    if (curves.generation != m_pastGeneration) {
+        return;
+    }
+    static LatencyHistogram &replaceTime = Diagnostics::histogram("charts.overlay");
+    LatencyHistogram::Scope timing(replaceTime);
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        if (curves.points[figure].size() != static_cast<int>(m_pastSeries[figure].size())) {
+            continue;
+        }
+        for (std::size_t i = 0; i < m_pastSeries[figure].size(); i++) {
+            m_pastSeries[figure][i]->replace(curves.points[figure][static_cast<int>(i)]);
+        }
+    }
+
+    // the range moved while this one was under way
+    m_resampling = false;
+    if (m_resamplePending) {
+        m_requestResample();
+    }
+}
+
+QChart *SessionCharts::m_pastChart(int figure) const {
+    switch (figure) {
+    case ChargeOverlay::VOLTAGE:
+        return m_chartVoltage;
+    case ChargeOverlay::CAPACITY:
+        return m_chartCapacity;
+    default:
+        return m_chartCellsVoltage;
+    }
+}
+
+int SessionCharts::m_pastFigure(QChart *chart) const {
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        if (m_pastChart(figure) == chart) {
+            return figure;
+        }
+    }
+    return -1;
+}
+
+ChargeOverlay::Alignment SessionCharts::m_chartAlignment(QChart *chart) const {
+    // capacity against capacity says nothing, that chart stays on time
+    return chart == m_chartCapacity ? ChargeOverlay::ALIGN_TIME : m_alignment;
+}
+
+void SessionCharts::m_clearPastSeries() {
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        for (QLineSeries *series : m_pastSeries[figure]) {
+            series->chart()->removeSeries(series);
+            delete series;
+        }
+        m_pastSeries[figure].clear();
+    }
+}
+
+void SessionCharts::m_requestResample() {
+    if (m_resampler == nullptr || m_pastSeries[0].empty()) {
+        return;
+    }
+    // one request under way at a time, the latest range goes next
+    if (m_resampling) {
+        m_resamplePending = true;
+        return;
+    }
+
+    OverlayRequest request;
+    request.generation = m_pastGeneration;
+    for (int figure = 0; figure < ChargeOverlay::FIGURES; figure++) {
+        QChart *chart = m_pastChart(figure);
+        request.alignment[figure] = m_chartAlignment(chart);
+        QValueAxis *axis = chart->axes(Qt::Horizontal).isEmpty() ? nullptr :
+                           qobject_cast<QValueAxis*>(chart->axes(Qt::Horizontal).at(0));
+        if (axis == nullptr || !m_render->isChartVisible(chart)) {
+            continue;
+        }
+        const int pixels = static_cast<int>(chart->plotArea().width());
+        request.xMin[figure] = axis->min();
+        request.xMax[figure] = axis->max();
+        request.buckets[figure] = pixels > 0 ? pixels : 1000;
+    }
+    m_resampling = true;
+    m_resamplePending = false;
+    QMetaObject::invokeMethod(m_resampler, "resample", Qt::QueuedConnection, Q_ARG(OverlayRequest, request));
+}
+
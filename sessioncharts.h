@@ -0,0 +1,162 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SESSIONCHARTS_H
+#define SESSIONCHARTS_H
+
+#include <memory>
+#include <vector>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include <QtCharts>
+#include "chargeanalytics.h"
+#include "chargersession.h"
+#include "overlayresampler.h"
+#include "renderscheduler.h"
+#include "telemetrystore.h"
+
+using namespace QtCharts;
+
+/*
+ * The charts of one ChargerSession. Follows the session's TelemetryStore and
+ * plots it through a RenderScheduler; series only hold what is on screen.
+ * Charts and series are created once and reused for every charge of the
+ * session. The voltage chart carries dV/dt and the cell chart the spread
+ * between the cells as overlays on a scale of their own; the capacity chart
+ * runs on past the last sample to the forecast end of the charge and its
+ * band. The main window only shows the charts of the selected session.
+ *
+ * Past charges can be laid over the voltage, capacity and cell charts, the
+ * cells as the highest one of each sample. An OverlayResampler maps their
+ * logs and hands back only what is in the visible range at the charts'
+ * resolution, again whenever that range moves. Aligned by capacity, the
+ * voltage and cell charts, live series included, run against the capacity
+ * charged instead of time. A chart the user zoomed or panned keeps its
+ * range until it is told to follow the live charge again.
+ *
+ * With a playhead set, e.g. while scrubbing through a replay, the charts end
+ * there instead of at the last sample, so only the samples up to it are
+ * queried and drawn.
+ */
+class SessionCharts : public QObject {
+    Q_OBJECT
+public:
+    explicit SessionCharts(ChargerSession *session);
+    ~SessionCharts();
+
+    QChart *chartCurrent() const { return m_chartCurrent; }
+    QChart *chartVoltage() const { return m_chartVoltage; }
+    QChart *chartCapacity() const { return m_chartCapacity; }
+    QChart *chartTemp() const { return m_chartTemp; }
+    QChart *chartCellsVoltage() const { return m_chartCellsVoltage; }
+    RenderScheduler *renderScheduler() const { return m_render; }
+
+    void setCapacityLimit(int capacity);
+    void setOverlaysVisible(bool visible);
+
+    // logs of the charges to lay over the live one, none to take them off
+    void setPastCharges(const QStringList &logs);
+    void setAlignment(ChargeOverlay::Alignment alignment);
+    ChargeOverlay::Alignment alignment() const { return m_alignment; }
+
+    // holds the chart at this horizontal range rather than following the charge
+    void setViewRange(QChart *chart, qreal min, qreal max);
+    void followLive(QChart *chart);
+
+    // capacity is what the charge had reached at timeS, for charts aligned by capacity
+    void setPlayhead(double timeS, int capacity);
+    void clearPlayhead();
+
+private slots:
+    void onSamplesAppended();
+    void onSamplesCleared();
+    void onSysInfoLoaded(b6::SysInfo info);
+    void onViewChanged(QChart *chart);
+    void onPastChargesLoaded(int generation, int curves, ChargeOverlay::Extent extent);
+    void onPastChargesResampled(OverlayCurves curves);
+
+private:
+    ChargerSession *m_session;
+    RenderScheduler *m_render;
+    std::size_t m_plotted = 0;
+
+    QChart *m_chartCurrent, *m_chartVoltage, *m_chartCapacity, *m_chartTemp, *m_chartCellsVoltage;
+    QLineSeries *m_seriesCurrent, *m_seriesVoltage, *m_seriesCapacity,
+                *m_seriesTempExt, *m_seriesTempInt, *m_seriesCellsVoltage[8];
+    QLineSeries *m_seriesVoltageSlope, *m_seriesCellSpread;
+    QValueAxis *m_axisVoltageSlope, *m_axisCellSpread;
+    QLineSeries *m_seriesForecast, *m_seriesForecastLow, *m_seriesForecastHigh;
+    QAreaSeries *m_seriesForecastBand;
+    std::vector<std::unique_ptr<LodSeries::Source>> m_columns;
+    TelemetryColumn *m_columnCells[8];
+    AnalyticsColumn *m_columnVoltageSlope, *m_columnCellSpread;
+    bool m_overlaysVisible = true;
+
+    // live series that follow the alignment, with their source for each
+    struct Aligned {
+        QXYSeries *series;
+        const LodSeries::Source *time;
+        CapacityAxis *capacity;
+    };
+    std::vector<Aligned> m_aligned;
+    ChargeOverlay::Alignment m_alignment = ChargeOverlay::ALIGN_TIME;
+    QSet<QChart*> m_heldCharts;
+    double m_playheadS = -1.0;
+    int m_playheadCapacity = 0;
+
+    QThread *m_pastThread = nullptr;
+    OverlayResampler *m_resampler = nullptr;
+    std::vector<QLineSeries*> m_pastSeries[ChargeOverlay::FIGURES];
+    ChargeOverlay::Extent m_pastExtent;
+    int m_pastGeneration = 0;
+    bool m_resampling = false, m_resamplePending = false;
+
+    double m_minCurrent = 100.0, m_maxCurrent = 0.0,
+           m_minVoltage = 100.0, m_maxVoltage = 0.0,
+           m_minCellVoltage = 100.0, m_maxCellVoltage = 0.0;
+    int m_minCapacity = 10000, m_maxCapacity = 0,
+        m_minTempExt = 80, m_maxTempExt = 0,
+        m_minTempInt = 80, m_maxTempInt = 0,
+        m_minTime = 100000;
+    double m_minVoltageSlope = 0.0, m_maxVoltageSlope = 0.0;
+    int m_maxCellSpread = 0;
+
+    bool m_extTempAvailable = false;
+    bool m_CellsAvailable = false;
+
+    TelemetryColumn *m_addColumn(TelemetryStore::Column column, int cell = 0, double scale = 1.0);
+    AnalyticsColumn *m_addColumn(AnalyticsColumn::Figure figure);
+    QLineSeries *m_createOverlay(const QString &name, const QColor &color, QValueAxis **axis);
+    void m_addOverlay(QChart *chart, QLineSeries *series, QValueAxis *axis);
+    void m_addAligned(QXYSeries *series, const LodSeries::Source *source);
+    void m_plotSample(std::size_t index);
+    void m_plotForecast();
+    void m_replot();
+    void m_setHorizontalRange(QChart *chart, double min, double max);
+    void m_setVerticalRange(QChart *chart, double min, double max);
+
+    QChart *m_pastChart(int figure) const;
+    int m_pastFigure(QChart *chart) const;
+    ChargeOverlay::Alignment m_chartAlignment(QChart *chart) const;
+    void m_clearPastSeries();
+    void m_requestResample();
+};
+
+#endif // SESSIONCHARTS_H
@@ -0,0 +1,317 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QVariant>
+#include "chargeprofiles.h"
+#include "diagnostics.h"
+#include "sessionhistory.h"
+
+static const char *COLUMNS = "id, pack, location, log, started_at, battery_type, mode, cells, outcome, capacity, "
+                             "duration, energy, max_temp, resistance, max_cell_delta, end_voltage";
+
+static ChargeSummary fromRow(const QSqlQuery &row) {
+    ChargeSummary summary;
+    summary.id = row.value(0).toLongLong();
+    summary.pack = row.value(1).toString().toStdString();
+    summary.location = row.value(2).toString().toStdString();
+    summary.log = row.value(3).toString().toStdString();
+    summary.startedAtMs = row.value(4).toLongLong();
+    summary.batteryType = row.value(5).toInt();
+    summary.mode = row.value(6).toInt();
+    summary.cellCount = row.value(7).toInt();
+    summary.outcome = static_cast<ChargeSummary::Outcome>(row.value(8).toInt());
+    summary.capacity = row.value(9).toInt();
+    summary.durationS = row.value(10).toInt();
+    summary.energyWh = row.value(11).toDouble();
+    summary.maxTemp = row.value(12).toInt();
+    summary.resistance = row.value(13).toDouble();
+    summary.maxCellDelta = row.value(14).toInt();
+    summary.endVoltage = row.value(15).toInt();
+    return summary;
+}
+
+static qint64 parseTime(const QString &text, bool *ok) {
+    QDateTime time = QDateTime::fromString(text, Qt::ISODate);
+    *ok = time.isValid();
+    return time.toMSecsSinceEpoch();
+}
+
+SessionHistory::SessionHistory(QObject *parent) :
+    QObject(parent),
+    m_connection(QString("history-%1").arg(reinterpret_cast<quintptr>(this), 0, 16))
+{
+}
+
+SessionHistory::~SessionHistory() {
+    if (QSqlDatabase::contains(m_connection)) {
+        QSqlDatabase::database(m_connection, false).close();
+        QSqlDatabase::removeDatabase(m_connection);
+    }
+}
+
+QString SessionHistory::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/history.sqlite";
+}
+
+bool SessionHistory::parseQuery(const QString &text, Query &query) {
+    query = Query();
+    for (const QString &part : text.split(',', QString::SkipEmptyParts)) {
+        const QString key = part.section('=', 0, 0).trimmed().toLower();
+        const QString value = part.section('=', 1).trimmed();
+        bool ok = true;
+        if (key == "pack") {
+            query.pack = value;
+        } else if (key == "type") {
+            b6::BATTERY_TYPE type;
+            ok = ChargeProfiles::parseBatteryType(value, type);
+            query.batteryType = static_cast<int>(type);
+        } else if (key == "min-cell-delta") {
+            query.minCellDelta = value.toInt(&ok);
+        } else if (key == "since") {
+            query.fromMs = parseTime(value, &ok);
+        } else if (key == "until") {
+            query.toMs = parseTime(value, &ok);
+        } else if (key == "completed") {
+            query.completedOnly = true;
+        } else if (key == "limit") {
+            query.limit = value.toInt(&ok);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SessionHistory::open(const QString &path) {
+    if (path != ":memory:") {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+    }
+
+    QSqlDatabase db = QSqlDatabase::contains(m_connection) ? QSqlDatabase::database(m_connection, false)
+                                                           : QSqlDatabase::addDatabase("QSQLITE", m_connection);
+    db.close();
+    db.setDatabaseName(path);
+    if (!db.open()) {
+        m_error = db.lastError().text();
+        return false;
+    }
+
+    // rows are added one at a time as charges end, WAL keeps that from blocking readers
+    return m_exec("PRAGMA journal_mode = WAL") &&
+           m_exec("PRAGMA synchronous = NORMAL") &&
+           m_exec("CREATE TABLE IF NOT EXISTS sessions ("
+                  "id INTEGER PRIMARY KEY, pack TEXT NOT NULL DEFAULT '', location TEXT NOT NULL DEFAULT '', "
+                  "log TEXT NOT NULL DEFAULT '', started_at INTEGER NOT NULL, battery_type INTEGER NOT NULL, "
+                  "mode INTEGER NOT NULL, cells INTEGER NOT NULL, outcome INTEGER NOT NULL, capacity INTEGER NOT NULL, "
+                  "duration INTEGER NOT NULL, energy REAL NOT NULL, max_temp INTEGER NOT NULL, resistance REAL NOT NULL, "
+                  "max_cell_delta INTEGER NOT NULL, end_voltage INTEGER NOT NULL)") &&
+           m_exec("CREATE INDEX IF NOT EXISTS sessions_pack ON sessions (pack, started_at)") &&
+           m_exec("CREATE INDEX IF NOT EXISTS sessions_started ON sessions (started_at)") &&
+           m_exec("CREATE INDEX IF NOT EXISTS sessions_type ON sessions (battery_type, max_cell_delta)") &&
+           m_exec("CREATE INDEX IF NOT EXISTS sessions_log ON sessions (log)");
+}
+
+bool SessionHistory::isOpen() const {
+    return QSqlDatabase::contains(m_connection) && QSqlDatabase::database(m_connection, false).isOpen();
+}
+
+void SessionHistory::watch(DeviceManager *devices) {
+    connect(devices, SIGNAL(sessionAdded(ChargerSession*)), this, SLOT(onSessionAdded(ChargerSession*)));
+    for (ChargerSession *session : devices->sessions()) {
+        onSessionAdded(session);
+    }
+}
+
+qint64 SessionHistory::add(const ChargeSummary &summary) {
+    const qint64 id = m_insert(summary);
+    if (id != 0) {
+        emit changed();
+    }
+    return id;
+}
+
+qint64 SessionHistory::m_insert(const ChargeSummary &summary) {
+    static LatencyHistogram &addTime = Diagnostics::histogram("history.add");
+    LatencyHistogram::Scope timing(addTime);
+
+    QSqlQuery insert(QSqlDatabase::database(m_connection, false));
+    insert.prepare("INSERT INTO sessions (pack, location, log, started_at, battery_type, mode, cells, outcome, capacity, "
+                   "duration, energy, max_temp, resistance, max_cell_delta, end_voltage) "
+                   "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    insert.addBindValue(QString::fromStdString(summary.pack));
+    insert.addBindValue(QString::fromStdString(summary.location));
+    insert.addBindValue(QString::fromStdString(summary.log));
+    insert.addBindValue(static_cast<qint64>(summary.startedAtMs));
+    insert.addBindValue(summary.batteryType);
+    insert.addBindValue(summary.mode);
+    insert.addBindValue(summary.cellCount);
+    insert.addBindValue(static_cast<int>(summary.outcome));
+    insert.addBindValue(summary.capacity);
+    insert.addBindValue(summary.durationS);
+    insert.addBindValue(summary.energyWh);
+    insert.addBindValue(summary.maxTemp);
+    insert.addBindValue(summary.resistance);
+    insert.addBindValue(summary.maxCellDelta);
+    insert.addBindValue(summary.endVoltage);
+    if (!insert.exec()) {
+        m_error = insert.lastError().text();
+        return 0;
+    }
+
+    return insert.lastInsertId().toLongLong();
+}
+
+QVector<ChargeSummary> SessionHistory::find(const Query &query) const {
+    static LatencyHistogram &findTime = Diagnostics::histogram("history.find");
+    LatencyHistogram::Scope timing(findTime);
+
+    QStringList where;
+    QVariantList values;
+    if (!query.pack.isEmpty()) {
+        where << "pack = ?";
+        values << query.pack;
+    }
+    if (query.batteryType >= 0) {
+        where << "battery_type = ?";
+        values << query.batteryType;
+    }
+    if (query.minCellDelta > 0) {
+        where << "max_cell_delta >= ?";
+        values << query.minCellDelta;
+    }
+    if (query.fromMs > 0) {
+        where << "started_at >= ?";
+        values << query.fromMs;
+    }
+    if (query.toMs > 0) {
+        where << "started_at < ?";
+        values << query.toMs;
+    }
+    if (query.completedOnly) {
+        where << "outcome = ?";
+        values << static_cast<int>(ChargeSummary::COMPLETED);
+    }
+
+    QString sql = QString("SELECT %1 FROM sessions").arg(COLUMNS);
+    if (!where.isEmpty()) {
+        sql += " WHERE " + where.join(" AND ");
+    }
+    if (query.limit > 0) {
+        sql += " ORDER BY started_at DESC LIMIT ?";
+        values << query.limit;
+    } else {
+        sql += " ORDER BY started_at";
+    }
+
+    QSqlQuery select(QSqlDatabase::database(m_connection, false));
+    select.setForwardOnly(true);
+    select.prepare(sql);
+    for (const QVariant &value : values) {
+        select.addBindValue(value);
+    }
+
+    QVector<ChargeSummary> summaries;
+    if (select.exec()) {
+        while (select.next()) {
+            summaries << fromRow(select);
+        }
+    }
+    return summaries;
+}
+
+bool SessionHistory::summary(qint64 id, ChargeSummary &out) const {
+    QSqlQuery select(QSqlDatabase::database(m_connection, false));
+    select.prepare(QString("SELECT %1 FROM sessions WHERE id = ?").arg(COLUMNS));
+    select.addBindValue(id);
+    if (!select.exec() || !select.next()) {
+        return false;
+    }
+    out = fromRow(select);
+    return true;
+}
+
+int SessionHistory::count() const {
+    QSqlQuery select("SELECT COUNT(*) FROM sessions", QSqlDatabase::database(m_connection, false));
+    return select.next() ? select.value(0).toInt() : 0;
+}
+
+int SessionHistory::importLogs(const QString &directory) {
+    QSet<QString> known;
+    QSqlQuery select("SELECT log FROM sessions WHERE log <> ''", QSqlDatabase::database(m_connection, false));
+    while (select.next()) {
+        known.insert(select.value(0).toString());
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(m_connection, false);
+    db.transaction();
+    int added = 0;
+    const QDir dir(directory);
+    for (const QString &name : dir.entryList(QStringList("*.cglog"), QDir::Files, QDir::Name)) {
+        const QString path = dir.absoluteFilePath(name);
+        ChargeSummary summary;
+        if (known.contains(path) || name.startsWith("replay-") || name.startsWith("sim-") ||
+                !ChargeSummary::fromLog(path.toStdString(), summary)) {
+            continue;
+        }
+        // named location_started.cglog by AcquisitionWorker
+        summary.location = name.section('_', 0, -2).toStdString();
+        if (m_insert(summary) != 0) {
+            added++;
+        }
+    }
+    db.commit();
+    if (added > 0) {
+        emit changed();
+    }
+    return added;
+}
+
+void SessionHistory::onSessionAdded(ChargerSession *session) {
+    connect(session, SIGNAL(chargeEnded()), this, SLOT(onChargeEnded()));
+}
+
+void SessionHistory::onChargeEnded() {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    // a start the charger never acted on, or one of a simulated or replayed charger
+    if (!isOpen() || session->summary().durationS == 0 || session->isVirtual()) {
+        return;
+    }
+    if (add(session->summary()) == 0) {
+        qWarning("cannot add the charge on %s to the history: %s", qPrintable(session->location()), qPrintable(m_error));
+    }
+}
+
+bool SessionHistory::m_exec(const QString &statement) {
+    QSqlQuery query(QSqlDatabase::database(m_connection, false));
+    if (!query.exec(statement)) {
+        m_error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SESSIONHISTORY_H
+#define SESSIONHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include "chargesummary.h"
+#include "devicemanager.h"
+
+/*
+ * On-disk history of charges: a SQLite database with a ChargeSummary row per
+ * charge, indexed by pack and start time, by start time alone and by battery
+ * type and cell delta, so the usual questions ("capacity of pack 42 over
+ * time", "Li-Hv charges with the cells more than 30 mV apart") are answered
+ * from the indexes. Samples are not copied in; a row names its session log,
+ * which is only read when the charge is opened. watch() records every charge
+ * of a DeviceManager's chargers as it ends.
+ */
+class SessionHistory : public QObject {
+    Q_OBJECT
+public:
+    struct Query {
+        QString pack;                   // any if empty
+        int batteryType = -1;           // any if -1
+        qint64 fromMs = 0;              // started at or after, ms since epoch, 0 for no bound
+        qint64 toMs = 0;                // started before
+        int minCellDelta = 0;           // mV
+        bool completedOnly = false;
+        int limit = 0;                  // newest first if set, 0 for all
+    };
+
+    explicit SessionHistory(QObject *parent = 0);
+    ~SessionHistory();
+
+    static QString defaultPath();
+    // "pack=42, type=lihv, min-cell-delta=30, since=2018-06-01, until=..., completed, limit=100"
+    static bool parseQuery(const QString &text, Query &query);
+
+    // creates the database and its tables if needed; ":memory:" for one that is not kept
+    bool open(const QString &path);
+    bool isOpen() const;
+    QString errorString() const { return m_error; }
+    void watch(DeviceManager *devices);
+
+    // returns the id of the new row, 0 on failure
+    qint64 add(const ChargeSummary &summary);
+    // oldest first unless query.limit is set
+    QVector<ChargeSummary> find(const Query &query) const;
+    bool summary(qint64 id, ChargeSummary &out) const;
+    int count() const;
+    // adds the session logs in directory that are not in the history yet, returns how many
+    int importLogs(const QString &directory);
+
+signals:
+    // rows were added
+    void changed();
+
+private slots:
+    void onSessionAdded(ChargerSession *session);
+    void onChargeEnded();
+
+private:
+    QString m_connection;
+    QString m_error;
+
+    bool m_exec(const QString &statement);
+    qint64 m_insert(const ChargeSummary &summary);
+};
+
+#endif // SESSIONHISTORY_H
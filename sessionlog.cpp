@@ -0,0 +1,340 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sessionlog.h"
+
+template <typename T>
+static T clampTo(int64_t value) {
+    return static_cast<T>(std::min<int64_t>(std::max<int64_t>(value, std::numeric_limits<T>::min()),
+                                            std::numeric_limits<T>::max()));
+}
+
+static bool writeAll(int fd, const void *data, std::size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+static bool readHeader(int fd, SessionLog::Header &header) {
+    if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        return false;
+    }
+    return std::memcmp(header.magic, SessionLog::MAGIC, sizeof(header.magic)) == 0 &&
+           header.version == SessionLog::VERSION &&
+           header.crc == SessionLog::crc32(&header, offsetof(SessionLog::Header, crc));
+}
+
+static std::array<uint32_t, 256> crcTable() {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+uint32_t SessionLog::crc32(const void *data, std::size_t size) {
+    static const std::array<uint32_t, 256> table = crcTable();
+
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xffffffffu;
+    for (std::size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+SessionLog::Record SessionLog::makeRecord(uint32_t timeMs, const b6::ChargeInfo &info) {
+    Record record;
+    std::memset(&record, 0, sizeof(record));
+    record.timeMs = timeMs;
+    record.capacity = clampTo<uint32_t>(info.capacity);
+    record.current = clampTo<int16_t>(info.current);
+    record.voltage = clampTo<uint16_t>(info.voltage);
+    for (int i = 0; i < 8; i++) {
+        record.cells[i] = clampTo<uint16_t>(info.cells[i]);
+    }
+    record.tempInt = clampTo<int8_t>(info.tempInt);
+    record.tempExt = clampTo<int8_t>(info.tempExt);
+    record.state = static_cast<uint8_t>(info.state);
+    record.crc = crc32(&record, offsetof(Record, crc));
+    return record;
+}
+
+b6::ChargeInfo SessionLog::toChargeInfo(const Record &record) {
+    b6::ChargeInfo info;
+    std::memset(&info, 0, sizeof(info));
+    info.state = record.state;
+    info.time = record.timeMs / 1000;
+    info.current = record.current;
+    info.voltage = record.voltage;
+    info.capacity = record.capacity;
+    info.tempInt = record.tempInt;
+    info.tempExt = record.tempExt;
+    for (int i = 0; i < 8; i++) {
+        info.cells[i] = record.cells[i];
+    }
+    return info;
+}
+
+bool SessionLog::isValid(const Record &record) {
+    return record.crc == crc32(&record, offsetof(Record, crc));
+}
+
+long SessionLog::recover(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    Header header;
+    struct stat st;
+    if (!readHeader(fd, header) || ::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    const std::size_t total = (static_cast<std::size_t>(st.st_size) - sizeof(Header)) / sizeof(Record);
+    std::size_t valid = 0;
+    Record batch[256];
+    while (valid < total) {
+        const std::size_t count = std::min<std::size_t>(total - valid, 256);
+        const off_t offset = static_cast<off_t>(sizeof(Header) + valid * sizeof(Record));
+        if (::pread(fd, batch, count * sizeof(Record), offset) != static_cast<ssize_t>(count * sizeof(Record))) {
+            break;
+        }
+        std::size_t i = 0;
+        while (i < count && isValid(batch[i])) {
+            i++;
+        }
+        valid += i;
+        if (i < count) {
+            break;
+        }
+    }
+
+    const off_t length = static_cast<off_t>(sizeof(Header) + valid * sizeof(Record));
+    if (length != st.st_size) {
+        if (::ftruncate(fd, length) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        ::fsync(fd);
+    }
+    ::close(fd);
+    return static_cast<long>(valid);
+}
+
+SessionLogWriter::~SessionLogWriter() {
+    close();
+}
+
+bool SessionLogWriter::create(const std::string &path, int cellCount, int64_t startedAtMs) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::memset(&m_header, 0, sizeof(m_header));
+    std::memcpy(m_header.magic, SessionLog::MAGIC, sizeof(m_header.magic));
+    m_header.version = SessionLog::VERSION;
+    m_header.cellCount = static_cast<uint32_t>(cellCount);
+    m_header.startedAtMs = startedAtMs;
+    m_header.crc = SessionLog::crc32(&m_header, offsetof(SessionLog::Header, crc));
+    if (!writeAll(fd, &m_header, sizeof(m_header)) || ::fdatasync(fd) != 0) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    m_fd = fd;
+    m_path = path;
+    m_hasLast = false;
+    return true;
+}
+
+bool SessionLogWriter::resume(const std::string &path) {
+    close();
+
+    const long count = SessionLog::recover(path);
+    if (count < 0) {
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (!readHeader(fd, m_header) || (m_header.flags & SessionLog::FLAG_CLOSED) ||
+            ::lseek(fd, 0, SEEK_END) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_hasLast = count > 0 &&
+                ::pread(fd, &m_last, sizeof(m_last), static_cast<off_t>(sizeof(SessionLog::Header) + (count - 1) * sizeof(SessionLog::Record)))
+                == static_cast<ssize_t>(sizeof(m_last));
+    m_fd = fd;
+    m_path = path;
+    return true;
+}
+
+void SessionLogWriter::append(const SessionLog::Record &record) {
+    m_buffer.push_back(record);
+    m_last = record;
+    m_hasLast = true;
+}
+
+bool SessionLogWriter::flush(bool sync) {
+    if (m_fd < 0) {
+        m_buffer.clear();
+        return false;
+    }
+
+    bool ok = true;
+    if (!m_buffer.empty()) {
+        ok = writeAll(m_fd, m_buffer.data(), m_buffer.size() * sizeof(SessionLog::Record));
+        m_buffer.clear();
+    }
+    if (ok && sync) {
+        ok = ::fdatasync(m_fd) == 0;
+    }
+    return ok;
+}
+
+void SessionLogWriter::finish() {
+    if (m_fd < 0) {
+        return;
+    }
+
+    flush(false);
+    m_header.flags |= SessionLog::FLAG_CLOSED;
+    m_header.crc = SessionLog::crc32(&m_header, offsetof(SessionLog::Header, crc));
+    ::pwrite(m_fd, &m_header, sizeof(m_header), 0);
+    close();
+}
+
+void SessionLogWriter::close() {
+    if (m_fd < 0) {
+        return;
+    }
+
+    flush(true);
+    ::close(m_fd);
+    m_fd = -1;
+    m_path.clear();
+    m_hasLast = false;
+}
+
+SessionLogReader::~SessionLogReader() {
+    close();
+}
+
+bool SessionLogReader::open(const std::string &path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    SessionLog::Header header;
+    struct stat st;
+    if (!readHeader(fd, header) || ::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    ::madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_mappedBytes = static_cast<std::size_t>(st.st_size);
+    m_size = (m_mappedBytes - sizeof(SessionLog::Header)) / sizeof(SessionLog::Record);
+    return true;
+}
+
+void SessionLogReader::close() {
+    if (m_data == nullptr) {
+        return;
+    }
+
+    ::munmap(const_cast<uint8_t*>(m_data), m_mappedBytes);
+    m_data = nullptr;
+    m_mappedBytes = 0;
+    m_size = 0;
+}
+
+std::size_t SessionLogReader::exportCsv(std::ostream &out) const {
+    if (!isOpen()) {
+        return 0;
+    }
+
+    const int cellCount = static_cast<int>(std::min<uint32_t>(header().cellCount, 8));
+    out << "time_s,state,current_mA,voltage_mV,capacity_mAh,temp_int_C,temp_ext_C";
+    for (int i = 0; i < cellCount; i++) {
+        out << ",cell" << (i + 1) << "_mV";
+    }
+    out << '\n';
+
+    char line[160];
+    std::size_t count = 0;
+    for (; count < m_size; count++) {
+        const SessionLog::Record &r = record(count);
+        if (!SessionLog::isValid(r)) {
+            break;
+        }
+        int length = std::snprintf(line, sizeof(line), "%.3f,%u,%d,%u,%u,%d,%d", r.timeMs / 1000.0,
+                                   r.state, r.current, r.voltage, r.capacity, r.tempInt, r.tempExt);
+        for (int i = 0; i < cellCount; i++) {
+            length += std::snprintf(line + length, sizeof(line) - length, ",%u", r.cells[i]);
+        }
+        out.write(line, length);
+        out.put('\n');
+    }
+    return count;
+}
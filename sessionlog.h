@@ -0,0 +1,146 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <b6/Device.hh>
+
+/*
+ * On-disk log of one charge: a fixed header followed by fixed-size records,
+ * each carrying its own CRC-32. The file is only ever appended to, so after a
+ * crash everything up to the last complete record is intact; recover() cuts
+ * off a torn tail. Records are plain little-endian structs, so a reader can
+ * mmap the file and index it directly.
+ */
+namespace SessionLog {
+    static const char MAGIC[8] = { 'C', 'G', 'L', 'O', 'G', '\0', '\0', '\0' };
+    static const uint32_t VERSION = 1;
+    static const uint32_t FLAG_CLOSED = 0x1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;       // FLAG_CLOSED once the charge ended cleanly
+        uint32_t cellCount;
+        uint32_t reserved;
+        int64_t startedAtMs;  // wall clock, ms since epoch
+        uint32_t pad;
+        uint32_t crc;         // of the bytes before it
+    };
+
+    struct Record {
+        uint32_t timeMs;
+        uint32_t capacity;
+        int16_t current;
+        uint16_t voltage;
+        uint16_t cells[8];
+        int8_t tempInt;
+        int8_t tempExt;
+        uint8_t state;
+        uint8_t reserved;
+        uint32_t crc;         // of the bytes before it
+    };
+
+    static_assert(sizeof(Header) == 40, "SessionLog::Header must stay 40 bytes");
+    static_assert(sizeof(Record) == 36, "SessionLog::Record must stay 36 bytes");
+
+    uint32_t crc32(const void *data, std::size_t size);
+    Record makeRecord(uint32_t timeMs, const b6::ChargeInfo &info);
+    b6::ChargeInfo toChargeInfo(const Record &record);
+    bool isValid(const Record &record);
+
+    // truncates a torn or corrupt tail, returns the number of intact records or -1
+    long recover(const std::string &path);
+}
+
+/*
+ * Appends records to a session log. append() only buffers; flush() hands the
+ * batch to the kernel in a single write() and optionally waits for it to reach
+ * the disk.
+ */
+class SessionLogWriter {
+public:
+    SessionLogWriter() {}
+    ~SessionLogWriter();
+
+    SessionLogWriter(const SessionLogWriter&) = delete;
+    SessionLogWriter &operator=(const SessionLogWriter&) = delete;
+
+    bool create(const std::string &path, int cellCount, int64_t startedAtMs);
+    // continues a log that was not closed, after recovering it
+    bool resume(const std::string &path);
+    bool isOpen() const { return m_fd >= 0; }
+    const std::string &path() const { return m_path; }
+    const SessionLog::Header &header() const { return m_header; }
+    const SessionLog::Record *lastRecord() const { return m_hasLast ? &m_last : nullptr; }
+
+    void append(const SessionLog::Record &record);
+    std::size_t pending() const { return m_buffer.size(); }
+    bool flush(bool sync);
+    // flushes and marks the log as cleanly finished
+    void finish();
+    // flushes and closes, leaving the log open for resume()
+    void close();
+
+private:
+    int m_fd = -1;
+    std::string m_path;
+    SessionLog::Header m_header;
+    SessionLog::Record m_last;
+    bool m_hasLast = false;
+    std::vector<SessionLog::Record> m_buffer;
+};
+
+/*
+ * Read-only, memory-mapped view of a session log. size() counts the complete
+ * records; record(i) does not check the CRC, use SessionLog::isValid().
+ */
+class SessionLogReader {
+public:
+    SessionLogReader() {}
+    ~SessionLogReader();
+
+    SessionLogReader(const SessionLogReader&) = delete;
+    SessionLogReader &operator=(const SessionLogReader&) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    const SessionLog::Header &header() const { return *reinterpret_cast<const SessionLog::Header*>(m_data); }
+    std::size_t size() const { return m_size; }
+    const SessionLog::Record &record(std::size_t index) const {
+        return reinterpret_cast<const SessionLog::Record*>(m_data + sizeof(SessionLog::Header))[index];
+    }
+
+    // writes the log as CSV one record at a time, stops at the first bad record
+    std::size_t exportCsv(std::ostream &out) const;
+
+private:
+    const uint8_t *m_data = nullptr;
+    std::size_t m_mappedBytes = 0;
+    std::size_t m_size = 0;
+};
+
+#endif // SESSIONLOG_H
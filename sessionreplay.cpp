@@ -0,0 +1,88 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include "sessionreplay.h"
+
+bool SessionReplay::open(const std::string &path) {
+    close();
+    if (!m_log.open(path)) {
+        return false;
+    }
+
+    // what ChargerSession does with a charge it did not start: no -dV threshold
+    ChargeAnalytics analytics;
+    analytics.startCharge();
+    for (; m_size < m_log.size() && SessionLog::isValid(m_log.record(m_size)); m_size++) {
+        m_step(analytics, m_size);
+        if (m_size % KEYFRAME_STRIDE == 0) {
+            m_keyframes.push_back({ m_log.record(m_size).timeMs, analytics });
+        }
+    }
+    if (m_size == 0) {
+        close();
+        return false;
+    }
+    m_position = 0;
+    m_analytics = m_keyframes.front().analytics;
+    return true;
+}
+
+void SessionReplay::close() {
+    m_log.close();
+    m_size = 0;
+    m_keyframes.clear();
+    m_position = 0;
+    m_analytics.reset();
+}
+
+std::size_t SessionReplay::indexAt(uint32_t timeMs) const {
+    // the stride the time falls in, then the record within it
+    auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), timeMs,
+                                     [](uint32_t time, const Keyframe &k) { return time < k.timeMs; });
+    if (keyframe == m_keyframes.begin()) {
+        return 0;
+    }
+    std::size_t first = static_cast<std::size_t>(keyframe - m_keyframes.begin() - 1) * KEYFRAME_STRIDE;
+    std::size_t last = std::min(first + KEYFRAME_STRIDE, m_size);
+    while (last - first > 1) {
+        const std::size_t middle = first + (last - first) / 2;
+        if (m_log.record(middle).timeMs <= timeMs) {
+            first = middle;
+        } else {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+void SessionReplay::seek(std::size_t index) {
+    index = std::min(index, m_size - 1);
+    const std::size_t keyframe = index / KEYFRAME_STRIDE * KEYFRAME_STRIDE;
+    if (index < m_position || keyframe > m_position) {
+        m_analytics = m_keyframes[index / KEYFRAME_STRIDE].analytics;
+        m_position = keyframe;
+    }
+    while (m_position < index) {
+        m_step(m_analytics, ++m_position);
+    }
+}
+
+void SessionReplay::m_step(ChargeAnalytics &analytics, std::size_t index) const {
+    const SessionLog::Record &record = m_log.record(index);
+    analytics.update(record.timeMs, SessionLog::toChargeInfo(record));
+}
@@ -0,0 +1,81 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SESSIONREPLAY_H
+#define SESSIONREPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <b6/Device.hh>
+#include "chargeanalytics.h"
+#include "sessionlog.h"
+
+/*
+ * Random access to a recorded charge for scrubbing through it. The log is
+ * memory-mapped; every KEYFRAME_STRIDE-th record gets a keyframe holding its
+ * time and the ChargeAnalytics as they stood after it, built in one pass on
+ * open(). Finding the record at a time is a binary search over the keyframes
+ * and then within one stride, and seek() restores the keyframe before the
+ * record and runs at most a stride of records from there, or steps forward
+ * from where it is when that is closer. Times are the charger's, ms since the
+ * start of the charge, as in the log.
+ */
+class SessionReplay {
+public:
+    static const std::size_t KEYFRAME_STRIDE = 256;
+
+    SessionReplay() {}
+    SessionReplay(const SessionReplay&) = delete;
+    SessionReplay &operator=(const SessionReplay&) = delete;
+
+    // false if the log cannot be read or holds no intact record
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return m_size > 0; }
+
+    std::size_t size() const { return m_size; }
+    int cellCount() const { return static_cast<int>(m_log.header().cellCount); }
+    uint32_t timeMs(std::size_t index) const { return m_log.record(index).timeMs; }
+    uint32_t startMs() const { return timeMs(0); }
+    uint32_t endMs() const { return timeMs(m_size - 1); }
+    // the last record at or before timeMs, the first one before the start
+    std::size_t indexAt(uint32_t timeMs) const;
+
+    void seek(std::size_t index);
+    std::size_t position() const { return m_position; }
+    b6::ChargeInfo chargeInfo() const { return SessionLog::toChargeInfo(m_log.record(m_position)); }
+    // as a live session had them at the record seek() went to
+    const ChargeAnalytics &analytics() const { return m_analytics; }
+
+private:
+    struct Keyframe {
+        uint32_t timeMs;
+        ChargeAnalytics analytics;
+    };
+
+    SessionLogReader m_log;
+    std::size_t m_size = 0;
+    std::vector<Keyframe> m_keyframes;
+    std::size_t m_position = 0;
+    ChargeAnalytics m_analytics;
+
+    void m_step(ChargeAnalytics &analytics, std::size_t index) const;
+};
+
+#endif // SESSIONREPLAY_H
@@ -0,0 +1,414 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "simulateddevice.h"
+
+// what the B6 reports besides b6::STATE::CHARGING
+static const uint8_t STATE_IDLE = 0x00;
+static const uint8_t STATE_COMPLETE = 0x03;
+
+SimulatedDevice::SimulatedDevice(const Options &options) : m_options(options), m_random(options.seed),
+        m_epoch(std::chrono::steady_clock::now()), m_chemistry(m_chemistryOf(b6::BATTERY_TYPE::LIPO)) {
+    std::memset(&m_profile, 0, sizeof(m_profile));
+    std::memset(&m_sysInfo, 0, sizeof(m_sysInfo));
+    m_sysInfo.cycleTime = 5;
+    m_sysInfo.timeLimit = 120;
+    m_sysInfo.capLimit = 5000;
+    m_sysInfo.tempLimit = 80;
+    m_sysInfo.voltage = 12000;
+
+    m_packTemp = m_chargerTemp = m_fullTemp = m_options.ambient;
+    if (m_options.cells > 0) {
+        m_buildPack(m_options.cells);
+    }
+    m_updateInfo(false);
+}
+
+b6::SysInfo SimulatedDevice::getSysInfo() {
+    m_checkConnected();
+    return m_sysInfo;
+}
+
+b6::ChargeInfo SimulatedDevice::getChargeInfo() {
+    m_checkConnected();
+
+    // one simulated second per read at most, so a slow reader slows the charge down instead of missing samples
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+    if (m_options.speed <= 0.0 || m_steps < elapsed * m_options.speed) {
+        m_step();
+        m_steps++;
+    }
+
+    m_checkConnected();
+    if (!m_error.empty()) {
+        std::string message;
+        message.swap(m_error);
+        throw ChargerError(message);
+    }
+    return m_info;
+}
+
+b6::ChargeProfile SimulatedDevice::getDefaultChargeProfile(b6::BATTERY_TYPE type) {
+    m_checkConnected();
+
+    const Chemistry chemistry = m_chemistryOf(type);
+    b6::ChargeProfile profile;
+    std::memset(&profile, 0, sizeof(profile));
+    profile.batteryType = type;
+    profile.cellCount = 1;
+    profile.chargeCurrent = 1000;
+    profile.dischargeCurrent = 500;
+    profile.cellDischargeVoltage = static_cast<uint16_t>(chemistry.cutoffVoltage * 1000);
+    profile.endVoltage = static_cast<uint16_t>(chemistry.chargeVoltage * 1000);
+    return profile;
+}
+
+bool SimulatedDevice::startCharging(const b6::ChargeProfile &profile) {
+    m_checkConnected();
+
+    const bool li = b6::Device::isBatteryLi(profile.batteryType);
+    const int cells = std::max<int>(profile.cellCount, 1);
+    if (m_cells.empty()) {
+        m_buildPack(cells);
+    } else if (li && cells != static_cast<int>(m_cells.size())) {
+        throw ChargerError("cell count mismatch, the pack has " + std::to_string(m_cells.size()) + " cells");
+    }
+    if (li && m_cells.size() > static_cast<std::size_t>(MAX_BALANCE_CELLS)) {
+        throw ChargerError("too many cells for the balance port");
+    }
+
+    m_profile = profile;
+    m_chemistry = m_chemistryOf(profile.batteryType);
+    m_li = li;
+
+    m_phases.clear();
+    if (li) {
+        switch (profile.mode.li) {
+        case b6::CHARGING_MODE_LI::DISCHARGE: m_phases.push_back(DISCHARGE); break;
+        case b6::CHARGING_MODE_LI::STORAGE: m_phases.push_back(STORAGE); break;
+        default: m_phases.push_back(CHARGE); break;
+        }
+    } else if (b6::Device::isBatteryNi(profile.batteryType)) {
+        switch (profile.mode.ni) {
+        case b6::CHARGING_MODE_NI::DISCHARGE:
+            m_phases.push_back(DISCHARGE);
+            break;
+        case b6::CHARGING_MODE_NI::CYCLE:
+            for (int i = 0; i < std::max<int>(profile.cycleCount, 1); i++) {
+                m_phases.push_back(DISCHARGE);
+                m_phases.push_back(CHARGE);
+            }
+            break;
+        case b6::CHARGING_MODE_NI::REPEAK:
+            m_phases.insert(m_phases.end(), std::max<int>(profile.rPeakCount, 1), CHARGE);
+            break;
+        default:
+            m_phases.push_back(CHARGE);
+            break;
+        }
+    } else {
+        m_phases.push_back(profile.mode.pb == b6::CHARGING_MODE_PB::DISCHARGE ? DISCHARGE : CHARGE);
+    }
+
+    m_time = 0;
+    m_error.clear();
+    m_state = static_cast<uint8_t>(b6::STATE::CHARGING);
+    m_nextPhase();
+    m_updateInfo(false);
+    return true;
+}
+
+bool SimulatedDevice::stopCharging() {
+    m_checkConnected();
+
+    m_phases.clear();
+    m_phase = IDLE;
+    m_current = 0.0;
+    m_state = STATE_IDLE;
+    m_updateInfo(false);
+    return true;
+}
+
+void SimulatedDevice::setTimeLimit(bool enabled, unsigned minutes) {
+    m_checkConnected();
+    m_sysInfo.timeLimitOn = enabled;
+    m_sysInfo.timeLimit = minutes;
+}
+
+void SimulatedDevice::setCapacityLimit(bool enabled, unsigned capacity) {
+    m_checkConnected();
+    m_sysInfo.capLimitOn = enabled;
+    m_sysInfo.capLimit = capacity;
+}
+
+void SimulatedDevice::setTempLimit(unsigned temp) {
+    m_checkConnected();
+    m_sysInfo.tempLimit = temp;
+}
+
+void SimulatedDevice::setCycleTime(unsigned minutes) {
+    m_checkConnected();
+    m_sysInfo.cycleTime = minutes;
+}
+
+void SimulatedDevice::setBuzzers(bool system, bool key) {
+    m_checkConnected();
+    m_sysInfo.systemBuzzer = system;
+    m_sysInfo.keyBuzzer = key;
+}
+
+int SimulatedDevice::pollIntervalMs() const {
+    if (m_options.speed <= 0.0) {
+        return 1;
+    }
+    return std::max(1, static_cast<int>(1000.0 / m_options.speed));
+}
+
+SimulatedDevice::Chemistry SimulatedDevice::m_chemistryOf(b6::BATTERY_TYPE type) {
+    // empty, full, knee, CV, cut-off, storage, resistance, polarization
+    switch (type) {
+    case b6::BATTERY_TYPE::LIIO: return { 3.35, 4.10, 0.25, 4.10, 3.00, 3.75, 0.035, 0.0 };
+    case b6::BATTERY_TYPE::LIFE: return { 3.20, 3.60, 0.30, 3.60, 2.80, 3.30, 0.020, 0.0 };
+    case b6::BATTERY_TYPE::LIHV: return { 3.45, 4.35, 0.30, 4.35, 3.10, 3.85, 0.030, 0.0 };
+    case b6::BATTERY_TYPE::NIMH: return { 1.20, 1.40, 0.05, 0.00, 1.00, 0.00, 0.020, 0.05 };
+    case b6::BATTERY_TYPE::NICD: return { 1.20, 1.40, 0.05, 0.00, 0.90, 0.00, 0.015, 0.05 };
+    case b6::BATTERY_TYPE::PB:   return { 1.95, 2.15, 0.00, 2.40, 1.80, 0.00, 0.050, 0.35 };
+    default:                     return { 3.40, 4.20, 0.25, 4.20, 3.00, 3.80, 0.030, 0.0 };
+    }
+}
+
+double SimulatedDevice::m_openCircuitVoltage(const Cell &cell) const {
+    const Chemistry &c = m_chemistry;
+    const double soc = std::min(cell.soc, 1.0);
+    // flat middle, a knee towards full and a collapse below the cut-off when empty
+    return c.emptyVoltage + (c.fullVoltage - c.emptyVoltage - c.knee) * soc + c.knee * std::pow(soc, 4) -
+           (c.emptyVoltage - c.cutoffVoltage + 0.1) * std::exp(-25.0 * soc);
+}
+
+void SimulatedDevice::m_checkConnected() const {
+    if (m_disconnected) {
+        throw std::runtime_error("simulated charger disconnected");
+    }
+}
+
+void SimulatedDevice::m_buildPack(int count) {
+    std::normal_distribution<double> spread(0.0, 1.0);
+    m_cells.resize(static_cast<std::size_t>(std::min(std::max(count, 1), MAX_CELLS)));
+    for (Cell &cell : m_cells) {
+        cell.capacity = m_options.capacity / 1000.0 * (1.0 + 0.02 * spread(m_random));
+        cell.resistanceScale = std::max(0.5, 1.0 + 0.1 * spread(m_random));
+        cell.soc = std::min(std::max(m_options.soc + 0.01 * spread(m_random), 0.0), 1.0);
+        cell.voltage = m_openCircuitVoltage(cell);
+    }
+}
+
+void SimulatedDevice::m_nextPhase() {
+    m_current = 0.0;
+    if (m_phases.empty()) {
+        m_phase = DONE;
+        m_state = STATE_COMPLETE;
+        return;
+    }
+
+    m_phase = m_phases.front();
+    m_phases.erase(m_phases.begin());
+    m_capacity = 0.0;
+    m_overcharge = 0.0;
+    m_peakVoltage = 0;
+    if (m_phase == STORAGE) {
+        double total = 0.0;
+        for (const Cell &cell : m_cells) {
+            total += m_openCircuitVoltage(cell);
+        }
+        m_storageDischarge = total / m_cells.size() > m_chemistry.storageVoltage;
+    }
+}
+
+void SimulatedDevice::m_step() {
+    const bool running = m_phase == CHARGE || m_phase == DISCHARGE || m_phase == STORAGE;
+    if (running) {
+        m_time++;
+        if (m_phase == CHARGE) {
+            const double setpoint = m_li && m_profile.endVoltage > 0 ? m_profile.endVoltage / 1000.0 : m_chemistry.chargeVoltage;
+            m_charge(setpoint, m_li && m_profile.mode.li == b6::CHARGING_MODE_LI::BALANCE);
+        } else if (m_phase == DISCHARGE || m_storageDischarge) {
+            m_discharge();
+        } else {
+            m_charge(m_chemistry.storageVoltage, true);
+        }
+    } else {
+        m_current = 0.0;
+        for (Cell &cell : m_cells) {
+            cell.voltage = m_openCircuitVoltage(cell);
+        }
+    }
+
+    // first order lags towards what the dissipated power would settle at
+    const double amps = std::abs(m_current);
+    double resistance = 0.0;
+    for (const Cell &cell : m_cells) {
+        resistance += m_chemistry.resistance * cell.resistanceScale;
+    }
+    const double packTarget = m_options.ambient + 4.0 * amps * amps * resistance + (m_overcharge > 0.0 ? 12.0 * amps : 0.0);
+    m_packTemp += (packTarget - m_packTemp) / 300.0;
+    m_chargerTemp += (m_options.ambient + 6.0 * amps - m_chargerTemp) / 120.0;
+
+    if (m_phase == CHARGE || m_phase == DISCHARGE || m_phase == STORAGE) {
+        // the charger's own safety limits end the charge like a normal completion
+        if ((m_sysInfo.capLimitOn && m_capacity >= m_sysInfo.capLimit) ||
+                (m_sysInfo.timeLimitOn && m_time >= static_cast<int>(m_sysInfo.timeLimit) * 60) ||
+                (m_options.extSensor && m_packTemp >= m_sysInfo.tempLimit)) {
+            m_phases.clear();
+            m_nextPhase();
+        }
+    }
+    if (running && m_time == m_options.errorAt) {
+        m_error = "simulated charging error";
+        m_phases.clear();
+        m_phase = IDLE;
+        m_current = 0.0;
+        m_state = STATE_IDLE;
+    }
+    if (running && m_options.disconnectAt >= 0 && m_time >= m_options.disconnectAt) {
+        m_disconnected = true;
+    }
+
+    m_updateInfo(running);
+}
+
+void SimulatedDevice::m_charge(double setpoint, bool perCell) {
+    const double setCurrent = std::max<int>(m_profile.chargeCurrent, 50) / 1000.0;
+    const double bleed = 0.2;
+    double current = setCurrent;
+
+    if (setpoint > 0.0) {
+        // constant voltage: the current that puts the limiting voltage right at the setpoint
+        double ocv = 0.0, resistance = 0.0;
+        for (const Cell &cell : m_cells) {
+            const double cellOcv = m_openCircuitVoltage(cell) + m_chemistry.polarization * std::pow(std::min(cell.soc, 1.0), 4);
+            const double cellResistance = m_chemistry.resistance * cell.resistanceScale;
+            if (perCell) {
+                current = std::min(current, (setpoint - cellOcv) / cellResistance);
+            }
+            ocv += cellOcv;
+            resistance += cellResistance;
+        }
+        if (!perCell) {
+            current = std::min(current, (setpoint * m_cells.size() - ocv) / resistance);
+        }
+        current = std::max(current, 0.0);
+        if (current < setCurrent / 10.0) {
+            m_nextPhase();
+            return;
+        }
+    }
+
+    double lowest = 10.0;
+    for (const Cell &cell : m_cells) {
+        lowest = std::min(lowest, cell.voltage);
+    }
+
+    const bool ni = m_chemistry.chargeVoltage == 0.0;
+    int packVoltage = 0;
+    for (Cell &cell : m_cells) {
+        // the balancer bleeds the cells running ahead
+        const double cellCurrent = perCell && cell.voltage > lowest + 0.01 ? current - std::min(bleed, current) : current;
+        cell.soc += cellCurrent / 3600.0 / cell.capacity;
+        if (cell.soc > 1.0) {
+            if (ni) {
+                if (m_overcharge == 0.0) {
+                    m_fullTemp = m_packTemp;
+                }
+                m_overcharge += (cell.soc - 1.0) * cell.capacity;
+                cell.soc = 1.0;
+            } else {
+                cell.soc = std::min(cell.soc, 1.1);
+            }
+        }
+
+        cell.voltage = m_openCircuitVoltage(cell) + current * m_chemistry.resistance * cell.resistanceScale +
+                       m_chemistry.polarization * std::pow(std::min(cell.soc, 1.0), 4);
+        if (m_overcharge > 0.0) {
+            // Ni cells lose voltage as they heat up once full, that is the -dV the charger looks for
+            cell.voltage -= 0.004 * (m_packTemp - m_fullTemp);
+        }
+        packVoltage += static_cast<int>(cell.voltage * 1000);
+    }
+    m_capacity += current * 1000.0 / 3600.0;
+    m_current = current;
+
+    if (ni) {
+        m_peakVoltage = std::max(m_peakVoltage, packVoltage);
+        if (m_overcharge > 0.0 && m_peakVoltage - packVoltage >= 5 * static_cast<int>(m_cells.size())) {
+            m_nextPhase();
+        }
+    }
+}
+
+void SimulatedDevice::m_discharge() {
+    const double current = std::max<int>(m_profile.dischargeCurrent, 50) / 1000.0;
+    const double cutoff = m_profile.cellDischargeVoltage > 0 ? m_profile.cellDischargeVoltage / 1000.0 : m_chemistry.cutoffVoltage;
+
+    double lowest = 10.0, total = 0.0, ocv = 0.0;
+    bool empty = false;
+    for (Cell &cell : m_cells) {
+        cell.soc = std::max(cell.soc - current / 3600.0 / cell.capacity, 0.0);
+        empty = empty || cell.soc == 0.0;
+        cell.voltage = m_openCircuitVoltage(cell) - current * m_chemistry.resistance * cell.resistanceScale;
+        lowest = std::min(lowest, cell.voltage);
+        total += cell.voltage;
+        ocv += m_openCircuitVoltage(cell);
+    }
+    m_capacity += current * 1000.0 / 3600.0;
+    m_current = -current;
+
+    const bool done = m_phase == STORAGE ? ocv / m_cells.size() <= m_chemistry.storageVoltage
+                                         : empty || (m_li ? lowest <= cutoff : total <= cutoff * m_cells.size());
+    if (done) {
+        m_nextPhase();
+    }
+}
+
+void SimulatedDevice::m_updateInfo(bool noise) {
+    std::uniform_int_distribution<int> millis(-2, 2);
+
+    std::memset(&m_info, 0, sizeof(m_info));
+    m_info.state = m_state;
+    m_info.time = m_time;
+    m_info.capacity = static_cast<int>(m_capacity);
+    m_info.current = static_cast<int>(std::abs(m_current) * 1000);
+    if (noise && m_info.current > 0) {
+        m_info.current += 2 * millis(m_random);
+    }
+
+    double resistance = 0.0;
+    for (std::size_t i = 0; i < m_cells.size(); i++) {
+        const int mV = static_cast<int>(m_cells[i].voltage * 1000) + (noise ? millis(m_random) : 0);
+        if (m_li && i < 8) {
+            m_info.cells[i] = mV;
+        }
+        m_info.voltage += mV;
+        resistance += m_chemistry.resistance * m_cells[i].resistanceScale;
+    }
+    m_info.impendance = static_cast<int>(resistance * 1000);
+    m_info.tempInt = static_cast<uint16_t>(std::lround(m_chargerTemp));
+    m_info.tempExt = m_options.extSensor ? static_cast<uint16_t>(std::lround(m_packTemp)) : 0;
+}
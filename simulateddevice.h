@@ -0,0 +1,138 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMULATEDDEVICE_H
+#define SIMULATEDDEVICE_H
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "chargerdevice.h"
+
+/*
+ * A B6 with a battery attached, in software. The pack is a string of cells,
+ * each with its own capacity, internal resistance and charge level drawn
+ * around the nominal values from a seeded generator, so the same options
+ * always give the same charge. Li and Pb are charged CC/CV, Ni until -dV,
+ * discharges run to the cut-off voltage; pack and charger temperatures follow
+ * the power dissipated. The simulation advances in steps of one simulated
+ * second and at most one step per getChargeInfo(), so the samples do not
+ * depend on how fast the host keeps up, only their pace does.
+ */
+class SimulatedDevice : public ChargerDevice {
+public:
+    struct Options {
+        int cells = 0;            // cells in the pack, 0 to take whatever the first charge asks for
+        int capacity = 2200;      // nominal capacity of a cell, mAh
+        double soc = 0.3;         // state of charge of the pack when attached, 0..1
+        double speed = 1.0;       // simulated seconds per real second, 0 for as fast as it is read
+        double ambient = 25.0;    // degrees C
+        bool extSensor = false;   // report the pack temperature as the external probe
+        unsigned seed = 1;
+        int errorAt = -1;         // charge time (s) at which the charger reports an error, -1 for never
+        int disconnectAt = -1;    // charge time (s) from which every call fails, -1 for never
+    };
+
+    explicit SimulatedDevice(const Options &options);
+
+    std::string getCoreType() override { return "SIM6"; }
+    double getHWVersion() override { return 1.0; }
+    double getSWVersion() override { return 1.0; }
+    int getCellCount() override { return MAX_BALANCE_CELLS; }
+
+    b6::SysInfo getSysInfo() override;
+    b6::ChargeInfo getChargeInfo() override;
+    b6::ChargeProfile getDefaultChargeProfile(b6::BATTERY_TYPE type) override;
+    bool startCharging(const b6::ChargeProfile &profile) override;
+    bool stopCharging() override;
+
+    void setTimeLimit(bool enabled, unsigned minutes) override;
+    void setCapacityLimit(bool enabled, unsigned capacity) override;
+    void setTempLimit(unsigned temp) override;
+    void setCycleTime(unsigned minutes) override;
+    void setBuzzers(bool system, bool key) override;
+
+    int pollIntervalMs() const override;
+    int64_t sampleTimeMs() const override { return static_cast<int64_t>(m_info.time) * 1000; }
+
+private:
+    static const int MAX_BALANCE_CELLS = 6;
+    static const int MAX_CELLS = 16;
+
+    enum Phase { IDLE, CHARGE, DISCHARGE, STORAGE, DONE };
+
+    struct Cell {
+        double capacity;          // Ah
+        double resistanceScale;   // of the chemistry's nominal resistance
+        double soc;
+        double voltage;           // at the terminals, V
+    };
+
+    struct Chemistry {
+        double emptyVoltage;      // per cell at soc 0, V
+        double fullVoltage;       // per cell at soc 1
+        double knee;              // extra rise towards full
+        double chargeVoltage;     // CV setpoint per cell, 0 for -dV termination
+        double cutoffVoltage;     // default discharge cut-off per cell
+        double storageVoltage;    // open circuit target of the storage mode
+        double resistance;        // nominal internal resistance, ohm
+        double polarization;      // overpotential while charging near full, V
+    };
+
+    Options m_options;
+    std::mt19937 m_random;
+    std::chrono::steady_clock::time_point m_epoch;
+    long m_steps = 0;
+
+    std::vector<Cell> m_cells;
+    Chemistry m_chemistry;
+    bool m_li = true;
+    b6::ChargeProfile m_profile;
+    b6::SysInfo m_sysInfo;
+    std::vector<Phase> m_phases;
+    Phase m_phase = IDLE;
+    bool m_storageDischarge = false;
+
+    double m_current = 0.0;       // A, positive into the pack
+    double m_capacity = 0.0;      // mAh moved during the charge
+    int m_time = 0;               // s since the charge started
+    double m_packTemp;
+    double m_chargerTemp;
+    double m_overcharge = 0.0;    // Ah pushed into a full Ni pack, turns into heat
+    double m_fullTemp;            // pack temperature when it became full
+    int m_peakVoltage = 0;        // mV, for -dV
+    uint8_t m_state = 0;
+
+    bool m_disconnected = false;
+    std::string m_error;
+    b6::ChargeInfo m_info;
+
+    static Chemistry m_chemistryOf(b6::BATTERY_TYPE type);
+    double m_openCircuitVoltage(const Cell &cell) const;
+    void m_checkConnected() const;
+    void m_buildPack(int count);
+    void m_nextPhase();
+    void m_step();
+    void m_charge(double setpoint, bool perCell);
+    void m_discharge();
+    void m_finish(uint8_t state);
+    void m_updateInfo(bool noise);
+};
+
+#endif // SIMULATEDDEVICE_H
@@ -0,0 +1,310 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QPainter>
+#include <QWheelEvent>
+#include "diagnostics.h"
+#include "stripchart.h"
+
+static const int MARGIN_LEFT = 48;
+static const int MARGIN_TOP = 18;
+static const int MARGIN_RIGHT = 6;
+static const int MARGIN_BOTTOM = 16;
+
+static const double DEFAULT_WINDOW = 600.0;
+static const double MIN_WINDOW = 60.0;
+static const double MAX_WINDOW = 86400.0;
+// window kept per wheel step, as in ChartView
+static const double ZOOM_STEP = 0.8;
+// head room left above and below the data on a redraw
+static const double RANGE_MARGIN = 0.1;
+
+static QString spanText(double seconds) {
+    if (seconds >= 7200.0) {
+        return QString("%1 h").arg(seconds / 3600.0, 0, 'f', 1);
+    }
+    if (seconds >= 120.0) {
+        return QString("%1 min").arg(qRound(seconds / 60.0));
+    }
+    return QString("%1 s").arg(qRound(seconds));
+}
+
+StripChart::StripChart(QWidget *parent) : QWidget(parent), m_window(DEFAULT_WINDOW) {
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumHeight(MARGIN_TOP + MARGIN_BOTTOM + 40);
+}
+
+void StripChart::setTitle(const QString &title) {
+    m_title = title;
+    update();
+}
+
+void StripChart::addTrace(LodSeries::Source *source, const QColor &color) {
+    m_traces.emplace_back(new Trace(source, color));
+    m_redraw();
+    update();
+}
+
+void StripChart::clearTraces() {
+    m_traces.clear();
+    m_redraw();
+    update();
+}
+
+void StripChart::setWindow(double seconds) {
+    m_window = std::max(MIN_WINDOW, std::min(MAX_WINDOW, seconds));
+    m_redraw();
+    update();
+}
+
+void StripChart::appendSamples() {
+    static LatencyHistogram &appendTime = Diagnostics::histogram("strip.append");
+    LatencyHistogram::Scope timer(appendTime);
+
+    if (m_image.isNull()) {
+        return;
+    }
+    double end = -std::numeric_limits<double>::infinity();
+    double min = std::numeric_limits<double>::infinity(), max = -min;
+    bool cleared = false;
+    for (const std::unique_ptr<Trace> &trace : m_traces) {
+        const std::size_t size = trace->source->size();
+        cleared = cleared || size < trace->drawn;
+        for (std::size_t i = trace->drawn; i < size; i++) {
+            const LodSeries::Point point = trace->source->at(i);
+            end = std::max(end, point.x);
+            min = std::min(min, point.y);
+            max = std::max(max, point.y);
+        }
+    }
+    if (!cleared && min > max) {
+        return;
+    }
+
+    const int64_t column = cleared ? m_column : m_columnAt(end);
+    if (cleared || m_column < 0 || column < m_column || column - m_column >= m_image.width() ||
+            min < m_yMin || max > m_yMax) {
+        m_redraw();
+        update();
+        return;
+    }
+
+    m_advance(column);
+    QPainter painter(&m_image);
+    QVector<QLine> lines;
+    for (const std::unique_ptr<Trace> &trace : m_traces) {
+        trace->lod.update();
+        lines.clear();
+        for (std::size_t i = trace->drawn; i < trace->lod.size(); i++) {
+            m_lineTo(*trace, trace->source->at(i), lines);
+        }
+        trace->drawn = trace->lod.size();
+        m_drawLines(painter, lines, trace->color);
+    }
+    update(m_plotRect());
+}
+
+void StripChart::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+
+    const QRect plot = m_plotRect();
+    painter.setPen(palette().color(QPalette::WindowText));
+    painter.drawText(QRect(MARGIN_LEFT, 0, width() - MARGIN_LEFT, MARGIN_TOP), Qt::AlignLeft | Qt::AlignVCenter, m_title);
+    if (m_image.isNull()) {
+        return;
+    }
+
+    // the ring starts at the column after the right edge
+    const int width = m_image.width();
+    const int split = m_column < 0 ? 0 : static_cast<int>((m_column + 1) % width);
+    painter.drawImage(plot.left(), plot.top(), m_image, split, 0, width - split, m_image.height());
+    if (split > 0) {
+        painter.drawImage(plot.left() + width - split, plot.top(), m_image, 0, 0, split, m_image.height());
+    }
+    painter.drawRect(plot.adjusted(-1, -1, 0, 0));
+
+    if (m_column < 0) {
+        return;
+    }
+    const QFontMetrics metrics = painter.fontMetrics();
+    const QRect left(0, plot.top() - metrics.height() / 2, MARGIN_LEFT - 4, metrics.height());
+    painter.drawText(left, Qt::AlignRight | Qt::AlignVCenter, QString::number(m_yMax, 'g', 4));
+    painter.drawText(left.translated(0, plot.height()), Qt::AlignRight | Qt::AlignVCenter, QString::number(m_yMin, 'g', 4));
+    const QRect bottom(plot.left(), plot.bottom() + 1, plot.width(), MARGIN_BOTTOM);
+    painter.drawText(bottom, Qt::AlignLeft | Qt::AlignVCenter, "-" + spanText(m_window));
+    painter.drawText(bottom, Qt::AlignRight | Qt::AlignVCenter, "now");
+}
+
+void StripChart::resizeEvent(QResizeEvent *) {
+    const QRect plot = m_plotRect();
+    if (plot.width() > 0 && plot.height() > 0) {
+        m_image = QImage(plot.size(), QImage::Format_ARGB32_Premultiplied);
+    } else {
+        m_image = QImage();
+    }
+    m_redraw();
+}
+
+void StripChart::wheelEvent(QWheelEvent *event) {
+    if (event->angleDelta().y() == 0) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+    setWindow(event->angleDelta().y() > 0 ? m_window * ZOOM_STEP : m_window / ZOOM_STEP);
+    event->accept();
+}
+
+QRect StripChart::m_plotRect() const {
+    return rect().adjusted(MARGIN_LEFT, MARGIN_TOP, -MARGIN_RIGHT, -MARGIN_BOTTOM);
+}
+
+int64_t StripChart::m_columnAt(double x) const {
+    return static_cast<int64_t>(std::floor(x / m_secondsPerColumn()));
+}
+
+int StripChart::m_rowAt(double y) const {
+    const int bottom = m_image.height() - 1;
+    return bottom - static_cast<int>(std::lround((y - m_yMin) / (m_yMax - m_yMin) * bottom));
+}
+
+void StripChart::m_redraw() {
+    static LatencyHistogram &redrawTime = Diagnostics::histogram("strip.redraw");
+    LatencyHistogram::Scope timer(redrawTime);
+
+    m_column = -1;
+    for (const std::unique_ptr<Trace> &trace : m_traces) {
+        trace->lod.update();
+        trace->drawn = trace->lod.size();
+        trace->started = false;
+    }
+    if (m_image.isNull()) {
+        return;
+    }
+    m_image.fill(palette().color(QPalette::Base));
+
+    double end = -std::numeric_limits<double>::infinity();
+    for (const std::unique_ptr<Trace> &trace : m_traces) {
+        if (!trace->lod.empty()) {
+            end = std::max(end, trace->lod.back().x);
+        }
+    }
+    if (std::isinf(end)) {
+        return;
+    }
+    m_column = m_columnAt(end);
+
+    const std::size_t width = static_cast<std::size_t>(m_image.width());
+    const double start = (m_column - m_image.width() + 1) * m_secondsPerColumn();
+    std::vector<std::vector<LodSeries::Point>> selected(m_traces.size());
+    double min = std::numeric_limits<double>::infinity(), max = -min;
+    for (std::size_t i = 0; i < m_traces.size(); i++) {
+        if (m_traces[i]->lod.empty()) {
+            continue;
+        }
+        m_traces[i]->lod.query(start, end, width, selected[i]);
+        for (const LodSeries::Point &point : selected[i]) {
+            if (point.x >= start) {
+                min = std::min(min, point.y);
+                max = std::max(max, point.y);
+            }
+        }
+    }
+    m_fitRange(min, max);
+
+    QPainter painter(&m_image);
+    QVector<QLine> lines;
+    for (std::size_t i = 0; i < m_traces.size(); i++) {
+        Trace &trace = *m_traces[i];
+        lines.clear();
+        for (const LodSeries::Point &point : selected[i]) {
+            m_lineTo(trace, point, lines);
+        }
+        if (!trace.lod.empty()) {
+            // the selection may end on a bucket's extreme rather than on the newest point
+            m_lineTo(trace, trace.lod.back(), lines);
+        }
+        m_drawLines(painter, lines, trace.color);
+    }
+}
+
+void StripChart::m_fitRange(double min, double max) {
+    if (min > max) {
+        min = max = 0.0;
+    }
+    const double margin = max > min ? (max - min) * RANGE_MARGIN : std::max(std::fabs(max) * RANGE_MARGIN, 0.01);
+    m_yMin = min - margin;
+    m_yMax = max + margin;
+}
+
+void StripChart::m_advance(int64_t column) {
+    const int width = m_image.width();
+    const int from = static_cast<int>((m_column + 1) % width);
+    const int count = static_cast<int>(column - m_column);
+    m_column = column;
+    if (count <= 0) {
+        return;
+    }
+
+    QPainter painter(&m_image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    const QColor base = palette().color(QPalette::Base);
+    painter.fillRect(from, 0, std::min(count, width - from), m_image.height(), base);
+    if (from + count > width) {
+        painter.fillRect(0, 0, from + count - width, m_image.height(), base);
+    }
+}
+
+void StripChart::m_lineTo(Trace &trace, const LodSeries::Point &point, QVector<QLine> &lines) {
+    const int64_t left = m_column - m_image.width() + 1;
+    const int64_t column = m_columnAt(point.x);
+    if (trace.started) {
+        // a point from before the window is left of the clip anyway, only keep it in int range
+        const int64_t from = std::max(trace.lastColumn - left, static_cast<int64_t>(-m_image.width()));
+        lines.append(QLine(static_cast<int>(from), m_rowAt(trace.lastY),
+                           static_cast<int>(column - left), m_rowAt(point.y)));
+    }
+    trace.started = true;
+    trace.lastColumn = column;
+    trace.lastY = point.y;
+}
+
+void StripChart::m_drawLines(QPainter &painter, const QVector<QLine> &lines, const QColor &color) {
+    if (lines.isEmpty()) {
+        return;
+    }
+    // columns from the left edge start at the ring's split, so they are drawn twice: once for
+    // the part of the image right of the split, once shifted a width back for the part left of it
+    const int width = m_image.width();
+    const int split = static_cast<int>((m_column + 1) % width);
+    painter.save();
+    painter.setPen(QPen(color, 1.0));
+    painter.setClipRect(split, 0, width - split, m_image.height());
+    painter.translate(split, 0);
+    painter.drawLines(lines);
+    if (split > 0) {
+        painter.resetTransform();
+        painter.setClipRect(0, 0, split, m_image.height());
+        painter.translate(split - width, 0);
+        painter.drawLines(lines);
+    }
+    painter.restore();
+}
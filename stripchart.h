@@ -0,0 +1,95 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STRIPCHART_H
+#define STRIPCHART_H
+
+#include <memory>
+#include <vector>
+#include <QColor>
+#include <QImage>
+#include <QLine>
+#include <QPainter>
+#include <QVector>
+#include <QWidget>
+#include "lodseries.h"
+
+/*
+ * Scrolling raster chart of the last window() seconds, a cheaper stand-in for
+ * a QChartView in the live view. The plot is kept in a backing image used as
+ * a ring of pixel columns: new samples only clear and draw the columns they
+ * advance into, and a paint just blits the ring in two pieces, so the cost per
+ * sample does not grow with the charge. The whole image is redrawn from the
+ * traces' LOD selection only when the window, the size or the vertical range
+ * changes. The vertical range only grows while live, to keep that rare.
+ */
+class StripChart : public QWidget {
+    Q_OBJECT
+public:
+    explicit StripChart(QWidget *parent = 0);
+
+    void setTitle(const QString &title);
+    // takes ownership of the source
+    void addTrace(LodSeries::Source *source, const QColor &color);
+    void clearTraces();
+
+    double window() const { return m_window; }
+    void setWindow(double seconds);
+
+public slots:
+    // draws what the sources gained since the last call; a cleared source redraws from scratch
+    void appendSamples();
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void wheelEvent(QWheelEvent *event);
+
+private:
+    struct Trace {
+        std::unique_ptr<LodSeries::Source> source;
+        LodSeries lod;
+        QColor color;
+        std::size_t drawn = 0;      // points of the source already in the image
+        bool started = false;
+        int64_t lastColumn = 0;     // column and value of the last drawn point
+        double lastY = 0.0;
+
+        Trace(LodSeries::Source *source, const QColor &color) : source(source), lod(source), color(color) {}
+    };
+
+    QString m_title;
+    std::vector<std::unique_ptr<Trace>> m_traces;
+    double m_window;
+    QImage m_image;
+    int64_t m_column = -1;          // absolute column of the right edge, -1 before the first point
+    double m_yMin = 0.0, m_yMax = 0.0;
+
+    QRect m_plotRect() const;
+    double m_secondsPerColumn() const { return m_window / m_image.width(); }
+    int64_t m_columnAt(double x) const;
+    int m_rowAt(double y) const;
+    void m_redraw();
+    void m_fitRange(double min, double max);
+    void m_advance(int64_t column);
+    // a line from the trace's last point, in columns counted from the left edge
+    void m_lineTo(Trace &trace, const LodSeries::Point &point, QVector<QLine> &lines);
+    void m_drawLines(QPainter &painter, const QVector<QLine> &lines, const QColor &color);
+};
+
+#endif // STRIPCHART_H
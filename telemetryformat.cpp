@@ -0,0 +1,105 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "chargeprofiles.h"
+#include "telemetryformat.h"
+
+static QByteArray jsonLine(const QJsonObject &object) {
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QByteArray TelemetryFormat::sampleJson(const QString &location, uint32_t timeMs, const b6::ChargeInfo &info, int cellCount) {
+    QJsonArray cells;
+    for (int i = 0; i < cellCount && i < 8; i++) {
+        cells.append(static_cast<int>(info.cells[i]));
+    }
+
+    QJsonObject object;
+    object["event"] = "sample";
+    object["location"] = location;
+    object["state"] = static_cast<int>(info.state);
+    object["time"] = static_cast<int>(info.time);
+    object["timeMs"] = static_cast<double>(timeMs);
+    object["current"] = static_cast<int>(info.current);
+    object["voltage"] = static_cast<int>(info.voltage);
+    object["capacity"] = static_cast<int>(info.capacity);
+    object["tempInt"] = static_cast<int>(info.tempInt);
+    object["tempExt"] = static_cast<int>(info.tempExt);
+    object["cells"] = cells;
+    return jsonLine(object);
+}
+
+QByteArray TelemetryFormat::eventJson(const QString &location, const QString &event, const QString &message) {
+    QJsonObject object;
+    object["event"] = event;
+    object["location"] = location;
+    if (!message.isEmpty()) {
+        object["message"] = message;
+    }
+    return jsonLine(object);
+}
+
+QByteArray TelemetryFormat::summaryJson(const ChargeSummary &summary) {
+    static const char *outcomes[] = { "completed", "stopped", "failed" };
+
+    QJsonObject object;
+    object["event"] = "summary";
+    object["id"] = static_cast<double>(summary.id);
+    object["pack"] = QString::fromStdString(summary.pack);
+    object["location"] = QString::fromStdString(summary.location);
+    object["log"] = QString::fromStdString(summary.log);
+    object["startedAt"] = static_cast<double>(summary.startedAtMs);
+    object["type"] = ChargeProfiles::batteryTypeName(summary.batteryType);
+    object["mode"] = ChargeProfiles::modeName(summary.batteryType, summary.mode);
+    object["cells"] = summary.cellCount;
+    object["outcome"] = outcomes[summary.outcome];
+    object["capacity"] = summary.capacity;
+    object["duration"] = summary.durationS;
+    object["energy"] = summary.energyWh;
+    object["maxTemp"] = summary.maxTemp;
+    object["resistance"] = summary.resistance;
+    object["maxCellDelta"] = summary.maxCellDelta;
+    object["endVoltage"] = summary.endVoltage;
+    return jsonLine(object);
+}
+
+QByteArray TelemetryFormat::csvHeader(int cellCount) {
+    QByteArray line("location,state,time_s,current_mA,voltage_mV,capacity_mAh,temp_int_C,temp_ext_C");
+    for (int i = 0; i < cellCount && i < 8; i++) {
+        line += ",cell" + QByteArray::number(i + 1) + "_mV";
+    }
+    return line + '\n';
+}
+
+QByteArray TelemetryFormat::sampleCsv(const QString &location, const b6::ChargeInfo &info, int cellCount) {
+    QByteArray line = location.toUtf8();
+    line += ',' + QByteArray::number(static_cast<int>(info.state));
+    line += ',' + QByteArray::number(static_cast<int>(info.time));
+    line += ',' + QByteArray::number(static_cast<int>(info.current));
+    line += ',' + QByteArray::number(static_cast<int>(info.voltage));
+    line += ',' + QByteArray::number(static_cast<int>(info.capacity));
+    line += ',' + QByteArray::number(static_cast<int>(info.tempInt));
+    line += ',' + QByteArray::number(static_cast<int>(info.tempExt));
+    for (int i = 0; i < cellCount && i < 8; i++) {
+        line += ',' + QByteArray::number(static_cast<int>(info.cells[i]));
+    }
+    return line + '\n';
+}
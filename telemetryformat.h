@@ -0,0 +1,41 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRYFORMAT_H
+#define TELEMETRYFORMAT_H
+
+#include <QByteArray>
+#include <QString>
+#include <b6/Device.hh>
+#include "chargesummary.h"
+
+/*
+ * Text encodings of live telemetry for consumers outside the GUI: one JSON
+ * object per line, or CSV rows. Every line ends with '\n'.
+ */
+namespace TelemetryFormat {
+    // timeMs is the charge time in ms, finer than info.time when the charger is polled faster
+    QByteArray sampleJson(const QString &location, uint32_t timeMs, const b6::ChargeInfo &info, int cellCount);
+    QByteArray eventJson(const QString &location, const QString &event, const QString &message = QString());
+    QByteArray summaryJson(const ChargeSummary &summary);
+
+    QByteArray csvHeader(int cellCount);
+    QByteArray sampleCsv(const QString &location, const b6::ChargeInfo &info, int cellCount);
+}
+
+#endif // TELEMETRYFORMAT_H
@@ -0,0 +1,173 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "chargeprofiles.h"
+#include "telemetryformat.h"
+#include "telemetryserver.h"
+
+static QString stringValue(const QJsonObject &object, const QString &key, const QString &defaultValue) {
+    return object.contains(key) ? object.value(key).toString() : defaultValue;
+}
+
+TelemetryServer::TelemetryServer(DeviceManager *devices, QObject *parent) : QObject(parent), m_devices(devices) {
+    m_server = new QLocalServer(this);
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+
+    connect(devices, SIGNAL(sessionAdded(ChargerSession*)), this, SLOT(onSessionAdded(ChargerSession*)));
+    for (ChargerSession *session : devices->sessions()) {
+        onSessionAdded(session);
+    }
+}
+
+bool TelemetryServer::listen(const QString &name) {
+    // a server that crashed leaves its socket file behind
+    QLocalServer::removeServer(name);
+    return m_server->listen(name);
+}
+
+void TelemetryServer::onSessionAdded(ChargerSession *session) {
+    connect(session, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(session, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(session, SIGNAL(chargingChanged(bool)), this, SLOT(onChargingChanged(bool)));
+    connect(session, SIGNAL(chargeInfoUpdated()), this, SLOT(onChargeInfoUpdated()));
+    connect(session, SIGNAL(chargingCompleted(b6::ChargeInfo)), this, SLOT(onChargingCompleted(b6::ChargeInfo)));
+    connect(session, SIGNAL(chargingError(QString)), this, SLOT(onChargingError(QString)));
+}
+
+void TelemetryServer::onNewConnection() {
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_clients.insert(socket, Client());
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onClientReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
+    }
+}
+
+void TelemetryServer::onClientReadyRead() {
+    QLocalSocket *socket = static_cast<QLocalSocket*>(sender());
+    while (socket->canReadLine()) {
+        m_command(socket, socket->readLine().trimmed());
+    }
+
+    // a line no command comes close to would otherwise be buffered for as long as the client keeps sending
+    if (socket->bytesAvailable() > MAX_LINE_BYTES) {
+        socket->readAll();
+        m_send(socket, m_clients[socket], TelemetryFormat::eventJson(QString(), "rejected", "command line too long"));
+        socket->disconnectFromServer();
+    }
+}
+
+void TelemetryServer::onClientDisconnected() {
+    QLocalSocket *socket = static_cast<QLocalSocket*>(sender());
+    m_clients.remove(socket);
+    socket->deleteLater();
+}
+
+void TelemetryServer::onConnected() {
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    m_broadcast(TelemetryFormat::eventJson(session->location(), "connected", session->deviceInfo().coreType));
+}
+
+void TelemetryServer::onDisconnected() {
+    m_broadcast(TelemetryFormat::eventJson(static_cast<ChargerSession*>(sender())->location(), "disconnected"));
+}
+
+void TelemetryServer::onChargingChanged(bool charging) {
+    m_broadcast(TelemetryFormat::eventJson(static_cast<ChargerSession*>(sender())->location(),
+                                           charging ? "chargingStarted" : "chargingStopped"));
+}
+
+void TelemetryServer::onChargeInfoUpdated() {
+    if (m_clients.isEmpty()) {
+        return;
+    }
+
+    ChargerSession *session = static_cast<ChargerSession*>(sender());
+    m_broadcast(TelemetryFormat::sampleJson(session->location(), session->chargeTimeMs(), session->chargeInfo(), session->deviceInfo().cellCount));
+}
+
+void TelemetryServer::onChargingCompleted(b6::ChargeInfo) {
+    m_broadcast(TelemetryFormat::eventJson(static_cast<ChargerSession*>(sender())->location(), "completed"));
+}
+
+void TelemetryServer::onChargingError(QString message) {
+    m_broadcast(TelemetryFormat::eventJson(static_cast<ChargerSession*>(sender())->location(), "error", message));
+}
+
+void TelemetryServer::m_broadcast(const QByteArray &message) {
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        m_send(it.key(), it.value(), message);
+    }
+}
+
+void TelemetryServer::m_send(QLocalSocket *socket, Client &client, const QByteArray &message) {
+    if (socket->bytesToWrite() > MAX_PENDING_BYTES) {
+        client.dropped++;
+        m_dropped++;
+        return;
+    }
+
+    if (client.dropped > 0) {
+        socket->write(TelemetryFormat::eventJson(QString(), "dropped", QString::number(client.dropped)));
+        client.dropped = 0;
+    }
+    socket->write(message);
+}
+
+void TelemetryServer::m_command(QLocalSocket *socket, const QByteArray &line) {
+    if (line.isEmpty()) {
+        return;
+    }
+
+    QJsonObject command = QJsonDocument::fromJson(line).object();
+    QString location = command.value("location").toString();
+    if (location.isEmpty() && m_devices->sessions().size() == 1) {
+        location = m_devices->sessions().first()->location();
+    }
+
+    ChargerSession *session = m_devices->session(location);
+    QString name = command.value("command").toString();
+    QString error;
+    if (session == nullptr || !session->isConnected()) {
+        error = "no charger connected at '" + location + "'";
+    } else if (name == "stop") {
+        session->stopCharging();
+    } else if (name == "start") {
+        b6::BATTERY_TYPE battType;
+        b6::ChargeProfile settings = {};
+        if (!ChargeProfiles::parseBatteryType(stringValue(command, "type", "lipo"), battType)) {
+            error = "unknown battery type";
+        } else if (!ChargeProfiles::parseMode(battType, stringValue(command, "mode", "standard"), settings)) {
+            error = "unknown charging mode";
+        } else {
+            settings.cellCount = command.value("cells").toInt(1);
+            settings.chargeCurrent = command.value("chargeCurrent").toInt(100);
+            settings.dischargeCurrent = command.value("dischargeCurrent").toInt(100);
+            settings.cellDischargeVoltage = command.value("cellDischargeVoltage").toInt(3000);
+            settings.endVoltage = command.value("endVoltage").toInt(4100);
+            settings.rPeakCount = command.value("rPeakCount").toInt(1);
+            settings.cycleCount = command.value("cycleCount").toInt(1);
+            session->startCharging(battType, settings, stringValue(command, "pack", QString()));
+        }
+    } else {
+        error = "unknown command '" + name + "'";
+    }
+
+    m_send(socket, m_clients[socket], TelemetryFormat::eventJson(location, error.isEmpty() ? "ack" : "rejected", error));
+}
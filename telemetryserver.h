@@ -0,0 +1,83 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRYSERVER_H
+#define TELEMETRYSERVER_H
+
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include "chargersession.h"
+#include "devicemanager.h"
+
+/*
+ * Pushes the telemetry of every charger to local clients over a Unix domain
+ * socket, one JSON object per line (see TelemetryFormat). Each message is
+ * serialized once and the same buffer is queued to every client. A client
+ * that has more than MAX_PENDING_BYTES unsent has messages dropped instead;
+ * once it catches up it gets a "dropped" event with the count. Acquisition
+ * runs on the sessions' own threads and is never held up by clients.
+ *
+ * Clients may send commands, one JSON object per line:
+ *   {"command":"start","location":"1-2","type":"lipo","mode":"balance","cells":3,"chargeCurrent":1000,...}
+ *   {"command":"stop","location":"1-2"}
+ * A client that sends more than MAX_LINE_BYTES without a newline gets a
+ * "rejected" event and is disconnected.
+ */
+class TelemetryServer : public QObject {
+    Q_OBJECT
+public:
+    static const qint64 MAX_PENDING_BYTES = 256 * 1024;
+    static const qint64 MAX_LINE_BYTES = 64 * 1024;
+
+    explicit TelemetryServer(DeviceManager *devices, QObject *parent = 0);
+
+    bool listen(const QString &name);
+    QString serverName() const { return m_server->fullServerName(); }
+    int clientCount() const { return m_clients.size(); }
+    quint64 droppedMessages() const { return m_dropped; }
+
+private slots:
+    void onSessionAdded(ChargerSession *session);
+    void onNewConnection();
+    void onClientReadyRead();
+    void onClientDisconnected();
+    void onConnected();
+    void onDisconnected();
+    void onChargingChanged(bool charging);
+    void onChargeInfoUpdated();
+    void onChargingCompleted(b6::ChargeInfo info);
+    void onChargingError(QString message);
+
+private:
+    struct Client {
+        quint64 dropped = 0;
+    };
+
+    DeviceManager *m_devices;
+    QLocalServer *m_server;
+    QHash<QLocalSocket*, Client> m_clients;
+    quint64 m_dropped = 0;
+
+    void m_broadcast(const QByteArray &message);
+    void m_send(QLocalSocket *socket, Client &client, const QByteArray &message);
+    void m_command(QLocalSocket *socket, const QByteArray &line);
+};
+
+#endif // TELEMETRYSERVER_H
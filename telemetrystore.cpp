@@ -0,0 +1,345 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "diagnostics.h"
+#include "telemetrystore.h"
+
+template <typename T>
+static T clampTo(int64_t value) {
+    return static_cast<T>(std::min<int64_t>(std::max<int64_t>(value, std::numeric_limits<T>::min()),
+                                            std::numeric_limits<T>::max()));
+}
+
+TelemetryChunkPool &TelemetryChunkPool::instance() {
+    static TelemetryChunkPool pool;
+    return pool;
+}
+
+std::unique_ptr<uint8_t[]> TelemetryChunkPool::take(std::size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_free.find(bytes);
+        if (it != m_free.end() && !it->second.empty()) {
+            std::unique_ptr<uint8_t[]> chunk = std::move(it->second.back());
+            it->second.pop_back();
+            m_bytes -= bytes;
+            return chunk;
+        }
+    }
+    return std::unique_ptr<uint8_t[]>(new uint8_t[bytes]);
+}
+
+void TelemetryChunkPool::give(std::unique_ptr<uint8_t[]> chunk, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_bytes + bytes > m_maxBytes) {
+        return;
+    }
+    m_free[bytes].push_back(std::move(chunk));
+    m_bytes += bytes;
+}
+
+void TelemetryChunkPool::setMaxBytes(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxBytes = bytes;
+    m_trim();
+}
+
+std::size_t TelemetryChunkPool::maxBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxBytes;
+}
+
+std::size_t TelemetryChunkPool::bytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+void TelemetryChunkPool::m_trim() {
+    for (auto it = m_free.begin(); it != m_free.end() && m_bytes > m_maxBytes; ++it) {
+        while (!it->second.empty() && m_bytes > m_maxBytes) {
+            it->second.pop_back();
+            m_bytes -= it->first;
+        }
+    }
+}
+
+/*
+ * View of a coarsened chunk: for each of its buckets the time of the first
+ * and the last row, then per value column the minimum, maximum and average
+ * and the rows within the bucket the minimum and maximum came from.
+ */
+class TelemetryStore::Coarse {
+public:
+    Coarse(const uint8_t *data, int tier) : m_data(const_cast<uint8_t*>(data)), m_buckets(CHUNK_SAMPLES >> (4 * tier)) {}
+
+    static std::size_t bytes(int tier, int valueColumns) {
+        return (CHUNK_SAMPLES >> (4 * tier)) * (8 + 16 * static_cast<std::size_t>(valueColumns));
+    }
+
+    uint32_t *firstTime() const { return reinterpret_cast<uint32_t*>(m_data); }
+    uint32_t *lastTime() const { return reinterpret_cast<uint32_t*>(m_data + 4 * m_buckets); }
+    int32_t *min(int column) const { return reinterpret_cast<int32_t*>(m_column(column)); }
+    int32_t *max(int column) const { return reinterpret_cast<int32_t*>(m_column(column) + 4 * m_buckets); }
+    int32_t *avg(int column) const { return reinterpret_cast<int32_t*>(m_column(column) + 8 * m_buckets); }
+    uint16_t *minRow(int column) const { return reinterpret_cast<uint16_t*>(m_column(column) + 12 * m_buckets); }
+    uint16_t *maxRow(int column) const { return reinterpret_cast<uint16_t*>(m_column(column) + 14 * m_buckets); }
+
+private:
+    uint8_t *m_data;
+    std::size_t m_buckets;
+
+    uint8_t *m_column(int column) const { return m_data + 8 * m_buckets + 16 * m_buckets * column; }
+};
+
+std::size_t TelemetryStore::m_defaultBudget = 0;
+
+void TelemetryStore::setDefaultBudget(std::size_t bytes) {
+    m_defaultBudget = bytes;
+}
+
+TelemetryStore::TelemetryStore(int cellCount) : m_budget(m_defaultBudget) {
+    reset(cellCount);
+}
+
+TelemetryStore::~TelemetryStore() {
+    clear();
+}
+
+void TelemetryStore::setBudget(std::size_t bytes) {
+    m_budget = bytes;
+}
+
+void TelemetryStore::reset(int cellCount) {
+    // chunks go back to the pool at their current size, before the layout changes
+    clear();
+    m_cellCount = std::min(std::max(cellCount, 0), MAX_CELLS);
+
+    // widest columns first so every column stays naturally aligned
+    m_timeOffset = 0;
+    m_capacityOffset = m_timeOffset + 4 * CHUNK_SAMPLES;
+    m_currentOffset = m_capacityOffset + 4 * CHUNK_SAMPLES;
+    m_voltageOffset = m_currentOffset + 2 * CHUNK_SAMPLES;
+    m_cellsOffset = m_voltageOffset + 2 * CHUNK_SAMPLES;
+    m_tempIntOffset = m_cellsOffset + m_cellCount * 2 * CHUNK_SAMPLES;
+    m_tempExtOffset = m_tempIntOffset + CHUNK_SAMPLES;
+    m_chunkBytes = m_tempExtOffset + CHUNK_SAMPLES;
+}
+
+void TelemetryStore::clear() {
+    TelemetryChunkPool &pool = TelemetryChunkPool::instance();
+    for (Chunk &chunk : m_chunks) {
+        if (chunk.tier == 0) {
+            pool.give(std::move(chunk.data), m_chunkBytes);
+        }
+    }
+    m_chunks.clear();
+    m_size = 0;
+    m_bytes = 0;
+    m_coarsest = 0;
+}
+
+void TelemetryStore::append(uint32_t timeMs, const b6::ChargeInfo &info) {
+    if (m_size == m_chunks.size() * CHUNK_SAMPLES) {
+        Chunk chunk = { 0, TelemetryChunkPool::instance().take(m_chunkBytes) };
+        m_chunks.push_back(std::move(chunk));
+        m_bytes += m_chunkBytes;
+    }
+
+    const std::size_t index = m_size;
+    m_setColumn<uint32_t>(index, m_timeOffset, timeMs);
+    m_setColumn<uint32_t>(index, m_capacityOffset, clampTo<uint32_t>(info.capacity));
+    m_setColumn<int16_t>(index, m_currentOffset, clampTo<int16_t>(info.current));
+    m_setColumn<uint16_t>(index, m_voltageOffset, clampTo<uint16_t>(info.voltage));
+    for (int i = 0; i < m_cellCount; i++) {
+        m_setColumn<uint16_t>(index, m_cellsOffset + i * 2 * CHUNK_SAMPLES, clampTo<uint16_t>(info.cells[i]));
+    }
+    m_setColumn<int8_t>(index, m_tempIntOffset, clampTo<int8_t>(info.tempInt));
+    m_setColumn<int8_t>(index, m_tempExtOffset, clampTo<int8_t>(info.tempExt));
+    m_size++;
+
+    // one tier of one chunk per sample keeps every append short, a new chunk is
+    // brought back under the budget within a few samples; with every full chunk
+    // at MAX_TIER the store stays over it
+    if (m_budget > 0 && m_bytes > m_budget && m_coarsest + 1 < m_chunks.size()) {
+        m_coarsen(m_chunks[m_coarsest]);
+        if (m_chunks[m_coarsest].tier == MAX_TIER) {
+            m_coarsest++;
+        }
+    }
+}
+
+int64_t TelemetryStore::value(Column column, int cell, std::size_t index) const {
+    switch (column) {
+    case TIME:
+        return timeMs(index);
+    case CURRENT:
+        return current(index);
+    case VOLTAGE:
+        return voltage(index);
+    case CAPACITY:
+        return capacity(index);
+    case TEMP_INT:
+        return tempInt(index);
+    case TEMP_EXT:
+        return tempExt(index);
+    case CELL:
+        return cell >= 0 && cell < m_cellCount ? this->cell(cell, index) : 0;
+    }
+    return 0;
+}
+
+std::size_t TelemetryStore::m_bytesOf(int tier) const {
+    return tier == 0 ? m_chunkBytes : Coarse::bytes(tier, m_valueColumns());
+}
+
+int TelemetryStore::m_rawValue(const Chunk &chunk, int valueColumn, std::size_t row) const {
+    switch (valueColumn) {
+    case 0:
+        return m_raw<int16_t>(chunk, row, m_currentOffset);
+    case 1:
+        return m_raw<uint16_t>(chunk, row, m_voltageOffset);
+    case 2:
+        return static_cast<int>(m_raw<uint32_t>(chunk, row, m_capacityOffset));
+    case 3:
+        return m_raw<int8_t>(chunk, row, m_tempIntOffset);
+    case 4:
+        return m_raw<int8_t>(chunk, row, m_tempExtOffset);
+    default:
+        return m_raw<uint16_t>(chunk, row, m_cellsOffset + (valueColumn - 5) * 2 * CHUNK_SAMPLES);
+    }
+}
+
+uint32_t TelemetryStore::m_coarseTime(const Chunk &chunk, std::size_t index) const {
+    const Coarse coarse(chunk.data.get(), chunk.tier);
+    const std::size_t span = m_span(chunk.tier);
+    const std::size_t bucket = index % CHUNK_SAMPLES / span;
+    const uint64_t first = coarse.firstTime()[bucket], last = coarse.lastTime()[bucket];
+    return static_cast<uint32_t>(first + (last - first) * (index % span) / (span - 1));
+}
+
+int TelemetryStore::m_coarseValue(const Chunk &chunk, int valueColumn, std::size_t index) const {
+    const Coarse coarse(chunk.data.get(), chunk.tier);
+    const std::size_t span = m_span(chunk.tier);
+    const std::size_t bucket = index % CHUNK_SAMPLES / span;
+    const std::size_t row = index % span;
+    if (row == coarse.minRow(valueColumn)[bucket]) {
+        return coarse.min(valueColumn)[bucket];
+    }
+    if (row == coarse.maxRow(valueColumn)[bucket]) {
+        return coarse.max(valueColumn)[bucket];
+    }
+    return coarse.avg(valueColumn)[bucket];
+}
+
+void TelemetryStore::m_coarsen(Chunk &chunk) {
+    static LatencyHistogram &coarsenTime = Diagnostics::histogram("store.coarsen");
+    LatencyHistogram::Scope timing(coarsenTime);
+
+    const int tier = chunk.tier + 1;
+    const std::size_t buckets = CHUNK_SAMPLES / m_span(tier);
+    std::unique_ptr<uint8_t[]> data(new uint8_t[m_bytesOf(tier)]);
+    const Coarse to(data.get(), tier);
+
+    if (chunk.tier == 0) {
+        const std::size_t span = TIER_FACTOR;
+        for (std::size_t b = 0; b < buckets; b++) {
+            to.firstTime()[b] = m_raw<uint32_t>(chunk, b * span, m_timeOffset);
+            to.lastTime()[b] = m_raw<uint32_t>(chunk, b * span + span - 1, m_timeOffset);
+        }
+        for (int column = 0; column < m_valueColumns(); column++) {
+            for (std::size_t b = 0; b < buckets; b++) {
+                int64_t sum = 0;
+                int min = std::numeric_limits<int>::max(), max = std::numeric_limits<int>::min();
+                uint16_t minRow = 0, maxRow = 0;
+                // the first of equal minima and the last of equal maxima, so a column that only counts
+                // up, like the capacity, still does row by row when read back
+                for (std::size_t row = 0; row < span; row++) {
+                    const int value = m_rawValue(chunk, column, b * span + row);
+                    sum += value;
+                    if (value < min) {
+                        min = value;
+                        minRow = static_cast<uint16_t>(row);
+                    }
+                    if (value >= max) {
+                        max = value;
+                        maxRow = static_cast<uint16_t>(row);
+                    }
+                }
+                to.min(column)[b] = min;
+                to.max(column)[b] = max;
+                to.avg(column)[b] = static_cast<int32_t>(std::llround(static_cast<double>(sum) / span));
+                to.minRow(column)[b] = minRow;
+                to.maxRow(column)[b] = maxRow;
+            }
+        }
+        TelemetryChunkPool::instance().give(std::move(chunk.data), m_chunkBytes);
+    } else {
+        const Coarse from(chunk.data.get(), chunk.tier);
+        const std::size_t span = m_span(chunk.tier);
+        for (std::size_t b = 0; b < buckets; b++) {
+            to.firstTime()[b] = from.firstTime()[b * TIER_FACTOR];
+            to.lastTime()[b] = from.lastTime()[b * TIER_FACTOR + TIER_FACTOR - 1];
+        }
+        for (int column = 0; column < m_valueColumns(); column++) {
+            for (std::size_t b = 0; b < buckets; b++) {
+                int64_t sum = 0;
+                std::size_t minFrom = b * TIER_FACTOR, maxFrom = b * TIER_FACTOR;
+                for (std::size_t i = b * TIER_FACTOR; i < (b + 1) * TIER_FACTOR; i++) {
+                    sum += from.avg(column)[i];
+                    if (from.min(column)[i] < from.min(column)[minFrom]) {
+                        minFrom = i;
+                    }
+                    if (from.max(column)[i] >= from.max(column)[maxFrom]) {
+                        maxFrom = i;
+                    }
+                }
+                to.min(column)[b] = from.min(column)[minFrom];
+                to.max(column)[b] = from.max(column)[maxFrom];
+                to.avg(column)[b] = static_cast<int32_t>(std::llround(static_cast<double>(sum) / TIER_FACTOR));
+                to.minRow(column)[b] = static_cast<uint16_t>((minFrom % TIER_FACTOR) * span + from.minRow(column)[minFrom]);
+                to.maxRow(column)[b] = static_cast<uint16_t>((maxFrom % TIER_FACTOR) * span + from.maxRow(column)[maxFrom]);
+            }
+        }
+    }
+
+    m_bytes = m_bytes - m_bytesOf(chunk.tier) + m_bytesOf(tier);
+    chunk.tier = tier;
+    chunk.data = std::move(data);
+}
+
+void CapacityAxis::reset() {
+    m_rising = 0;
+    m_lastCapacity = 0;
+    m_fell = false;
+}
+
+std::size_t CapacityAxis::size() const {
+    const std::size_t size = m_source->size();
+    for (; !m_fell && m_rising < size; m_rising++) {
+        const int capacity = m_store->capacity(m_rising);
+        if (capacity < m_lastCapacity) {
+            m_fell = true;
+            break;
+        }
+        m_lastCapacity = capacity;
+    }
+    return std::min(m_rising, size);
+}
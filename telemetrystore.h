@@ -0,0 +1,237 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <b6/Device.hh>
+#include "lodseries.h"
+
+/*
+ * Free chunks of TelemetryStore storage, shared by all stores. A store hands
+ * its chunks back when it is cleared and takes them from here before it
+ * allocates, so charge after charge runs on the same blocks instead of
+ * leaving the heap to fragment. At most maxBytes() are kept, anything beyond
+ * that goes back to the allocator.
+ */
+class TelemetryChunkPool {
+public:
+    static const std::size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+
+    static TelemetryChunkPool &instance();
+
+    std::unique_ptr<uint8_t[]> take(std::size_t bytes);
+    void give(std::unique_ptr<uint8_t[]> chunk, std::size_t bytes);
+
+    void setMaxBytes(std::size_t bytes);
+    std::size_t maxBytes() const;
+    // bytes held in free chunks
+    std::size_t bytes() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::size_t m_maxBytes = DEFAULT_MAX_BYTES;
+    std::size_t m_bytes = 0;
+    // free chunks by size, a store's chunk size depends on its cell count
+    std::map<std::size_t, std::vector<std::unique_ptr<uint8_t[]>>> m_free;
+
+    void m_trim();
+};
+
+/*
+ * Samples of one charge, stored column by column in the units b6::ChargeInfo
+ * uses (ms, mA, mV, mAh, °C). Storage grows in fixed-size chunks, each one a
+ * single allocation holding CHUNK_SAMPLES rows of every column, so appending
+ * never moves existing data.
+ *
+ * A row takes 14 + 2 * cellCount bytes (26 bytes for a 6S pack), against
+ * 16 bytes per value when every quantity was kept as a QPointF in its own
+ * QLineSeries. Chunks come from and go back to the TelemetryChunkPool.
+ *
+ * With a budget set, full chunks are coarsened oldest first once the store
+ * outgrows it, one tier per append: a tier keeps the minimum, maximum and
+ * average of every TIER_FACTOR buckets of the tier below, down to a single
+ * bucket per chunk (about 200 bytes for 4096 samples of a 6S pack). Indices
+ * stay valid. A row of a coarsened chunk reads as the minimum or maximum of
+ * its bucket if that is where the extreme was (the first of equal minima, the
+ * last of equal maxima), as the average otherwise, so a column that never
+ * decreases reads back that way.
+ * Its time is interpolated over the bucket. The chunk being filled is always
+ * kept at full resolution.
+ *
+ * The budget is a target, not a hard cap: once every full chunk is down to a
+ * single bucket there is nothing left to coarsen, and the store keeps growing
+ * by that bucket per chunk (about 4 KiB a day at 1 Hz) plus the chunk being
+ * filled.
+ */
+class TelemetryStore {
+public:
+    enum Column { TIME, CURRENT, VOLTAGE, CAPACITY, TEMP_INT, TEMP_EXT, CELL };
+
+    static const std::size_t CHUNK_SAMPLES = 4096;
+    static const int MAX_CELLS = 8;
+    static const std::size_t TIER_FACTOR = 16;
+    static const int MAX_TIER = 3;      // TIER_FACTOR^3 = CHUNK_SAMPLES
+
+    explicit TelemetryStore(int cellCount = MAX_CELLS);
+    ~TelemetryStore();
+
+    // budget of stores created from now on, 0 for no limit; see above for what
+    // it does not bound
+    static void setDefaultBudget(std::size_t bytes);
+    void setBudget(std::size_t bytes);
+    std::size_t budget() const { return m_budget; }
+
+    void reset(int cellCount);
+    void clear();
+    void append(uint32_t timeMs, const b6::ChargeInfo &info);
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    int cellCount() const { return m_cellCount; }
+
+    uint32_t timeMs(std::size_t index) const {
+        const Chunk &chunk = m_chunks[index / CHUNK_SAMPLES];
+        return chunk.tier == 0 ? m_raw<uint32_t>(chunk, index, m_timeOffset) : m_coarseTime(chunk, index);
+    }
+    int current(std::size_t index) const { return m_column<int16_t>(index, m_currentOffset, 0); }
+    int voltage(std::size_t index) const { return m_column<uint16_t>(index, m_voltageOffset, 1); }
+    int capacity(std::size_t index) const { return m_column<uint32_t>(index, m_capacityOffset, 2); }
+    int tempInt(std::size_t index) const { return m_column<int8_t>(index, m_tempIntOffset, 3); }
+    int tempExt(std::size_t index) const { return m_column<int8_t>(index, m_tempExtOffset, 4); }
+    int cell(int cell, std::size_t index) const {
+        return m_column<uint16_t>(index, m_cellsOffset + cell * 2 * CHUNK_SAMPLES, 5 + cell);
+    }
+
+    int64_t value(Column column, int cell, std::size_t index) const;
+
+    // rows that share one stored value at index, 1 at full resolution
+    std::size_t resolution(std::size_t index) const { return m_span(m_chunks[index / CHUNK_SAMPLES].tier); }
+
+    std::size_t bytesPerSample() const { return m_chunkBytes / CHUNK_SAMPLES; }
+    std::size_t bytesAllocated() const { return m_bytes; }
+
+private:
+    struct Chunk {
+        int tier;
+        std::unique_ptr<uint8_t[]> data;
+    };
+    class Coarse;
+
+    static std::size_t m_defaultBudget;
+
+    int m_cellCount = 0;
+    std::size_t m_size = 0;
+    std::size_t m_budget = 0;
+    std::size_t m_bytes = 0;
+    std::size_t m_coarsest = 0;         // chunks before this one are at MAX_TIER
+    std::size_t m_chunkBytes = 0;
+    std::size_t m_timeOffset = 0, m_capacityOffset = 0, m_currentOffset = 0, m_voltageOffset = 0,
+                m_cellsOffset = 0, m_tempIntOffset = 0, m_tempExtOffset = 0;
+    std::vector<Chunk> m_chunks;
+
+    static std::size_t m_span(int tier) { return std::size_t(1) << (4 * tier); }
+    int m_valueColumns() const { return 5 + m_cellCount; }
+    std::size_t m_bytesOf(int tier) const;
+
+    template <typename T>
+    T m_raw(const Chunk &chunk, std::size_t index, std::size_t offset) const {
+        return reinterpret_cast<const T*>(chunk.data.get() + offset)[index % CHUNK_SAMPLES];
+    }
+
+    // value columns are numbered current, voltage, capacity, temp int, temp ext, cells
+    template <typename T>
+    int m_column(std::size_t index, std::size_t offset, int valueColumn) const {
+        const Chunk &chunk = m_chunks[index / CHUNK_SAMPLES];
+        return chunk.tier == 0 ? m_raw<T>(chunk, index, offset) : m_coarseValue(chunk, valueColumn, index);
+    }
+
+    template <typename T>
+    void m_setColumn(std::size_t index, std::size_t offset, T value) {
+        uint8_t *chunk = m_chunks[index / CHUNK_SAMPLES].data.get();
+        reinterpret_cast<T*>(chunk + offset)[index % CHUNK_SAMPLES] = value;
+    }
+
+    int m_rawValue(const Chunk &chunk, int valueColumn, std::size_t row) const;
+    uint32_t m_coarseTime(const Chunk &chunk, std::size_t index) const;
+    int m_coarseValue(const Chunk &chunk, int valueColumn, std::size_t index) const;
+    void m_coarsen(Chunk &chunk);
+};
+
+/*
+ * One column of a TelemetryStore as chart points: x in seconds, y scaled by
+ * the given factor (e.g. 0.001 to plot mV as V).
+ */
+class TelemetryColumn : public LodSeries::Source {
+public:
+    TelemetryColumn(const TelemetryStore *store, TelemetryStore::Column column, int cell = 0, double scale = 1.0)
+        : m_store(store), m_column(column), m_cell(cell), m_scale(scale) {}
+
+    std::size_t size() const override { return m_store->size(); }
+    std::size_t resolution(std::size_t index) const override { return m_store->resolution(index); }
+    LodSeries::Point at(std::size_t index) const override {
+        LodSeries::Point point = { m_store->timeMs(index) / 1000.0,
+                                   m_store->value(m_column, m_cell, index) * m_scale };
+        return point;
+    }
+
+private:
+    const TelemetryStore *m_store;
+    TelemetryStore::Column m_column;
+    int m_cell;
+    double m_scale;
+};
+
+/*
+ * The points of another source over the same store, placed against the
+ * capacity charged instead of the time. The charger's capacity counter starts
+ * over with every phase (the cycles of a Ni cycle or re-peak run, a charge
+ * after a discharge), so only the first phase is shown, up to where the
+ * counter first goes back, the way ChargeOverlay clips past charges. Call
+ * reset() when the store is.
+ */
+class CapacityAxis : public LodSeries::Source {
+public:
+    CapacityAxis(const TelemetryStore *store, const LodSeries::Source *source) : m_store(store), m_source(source) {}
+
+    void reset();
+
+    std::size_t size() const override;
+    std::size_t resolution(std::size_t index) const override { return m_source->resolution(index); }
+    LodSeries::Point at(std::size_t index) const override {
+        LodSeries::Point point = m_source->at(index);
+        point.x = m_store->capacity(index);
+        return point;
+    }
+
+private:
+    const TelemetryStore *m_store;
+    const LodSeries::Source *m_source;
+    // the rising prefix as found so far, extended as samples come in
+    mutable std::size_t m_rising = 0;
+    mutable int m_lastCapacity = 0;
+    mutable bool m_fell = false;
+};
+
+#endif // TELEMETRYSTORE_H
@@ -0,0 +1,247 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "usbhotplugmonitor.h"
+
+UsbHotplugMonitor::UsbHotplugMonitor(QObject *parent) : QObject(parent) {
+}
+
+UsbHotplugMonitor::~UsbHotplugMonitor() {
+    if (m_ctx != nullptr) {
+        libusb_set_pollfd_notifiers(m_ctx, nullptr, nullptr, nullptr);
+        if (m_callbackRegistered) {
+            libusb_hotplug_deregister_callback(m_ctx, m_callback);
+        }
+        libusb_exit(m_ctx);
+    }
+    if (m_netlinkFd >= 0) {
+        close(m_netlinkFd);
+    }
+}
+
+void UsbHotplugMonitor::start() {
+    if (libusb_init(&m_ctx) != LIBUSB_SUCCESS) {
+        m_ctx = nullptr;
+        return;
+    }
+    if (m_startHotplug()) {
+        return;
+    }
+
+    // neither of the fallbacks reports chargers that are already plugged in
+    onEnumerate();
+    if (!m_startNetlink()) {
+        m_enumerateTimer = new QTimer(this);
+        connect(m_enumerateTimer, SIGNAL(timeout()), this, SLOT(onEnumerate()));
+        m_enumerateTimer->start(std::chrono::milliseconds(1000));
+    }
+}
+
+QString UsbHotplugMonitor::locationOf(libusb_device *dev) {
+    uint8_t ports[8];
+    int count = libusb_get_port_numbers(dev, ports, sizeof(ports));
+
+    QString location = QString::number(libusb_get_bus_number(dev)) + '-';
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            location += '.';
+        }
+        location += QString::number(ports[i]);
+    }
+    return location;
+}
+
+libusb_device *UsbHotplugMonitor::findDevice(libusb_device **list, ssize_t count, const QString &location) {
+    for (ssize_t i = 0; i < count; i++) {
+        libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) != LIBUSB_SUCCESS) {
+            continue;
+        }
+        if (desc.idVendor == VENDOR_ID && desc.idProduct == PRODUCT_ID && locationOf(list[i]) == location) {
+            return list[i];
+        }
+    }
+    return nullptr;
+}
+
+bool UsbHotplugMonitor::m_startHotplug() {
+    if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        return false;
+    }
+
+    const libusb_pollfd **fds = libusb_get_pollfds(m_ctx);
+    if (fds != nullptr) {
+        for (int i = 0; fds[i] != nullptr; i++) {
+            m_addPollfd(fds[i]->fd, fds[i]->events);
+        }
+        libusb_free_pollfds(fds);
+    }
+    libusb_set_pollfd_notifiers(m_ctx, &UsbHotplugMonitor::m_pollfdAdded, &UsbHotplugMonitor::m_pollfdRemoved, this);
+
+    // ENUMERATE makes libusb report chargers that are already plugged in, too
+    int err = libusb_hotplug_register_callback(m_ctx,
+            static_cast<libusb_hotplug_event>(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+            LIBUSB_HOTPLUG_ENUMERATE, VENDOR_ID, PRODUCT_ID, LIBUSB_HOTPLUG_MATCH_ANY,
+            &UsbHotplugMonitor::m_hotplugCallback, this, &m_callback);
+    m_callbackRegistered = err == LIBUSB_SUCCESS;
+    return m_callbackRegistered;
+}
+
+bool UsbHotplugMonitor::m_startNetlink() {
+    m_netlinkFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (m_netlinkFd < 0) {
+        return false;
+    }
+
+    sockaddr_nl addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // kernel uevents
+    if (bind(m_netlinkFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(m_netlinkFd);
+        m_netlinkFd = -1;
+        return false;
+    }
+
+    m_netlinkNotifier = new QSocketNotifier(m_netlinkFd, QSocketNotifier::Read, this);
+    connect(m_netlinkNotifier, SIGNAL(activated(int)), this, SLOT(onNetlinkActivity()));
+    return true;
+}
+
+void UsbHotplugMonitor::onLibusbActivity() {
+    timeval tv = { 0, 0 };
+    libusb_handle_events_timeout_completed(m_ctx, &tv, nullptr);
+}
+
+void UsbHotplugMonitor::onNetlinkActivity() {
+    char buf[4096];
+    const QByteArray product = QByteArray::number(VENDOR_ID, 16) + '/' + QByteArray::number(PRODUCT_ID, 16) + '/';
+
+    ssize_t len;
+    while ((len = recv(m_netlinkFd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[len] = '\0';
+
+        // payload is "action@devpath" followed by NUL separated KEY=value pairs
+        QByteArray action, devPath;
+        bool usbDevice = false, charger = false;
+        for (ssize_t i = 0; i < len; i += std::strlen(buf + i) + 1) {
+            QByteArray entry(buf + i);
+            if (entry.startsWith("ACTION=")) {
+                action = entry.mid(7);
+            } else if (entry.startsWith("DEVPATH=")) {
+                devPath = entry.mid(8);
+            } else if (entry == "DEVTYPE=usb_device") {
+                usbDevice = true;
+            } else if (entry.startsWith("PRODUCT=")) {
+                charger = entry.mid(8).startsWith(product);
+            }
+        }
+
+        if (!usbDevice || !charger) {
+            continue;
+        }
+        QString location = QString::fromLatin1(devPath.mid(devPath.lastIndexOf('/') + 1));
+        if (action == "add" && !m_present.contains(location)) {
+            m_present.insert(location);
+            emit deviceArrived(location);
+        } else if (action == "remove" && m_present.remove(location)) {
+            emit deviceLeft(location);
+        }
+    }
+}
+
+void UsbHotplugMonitor::onEnumerate() {
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(m_ctx, &list);
+    if (count < 0) {
+        return;
+    }
+
+    QSet<QString> present;
+    for (ssize_t i = 0; i < count; i++) {
+        libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) == LIBUSB_SUCCESS &&
+                desc.idVendor == VENDOR_ID && desc.idProduct == PRODUCT_ID) {
+            present.insert(locationOf(list[i]));
+        }
+    }
+    libusb_free_device_list(list, 1);
+
+    for (const QString &location : present) {
+        if (!m_present.contains(location)) {
+            emit deviceArrived(location);
+        }
+    }
+    for (const QString &location : m_present) {
+        if (!present.contains(location)) {
+            emit deviceLeft(location);
+        }
+    }
+    m_present = present;
+}
+
+void UsbHotplugMonitor::m_addPollfd(int fd, short events) {
+    if (events & POLLIN) {
+        QSocketNotifier *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(onLibusbActivity()));
+        m_readNotifiers.insert(fd, notifier);
+    }
+    if (events & POLLOUT) {
+        QSocketNotifier *notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(onLibusbActivity()));
+        m_writeNotifiers.insert(fd, notifier);
+    }
+}
+
+void UsbHotplugMonitor::m_removePollfd(int fd) {
+    // may be called from inside libusb_handle_events(), i.e. while a notifier is emitting
+    QSocketNotifier *notifier = m_readNotifiers.take(fd);
+    if (notifier != nullptr) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+    }
+    notifier = m_writeNotifiers.take(fd);
+    if (notifier != nullptr) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+    }
+}
+
+int LIBUSB_CALL UsbHotplugMonitor::m_hotplugCallback(libusb_context *, libusb_device *device,
+                                                     libusb_hotplug_event event, void *userData) {
+    UsbHotplugMonitor *self = static_cast<UsbHotplugMonitor*>(userData);
+    if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+        emit self->deviceArrived(locationOf(device));
+    } else if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+        emit self->deviceLeft(locationOf(device));
+    }
+    return 0;
+}
+
+void LIBUSB_CALL UsbHotplugMonitor::m_pollfdAdded(int fd, short events, void *userData) {
+    static_cast<UsbHotplugMonitor*>(userData)->m_addPollfd(fd, events);
+}
+
+void LIBUSB_CALL UsbHotplugMonitor::m_pollfdRemoved(int fd, void *userData) {
+    static_cast<UsbHotplugMonitor*>(userData)->m_removePollfd(fd);
+}
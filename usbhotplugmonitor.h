@@ -0,0 +1,84 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef USBHOTPLUGMONITOR_H
+#define USBHOTPLUGMONITOR_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <libusb.h>
+
+/*
+ * Reports arrival and removal of SkyRC B6 chargers. Uses libusb hotplug
+ * callbacks driven from the Qt event loop when the platform supports them and
+ * falls back to listening for kernel uevents on a netlink socket, or to
+ * periodic enumeration as a last resort.
+ *
+ * Chargers are identified by their physical location, "<bus>-<port>[.<port>...]",
+ * which is the same name the kernel gives the device in sysfs.
+ */
+class UsbHotplugMonitor : public QObject {
+    Q_OBJECT
+public:
+    static const uint16_t VENDOR_ID = 0x0000;
+    static const uint16_t PRODUCT_ID = 0x0001;
+
+    explicit UsbHotplugMonitor(QObject *parent = 0);
+    ~UsbHotplugMonitor();
+
+    void start();
+
+    static QString locationOf(libusb_device *dev);
+    static libusb_device *findDevice(libusb_device **list, ssize_t count, const QString &location);
+
+signals:
+    void deviceArrived(QString location);
+    void deviceLeft(QString location);
+
+private slots:
+    void onLibusbActivity();
+    void onNetlinkActivity();
+    void onEnumerate();
+
+private:
+    libusb_context *m_ctx = nullptr;
+    libusb_hotplug_callback_handle m_callback;
+    bool m_callbackRegistered = false;
+    QHash<int, QSocketNotifier*> m_readNotifiers, m_writeNotifiers;
+
+    int m_netlinkFd = -1;
+    QSocketNotifier *m_netlinkNotifier = nullptr;
+
+    QTimer *m_enumerateTimer = nullptr;
+    QSet<QString> m_present;
+
+    bool m_startHotplug();
+    bool m_startNetlink();
+    void m_addPollfd(int fd, short events);
+    void m_removePollfd(int fd);
+
+    static int LIBUSB_CALL m_hotplugCallback(libusb_context *ctx, libusb_device *device,
+                                             libusb_hotplug_event event, void *userData);
+    static void LIBUSB_CALL m_pollfdAdded(int fd, short events, void *userData);
+    static void LIBUSB_CALL m_pollfdRemoved(int fd, void *userData);
+};
+
+#endif // USBHOTPLUGMONITOR_H
@@ -0,0 +1,122 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include "workstealingpool.h"
+
+namespace {
+    thread_local const WorkStealingPool *t_pool = nullptr;
+    thread_local int t_worker = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int threads) : m_queued(0), m_pending(0), m_next(0), m_steals(0) {
+    if (threads <= 0) {
+        threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < threads; i++) {
+        m_queues.emplace_back(new Queue());
+    }
+    for (int i = 0; i < threads; i++) {
+        m_threads.emplace_back(&WorkStealingPool::m_run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    int index = currentWorker();
+    if (index < 0) {
+        index = static_cast<int>(m_next++ % m_queues.size());
+    }
+
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_queued++;
+    // under the lock, so a worker about to sleep either sees the task or gets woken
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_pending == 0; });
+}
+
+int WorkStealingPool::currentWorker() const {
+    return t_pool == this ? t_worker : -1;
+}
+
+void WorkStealingPool::m_run(int index) {
+    t_pool = this;
+    t_worker = index;
+
+    Task task;
+    for (;;) {
+        if (m_take(index, task)) {
+            task();
+            task = nullptr;
+            if (--m_pending == 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]() { return m_queued > 0 || m_stop; });
+        if (m_stop && m_queued == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::m_take(int index, Task &task) {
+    const int count = static_cast<int>(m_queues.size());
+    for (int i = 0; i < count; i++) {
+        Queue &queue = *m_queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        // the owner works at the back and thieves at the front, so they rarely want the same task
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_steals++;
+        }
+        m_queued--;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+/* Copyright © 2018, Maciej Sopyło <me@klh.io>
+ *
+ * This file is part of charge-guru.
+ *
+ *  charge-guru is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  charge-guru is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with charge-guru.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of threads with a task deque each. A worker runs its own tasks
+ * newest first and, when it runs out, steals the oldest task of another
+ * worker, so a few large tasks do not leave the other threads idle. Tasks
+ * submitted from a worker go onto its own deque, the others round robin.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+    // 0 for one thread per core
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return static_cast<int>(m_threads.size()); }
+    void submit(Task task);
+    // until every task submitted so far, and the ones they submitted, has run
+    void wait();
+    // index of the calling thread in the pool, -1 if it is not one of its workers
+    int currentWorker() const;
+    std::size_t steals() const { return m_steals; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::atomic<std::size_t> m_queued;      // in the deques
+    std::atomic<std::size_t> m_pending;     // queued or running
+    std::atomic<std::size_t> m_next;
+    std::atomic<std::size_t> m_steals;
+    bool m_stop = false;
+
+    void m_run(int index);
+    bool m_take(int index, Task &task);
+};
+
+#endif // WORKSTEALINGPOOL_H